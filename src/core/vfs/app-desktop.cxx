@@ -33,6 +33,7 @@
 #include <ztd/ztd.hxx>
 
 #include "vfs/app-desktop.hxx"
+#include "vfs/desktop-index.hxx"
 #include "vfs/error.hxx"
 #include "vfs/execute.hxx"
 #include "vfs/file.hxx"
@@ -52,6 +53,17 @@ static std::flat_map<std::filesystem::path, desktop_cache_data> desktops_cache;
 std::expected<vfs::desktop, std::error_code>
 vfs::desktop::create(const std::filesystem::path& desktop_file) noexcept
 {
+    if (!desktop_file.is_absolute())
+    {
+        // a desktop id, already parsed by the index
+        const auto index = vfs::desktop_index::global();
+        const auto* entry = index->lookup(desktop_file.string());
+        if (entry != nullptr)
+        {
+            return vfs::desktop(*entry);
+        }
+    }
+
     if (desktops_cache.contains(desktop_file))
     {
         // logger::info<logger::vfs>("vfs::desktop({})  cache   {}", logger::utils::ptr(desktop), desktop_file);
@@ -89,6 +101,19 @@ vfs::desktop::desktop(const std::filesystem::path& desktop_file) noexcept
     // logger::info<logger::vfs>("vfs::desktop::desktop({})", logger::utils::ptr(this));
 }
 
+vfs::desktop::desktop(const vfs::desktop_index::entry& entry) noexcept
+    : filename_(entry.id), path_(entry.path)
+{
+    desktop_entry_.type = "Application";
+    desktop_entry_.name = entry.name;
+    desktop_entry_.no_display = entry.no_display;
+    desktop_entry_.icon = entry.icon;
+    desktop_entry_.exec = entry.exec;
+    desktop_entry_.path = entry.working_dir;
+    desktop_entry_.terminal = entry.terminal;
+    desktop_entry_.mime_type = ztd::join(entry.mime_types, ";");
+}
+
 vfs::error_code
 vfs::desktop::parse_desktop_file() noexcept
 {
@@ -30,6 +30,7 @@
 
 #include <ztd/ztd.hxx>
 
+#include "vfs/desktop-index.hxx"
 #include "vfs/error.hxx"
 #include "vfs/file.hxx"
 
@@ -59,6 +60,7 @@ class desktop final
 
   private:
     desktop(const std::filesystem::path& desktop_file) noexcept;
+    desktop(const vfs::desktop_index::entry& entry) noexcept;
     [[nodiscard]] vfs::error_code parse_desktop_file() noexcept;
 
     [[nodiscard]] bool open_multiple_files() const noexcept;
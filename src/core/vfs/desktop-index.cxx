@@ -0,0 +1,387 @@
+/**
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include <cstdint>
+
+#include <glibmm.h>
+
+#include <ztd/ztd.hxx>
+
+#include "vfs/desktop-index.hxx"
+#include "vfs/executor.hxx"
+#include "vfs/user-dirs.hxx"
+
+#include "logger.hxx"
+
+namespace global
+{
+static std::atomic<std::shared_ptr<const vfs::desktop_index>> desktop_index;
+// serializes building and dropping, readers never take it
+static std::mutex desktop_index_load_lock;
+// bumped by reload(), a background build for an older generation is discarded
+static std::uint64_t desktop_index_generation{0};
+} // namespace global
+
+namespace
+{
+struct parsed_entry final
+{
+    vfs::desktop_index::entry entry;
+    bool hidden{false}; // also set for entries that are not Type=Application
+};
+
+[[nodiscard]] std::optional<parsed_entry>
+parse_entry(const std::filesystem::path& path, std::string&& id) noexcept
+{
+    static constexpr auto group = "Desktop Entry";
+
+    const auto kf = Glib::KeyFile::create();
+    try
+    {
+        kf->load_from_file(path, Glib::KeyFile::Flags::NONE);
+    }
+    catch (...) // Glib::KeyFileError, Glib::FileError
+    {
+        return std::nullopt;
+    }
+
+    const auto get_string = [&kf](const char* key) -> std::string
+    {
+        try
+        {
+            if (kf->has_key(group, key))
+            {
+                return kf->get_string(group, key);
+            }
+        }
+        catch (...) // Glib::KeyFileError
+        {
+        }
+        return {};
+    };
+    const auto get_boolean = [&kf](const char* key) -> bool
+    {
+        try
+        {
+            return kf->has_key(group, key) && kf->get_boolean(group, key);
+        }
+        catch (...) // Glib::KeyFileError
+        {
+            return false;
+        }
+    };
+
+    parsed_entry parsed;
+    parsed.entry.id = std::move(id);
+    parsed.entry.path = path;
+    parsed.hidden = get_boolean("Hidden") || get_string("Type") != "Application";
+    if (parsed.hidden)
+    {
+        return parsed;
+    }
+
+    try
+    {
+        if (kf->has_key(group, "Name"))
+        {
+            parsed.entry.name = kf->get_locale_string(group, "Name");
+        }
+    }
+    catch (...) // Glib::KeyFileError
+    {
+    }
+    if (parsed.entry.name.empty())
+    {
+        // Name is required
+        return std::nullopt;
+    }
+
+    parsed.entry.exec = get_string("Exec");
+    parsed.entry.icon = get_string("Icon");
+    parsed.entry.working_dir = get_string("Path");
+    parsed.entry.terminal = get_boolean("Terminal");
+    parsed.entry.no_display = get_boolean("NoDisplay");
+    for (const auto& type : ztd::split(get_string("MimeType"), ";"))
+    {
+        if (!type.empty())
+        {
+            parsed.entry.mime_types.push_back(type);
+        }
+    }
+
+    return parsed;
+}
+
+/**
+ * Parse every desktop file below dir, subdirs are part of the desktop id.
+ */
+[[nodiscard]] std::vector<parsed_entry>
+scan_dir(const std::filesystem::path& dir) noexcept
+{
+    std::vector<parsed_entry> parsed;
+
+    std::error_code ec;
+    auto it = std::filesystem::recursive_directory_iterator(
+        dir,
+        std::filesystem::directory_options::skip_permission_denied,
+        ec);
+    if (ec)
+    {
+        return parsed;
+    }
+
+    for (; it != std::filesystem::recursive_directory_iterator(); it.increment(ec))
+    {
+        if (ec)
+        {
+            break;
+        }
+
+        const auto& path = it->path();
+        if (path.extension() != ".desktop" || !it->is_regular_file(ec))
+        {
+            continue;
+        }
+
+        auto id = ztd::replace(path.lexically_relative(dir).string(), "/", "-");
+        auto entry = parse_entry(path, std::move(id));
+        if (entry)
+        {
+            parsed.push_back(std::move(*entry));
+        }
+    }
+
+    return parsed;
+}
+
+/**
+ * @param[in] scanned the result of scan_dir() for each dir, in order of precedence
+ *
+ * @return the visible entries, sorted by name
+ */
+[[nodiscard]] std::vector<vfs::desktop_index::entry>
+merge(std::vector<std::vector<parsed_entry>>&& scanned) noexcept
+{
+    std::vector<vfs::desktop_index::entry> entries;
+
+    std::unordered_set<std::string> seen;
+    for (auto& dir : scanned)
+    {
+        for (auto& parsed : dir)
+        {
+            if (!seen.insert(parsed.entry.id).second || parsed.hidden)
+            {
+                continue;
+            }
+            entries.push_back(std::move(parsed.entry));
+        }
+    }
+
+    std::ranges::sort(entries,
+                      [](const auto& a, const auto& b)
+                      {
+                          const auto fold = [](const char c)
+                          { return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c; };
+                          if (std::ranges::equal(a.name, b.name, {}, fold, fold))
+                          {
+                              return a.id < b.id;
+                          }
+                          return std::ranges::lexicographical_compare(a.name, b.name, {}, fold, fold);
+                      });
+
+    return entries;
+}
+} // namespace
+
+vfs::desktop_index::desktop_index(std::vector<entry>&& entries) noexcept
+    : entries_(std::move(entries))
+{
+    // entries_ does not change from here on
+    for (const auto& entry : entries_)
+    {
+        ids_.insert({entry.id, &entry});
+        for (const auto& type : entry.mime_types)
+        {
+            types_[type].push_back(&entry);
+        }
+    }
+}
+
+vfs::desktop_index
+vfs::desktop_index::create(const std::span<const std::filesystem::path> dirs) noexcept
+{
+    std::vector<std::vector<parsed_entry>> scanned(dirs.size());
+    {
+        vfs::task_group tasks;
+        for (std::size_t i = 0; i < dirs.size(); ++i)
+        {
+            tasks.submit([&scanned, &dirs, i](const std::stop_token&)
+                         { scanned[i] = scan_dir(dirs[i]); });
+        }
+        tasks.wait();
+    }
+    return vfs::desktop_index(merge(std::move(scanned)));
+}
+
+std::vector<std::filesystem::path>
+vfs::desktop_index::dirs() noexcept
+{
+    std::vector<std::filesystem::path> dirs;
+    dirs.push_back(vfs::user::data() / "applications");
+    for (const std::filesystem::path sys_dir : Glib::get_system_data_dirs())
+    {
+        dirs.push_back(sys_dir / "applications");
+    }
+    return dirs;
+}
+
+std::shared_ptr<const vfs::desktop_index>
+vfs::desktop_index::global() noexcept
+{
+    auto index = global::desktop_index.load(std::memory_order_acquire);
+    if (index)
+    {
+        return index;
+    }
+
+    std::scoped_lock lock(global::desktop_index_load_lock);
+
+    index = global::desktop_index.load(std::memory_order_acquire);
+    if (index)
+    {
+        return index;
+    }
+
+    index = std::make_shared<const vfs::desktop_index>(create(dirs()));
+
+    logger::debug<logger::vfs>("desktop index built, {} applications", index->size());
+
+    global::desktop_index.store(index, std::memory_order_release);
+    return index;
+}
+
+void
+vfs::desktop_index::preload() noexcept
+{
+    struct build final
+    {
+        std::vector<std::filesystem::path> dirs;
+        std::vector<std::vector<parsed_entry>> scanned;
+        std::atomic<std::size_t> remaining;
+        std::uint64_t generation;
+    };
+
+    auto state = std::make_shared<build>();
+    state->dirs = dirs();
+    state->scanned.resize(state->dirs.size());
+    state->remaining = state->dirs.size();
+    {
+        std::scoped_lock lock(global::desktop_index_load_lock);
+        if (global::desktop_index.load(std::memory_order_acquire))
+        {
+            return;
+        }
+        state->generation = global::desktop_index_generation;
+    }
+
+    for (std::size_t i = 0; i < state->dirs.size(); ++i)
+    {
+        vfs::executor::global().submit(
+            [state, i]
+            {
+                state->scanned[i] = scan_dir(state->dirs[i]);
+                if (state->remaining.fetch_sub(1, std::memory_order_acq_rel) != 1)
+                {
+                    return;
+                }
+
+                // the last dir to finish publishes the index
+                auto index = std::make_shared<const vfs::desktop_index>(
+                    vfs::desktop_index(merge(std::move(state->scanned))));
+
+                std::scoped_lock lock(global::desktop_index_load_lock);
+                if (state->generation != global::desktop_index_generation ||
+                    global::desktop_index.load(std::memory_order_acquire))
+                {
+                    // reloaded while building, or global() built it first
+                    return;
+                }
+
+                logger::debug<logger::vfs>("desktop index built, {} applications",
+                                           index->size());
+
+                global::desktop_index.store(index, std::memory_order_release);
+            });
+    }
+}
+
+void
+vfs::desktop_index::reload() noexcept
+{
+    {
+        std::scoped_lock lock(global::desktop_index_load_lock);
+        global::desktop_index_generation += 1;
+        global::desktop_index.store(nullptr, std::memory_order_release);
+    }
+    preload();
+}
+
+const vfs::desktop_index::entry*
+vfs::desktop_index::lookup(const std::string_view id) const noexcept
+{
+    const auto it = ids_.find(id);
+    if (it == ids_.cend())
+    {
+        return nullptr;
+    }
+    return it->second;
+}
+
+std::span<const vfs::desktop_index::entry* const>
+vfs::desktop_index::lookup_type(const std::string_view type) const noexcept
+{
+    const auto it = types_.find(type);
+    if (it == types_.cend())
+    {
+        return {};
+    }
+    return it->second;
+}
+
+std::span<const vfs::desktop_index::entry>
+vfs::desktop_index::entries() const noexcept
+{
+    return entries_;
+}
+
+std::size_t
+vfs::desktop_index::size() const noexcept
+{
+    return entries_.size();
+}
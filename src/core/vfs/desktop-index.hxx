@@ -0,0 +1,126 @@
+/**
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <cstddef>
+
+namespace vfs
+{
+/**
+ * Every installed application, parsed once from the desktop files in the
+ * applications dir of $XDG_DATA_HOME and $XDG_DATA_DIRS.
+ *
+ * https://specifications.freedesktop.org/desktop-entry-spec/desktop-entry-spec-latest.html
+ *
+ * The desktop id of a file is its path relative to the applications dir with
+ * '/' replaced by '-', the first dir that has an id wins. An entry with
+ * Hidden=true hides the id in every less important dir. Only entries of
+ * Type=Application are kept.
+ *
+ * The dirs are scanned in parallel on the vfs::executor. vfs::mime_monitor
+ * calls reload() when a desktop file changes.
+ */
+class desktop_index final
+{
+  public:
+    struct entry final
+    {
+        std::string id;
+        std::filesystem::path path;
+        std::string name;
+        std::string exec;
+        std::string icon;
+        std::string working_dir;
+        std::vector<std::string> mime_types;
+        bool terminal{false};
+        bool no_display{false};
+    };
+
+    desktop_index(const desktop_index& other) = delete;
+    desktop_index(desktop_index&& other) noexcept = default;
+    desktop_index& operator=(const desktop_index& other) = delete;
+    desktop_index& operator=(desktop_index&& other) noexcept = default;
+
+    /**
+     * @param[in] dirs applications dirs, in order of precedence
+     */
+    [[nodiscard]] static desktop_index create(const std::span<const std::filesystem::path> dirs) noexcept;
+
+    /**
+     * $XDG_DATA_HOME/applications and $XDG_DATA_DIRS/applications
+     */
+    [[nodiscard]] static std::vector<std::filesystem::path> dirs() noexcept;
+
+    /**
+     * The process wide index, built by the caller if preload() has not finished.
+     */
+    [[nodiscard]] static std::shared_ptr<const desktop_index> global() noexcept;
+
+    /**
+     * Build the process wide index on the vfs::executor.
+     */
+    static void preload() noexcept;
+
+    /**
+     * Drop the process wide index and build it again in the background,
+     * called by vfs::mime_monitor.
+     */
+    static void reload() noexcept;
+
+    [[nodiscard]] const entry* lookup(const std::string_view id) const noexcept;
+
+    /**
+     * Entries whose MimeType key lists type.
+     */
+    [[nodiscard]] std::span<const entry* const> lookup_type(const std::string_view type) const noexcept;
+
+    /**
+     * Every entry, sorted by name.
+     */
+    [[nodiscard]] std::span<const entry> entries() const noexcept;
+
+    [[nodiscard]] std::size_t size() const noexcept;
+
+  private:
+    explicit desktop_index(std::vector<entry>&& entries) noexcept;
+
+    struct string_hash final
+    {
+        using is_transparent = void;
+
+        [[nodiscard]] std::size_t
+        operator()(const std::string_view str) const noexcept
+        {
+            return std::hash<std::string_view>{}(str);
+        }
+    };
+
+    // entries_ is never modified after create(), the maps point into it
+    std::vector<entry> entries_;
+    std::unordered_map<std::string_view, const entry*, string_hash, std::equal_to<>> ids_;
+    std::unordered_map<std::string_view, std::vector<const entry*>, string_hash, std::equal_to<>>
+        types_;
+};
+} // namespace vfs
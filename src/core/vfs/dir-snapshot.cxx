@@ -0,0 +1,463 @@
+/**
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <expected>
+#include <filesystem>
+#include <format>
+#include <limits>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "vfs/dir-snapshot.hxx"
+#include "vfs/file.hxx"
+#include "vfs/user-dirs.hxx"
+
+#include "vfs/linux/statx.hxx"
+#include "vfs/utils/file-ops.hxx"
+
+#include "logger.hxx"
+
+namespace global
+{
+static std::atomic_bool snapshots_enabled{false};
+static std::atomic_bool snapshots_pruned{false};
+}
+
+namespace
+{
+// native byte order, snapshots are never shared between machines
+constexpr std::array<char, 8> MAGIC{'S', 'F', 'M', 'S', 'N', 'A', 'P', '\0'};
+constexpr std::uint32_t VERSION = 1;
+
+struct header final
+{
+    std::array<char, 8> magic;
+    std::uint32_t version;
+    std::uint32_t count;
+    std::uint64_t hidden;
+    std::uint64_t dev;
+    std::uint64_t ino;
+    struct statx_timestamp mtime;
+    struct statx_timestamp ctime;
+    std::uint32_t path_offset; // offsets are into the string table
+    std::uint32_t path_size;
+    std::uint64_t strings_size;
+};
+
+struct record final
+{
+    std::uint32_t name_offset;
+    std::uint32_t name_size;
+    std::uint32_t mime_offset;
+    std::uint32_t mime_size;
+
+    std::uint32_t mask;
+    std::uint32_t blksize;
+    std::uint64_t attributes;
+    std::uint64_t attributes_mask;
+    std::uint32_t nlink;
+    std::uint32_t uid;
+    std::uint32_t gid;
+    std::uint16_t mode;
+    std::uint16_t pad;
+    std::uint64_t ino;
+    std::uint64_t size;
+    std::uint64_t blocks;
+    struct statx_timestamp atime;
+    struct statx_timestamp btime;
+    struct statx_timestamp ctime;
+    struct statx_timestamp mtime;
+    std::uint32_t rdev_major;
+    std::uint32_t rdev_minor;
+    std::uint32_t dev_major;
+    std::uint32_t dev_minor;
+};
+
+static_assert(std::is_trivially_copyable_v<header>);
+static_assert(std::is_trivially_copyable_v<record>);
+
+[[nodiscard]] bool
+same_time(const struct statx_timestamp& a, const struct statx_timestamp& b) noexcept
+{
+    return a.tv_sec == b.tv_sec && a.tv_nsec == b.tv_nsec;
+}
+
+[[nodiscard]] record
+make_record(const struct ::statx& stat) noexcept
+{
+    return record{
+        .name_offset = 0,
+        .name_size = 0,
+        .mime_offset = 0,
+        .mime_size = 0,
+        .mask = stat.stx_mask,
+        .blksize = stat.stx_blksize,
+        .attributes = stat.stx_attributes,
+        .attributes_mask = stat.stx_attributes_mask,
+        .nlink = stat.stx_nlink,
+        .uid = stat.stx_uid,
+        .gid = stat.stx_gid,
+        .mode = stat.stx_mode,
+        .pad = 0,
+        .ino = stat.stx_ino,
+        .size = stat.stx_size,
+        .blocks = stat.stx_blocks,
+        .atime = stat.stx_atime,
+        .btime = stat.stx_btime,
+        .ctime = stat.stx_ctime,
+        .mtime = stat.stx_mtime,
+        .rdev_major = stat.stx_rdev_major,
+        .rdev_minor = stat.stx_rdev_minor,
+        .dev_major = stat.stx_dev_major,
+        .dev_minor = stat.stx_dev_minor,
+    };
+}
+
+[[nodiscard]] struct ::statx
+make_statx(const record& record) noexcept
+{
+    struct ::statx stat{};
+    stat.stx_mask = record.mask;
+    stat.stx_blksize = record.blksize;
+    stat.stx_attributes = record.attributes;
+    stat.stx_attributes_mask = record.attributes_mask;
+    stat.stx_nlink = record.nlink;
+    stat.stx_uid = record.uid;
+    stat.stx_gid = record.gid;
+    stat.stx_mode = record.mode;
+    stat.stx_ino = record.ino;
+    stat.stx_size = record.size;
+    stat.stx_blocks = record.blocks;
+    stat.stx_atime = record.atime;
+    stat.stx_btime = record.btime;
+    stat.stx_ctime = record.ctime;
+    stat.stx_mtime = record.mtime;
+    stat.stx_rdev_major = record.rdev_major;
+    stat.stx_rdev_minor = record.rdev_minor;
+    stat.stx_dev_major = record.dev_major;
+    stat.stx_dev_minor = record.dev_minor;
+    return stat;
+}
+} // namespace
+
+vfs::dir_snapshot::dir_snapshot(void* data, const std::size_t size) noexcept
+    : data_(data), size_(size)
+{
+}
+
+vfs::dir_snapshot::~dir_snapshot() noexcept
+{
+    if (data_ != nullptr)
+    {
+        munmap(data_, size_);
+    }
+}
+
+vfs::dir_snapshot::dir_snapshot(dir_snapshot&& other) noexcept
+    : data_(std::exchange(other.data_, nullptr)), size_(std::exchange(other.size_, 0))
+{
+}
+
+vfs::dir_snapshot&
+vfs::dir_snapshot::operator=(dir_snapshot&& other) noexcept
+{
+    if (this != &other)
+    {
+        if (data_ != nullptr)
+        {
+            munmap(data_, size_);
+        }
+        data_ = std::exchange(other.data_, nullptr);
+        size_ = std::exchange(other.size_, 0);
+    }
+    return *this;
+}
+
+void
+vfs::dir_snapshot::enable(const bool enabled) noexcept
+{
+    global::snapshots_enabled = enabled;
+}
+
+bool
+vfs::dir_snapshot::is_enabled() noexcept
+{
+    return global::snapshots_enabled;
+}
+
+std::filesystem::path
+vfs::dir_snapshot::snapshot_dir() noexcept
+{
+    return vfs::user::cache() / PACKAGE_NAME / "snapshots";
+}
+
+std::filesystem::path
+vfs::dir_snapshot::snapshot_path(const vfs::linux::statx& stat) noexcept
+{
+    return snapshot_dir() / std::format("{:x}-{:x}", stat.dev().data(), stat.ino().data());
+}
+
+std::expected<vfs::dir_snapshot, std::error_code>
+vfs::dir_snapshot::open(const std::filesystem::path& path, const vfs::linux::statx& stat) noexcept
+{
+    const auto fd = ::open(snapshot_path(stat).c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1)
+    {
+        return std::unexpected(std::error_code(errno, std::generic_category()));
+    }
+
+    struct stat st{};
+    if (fstat(fd, &st) == -1 || std::cmp_less(st.st_size, sizeof(header)))
+    {
+        close(fd);
+        return std::unexpected(std::make_error_code(std::errc::invalid_argument));
+    }
+
+    const auto size = static_cast<std::size_t>(st.st_size);
+    auto* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+    {
+        return std::unexpected(std::error_code(errno, std::generic_category()));
+    }
+
+    auto snapshot = dir_snapshot(data, size);
+
+    const auto* hdr = static_cast<const header*>(data);
+    const auto& dir = stat.data();
+
+    const auto records_size = std::size_t(hdr->count) * sizeof(record);
+    if (hdr->magic != MAGIC || hdr->version != VERSION || hdr->dev != stat.dev().data() ||
+        hdr->ino != stat.ino().data() || !same_time(hdr->mtime, dir.stx_mtime) ||
+        !same_time(hdr->ctime, dir.stx_ctime) ||
+        size != sizeof(header) + records_size + hdr->strings_size ||
+        std::size_t(hdr->path_offset) + hdr->path_size > hdr->strings_size)
+    {
+        return std::unexpected(std::make_error_code(std::errc::invalid_argument));
+    }
+
+    const auto* strings = static_cast<const char*>(data) + sizeof(header) + records_size;
+    if (std::string_view(strings + hdr->path_offset, hdr->path_size) != path.native())
+    {
+        return std::unexpected(std::make_error_code(std::errc::invalid_argument));
+    }
+
+    const auto* records =
+        reinterpret_cast<const record*>(static_cast<const char*>(data) + sizeof(header));
+    for (const auto& r : std::span(records, hdr->count))
+    {
+        if (std::size_t(r.name_offset) + r.name_size > hdr->strings_size ||
+            std::size_t(r.mime_offset) + r.mime_size > hdr->strings_size)
+        {
+            return std::unexpected(std::make_error_code(std::errc::invalid_argument));
+        }
+    }
+
+    return snapshot;
+}
+
+void
+vfs::dir_snapshot::save(const std::filesystem::path& path, const vfs::linux::statx& stat,
+                        const std::span<const std::shared_ptr<vfs::file>> files,
+                        const std::uint64_t hidden) noexcept
+{
+    std::string strings;
+    std::vector<record> records;
+    records.reserve(files.size());
+
+    const auto add_string = [&strings](const std::string_view str)
+    {
+        const auto offset = strings.size();
+        strings.append(str);
+        return static_cast<std::uint32_t>(offset);
+    };
+
+    // only a few distinct mime types, store each once
+    std::unordered_map<std::string_view, std::uint32_t> mime_offsets;
+
+    const auto path_offset = add_string(path.native());
+    for (const auto& file : files)
+    {
+        const auto mime = file->mime_type()->type();
+        auto it = mime_offsets.find(mime);
+        if (it == mime_offsets.cend())
+        {
+            it = mime_offsets.insert({mime, add_string(mime)}).first;
+        }
+
+        auto r = make_record(file->stat().data());
+        r.name_offset = add_string(file->name());
+        r.name_size = static_cast<std::uint32_t>(file->name().size());
+        r.mime_offset = it->second;
+        r.mime_size = static_cast<std::uint32_t>(mime.size());
+        records.push_back(r);
+    }
+
+    if (strings.size() > std::numeric_limits<std::uint32_t>::max())
+    {
+        return;
+    }
+
+    const auto hdr = header{
+        .magic = MAGIC,
+        .version = VERSION,
+        .count = static_cast<std::uint32_t>(records.size()),
+        .hidden = hidden,
+        .dev = stat.dev().data(),
+        .ino = stat.ino().data(),
+        .mtime = stat.data().stx_mtime,
+        .ctime = stat.data().stx_ctime,
+        .path_offset = path_offset,
+        .path_size = static_cast<std::uint32_t>(path.native().size()),
+        .strings_size = strings.size(),
+    };
+
+    if (!global::snapshots_pruned.exchange(true))
+    {
+        prune();
+    }
+
+    std::string buffer;
+    buffer.reserve(sizeof(header) + (records.size() * sizeof(record)) + strings.size());
+    buffer.append(reinterpret_cast<const char*>(&hdr), sizeof(hdr));
+    buffer.append(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(record));
+    buffer.append(strings);
+
+    const auto snapshot = snapshot_path(stat);
+
+    std::error_code ec;
+    std::filesystem::create_directories(snapshot.parent_path(), ec);
+
+    // write then rename so a reader never maps a partial snapshot
+    const auto tmp = std::filesystem::path(std::format("{}.{}", snapshot.string(), getpid()));
+    if (vfs::utils::write_file(tmp, buffer))
+    {
+        logger::warn<logger::vfs>("Failed to write directory snapshot: {}", tmp);
+        std::filesystem::remove(tmp, ec);
+        return;
+    }
+    std::filesystem::rename(tmp, snapshot, ec);
+    if (ec)
+    {
+        logger::warn<logger::vfs>("Failed to save directory snapshot: {} {}",
+                                  snapshot,
+                                  ec.message());
+        std::filesystem::remove(tmp, ec);
+    }
+}
+
+void
+vfs::dir_snapshot::remove(const vfs::linux::statx& stat) noexcept
+{
+    std::error_code ec;
+    std::filesystem::remove(snapshot_path(stat), ec);
+}
+
+void
+vfs::dir_snapshot::prune() noexcept
+{
+    struct saved final
+    {
+        std::filesystem::path path;
+        std::filesystem::file_time_type mtime;
+        std::uintmax_t size;
+    };
+    std::vector<saved> snapshots;
+
+    // the temporary files of a save that did not finish are aged out the same way
+    const auto now = std::filesystem::file_time_type::clock::now();
+    std::error_code ec;
+    for (const auto& dfile : std::filesystem::directory_iterator(snapshot_dir(), ec))
+    {
+        const auto mtime = dfile.last_write_time(ec);
+        if (ec)
+        {
+            continue;
+        }
+        const auto size = dfile.file_size(ec);
+        if (ec)
+        {
+            continue;
+        }
+
+        if (now - mtime > MAX_AGE)
+        {
+            std::filesystem::remove(dfile.path(), ec);
+            continue;
+        }
+        snapshots.push_back({dfile.path(), mtime, size});
+    }
+
+    // newest first, a snapshot is rewritten whenever its directory changed
+    std::ranges::sort(snapshots, std::ranges::greater{}, &saved::mtime);
+
+    std::uintmax_t total = 0;
+    for (const auto& snapshot : snapshots)
+    {
+        total += snapshot.size;
+        if (total > MAX_SIZE)
+        {
+            std::filesystem::remove(snapshot.path, ec);
+        }
+    }
+}
+
+std::size_t
+vfs::dir_snapshot::size() const noexcept
+{
+    return static_cast<const header*>(data_)->count;
+}
+
+std::uint64_t
+vfs::dir_snapshot::hidden() const noexcept
+{
+    return static_cast<const header*>(data_)->hidden;
+}
+
+vfs::dir_snapshot::entry
+vfs::dir_snapshot::at(const std::size_t index) const noexcept
+{
+    const auto* hdr = static_cast<const header*>(data_);
+    const auto* base = static_cast<const char*>(data_) + sizeof(header);
+    const auto* strings = base + (std::size_t(hdr->count) * sizeof(record));
+
+    const auto& r = reinterpret_cast<const record*>(base)[index];
+
+    return entry{
+        .name = std::string_view(strings + r.name_offset, r.name_size),
+        .mime_type = std::string_view(strings + r.mime_offset, r.mime_size),
+        .stat = vfs::linux::statx(make_statx(r)),
+    };
+}
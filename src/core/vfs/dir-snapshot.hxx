@@ -0,0 +1,115 @@
+/**
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <expected>
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <string_view>
+#include <system_error>
+
+#include <cstddef>
+#include <cstdint>
+
+#include "vfs/file.hxx"
+
+#include "vfs/linux/statx.hxx"
+
+namespace vfs
+{
+/**
+ * On disk snapshot of a directory listing, stored in
+ * vfs::user::cache()/PACKAGE_NAME/snapshots and read back using mmap(2).
+ *
+ * A snapshot holds the filename, the statx fields used by vfs::file and the
+ * resolved mime type of every file. It is keyed by the directory's device
+ * and inode and only valid while the directory's mtime and ctime are the
+ * same as when it was saved, which covers every added, removed or renamed
+ * entry. Changes to the files themselves are not covered, so a directory
+ * loaded from a snapshot still has to be refreshed against the disk.
+ */
+class dir_snapshot final
+{
+  public:
+    struct entry final
+    {
+        std::string_view name;
+        std::string_view mime_type;
+        vfs::linux::statx stat;
+    };
+
+    dir_snapshot() = delete;
+    ~dir_snapshot() noexcept;
+    dir_snapshot(const dir_snapshot& other) = delete;
+    dir_snapshot(dir_snapshot&& other) noexcept;
+    dir_snapshot& operator=(const dir_snapshot& other) = delete;
+    dir_snapshot& operator=(dir_snapshot&& other) noexcept;
+
+    /**
+     * @param[in] path directory path
+     * @param[in] stat current statx of the directory
+     *
+     * @return the snapshot if one exists and is still valid for stat
+     */
+    [[nodiscard]] static std::expected<dir_snapshot, std::error_code>
+    open(const std::filesystem::path& path, const vfs::linux::statx& stat) noexcept;
+
+    /**
+     * @param[in] path directory path
+     * @param[in] stat statx of the directory taken before files were read
+     * @param[in] files every file in the directory that is not user hidden
+     * @param[in] hidden number of user hidden files
+     */
+    static void save(const std::filesystem::path& path, const vfs::linux::statx& stat,
+                     const std::span<const std::shared_ptr<vfs::file>> files,
+                     const std::uint64_t hidden) noexcept;
+
+    /**
+     * Remove the snapshot for the directory, if there is one.
+     */
+    static void remove(const vfs::linux::statx& stat) noexcept;
+
+    /**
+     * Remove the snapshots not saved within MAX_AGE, then the oldest ones
+     * until the rest fit in MAX_SIZE. Run by the first save() of a session.
+     */
+    static void prune() noexcept;
+
+    static constexpr std::chrono::days MAX_AGE{30};
+    static constexpr std::uintmax_t MAX_SIZE{64 * 1024 * 1024};
+
+    static void enable(const bool enabled) noexcept;
+    [[nodiscard]] static bool is_enabled() noexcept;
+
+    [[nodiscard]] std::size_t size() const noexcept;
+    [[nodiscard]] entry at(const std::size_t index) const noexcept;
+
+    // number of user hidden files when the snapshot was saved
+    [[nodiscard]] std::uint64_t hidden() const noexcept;
+
+  private:
+    dir_snapshot(void* data, const std::size_t size) noexcept;
+
+    [[nodiscard]] static std::filesystem::path snapshot_dir() noexcept;
+    [[nodiscard]] static std::filesystem::path
+    snapshot_path(const vfs::linux::statx& stat) noexcept;
+
+    void* data_{nullptr};
+    std::size_t size_{0};
+};
+} // namespace vfs
@@ -20,21 +20,27 @@
 #include <memory>
 #include <mutex>
 #include <optional>
+#include <span>
 #include <stop_token>
+#include <string>
 #include <vector>
 
-#include <pthread.h>
-
 #include <glibmm.h>
 #include <gtkmm.h>
 
 #include <ztd/ztd.hxx>
 
+#include "vfs/dir-snapshot.hxx"
 #include "vfs/dir.hxx"
+#include "vfs/executor.hxx"
 #include "vfs/file.hxx"
-#include "vfs/thumbnailer.hxx"
 #include "vfs/volume-manager.hxx"
 
+#include "vfs/linux/dir-scanner.hxx"
+#include "vfs/linux/statx.hxx"
+
+#include "vfs/thumbnails/thumbnails.hxx"
+
 #include "vfs/utils/file-ops.hxx"
 
 #include "logger.hxx"
@@ -64,42 +70,36 @@ vfs::dir::dir(const std::filesystem::path& path) noexcept
     // delete events
     notifier_.signal_delete().connect([this](const auto& p) { on_file_deleted(p); });
     notifier_.signal_moved_from().connect([this](const auto& p) { on_file_deleted(p); });
+    // rename events
+    notifier_.signal_rename().connect([this](const auto& from, const auto& to)
+                                      { on_file_renamed(from, to); });
     // modify events
     notifier_.signal_modify().connect([this](const auto& p) { on_file_changed(p); });
     notifier_.signal_attrib().connect([this](const auto& p) { on_file_changed(p); });
     // self event
     notifier_.signal_delete_self().connect([this](const auto& p) { on_self_deleted(p); });
     notifier_.signal_umount().connect([this](const auto& p) { on_self_deleted(p); });
+    // lost events
+    notifier_.signal_queue_overflow().connect([this](const auto&) { on_queue_overflow(); });
 
-    notifier_thread_ =
-        std::jthread([this](const std::stop_token& stoken) { notifier_.run(stoken); });
-    pthread_setname_np(notifier_thread_.native_handle(), "notifier");
-
-    thumbnailer_.signal_thumbnail_created().connect([this](auto f)
-                                                    { signal_thumbnail_loaded().emit(f); });
-
-    thumbnailer_thread_ =
-        std::jthread([this](const std::stop_token& stoken) { thumbnailer_.run(stoken); });
-    pthread_setname_np(thumbnailer_thread_.native_handle(), "thumbnailer");
+    notifier_.start();
 
     update_avoid_changes();
 
-    loader_thread_ = std::jthread([this](const std::stop_token& stoken) { load_thread(stoken); });
-    pthread_setname_np(loader_thread_.native_handle(), "loader");
+    loader_.submit([this](const std::stop_token& stoken) { load_thread(stoken); });
 }
 
 vfs::dir::~dir() noexcept
 {
     // logger::debug<logger::vfs>("vfs::dir::~dir({})  {}", logger::utils::ptr(this), path_);
 
-    thumbnailer_thread_.request_stop();
-    thumbnailer_thread_.join();
+    notifier_.stop();
 
-    notifier_thread_.request_stop();
-    notifier_thread_.join();
+    sniffer_.stop();
 
-    loader_thread_.request_stop();
-    loader_thread_.join();
+    // a running load or refresh can not queue another one
+    loader_.shutdown();
+    loader_.wait();
 }
 
 std::shared_ptr<vfs::dir>
@@ -138,7 +138,7 @@ std::vector<std::shared_ptr<vfs::file>>
 vfs::dir::files() noexcept
 {
     std::scoped_lock files_lock(files_lock_);
-    return files_;
+    return files_.files();
 }
 
 bool
@@ -204,11 +204,7 @@ vfs::dir::is_file_user_hidden(const std::filesystem::path& path) const noexcept
         return false;
     }
 
-    const auto filename = path.filename();
-
-    return std::ranges::any_of(*user_hidden_files_,
-                               [&filename](const auto& hide_filename)
-                               { return filename == hide_filename; });
+    return user_hidden_files_->contains(path.filename());
 }
 
 void
@@ -224,33 +220,159 @@ vfs::dir::load_thread(const std::stop_token& stoken) noexcept
     // load this dirs .hidden file
     load_user_hidden_files();
 
-    std::vector<std::shared_ptr<vfs::file>> files;
-    files.reserve(4096);
+    // taken before reading the directory, so a snapshot saved after the
+    // load is invalidated by any change made while loading
+    std::optional<vfs::linux::statx> dir_stat;
+    if (vfs::dir_snapshot::is_enabled())
+    {
+        const auto stat = vfs::linux::statx::create(path_);
+        if (stat)
+        {
+            dir_stat = *stat;
+        }
+    }
 
-    for (const auto& dfile : std::filesystem::directory_iterator(path_))
+    std::vector<std::shared_ptr<vfs::file>> chunk;
+    chunk.reserve(LOAD_CHUNK_SIZE);
+    auto last_publish = std::chrono::steady_clock::now();
+
+    const auto publish_chunk = [this, &chunk, &last_publish]()
     {
-        if (stoken.stop_requested())
+        std::size_t offset = 0;
         {
-            return;
+            std::scoped_lock files_lock(files_lock_);
+            // nothing is erased while loading, so the table has no free
+            // slots and the next file goes to the end of files()
+            offset = files_.size();
+            append_files_locked(chunk);
         }
 
-        if (is_file_user_hidden(dfile.path()))
+        signal_files_loaded().emit(offset, std::move(chunk));
+
+        chunk = {};
+        chunk.reserve(LOAD_CHUNK_SIZE);
+        last_publish = std::chrono::steady_clock::now();
+    };
+
+    if (dir_stat)
+    {
+        const auto snapshot = vfs::dir_snapshot::open(path_, *dir_stat);
+        if (snapshot)
         {
-            xhidden_count_ += 1;
-            continue;
+            xhidden_count_ = u64(snapshot->hidden());
+
+            for (std::size_t i = 0; i < snapshot->size(); ++i)
+            {
+                if (stoken.stop_requested())
+                {
+                    return;
+                }
+
+                const auto entry = snapshot->at(i);
+                chunk.push_back(
+                    vfs::file::create(path_ / entry.name,
+                                      entry.stat,
+                                      vfs::mime_type::create_from_type(entry.mime_type)));
+
+                if (chunk.size() >= LOAD_CHUNK_SIZE)
+                {
+                    publish_chunk();
+                }
+            }
+
+            if (!chunk.empty())
+            {
+                publish_chunk();
+            }
+
+            load_running_ = false;
+            initial_load_running_ = false;
+
+            signal_directory_loaded().emit();
+
+            // the snapshot does not cover changes to the files themselves
+            if (!stoken.stop_requested())
+            {
+                loader_.submit([this](const std::stop_token& token) { refresh_thread(token); });
+            }
+            return;
         }
+    }
+
+    auto scanner = vfs::linux::dir_scanner::create(path_);
+    if (!scanner)
+    {
+        logger::error<logger::vfs>("Failed to open directory: {} {}",
+                                   path_,
+                                   scanner.error().message());
+
+        load_running_ = false;
+        initial_load_running_ = false;
 
-        files.push_back(vfs::file::create(dfile.path()));
+        signal_directory_loaded().emit();
+        return;
     }
 
+    std::vector<vfs::linux::dir_scanner::entry> entries;
+    entries.reserve(4096);
+
+    while (scanner->next(entries) != 0)
     {
-        std::scoped_lock files_lock(files_lock_);
-        files_ = std::move(files);
+        for (const auto& entry : entries)
+        {
+            if (stoken.stop_requested())
+            {
+                return;
+            }
+
+            if (is_file_user_hidden(entry.name))
+            {
+                xhidden_count_ += 1;
+                continue;
+            }
+
+            chunk.push_back(vfs::file::create(path_ / entry.name, entry.stat));
+
+            if (chunk.size() >= LOAD_CHUNK_SIZE ||
+                std::chrono::steady_clock::now() - last_publish >= LOAD_CHUNK_INTERVAL)
+            {
+                publish_chunk();
+            }
+        }
+        entries.clear();
+    }
+
+    if (!chunk.empty())
+    {
+        publish_chunk();
     }
 
     load_running_ = false;
+    initial_load_running_ = false;
 
     signal_directory_loaded().emit();
+
+    // events were lost while loading
+    if (rescan_pending_ && !stoken.stop_requested())
+    {
+        loader_.submit([this](const std::stop_token& token) { refresh_thread(token); });
+    }
+
+    if (dir_stat)
+    {
+        std::vector<std::shared_ptr<vfs::file>> files;
+        {
+            std::scoped_lock files_lock(files_lock_);
+            if (files_.size() >= SNAPSHOT_MIN_FILES)
+            {
+                files = files_.files();
+            }
+        }
+        if (!files.empty())
+        {
+            vfs::dir_snapshot::save(path_, *dir_stat, files, xhidden_count_.data());
+        }
+    }
 }
 
 void
@@ -258,12 +380,10 @@ vfs::dir::refresh() noexcept
 {
     if (!load_running_)
     {
-        loader_thread_.request_stop();
-        loader_thread_.join();
+        loader_.cancel();
+        loader_.wait();
 
-        loader_thread_ =
-            std::jthread([this](const std::stop_token& stoken) { refresh_thread(stoken); });
-        pthread_setname_np(loader_thread_.native_handle(), "loader");
+        loader_.submit([this](const std::stop_token& stoken) { refresh_thread(stoken); });
     }
 }
 
@@ -273,56 +393,103 @@ vfs::dir::refresh_thread(const std::stop_token& stoken) noexcept
     std::scoped_lock lock(loader_mutex_);
 
     load_running_ = true;
+    // this scan covers every event lost before it started
+    rescan_pending_ = false;
     xhidden_count_ = 0;
 
     // reload this dirs .hidden file
     load_user_hidden_files();
 
-    for (const auto& dfile : std::filesystem::directory_iterator(path_))
+    const auto finish = [this, &stoken]()
     {
-        if (stoken.stop_requested())
-        {
-            break;
-        }
+        load_running_ = false;
+
+        signal_directory_refresh().emit();
 
-        // Check if new files are hidden
-        if (is_file_user_hidden(dfile.path()))
+        // the queue overflowed again while scanning
+        if (rescan_pending_ && !stoken.stop_requested())
         {
-            xhidden_count_ += 1;
-            continue;
+            loader_.submit([this](const std::stop_token& token) { refresh_thread(token); });
         }
+    };
+
+    auto scanner = vfs::linux::dir_scanner::create(path_);
+    if (!scanner)
+    {
+        logger::error<logger::vfs>("Failed to open directory: {} {}",
+                                   path_,
+                                   scanner.error().message());
+        finish();
+        return;
+    }
+
+    vfs::file_table::diff diff;
+
+    std::vector<vfs::linux::dir_scanner::entry> entries;
+    entries.reserve(4096);
+
+    while (!stoken.stop_requested() && scanner->next(entries) != 0)
+    {
+        // user hidden files are left out, so one that is
+        // already in files_ shows up as deleted
+        std::erase_if(entries,
+                      [this](const auto& entry)
+                      {
+                          if (is_file_user_hidden(entry.name))
+                          {
+                              xhidden_count_ += 1;
+                              return true;
+                          }
+                          return false;
+                      });
 
-        const auto filename = dfile.path().filename();
-        if (find_file(filename) == nullptr)
         {
-            on_file_created(filename);
+            std::scoped_lock files_lock(files_lock_);
+            files_.diff_entries(diff, entries);
         }
+        entries.clear();
+    }
+
+    if (stoken.stop_requested())
+    {
+        // a partial listing would delete every file not read yet
+        finish();
+        return;
     }
 
     {
         std::scoped_lock files_lock(files_lock_);
-        for (const auto& file : files_)
+        files_.diff_finish(diff);
+    }
+
+    if (!diff.empty())
+    {
+        for (const auto& filename : diff.deleted)
         {
-            if (stoken.stop_requested())
-            {
-                break;
-            }
+            events_.push(vfs::file_events::event_type::deleted, filename);
+        }
+        for (const auto& filename : diff.changed)
+        {
+            events_.push(vfs::file_events::event_type::changed, filename);
+        }
+        for (const auto& filename : diff.created)
+        {
+            events_.push(vfs::file_events::event_type::created, filename);
+        }
+        notify_file_change();
 
-            // Check if existing files have been hidden
-            if (is_file_user_hidden(file->path()))
+        if (vfs::dir_snapshot::is_enabled())
+        {
+            // stale, the next load reads the directory and saves a new one
+            const auto stat = vfs::linux::statx::create(path_);
+            if (stat)
             {
-                // Use the delete signal to properly remove this file from the file list.
-                on_file_deleted(file->name());
-
-                xhidden_count_ += 1;
-                continue;
+                vfs::dir_snapshot::remove(*stat);
             }
         }
     }
 
-    load_running_ = false;
-
-    signal_directory_refresh().emit();
+    finish();
 }
 
 std::shared_ptr<vfs::file>
@@ -330,16 +497,29 @@ vfs::dir::find_file(const std::filesystem::path& filename) noexcept
 {
     std::scoped_lock files_lock(files_lock_);
 
-    const auto it =
-        std::ranges::find_if(files_,
-                             [&filename](const auto& file) { return file->name() == filename; });
-    if (it != files_.cend())
+    return find_file_locked(filename.native());
+}
+
+std::shared_ptr<vfs::file>
+vfs::dir::find_file_locked(const std::string_view filename) const noexcept
+{
+    const auto handle = files_.find(filename);
+    if (handle)
     {
-        return *it;
+        return files_.file(*handle);
     }
     return nullptr;
 }
 
+void
+vfs::dir::append_files_locked(const std::span<const std::shared_ptr<vfs::file>> files) noexcept
+{
+    for (const auto& file : files)
+    {
+        files_.insert(file);
+    }
+}
+
 bool
 vfs::dir::add_hidden(const std::shared_ptr<vfs::file>& file) noexcept
 {
@@ -389,55 +569,24 @@ vfs::dir::write_hidden() const noexcept
 }
 
 void
-vfs::dir::enable_thumbnails(const bool enabled) noexcept
-{
-    enable_thumbnails_ = enabled;
-}
-
-void
-vfs::dir::load_thumbnails(const std::int32_t size) noexcept
-{
-    std::scoped_lock files_lock(files_lock_);
-
-    if (!enable_thumbnails_)
-    {
-        return;
-    }
-
-    for (const auto& file : files_)
-    {
-        load_thumbnail(file, size);
-    }
-}
-
-void
-vfs::dir::load_thumbnail(const std::shared_ptr<vfs::file>& file, const std::int32_t size) noexcept
+vfs::dir::sniff_mime_type(const std::shared_ptr<vfs::file>& file) noexcept
 {
-    if (enable_thumbnails_)
+    if (file->is_mime_type_sniff_needed())
     {
-        // logger::debug<logger::vfs>("vfs::dir::load_thumbnail()  {}", file->name());
-        thumbnailer_.request({file, size});
+        sniffer_.request(file);
     }
 }
 
-void
-vfs::dir::unload_thumbnails(const std::int32_t size) noexcept
+bool
+vfs::dir::is_loading() const noexcept
 {
-    (void)size;
-#if 0 // TODO
-    std::scoped_lock files_lock(files_lock_);
-
-    for (const auto& file : files_)
-    {
-        file->unload_thumbnail(size);
-    }
-#endif
+    return load_running_;
 }
 
 bool
-vfs::dir::is_loading() const noexcept
+vfs::dir::is_initial_load() const noexcept
 {
-    return load_running_;
+    return initial_load_running_;
 }
 
 bool
@@ -458,7 +607,7 @@ vfs::dir::update_file(const std::shared_ptr<vfs::file>& file) noexcept
     const bool updated = file->update();
     if (!updated)
     { /* The file does not exist */
-        if (std::ranges::contains(files_, file))
+        if (find_file(file->name()) == file)
         {
             on_file_deleted(file->path());
         }
@@ -467,68 +616,160 @@ vfs::dir::update_file(const std::shared_ptr<vfs::file>& file) noexcept
 }
 
 void
-vfs::dir::notify_file_change(const std::chrono::milliseconds timeout) noexcept
+vfs::dir::notify_file_change() noexcept
 {
-    if (!timer_running_)
+    if (!timer_running_.exchange(true))
     {
-        timer_running_ = true;
-
         timer_.connect_once(
             [this]()
             {
-                update_deleted_files();
-                update_changed_files();
-                update_created_files();
+                if (load_running_)
+                {
+                    // files_ is only inserted into while loading,
+                    // events are handled once the load is finished.
+                    timer_running_ = false;
+                    notify_file_change();
+                    return;
+                }
+
+                auto batch = events_.take();
+                if (!batch.empty())
+                {
+                    update_renamed_files(batch);
+                    update_deleted_files(batch.deleted);
+                    update_changed_files(batch.changed);
+                    update_created_files(batch.created);
+                }
 
                 timer_running_ = false;
+
+                // pushed while this batch was handled
+                if (!events_.empty())
+                {
+                    notify_file_change();
+                }
             },
-            static_cast<std::uint32_t>(timeout.count()),
+            static_cast<std::uint32_t>(events_.interval().count()),
             Glib::PRIORITY_LOW);
     }
 }
 
 void
-vfs::dir::update_deleted_files() noexcept
+vfs::dir::update_deleted_files(const std::span<const std::string> filenames) noexcept
 {
-    std::scoped_lock lock(events_.deleted_lock);
+    if (filenames.empty())
+    {
+        return;
+    }
+
+    std::vector<std::shared_ptr<vfs::file>> deleted_files;
+    {
+        std::scoped_lock files_lock(files_lock_);
+
+        for (const auto& filename : filenames)
+        {
+            const auto handle = files_.find(filename);
+            if (handle)
+            {
+                deleted_files.push_back(files_.file(*handle));
+                files_.erase(*handle);
+            }
+        }
+    }
 
-    if (events_.deleted.empty())
+    if (!deleted_files.empty())
+    {
+        signal_files_deleted().emit(deleted_files);
+    }
+}
+
+void
+vfs::dir::update_renamed_files(vfs::file_events::batch& batch) noexcept
+{
+    if (batch.renamed.empty())
     {
         return;
     }
 
+    std::vector<renamed_file> renamed_files;
     std::vector<std::shared_ptr<vfs::file>> deleted_files;
     {
-        for (const auto& filename : events_.deleted)
+        std::scoped_lock files_lock(files_lock_);
+
+        for (const auto& [from, to] : batch.renamed)
         {
-            const auto file = find_file(filename);
-            if (file)
+            const auto handle = files_.find(from);
+            if (!handle)
             {
-                std::scoped_lock files_lock(files_lock_);
-                std::erase_if(files_, [&](const auto& f) { return f == file; });
+                // not in files_, i.e. it was user hidden
+                batch.created.push_back(to);
+                continue;
+            }
+            const auto file = files_.file(*handle);
+
+            // a file replaced by the rename
+            const auto target = files_.find(to);
+            if (target)
+            {
+                deleted_files.push_back(files_.file(*target));
+                files_.erase(*target);
+            }
 
+            if (is_file_user_hidden(to))
+            {
                 deleted_files.push_back(file);
+                files_.erase(*handle);
+                xhidden_count_ += 1;
+                continue;
             }
+
+            const auto renamed = file->renamed(path_ / to);
+            files_.rename(*handle, renamed);
+            renamed_files.push_back({file, renamed});
         }
     }
 
-    signal_files_deleted().emit(deleted_files);
+    if (!deleted_files.empty())
+    {
+        signal_files_deleted().emit(deleted_files);
+    }
+    if (renamed_files.empty())
+    {
+        return;
+    }
+
+    for (const auto& [from, to] : renamed_files)
+    {
+        // the content is read by the sniffer, not under files_lock_
+        sniff_mime_type(to);
+    }
+
+    // the disk thumbnails are keyed by uri, move them so they are not created again
+    vfs::executor::global().submit(
+        [renamed_files]
+        {
+            for (const auto& [from, to] : renamed_files)
+            {
+                if (from->mime_type()->is_image() || from->mime_type()->is_video())
+                {
+                    vfs::detail::thumbnail::rename(from, to);
+                }
+            }
+        });
 
-    events_.deleted.clear();
+    signal_files_renamed().emit(renamed_files);
 }
 
 void
-vfs::dir::update_changed_files() noexcept
+vfs::dir::update_changed_files(const std::span<const std::string> filenames) noexcept
 {
-    std::scoped_lock lock(events_.changed_lock);
-
-    if (events_.changed.empty())
+    if (filenames.empty())
     {
         return;
     }
 
     std::vector<std::shared_ptr<vfs::file>> changed_files;
-    for (const auto& filename : events_.changed)
+    for (const auto& filename : filenames)
     {
         const auto file = find_file(filename);
         if (file && update_file(file))
@@ -536,23 +777,23 @@ vfs::dir::update_changed_files() noexcept
             changed_files.push_back(file);
         }
     }
-    signal_files_changed().emit(changed_files);
 
-    events_.changed.clear();
+    if (!changed_files.empty())
+    {
+        signal_files_changed().emit(changed_files);
+    }
 }
 
 void
-vfs::dir::update_created_files() noexcept
+vfs::dir::update_created_files(const std::span<const std::string> filenames) noexcept
 {
-    std::scoped_lock lock(events_.created_lock);
-
-    if (events_.created.empty())
+    if (filenames.empty())
     {
         return;
     }
 
     std::vector<std::shared_ptr<vfs::file>> created_files;
-    for (const auto& filename : events_.created)
+    for (const auto& filename : filenames)
     {
         const auto file = find_file(filename);
         if (!file)
@@ -570,7 +811,7 @@ vfs::dir::update_created_files() noexcept
                 std::scoped_lock files_lock(files_lock_);
 
                 const auto new_file = vfs::file::create(file_path);
-                files_.push_back(new_file);
+                append_files_locked({&new_file, 1});
                 created_files.push_back(new_file);
             }
         }
@@ -583,9 +824,11 @@ vfs::dir::update_created_files() noexcept
             }
         }
     }
-    signal_files_created().emit(created_files);
 
-    events_.created.clear();
+    if (!created_files.empty())
+    {
+        signal_files_created().emit(created_files);
+    }
 }
 
 void
@@ -596,12 +839,9 @@ vfs::dir::on_file_created(const std::filesystem::path& path) noexcept
         return;
     }
 
-    {
-        std::scoped_lock lock(events_.created_lock);
-        events_.created.insert(path.filename());
-    }
+    events_.push(vfs::file_events::event_type::created, path.filename().native());
 
-    notify_file_change(std::chrono::milliseconds(200));
+    notify_file_change();
 }
 
 void
@@ -612,12 +852,9 @@ vfs::dir::on_file_deleted(const std::filesystem::path& path) noexcept
         return;
     }
 
-    {
-        std::scoped_lock lock(events_.deleted_lock);
-        events_.deleted.insert(path.filename());
-    }
+    events_.push(vfs::file_events::event_type::deleted, path.filename().native());
 
-    notify_file_change(std::chrono::milliseconds(200));
+    notify_file_change();
 }
 
 void
@@ -633,12 +870,43 @@ vfs::dir::on_file_changed(const std::filesystem::path& path) noexcept
         return;
     }
 
+    events_.push(vfs::file_events::event_type::changed, path.filename().native());
+
+    notify_file_change();
+}
+
+void
+vfs::dir::on_file_renamed(const std::filesystem::path& from,
+                          const std::filesystem::path& to) noexcept
+{
+    if (avoid_changes_)
+    {
+        return;
+    }
+
+    events_.push(vfs::file_events::event_type::renamed,
+                 from.filename().native(),
+                 to.filename().native());
+
+    notify_file_change();
+}
+
+void
+vfs::dir::on_queue_overflow() noexcept
+{
+    if (avoid_changes_)
     {
-        std::scoped_lock lock(events_.changed_lock);
-        events_.changed.insert(path.filename());
+        return;
     }
 
-    notify_file_change(std::chrono::milliseconds(500));
+    logger::warn<logger::vfs>("File event queue overflow, rescanning {}", path_);
+
+    // picked up when a running load or refresh finishes
+    rescan_pending_ = true;
+    if (!load_running_)
+    {
+        loader_.submit([this](const std::stop_token& stoken) { refresh_thread(stoken); });
+    }
 }
 
 void
@@ -24,6 +24,8 @@
 #include <mutex>
 #include <span>
 #include <stop_token>
+#include <string>
+#include <string_view>
 #include <thread>
 #include <unordered_set>
 #include <vector>
@@ -34,9 +36,12 @@
 
 #include <ztd/ztd.hxx>
 
+#include "vfs/executor.hxx"
+#include "vfs/file-events.hxx"
+#include "vfs/file-table.hxx"
 #include "vfs/file.hxx"
+#include "vfs/mime-sniffer.hxx"
 #include "vfs/notify-cpp/controller.hxx"
-#include "vfs/thumbnailer.hxx"
 
 namespace vfs
 {
@@ -55,6 +60,12 @@ class dir : public std::enable_shared_from_this<dir>
     [[nodiscard]] static std::shared_ptr<vfs::dir> create(const std::filesystem::path& path,
                                                           const bool permanent = false) noexcept;
 
+    struct renamed_file final
+    {
+        std::shared_ptr<vfs::file> from;
+        std::shared_ptr<vfs::file> to;
+    };
+
     [[nodiscard]] const std::filesystem::path& path() const noexcept;
     [[nodiscard]] std::vector<std::shared_ptr<vfs::file>> files() noexcept;
 
@@ -67,23 +78,33 @@ class dir : public std::enable_shared_from_this<dir>
 
     [[nodiscard]] bool is_loaded() const noexcept;
     [[nodiscard]] bool is_loading() const noexcept;
+    // the first load, still emitting signal_files_loaded(). false during a refresh
+    [[nodiscard]] bool is_initial_load() const noexcept;
 
     [[nodiscard]] bool is_directory_empty() const noexcept;
 
     [[nodiscard]] bool add_hidden(const std::shared_ptr<vfs::file>& file) noexcept;
     [[nodiscard]] bool add_hidden(const std::span<const std::shared_ptr<vfs::file>> files) noexcept;
 
-    void load_thumbnails(const std::int32_t size) noexcept;
-    void load_thumbnail(const std::shared_ptr<vfs::file>& file, const std::int32_t size) noexcept;
-    void unload_thumbnails(const std::int32_t size) noexcept;
-    void enable_thumbnails(const bool enabled) noexcept;
+    // read the content of a shown file that the filename did not give a mime type for
+    void sniff_mime_type(const std::shared_ptr<vfs::file>& file) noexcept;
 
   private:
     void load_thread(const std::stop_token& stoken) noexcept;
+
+    // publish loaded files every LOAD_CHUNK_SIZE files or LOAD_CHUNK_INTERVAL, whichever is first
+    static constexpr std::size_t LOAD_CHUNK_SIZE = 2048;
+    static constexpr std::chrono::milliseconds LOAD_CHUNK_INTERVAL{50};
+    // smaller directories load faster than a snapshot can be written
+    static constexpr std::size_t SNAPSHOT_MIN_FILES = 1000;
     void refresh_thread(const std::stop_token& stoken) noexcept;
 
     [[nodiscard]] std::shared_ptr<vfs::file>
     find_file(const std::filesystem::path& filename) noexcept;
+    // files_lock_ must be held
+    [[nodiscard]] std::shared_ptr<vfs::file>
+    find_file_locked(const std::string_view filename) const noexcept;
+    void append_files_locked(const std::span<const std::shared_ptr<vfs::file>> files) noexcept;
     [[nodiscard]] bool update_file(const std::shared_ptr<vfs::file>& file) noexcept;
 
     // dir .hidden file
@@ -96,50 +117,44 @@ class dir : public std::enable_shared_from_this<dir>
     void on_file_created(const std::filesystem::path& path) noexcept;
     void on_file_deleted(const std::filesystem::path& path) noexcept;
     void on_file_changed(const std::filesystem::path& path) noexcept;
+    void on_file_renamed(const std::filesystem::path& from,
+                         const std::filesystem::path& to) noexcept;
     void on_self_deleted(const std::filesystem::path& path) noexcept;
+    // events were dropped, rescan and diff against files_
+    void on_queue_overflow() noexcept;
 
     std::filesystem::path path_;
 
-    std::vector<std::shared_ptr<vfs::file>> files_;
+    vfs::file_table files_;
     std::mutex files_lock_;
 
-    std::jthread loader_thread_;
+    // load and refresh run as tasks on vfs::executor::global()
+    vfs::task_group loader_;
     std::mutex loader_mutex_;
 
-    vfs::thumbnailer thumbnailer_;
-    std::jthread thumbnailer_thread_;
+    vfs::mime_sniffer sniffer_;
 
     notify::controller notifier_;
-    std::jthread notifier_thread_;
 
-    bool enable_thumbnails_{true};
-    bool avoid_changes_{false};           // disable file events, for nfs mount locations.
-    std::atomic_bool load_running_{true}; // is dir loaded, initial load or refresh
-    u64 xhidden_count_;                   // filenames starting with '.' and user hidden files
+    bool avoid_changes_{false};              // disable file events, for nfs mount locations.
+    std::atomic_bool load_running_{true};    // is dir loaded, initial load or refresh
+    // first load, until signal_directory_loaded()
+    std::atomic_bool initial_load_running_{true};
+    std::atomic_bool rescan_pending_{false}; // file events were lost, rescan after loading
+    u64 xhidden_count_;                      // filenames starting with '.' and user hidden files
 
     // batch handling for file events
-    void notify_file_change(const std::chrono::milliseconds timeout) noexcept;
+    void notify_file_change() noexcept;
     // file change notify
-    void update_created_files() noexcept;
-    void update_changed_files() noexcept;
-    void update_deleted_files() noexcept;
-    bool timer_running_ = false;
+    void update_created_files(const std::span<const std::string> filenames) noexcept;
+    void update_changed_files(const std::span<const std::string> filenames) noexcept;
+    void update_deleted_files(const std::span<const std::string> filenames) noexcept;
+    void update_renamed_files(vfs::file_events::batch& batch) noexcept;
+    std::atomic_bool timer_running_{false};
     Glib::SignalTimeout timer_ = Glib::signal_timeout();
 
-    struct file_events
-    {
-        // filenames only
-
-        std::mutex deleted_lock;
-        std::unordered_set<std::filesystem::path> deleted;
-
-        std::mutex changed_lock;
-        std::unordered_set<std::filesystem::path> changed;
-
-        std::mutex created_lock;
-        std::unordered_set<std::filesystem::path> created;
-    };
-    file_events events_;
+    // filenames only
+    vfs::file_events events_;
 
   public:
     // Signals
@@ -162,6 +177,28 @@ class dir : public std::enable_shared_from_this<dir>
         return signal_files_deleted_;
     }
 
+    /**
+     * Files renamed inside this directory. Each renamed file is replaced
+     * by a new vfs::file, see vfs::file::renamed().
+     */
+    [[nodiscard]] auto
+    signal_files_renamed() noexcept
+    {
+        return signal_files_renamed_;
+    }
+
+    /**
+     * Emitted from the loader thread with each chunk of files read
+     * while the directory is loading. offset is the position of the
+     * first file of the chunk in files(), chunks are emitted in order
+     * and are always followed by signal_directory_loaded().
+     */
+    [[nodiscard]] auto
+    signal_files_loaded() noexcept
+    {
+        return signal_files_loaded_;
+    }
+
     [[nodiscard]] auto
     signal_directory_loaded() noexcept
     {
@@ -174,10 +211,14 @@ class dir : public std::enable_shared_from_this<dir>
         return signal_directory_refresh_;
     }
 
+    /**
+     * Emitted from the executor after sniff_mime_type()
+     * found a different mime type for the files.
+     */
     [[nodiscard]] auto
-    signal_thumbnail_loaded() noexcept
+    signal_mime_types_changed() noexcept
     {
-        return signal_file_thumbnail_loaded_;
+        return sniffer_.signal_mime_types_changed();
     }
 
     /**
@@ -194,9 +235,10 @@ class dir : public std::enable_shared_from_this<dir>
     sigc::signal<void(std::vector<std::shared_ptr<vfs::file>>)> signal_files_created_;
     sigc::signal<void(std::vector<std::shared_ptr<vfs::file>>)> signal_files_changed_;
     sigc::signal<void(std::vector<std::shared_ptr<vfs::file>>)> signal_files_deleted_;
+    sigc::signal<void(std::vector<renamed_file>)> signal_files_renamed_;
+    sigc::signal<void(std::size_t, std::vector<std::shared_ptr<vfs::file>>)> signal_files_loaded_;
     sigc::signal<void()> signal_directory_loaded_;
     sigc::signal<void()> signal_directory_refresh_;
-    sigc::signal<void(const std::shared_ptr<vfs::file>&)> signal_file_thumbnail_loaded_;
     sigc::signal<void()> signal_directory_deleted_;
 };
 } // namespace vfs
@@ -0,0 +1,244 @@
+/**
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <ranges>
+#include <stop_token>
+#include <thread>
+#include <utility>
+
+#include <cstddef>
+
+#include <pthread.h>
+
+#include "vfs/executor.hxx"
+
+namespace global
+{
+// set for executor worker threads
+thread_local const vfs::executor* current_executor = nullptr;
+thread_local std::size_t current_worker = 0;
+} // namespace global
+
+vfs::executor::executor(const std::size_t threads) noexcept
+{
+    const auto count = std::max(threads, 1uz);
+
+    workers_.reserve(count);
+    for ([[maybe_unused]] const auto _ : std::views::iota(0uz, count))
+    {
+        workers_.push_back(std::make_unique<worker>());
+    }
+
+    threads_.reserve(count);
+    for (const auto index : std::views::iota(0uz, count))
+    {
+        threads_.emplace_back([this, index](const std::stop_token& stoken) { run(stoken, index); });
+        pthread_setname_np(threads_.back().native_handle(), "vfs-worker");
+    }
+}
+
+vfs::executor::~executor() noexcept
+{
+    for (auto& thread : threads_)
+    {
+        thread.request_stop();
+    }
+    threads_.clear();
+}
+
+vfs::executor&
+vfs::executor::global() noexcept
+{
+    // loading and thumbnailing block on io, so do not go below 4 on small machines
+    static vfs::executor executor(std::clamp(std::thread::hardware_concurrency(), 4u, 16u));
+    return executor;
+}
+
+std::size_t
+vfs::executor::size() const noexcept
+{
+    return workers_.size();
+}
+
+void
+vfs::executor::submit(task&& task) noexcept
+{
+    const auto index = global::current_executor == this
+                           ? global::current_worker
+                           : next_.fetch_add(1, std::memory_order_relaxed) % workers_.size();
+
+    {
+        // pending_ must not change between a worker checking it and going to sleep.
+        // counted before the push so it never goes below the number of queued tasks.
+        std::scoped_lock lock(sleep_lock_);
+        pending_.fetch_add(1, std::memory_order_release);
+    }
+
+    {
+        std::scoped_lock lock(workers_[index]->lock);
+        workers_[index]->tasks.push_back(std::move(task));
+    }
+
+    sleep_cv_.notify_one();
+}
+
+bool
+vfs::executor::pop(const std::size_t index, task& task) noexcept
+{
+    auto& worker = *workers_[index];
+
+    std::scoped_lock lock(worker.lock);
+    if (worker.tasks.empty())
+    {
+        return false;
+    }
+
+    task = std::move(worker.tasks.back());
+    worker.tasks.pop_back();
+    return true;
+}
+
+bool
+vfs::executor::steal(const std::size_t index, task& task) noexcept
+{
+    for (const auto offset : std::views::iota(1uz, workers_.size()))
+    {
+        auto& victim = *workers_[(index + offset) % workers_.size()];
+
+        std::scoped_lock lock(victim.lock);
+        if (victim.tasks.empty())
+        {
+            continue;
+        }
+
+        task = std::move(victim.tasks.front());
+        victim.tasks.pop_front();
+        return true;
+    }
+    return false;
+}
+
+void
+vfs::executor::run(const std::stop_token& stoken, const std::size_t index) noexcept
+{
+    global::current_executor = this;
+    global::current_worker = index;
+
+    while (!stoken.stop_requested())
+    {
+        task task;
+        if (pop(index, task) || steal(index, task))
+        {
+            pending_.fetch_sub(1, std::memory_order_acq_rel);
+
+            task();
+            continue;
+        }
+
+        std::unique_lock lock(sleep_lock_);
+        sleep_cv_.wait(lock,
+                       stoken,
+                       [this] { return pending_.load(std::memory_order_acquire) > 0; });
+    }
+}
+
+vfs::task_group::task_group(vfs::executor& executor) noexcept : executor_(executor) {}
+
+vfs::task_group::~task_group() noexcept
+{
+    shutdown();
+    wait();
+}
+
+void
+vfs::task_group::submit(task&& task) noexcept
+{
+    std::stop_token stoken;
+    {
+        std::scoped_lock lock(lock_);
+        if (shutdown_)
+        {
+            return;
+        }
+        pending_ += 1;
+        stoken = stop_.get_token();
+    }
+
+    // marks the task as finished when it is destroyed, so a task dropped
+    // without running does not leave wait() blocked
+    struct finish_guard final
+    {
+        explicit finish_guard(vfs::task_group* group) noexcept : group(group) {}
+        ~finish_guard() noexcept
+        {
+            if (group != nullptr)
+            {
+                std::scoped_lock lock(group->lock_);
+                group->pending_ -= 1;
+                group->cv_.notify_all();
+            }
+        }
+        finish_guard(const finish_guard& other) = delete;
+        finish_guard(finish_guard&& other) noexcept : group(std::exchange(other.group, nullptr))
+        {
+        }
+        finish_guard& operator=(const finish_guard& other) = delete;
+        finish_guard& operator=(finish_guard&& other) = delete;
+
+        vfs::task_group* group;
+    };
+
+    executor_.submit(
+        [guard = finish_guard(this), stoken, task = std::move(task)]() mutable
+        {
+            task(stoken);
+
+            // release anything the task captured before the group is told it finished
+            task = nullptr;
+        });
+}
+
+void
+vfs::task_group::cancel() noexcept
+{
+    std::scoped_lock lock(lock_);
+    stop_.request_stop();
+    stop_ = std::stop_source();
+}
+
+void
+vfs::task_group::shutdown() noexcept
+{
+    std::scoped_lock lock(lock_);
+    shutdown_ = true;
+    stop_.request_stop();
+}
+
+void
+vfs::task_group::wait() noexcept
+{
+    std::unique_lock lock(lock_);
+    cv_.wait(lock, [this] { return pending_ == 0; });
+}
+
+bool
+vfs::task_group::is_running() const noexcept
+{
+    std::scoped_lock lock(lock_);
+    return pending_ != 0;
+}
@@ -0,0 +1,133 @@
+/**
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
+#include <cstddef>
+
+namespace vfs
+{
+/**
+ * Bounded thread pool with per worker task queues.
+ *
+ * A worker runs tasks from the back of its own queue and steals from the
+ * front of the other workers queues once its own is empty. Tasks submitted
+ * from a worker go to that workers queue, everything else is spread round
+ * robin. Idle workers sleep until new tasks are submitted.
+ */
+class executor final
+{
+  public:
+    using task = std::move_only_function<void()>;
+
+    explicit executor(const std::size_t threads) noexcept;
+    ~executor() noexcept;
+    executor(const executor& other) = delete;
+    executor(executor&& other) = delete;
+    executor& operator=(const executor& other) = delete;
+    executor& operator=(executor&& other) = delete;
+
+    /**
+     * Process wide executor used by the vfs, started on first use.
+     */
+    [[nodiscard]] static vfs::executor& global() noexcept;
+
+    void submit(task&& task) noexcept;
+
+    [[nodiscard]] std::size_t size() const noexcept;
+
+  private:
+    struct worker final
+    {
+        std::mutex lock;
+        std::deque<task> tasks;
+    };
+
+    void run(const std::stop_token& stoken, const std::size_t index) noexcept;
+    [[nodiscard]] bool pop(const std::size_t index, task& task) noexcept;
+    [[nodiscard]] bool steal(const std::size_t index, task& task) noexcept;
+
+    // destroyed after the threads are joined, drops any tasks that never ran
+    std::vector<std::unique_ptr<worker>> workers_;
+
+    std::atomic<std::size_t> pending_{0};
+    std::atomic<std::size_t> next_{0};
+
+    std::mutex sleep_lock_;
+    std::condition_variable_any sleep_cv_;
+
+    std::vector<std::jthread> threads_;
+};
+
+/**
+ * Tasks submitted to an executor on behalf of one owner, so they can be
+ * cancelled and waited on together. Destroying the group cancels and waits
+ * for every task it submitted.
+ */
+class task_group final
+{
+  public:
+    using task = std::move_only_function<void(const std::stop_token&)>;
+
+    explicit task_group(vfs::executor& executor = vfs::executor::global()) noexcept;
+    ~task_group() noexcept;
+    task_group(const task_group& other) = delete;
+    task_group(task_group&& other) = delete;
+    task_group& operator=(const task_group& other) = delete;
+    task_group& operator=(task_group&& other) = delete;
+
+    void submit(task&& task) noexcept;
+
+    /**
+     * Request stop for all submitted tasks, tasks submitted after
+     * this get a new stop_token.
+     */
+    void cancel() noexcept;
+
+    /**
+     * Request stop for all submitted tasks and drop every task submitted
+     * after this, for owners that are being destroyed. Cannot be undone.
+     */
+    void shutdown() noexcept;
+
+    /**
+     * Block until every submitted task has finished or been dropped.
+     * Must not be called from one of the groups own tasks.
+     */
+    void wait() noexcept;
+
+    [[nodiscard]] bool is_running() const noexcept;
+
+  private:
+    vfs::executor& executor_;
+
+    std::stop_source stop_;
+    std::size_t pending_{0};
+    bool shutdown_{false};
+
+    mutable std::mutex lock_;
+    std::condition_variable cv_;
+};
+} // namespace vfs
@@ -0,0 +1,259 @@
+/**
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <cstddef>
+#include <cstdint>
+
+#include "vfs/file-events.hxx"
+
+bool
+vfs::file_events::batch::empty() const noexcept
+{
+    return renamed.empty() && deleted.empty() && changed.empty() && created.empty();
+}
+
+vfs::file_events::file_events(const std::size_t capacity) noexcept
+    : slots_(std::make_unique<slot[]>(std::bit_ceil(std::max(capacity, 2uz)))),
+      mask_(std::bit_ceil(std::max(capacity, 2uz)) - 1),
+      last_take_(std::chrono::steady_clock::now())
+{
+    for (std::size_t i = 0; i <= mask_; ++i)
+    {
+        slots_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+}
+
+void
+vfs::file_events::push(const event_type type, const std::string_view name,
+                       const std::string_view to) noexcept
+{
+    // counted first so the consumer never sees more events than pending
+    pending_.fetch_add(1, std::memory_order_acq_rel);
+
+    event value{.type = type,
+                .sequence = sequence_.fetch_add(1, std::memory_order_relaxed),
+                .name = std::string(name),
+                .to = std::string(to)};
+
+    if (!try_push(value))
+    {
+        std::scoped_lock lock(spill_lock_);
+        spill_.push_back(std::move(value));
+    }
+}
+
+bool
+vfs::file_events::try_push(event& value) noexcept
+{
+    auto position = enqueue_.load(std::memory_order_relaxed);
+    while (true)
+    {
+        auto& cell = slots_[position & mask_];
+        const auto sequence = cell.sequence.load(std::memory_order_acquire);
+        const auto diff =
+            static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(position);
+        if (diff == 0)
+        {
+            if (enqueue_.compare_exchange_weak(position,
+                                               position + 1,
+                                               std::memory_order_relaxed))
+            {
+                cell.value = std::move(value);
+                cell.sequence.store(position + 1, std::memory_order_release);
+                return true;
+            }
+        }
+        else if (diff < 0)
+        {
+            // full, the consumer has not reached this slot yet
+            return false;
+        }
+        else
+        {
+            position = enqueue_.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+bool
+vfs::file_events::try_pop(event& value) noexcept
+{
+    auto& cell = slots_[dequeue_ & mask_];
+    if (cell.sequence.load(std::memory_order_acquire) != dequeue_ + 1)
+    {
+        // empty, or a producer has claimed the slot but not written it yet
+        return false;
+    }
+
+    value = std::move(cell.value);
+    cell.sequence.store(dequeue_ + mask_ + 1, std::memory_order_release);
+    dequeue_ += 1;
+    return true;
+}
+
+bool
+vfs::file_events::empty() const noexcept
+{
+    return pending_.load(std::memory_order_acquire) == 0;
+}
+
+std::chrono::milliseconds
+vfs::file_events::interval() const noexcept
+{
+    return std::chrono::milliseconds(interval_.load(std::memory_order_relaxed));
+}
+
+void
+vfs::file_events::update_interval(const std::size_t events) noexcept
+{
+    const auto now = std::chrono::steady_clock::now();
+    const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - last_take_);
+    last_take_ = now;
+
+    const auto rate =
+        events * 1000 /
+        static_cast<std::size_t>(std::max(elapsed, std::chrono::milliseconds(1)).count());
+
+    auto current = interval();
+    if (rate > BUSY_RATE)
+    {
+        current = std::min(current * 2, MAX_INTERVAL);
+    }
+    else if (rate < IDLE_RATE)
+    {
+        current = std::max(current / 2, MIN_INTERVAL);
+    }
+    interval_.store(current.count(), std::memory_order_relaxed);
+}
+
+vfs::file_events::batch
+vfs::file_events::take() noexcept
+{
+    std::vector<event> events;
+
+    event value;
+    while (try_pop(value))
+    {
+        events.push_back(std::move(value));
+    }
+
+    {
+        std::scoped_lock lock(spill_lock_);
+        if (!spill_.empty())
+        {
+            events.insert(events.cend(),
+                          std::make_move_iterator(spill_.begin()),
+                          std::make_move_iterator(spill_.end()));
+            spill_.clear();
+
+            // only events from different producers can be out of order in the ring itself
+            std::ranges::stable_sort(events, {}, &event::sequence);
+        }
+    }
+
+    pending_.fetch_sub(events.size(), std::memory_order_acq_rel);
+
+    update_interval(events.size());
+
+    batch result;
+    result.events = events.size();
+
+    // what is left to do for a name, the table is only
+    // looked at once the whole batch has been collapsed
+    std::unordered_map<std::string, event_type> state;
+    for (auto& e : events)
+    {
+        switch (e.type)
+        {
+            case event_type::created:
+            {
+                // a delete before is a replaced file, the create updates it
+                state.insert_or_assign(std::move(e.name), event_type::created);
+                break;
+            }
+            case event_type::deleted:
+            {
+                // a file created in this batch is not in the table, erasing it is a no-op
+                state.insert_or_assign(std::move(e.name), event_type::deleted);
+                break;
+            }
+            case event_type::changed:
+            {
+                // a pending create or delete already covers a change
+                state.try_emplace(std::move(e.name), event_type::changed);
+                break;
+            }
+            case event_type::renamed:
+            {
+                const auto it = state.find(e.name);
+                if (it != state.cend() && it->second != event_type::changed)
+                {
+                    // the old name is not a file in the table,
+                    // a created file that was renamed is a create of the new name
+                    it->second = event_type::deleted;
+                    state.insert_or_assign(std::move(e.to), event_type::created);
+                    break;
+                }
+
+                const bool changed = it != state.cend();
+                if (changed)
+                {
+                    state.erase(it);
+                }
+
+                // the rename replaces anything pending for the new name
+                state.erase(e.to);
+                if (changed)
+                {
+                    state.insert({e.to, event_type::changed});
+                }
+                result.renamed.emplace_back(std::move(e.name), std::move(e.to));
+                break;
+            }
+        }
+    }
+
+    for (auto& [name, type] : state)
+    {
+        switch (type)
+        {
+            case event_type::created:
+                result.created.push_back(name);
+                break;
+            case event_type::deleted:
+                result.deleted.push_back(name);
+                break;
+            case event_type::changed:
+                result.changed.push_back(name);
+                break;
+            case event_type::renamed:
+                break;
+        }
+    }
+
+    return result;
+}
@@ -0,0 +1,140 @@
+/**
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace vfs
+{
+/**
+ * Pending file events for one directory.
+ *
+ * Any number of threads push events, the notify reader and the refresh
+ * task, into a bounded lock free ring. A single consumer, the vfs::dir
+ * flush timer, takes everything pushed so far and collapses it per name
+ * before anything is looked up in the file table, so a create, modify,
+ * delete of the same temp file between two flushes never reaches the gui.
+ *
+ * A push never blocks and never drops an event, when the ring is full it
+ * goes to a locked spill list and the order is restored from a sequence
+ * number when the batch is taken.
+ *
+ * The flush interval follows the event rate, short while a directory is
+ * quiet so single changes show up fast, longer under heavy churn so more
+ * events are collapsed per flush.
+ */
+class file_events final
+{
+  public:
+    enum class event_type : std::uint8_t
+    {
+        created,
+        deleted,
+        changed,
+        renamed,
+    };
+
+    /**
+     * Filenames left after collapsing, renames are applied
+     * first and in order, then deleted, changed and created.
+     */
+    struct batch final
+    {
+        std::vector<std::pair<std::string, std::string>> renamed;
+        std::vector<std::string> deleted;
+        std::vector<std::string> changed;
+        std::vector<std::string> created;
+
+        std::size_t events{0}; // events taken, before collapsing
+
+        [[nodiscard]] bool empty() const noexcept;
+    };
+
+    static constexpr std::size_t DEFAULT_CAPACITY = 4096;
+
+    static constexpr std::chrono::milliseconds MIN_INTERVAL{100};
+    static constexpr std::chrono::milliseconds MAX_INTERVAL{1000};
+    // events per second above which the interval grows, below which it shrinks
+    static constexpr std::size_t BUSY_RATE = 1000;
+    static constexpr std::size_t IDLE_RATE = 100;
+
+    // capacity is rounded up to a power of two
+    explicit file_events(const std::size_t capacity = DEFAULT_CAPACITY) noexcept;
+    ~file_events() noexcept = default;
+    file_events(const file_events& other) = delete;
+    file_events(file_events&& other) = delete;
+    file_events& operator=(const file_events& other) = delete;
+    file_events& operator=(file_events&& other) = delete;
+
+    // any thread, to is only used by renamed
+    void push(const event_type type, const std::string_view name,
+              const std::string_view to = {}) noexcept;
+
+    // consumer only
+    [[nodiscard]] batch take() noexcept;
+
+    // false if an event has been pushed that take() has not returned yet
+    [[nodiscard]] bool empty() const noexcept;
+
+    // how long to wait before the next take()
+    [[nodiscard]] std::chrono::milliseconds interval() const noexcept;
+
+  private:
+    struct event final
+    {
+        event_type type{event_type::changed};
+        std::uint64_t sequence{0};
+        std::string name;
+        std::string to;
+    };
+
+    struct slot final
+    {
+        std::atomic<std::size_t> sequence;
+        event value;
+    };
+
+    [[nodiscard]] bool try_push(event& value) noexcept;
+    [[nodiscard]] bool try_pop(event& value) noexcept;
+    void update_interval(const std::size_t events) noexcept;
+
+    std::unique_ptr<slot[]> slots_;
+    std::size_t mask_;
+
+    // producers and the consumer on their own cache lines
+    alignas(64) std::atomic<std::size_t> enqueue_{0};
+    alignas(64) std::size_t dequeue_{0};
+
+    alignas(64) std::atomic<std::uint64_t> sequence_{0};
+    std::atomic<std::size_t> pending_{0};
+
+    std::mutex spill_lock_;
+    std::vector<event> spill_;
+
+    std::atomic<std::chrono::milliseconds::rep> interval_{MIN_INTERVAL.count()};
+    std::chrono::steady_clock::time_point last_take_;
+};
+} // namespace vfs
@@ -0,0 +1,277 @@
+/**
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <cstddef>
+#include <cstdint>
+
+#include "vfs/file-table.hxx"
+#include "vfs/file.hxx"
+
+#include "vfs/linux/dir-scanner.hxx"
+
+vfs::file_table::handle
+vfs::file_table::insert(const std::shared_ptr<vfs::file>& file) noexcept
+{
+    const auto existing = find(file->name());
+    if (existing)
+    {
+        // the key is a view into the replaced file
+        index_.erase(file->name());
+        files_[existing->index] = file;
+        index_.insert({file->name(), existing->index});
+        return *existing;
+    }
+
+    std::uint32_t index = 0;
+    if (!free_.empty())
+    {
+        index = free_.back();
+        free_.pop_back();
+    }
+    else
+    {
+        index = static_cast<std::uint32_t>(files_.size());
+        files_.emplace_back();
+        generation_.emplace_back(1);
+    }
+
+    files_[index] = file;
+    index_.insert({file->name(), index});
+    count_ += 1;
+
+    return {index, generation_[index]};
+}
+
+void
+vfs::file_table::erase(const handle entry) noexcept
+{
+    if (!contains(entry))
+    {
+        return;
+    }
+
+    const auto index = entry.index;
+
+    index_.erase(files_[index]->name());
+    files_[index] = nullptr;
+
+    // invalidate every handle to this slot
+    generation_[index] += 1;
+    if (generation_[index] == 0)
+    {
+        generation_[index] = 1;
+    }
+
+    free_.push_back(index);
+    count_ -= 1;
+
+    if (count_ == 0)
+    {
+        clear();
+    }
+}
+
+void
+vfs::file_table::rename(const handle entry, const std::shared_ptr<vfs::file>& file) noexcept
+{
+    if (!contains(entry))
+    {
+        return;
+    }
+
+    const auto existing = find(file->name());
+    if (existing)
+    {
+        if (*existing == entry)
+        {
+            return;
+        }
+        erase(*existing);
+    }
+
+    const auto index = entry.index;
+
+    index_.erase(files_[index]->name());
+    files_[index] = file;
+    index_.insert({file->name(), index});
+}
+
+void
+vfs::file_table::clear() noexcept
+{
+    // generations are kept so old handles stay invalid
+    index_.clear();
+    for (std::uint32_t index = 0; index < files_.size(); ++index)
+    {
+        if (files_[index] != nullptr)
+        {
+            files_[index] = nullptr;
+            generation_[index] += 1;
+            if (generation_[index] == 0)
+            {
+                generation_[index] = 1;
+            }
+        }
+    }
+
+    free_.clear();
+    for (auto index = static_cast<std::uint32_t>(files_.size()); index > 0; --index)
+    {
+        free_.push_back(index - 1);
+    }
+
+    count_ = 0;
+}
+
+void
+vfs::file_table::reserve(const std::size_t size) noexcept
+{
+    files_.reserve(size);
+    generation_.reserve(size);
+    index_.reserve(size);
+}
+
+bool
+vfs::file_table::diff::empty() const noexcept
+{
+    return created.empty() && changed.empty() && deleted.empty();
+}
+
+void
+vfs::file_table::diff_entries(
+    diff& result, const std::span<const vfs::linux::dir_scanner::entry> entries) const noexcept
+{
+    result.seen_.resize(files_.size(), false);
+
+    for (const auto& entry : entries)
+    {
+        const auto it = index_.find(entry.name);
+        if (it == index_.cend())
+        {
+            result.created.push_back(entry.name);
+            continue;
+        }
+
+        const auto index = it->second;
+        result.seen_[index] = true;
+
+        const auto& stat = files_[index]->stat();
+        if (stat.ino() != entry.stat.ino() || stat.mtime() != entry.stat.mtime() ||
+            stat.ctime() != entry.stat.ctime())
+        {
+            result.changed.push_back(entry.name);
+        }
+    }
+}
+
+void
+vfs::file_table::diff_finish(diff& result) const noexcept
+{
+    result.seen_.resize(files_.size(), false);
+
+    for (std::uint32_t index = 0; index < files_.size(); ++index)
+    {
+        if (files_[index] != nullptr && !result.seen_[index])
+        {
+            result.deleted.emplace_back(files_[index]->name());
+        }
+    }
+
+    result.seen_ = {};
+}
+
+bool
+vfs::file_table::contains(const handle entry) const noexcept
+{
+    return entry.index < files_.size() && generation_[entry.index] == entry.generation &&
+           files_[entry.index] != nullptr;
+}
+
+std::optional<vfs::file_table::handle>
+vfs::file_table::find(const std::string_view name) const noexcept
+{
+    const auto it = index_.find(name);
+    if (it == index_.cend())
+    {
+        return std::nullopt;
+    }
+    return handle{it->second, generation_[it->second]};
+}
+
+const std::shared_ptr<vfs::file>&
+vfs::file_table::file(const handle entry) const noexcept
+{
+    static const std::shared_ptr<vfs::file> none = nullptr;
+    if (!contains(entry))
+    {
+        return none;
+    }
+    return files_[entry.index];
+}
+
+std::string_view
+vfs::file_table::name(const handle entry) const noexcept
+{
+    return files_[entry.index]->name();
+}
+
+std::size_t
+vfs::file_table::size() const noexcept
+{
+    return count_;
+}
+
+bool
+vfs::file_table::empty() const noexcept
+{
+    return count_ == 0;
+}
+
+std::vector<vfs::file_table::handle>
+vfs::file_table::handles() const noexcept
+{
+    std::vector<handle> handles;
+    handles.reserve(count_);
+    for (std::uint32_t index = 0; index < files_.size(); ++index)
+    {
+        if (files_[index] != nullptr)
+        {
+            handles.push_back({index, generation_[index]});
+        }
+    }
+    return handles;
+}
+
+std::vector<std::shared_ptr<vfs::file>>
+vfs::file_table::files() const noexcept
+{
+    std::vector<std::shared_ptr<vfs::file>> files;
+    files.reserve(count_);
+    for (const auto& file : files_)
+    {
+        if (file != nullptr)
+        {
+            files.push_back(file);
+        }
+    }
+    return files;
+}
@@ -0,0 +1,126 @@
+/**
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <cstddef>
+#include <cstdint>
+
+#include "vfs/file.hxx"
+
+#include "vfs/linux/dir-scanner.hxx"
+
+namespace vfs
+{
+/**
+ * Per directory index of the vfs::file of a directory.
+ *
+ * Files are addressed by a handle that stays valid until that file is
+ * erased, erasing does not move any other file and the slot is reused by
+ * the next insert. Name lookup keys on views into vfs::file::name(), which
+ * is stable because a vfs::file is never renamed in place, see
+ * vfs::file::renamed(). The metadata is only kept in the vfs::file.
+ *
+ * Not thread safe, the owner is expected to hold a lock.
+ */
+class file_table final
+{
+  public:
+    struct handle final
+    {
+        std::uint32_t index{0};
+        std::uint32_t generation{0}; // 0 is never a valid generation
+
+        [[nodiscard]] constexpr bool operator==(const handle& other) const noexcept = default;
+    };
+
+    /**
+     * Difference between a directory listing and the table. A file is
+     * changed when its inode, mtime or ctime differ, a name that is in
+     * the table but not in the listing is deleted.
+     */
+    struct diff final
+    {
+        std::vector<std::string> created;
+        std::vector<std::string> changed;
+        std::vector<std::string> deleted;
+
+        [[nodiscard]] bool empty() const noexcept;
+
+      private:
+        friend class file_table;
+        std::vector<bool> seen_; // by handle::index
+    };
+
+    file_table() = default;
+    ~file_table() noexcept = default;
+    file_table(const file_table& other) = delete;
+    file_table(file_table&& other) = delete;
+    file_table& operator=(const file_table& other) = delete;
+    file_table& operator=(file_table&& other) = delete;
+
+    /**
+     * Add a file, a file with the same name is replaced.
+     * During a load with no erase the handle index is the insertion order.
+     */
+    handle insert(const std::shared_ptr<vfs::file>& file) noexcept;
+    void erase(const handle entry) noexcept;
+    // the file was renamed to file, see vfs::file::renamed().
+    // a file that already has the new name is erased
+    void rename(const handle entry, const std::shared_ptr<vfs::file>& file) noexcept;
+    void clear() noexcept;
+    void reserve(const std::size_t size) noexcept;
+
+    /**
+     * Compare a directory listing against the table, fed one chunk at a time
+     * then finished once the whole listing has been seen. The table must not
+     * change in between.
+     */
+    void diff_entries(diff& result,
+                      const std::span<const vfs::linux::dir_scanner::entry> entries) const noexcept;
+    void diff_finish(diff& result) const noexcept;
+
+    [[nodiscard]] bool contains(const handle entry) const noexcept;
+    [[nodiscard]] std::optional<handle> find(const std::string_view name) const noexcept;
+
+    [[nodiscard]] const std::shared_ptr<vfs::file>& file(const handle entry) const noexcept;
+    [[nodiscard]] std::string_view name(const handle entry) const noexcept;
+
+    [[nodiscard]] std::size_t size() const noexcept;
+    [[nodiscard]] bool empty() const noexcept;
+
+    // every file, in handle index order
+    [[nodiscard]] std::vector<handle> handles() const noexcept;
+    [[nodiscard]] std::vector<std::shared_ptr<vfs::file>> files() const noexcept;
+
+  private:
+    // indexed by handle::index
+    std::vector<std::shared_ptr<vfs::file>> files_; // nullptr for a free slot
+    std::vector<std::uint32_t> generation_;
+
+    std::vector<std::uint32_t> free_;
+    std::size_t count_{0};
+
+    std::unordered_map<std::string_view, std::uint32_t> index_; // name -> handle::index
+};
+} // namespace vfs
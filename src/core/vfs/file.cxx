@@ -18,6 +18,7 @@
 #include <filesystem>
 #include <format>
 #include <memory>
+#include <optional>
 #include <string>
 #include <string_view>
 #include <system_error>
@@ -30,10 +31,13 @@
 
 #include "vfs/file.hxx"
 #include "vfs/mime-type.hxx"
+#include "vfs/texture-cache.hxx"
 #include "vfs/user-dirs.hxx"
 
+#include "vfs/linux/statx.hxx"
 #include "vfs/thumbnails/thumbnails.hxx"
 #include "vfs/utils/icon.hxx"
+#include "vfs/utils/id-cache.hxx"
 #include "vfs/utils/permissions.hxx"
 #include "vfs/utils/utils.hxx"
 
@@ -50,87 +54,172 @@ vfs::file::create(const std::filesystem::path& path) noexcept
     return std::make_shared<hack>(path);
 }
 
-vfs::file::file(const std::filesystem::path& path) noexcept : path_(path)
+std::shared_ptr<vfs::file>
+vfs::file::create(const std::filesystem::path& path, const vfs::linux::statx& stat) noexcept
 {
-    // logger::debug<logger::vfs>("vfs::file::file({})    {}", logger::utils::ptr(this), path_);
-
-    if (path_ == "/")
+    struct hack : public vfs::file
     {
-        // special case, using std::filesystem::path::filename() on the root
-        // directory returns an empty string. that causes subtle bugs
-        // so hard code "/" as the value for root.
-        name_ = "/";
-    }
-    else
+        hack(const std::filesystem::path& path, const vfs::linux::statx& stat) : file(path, stat)
+        {
+        }
+    };
+
+    return std::make_shared<hack>(path, stat);
+}
+
+std::shared_ptr<vfs::file>
+vfs::file::create(const std::filesystem::path& path, const vfs::linux::statx& stat,
+                  const std::shared_ptr<vfs::mime_type>& mime_type) noexcept
+{
+    struct hack : public vfs::file
     {
-        name_ = path_.filename();
-    }
+        hack(const std::filesystem::path& path, const vfs::linux::statx& stat,
+             const std::shared_ptr<vfs::mime_type>& mime_type)
+            : file(path, stat, mime_type)
+        {
+        }
+    };
 
-    // Is a hidden file
-    is_hidden_ = name_.starts_with('.');
+    return std::make_shared<hack>(path, stat, mime_type);
+}
+
+vfs::file::file(const std::filesystem::path& path) noexcept : path_(path)
+{
+    // logger::debug<logger::vfs>("vfs::file::file({})    {}", logger::utils::ptr(this), path_);
+
+    init_name();
 
     const auto result = update();
 
     logger::error_if<logger::vfs>(!result, "Failed to create vfs::file for {}", path);
 }
 
+vfs::file::file(const std::filesystem::path& path, const vfs::linux::statx& stat) noexcept
+    : stat_(stat), path_(path)
+{
+    // logger::debug<logger::vfs>("vfs::file::file({})    {}", logger::utils::ptr(this), path_);
+
+    init_name();
+
+    update_info(false);
+}
+
+vfs::file::file(const std::filesystem::path& path, const vfs::linux::statx& stat,
+                const std::shared_ptr<vfs::mime_type>& mime_type) noexcept
+    : stat_(stat), path_(path), mime_type_(mime_type->id())
+{
+    // logger::debug<logger::vfs>("vfs::file::file({})    {}", logger::utils::ptr(this), path_);
+
+    init_name();
+}
+
 vfs::file::~file() noexcept
 {
     // logger::debug<logger::vfs>("vfs::file::~file({})   {}", logger::utils::ptr(this), path_);
+
+    if (in_texture_cache_)
+    {
+        for (const auto size :
+             {raw_size::normal, raw_size::large, raw_size::x_large, raw_size::xx_large})
+        {
+            vfs::texture_cache::global().erase({this, std::to_underlying(size)});
+        }
+    }
+}
+
+void
+vfs::file::init_name() noexcept
+{
+    // Is a hidden file
+    is_hidden_ = name().starts_with('.');
 }
 
 bool
 vfs::file::update() noexcept
 {
-    const auto stat = ztd::statx::create(path_, ztd::statx::symlink::no_follow);
+    const auto stat = vfs::linux::statx::create(path_, vfs::linux::statx::symlink::no_follow);
     if (!stat)
     {
-        mime_type_ = vfs::mime_type::create_from_type(vfs::constants::mime_type::unknown);
+        mime_type_.store(vfs::mime_type::unknown_id);
         return false;
     }
     stat_ = stat.value();
 
-    // logger::debug<logger::vfs>("vfs::file::update({})    {}  size={}", logger::utils::ptr(this), name, file_stat.size());
-
-    mime_type_ = vfs::mime_type::create_from_file(path_);
-
-    // file size formated
-    display_size_ = vfs::utils::format_file_size(size());
-    display_size_bytes_ = std::format("{:L}", size());
+    update_info();
 
-    // disk file size formated
-    display_disk_size_ = vfs::utils::format_file_size(size_on_disk());
+    return true;
+}
 
-    // owner
-    const auto pw = ztd::passwd::create(stat_.uid().data());
-    if (pw)
+std::shared_ptr<vfs::file>
+vfs::file::renamed(const std::filesystem::path& path) const noexcept
+{
+    std::shared_ptr<vfs::file> file;
+    if (path_.extension() != path.extension() && stat_.is_regular_file())
+    {
+        // by name only, a file the new name does not match needs sniff_mime_type()
+        file = create(path, stat_, vfs::mime_type::create_from_file(path, stat_, false));
+    }
+    else
     {
-        display_owner_ = pw->name();
+        file = create(path, stat_, mime_type());
+        file->mime_type_sniffed_.store(mime_type_sniffed_.load());
     }
 
-    // group
-    const auto gr = ztd::group::create(stat_.gid().data());
-    if (gr)
+    if (in_texture_cache_)
     {
-        display_group_ = gr->name();
+        file->in_texture_cache_ = true;
+        for (const auto size :
+             {raw_size::normal, raw_size::large, raw_size::x_large, raw_size::xx_large})
+        {
+            vfs::texture_cache::global().move({this, std::to_underlying(size)},
+                                              {file.get(), std::to_underlying(size)});
+        }
     }
 
-    // time
-    display_atime_ = std::format("{}", std::chrono::floor<std::chrono::seconds>(atime()));
-    display_btime_ = std::format("{}", std::chrono::floor<std::chrono::seconds>(btime()));
-    display_ctime_ = std::format("{}", std::chrono::floor<std::chrono::seconds>(ctime()));
-    display_mtime_ = std::format("{}", std::chrono::floor<std::chrono::seconds>(mtime()));
+    return file;
+}
+
+void
+vfs::file::update_info(const bool read_content) noexcept
+{
+    // logger::debug<logger::vfs>("vfs::file::update_info({})    {}  size={}", logger::utils::ptr(this), name, file_stat.size());
 
-    // Cause file prem string to be regenerated as needed
-    display_perm_.clear();
+    mime_type_.store(vfs::mime_type::create_from_file(path_, stat_, read_content)->id());
+    mime_type_sniffed_.store(read_content);
 
-    return true;
+    // display strings are rebuilt on next use
+    display_ = nullptr;
+}
+
+vfs::file::display_data&
+vfs::file::display() const noexcept
+{
+    if (!display_)
+    {
+        display_ = std::make_unique<display_data>();
+    }
+    return *display_;
 }
 
 std::string_view
 vfs::file::name() const noexcept
 {
-    return name_;
+    const std::string_view path = path_.native();
+    if (path == "/")
+    {
+        // special case, using std::filesystem::path::filename() on the root
+        // directory returns an empty string. that causes subtle bugs
+        // so hard code "/" as the value for root.
+        return path;
+    }
+
+    // a view into path_, the filename is not stored separately
+    const auto pos = path.rfind('/');
+    if (pos == std::string_view::npos)
+    {
+        return path;
+    }
+    return path.substr(pos + 1);
 }
 
 const std::filesystem::path&
@@ -139,6 +228,12 @@ vfs::file::path() const noexcept
     return path_;
 }
 
+const vfs::linux::statx&
+vfs::file::stat() const noexcept
+{
+    return stat_;
+}
+
 std::string
 vfs::file::uri() const noexcept
 {
@@ -160,19 +255,34 @@ vfs::file::size_on_disk() const noexcept
 std::string_view
 vfs::file::display_size() const noexcept
 {
-    return display_size_;
+    auto& display = this->display();
+    if (!display.size)
+    {
+        display.size = vfs::utils::format_file_size(size());
+    }
+    return *display.size;
 }
 
 std::string_view
 vfs::file::display_size_in_bytes() const noexcept
 {
-    return display_size_bytes_;
+    auto& display = this->display();
+    if (!display.size_in_bytes)
+    {
+        display.size_in_bytes = std::format("{:L}", size());
+    }
+    return *display.size_in_bytes;
 }
 
 std::string_view
 vfs::file::display_size_on_disk() const noexcept
 {
-    return display_disk_size_;
+    auto& display = this->display();
+    if (!display.size_on_disk)
+    {
+        display.size_on_disk = vfs::utils::format_file_size(size_on_disk());
+    }
+    return *display.size_on_disk;
 }
 
 u64
@@ -184,7 +294,42 @@ vfs::file::blocks() const noexcept
 const std::shared_ptr<vfs::mime_type>&
 vfs::file::mime_type() const noexcept
 {
-    return mime_type_;
+    return vfs::mime_type::from_id(mime_type_.load());
+}
+
+bool
+vfs::file::is_mime_type_sniff_needed() const noexcept
+{
+    if (mime_type_sniffed_.load() || !stat_.is_regular_file() || stat_.size() == 0)
+    {
+        return false;
+    }
+
+    const auto type = mime_type()->type();
+    return type == vfs::constants::mime_type::unknown ||
+           type == vfs::constants::mime_type::executable;
+}
+
+bool
+vfs::file::sniff_mime_type() noexcept
+{
+    mime_type_sniffed_.store(true);
+
+    auto current = mime_type_.load();
+    const auto id = vfs::mime_type::create_from_content(path_)->id();
+    if (id == vfs::mime_type::unknown_id &&
+        vfs::mime_type::from_id(current)->type() == vfs::constants::mime_type::executable)
+    {
+        // nothing matched, keep the type from the permissions
+        return false;
+    }
+    if (id == current)
+    {
+        return false;
+    }
+
+    // update() won the race, its type is newer than what was read
+    return mime_type_.compare_exchange_strong(current, id);
 }
 
 std::string_view
@@ -235,37 +380,67 @@ vfs::file::special_directory_get_icon_name(const bool symbolic) const noexcept
 std::string_view
 vfs::file::display_owner() const noexcept
 {
-    return display_owner_;
+    auto& display = this->display();
+    if (!display.owner)
+    {
+        display.owner = vfs::utils::user_name(stat_.uid().data()).value_or("");
+    }
+    return *display.owner;
 }
 
 std::string_view
 vfs::file::display_group() const noexcept
 {
-    return display_group_;
+    auto& display = this->display();
+    if (!display.group)
+    {
+        display.group = vfs::utils::group_name(stat_.gid().data()).value_or("");
+    }
+    return *display.group;
 }
 
 std::string_view
 vfs::file::display_atime() const noexcept
 {
-    return display_atime_;
+    auto& display = this->display();
+    if (!display.atime)
+    {
+        display.atime = std::format("{}", std::chrono::floor<std::chrono::seconds>(atime()));
+    }
+    return *display.atime;
 }
 
 std::string_view
 vfs::file::display_btime() const noexcept
 {
-    return display_btime_;
+    auto& display = this->display();
+    if (!display.btime)
+    {
+        display.btime = std::format("{}", std::chrono::floor<std::chrono::seconds>(btime()));
+    }
+    return *display.btime;
 }
 
 std::string_view
 vfs::file::display_ctime() const noexcept
 {
-    return display_ctime_;
+    auto& display = this->display();
+    if (!display.ctime)
+    {
+        display.ctime = std::format("{}", std::chrono::floor<std::chrono::seconds>(ctime()));
+    }
+    return *display.ctime;
 }
 
 std::string_view
 vfs::file::display_mtime() const noexcept
 {
-    return display_mtime_;
+    auto& display = this->display();
+    if (!display.mtime)
+    {
+        display.mtime = std::format("{}", std::chrono::floor<std::chrono::seconds>(mtime()));
+    }
+    return *display.mtime;
 }
 
 std::chrono::system_clock::time_point
@@ -293,13 +468,14 @@ vfs::file::mtime() const noexcept
 }
 
 std::string_view
-vfs::file::display_permissions() noexcept
+vfs::file::display_permissions() const noexcept
 {
-    if (display_perm_.empty())
+    auto& display = this->display();
+    if (!display.permissions)
     {
-        display_perm_ = stat_.perms_fancy();
+        display.permissions = stat_.perms_fancy();
     }
-    return display_perm_;
+    return *display.permissions;
 }
 
 bool
@@ -467,18 +643,41 @@ vfs::file::icon(const std::int32_t size) const noexcept
     {
         return vfs::utils::load_icon(special_directory_get_icon_name(), size);
     }
-    return mime_type_->icon(size);
+    return mime_type()->icon(size);
 }
 
 Glib::RefPtr<Gdk::Paintable>
 vfs::file::thumbnail(const std::int32_t size) const noexcept
 {
-    auto thumbnail = thumbnail_.get(size);
+    if (!in_texture_cache_)
+    {
+        return icon(size);
+    }
+
+    const auto thumbnail =
+        vfs::texture_cache::global().get({this, std::to_underlying(get_raw_size(size))});
     if (!thumbnail)
     {
         return icon(size);
     }
-    return thumbnail;
+
+    const auto src_width = static_cast<std::float_t>(thumbnail->get_width());
+    const auto src_height = static_cast<std::float_t>(thumbnail->get_height());
+
+    const auto scale = std::min(static_cast<std::float_t>(size) / src_width,
+                                static_cast<std::float_t>(size) / src_height);
+
+    const auto scaled_width = src_width * scale;
+    const auto scaled_height = src_height * scale;
+
+    const auto final_width = scaled_width;
+    const auto final_height = scaled_height;
+
+    auto snapshot = Gtk::Snapshot::create();
+    snapshot->scale(scale, scale);
+    snapshot->append_texture(thumbnail, Gdk::Graphene::Rect(0.0f, 0.0f, src_width, src_height));
+
+    return snapshot->to_paintable(Gdk::Graphene::Size(final_width, final_height));
 }
 
 void
@@ -492,137 +691,56 @@ vfs::file::load_thumbnail(const std::int32_t size, bool force_reload) noexcept
         return;
     }
 
-    if (thumbnail_.is_loaded(size) && !force_reload)
+    if (is_thumbnail_loaded(size) && !force_reload)
     {
         return;
     }
 
-    const auto raw = thumbnail_data::get_raw_size(size);
+    const auto raw = get_raw_size(size);
 
     Glib::RefPtr<Gdk::Texture> thumbnail;
-    if (mime_type_->is_image())
+    if (mime_type()->is_image())
     {
         thumbnail = vfs::detail::thumbnail::image(shared_from_this(), std::to_underlying(raw));
     }
-    else if (mime_type_->is_video())
+    else if (mime_type()->is_video())
     {
         thumbnail = vfs::detail::thumbnail::video(shared_from_this(), std::to_underlying(raw));
     }
 
     if (thumbnail)
     {
-        thumbnail_.set(raw, thumbnail);
+        // decoded as 4 bytes per pixel
+        const auto bytes = static_cast<std::size_t>(thumbnail->get_width()) *
+                           static_cast<std::size_t>(thumbnail->get_height()) * 4;
+
+        in_texture_cache_ = true;
+        vfs::texture_cache::global().insert({this, std::to_underlying(raw)}, thumbnail, bytes);
     }
 }
 
 bool
 vfs::file::is_thumbnail_loaded(const std::int32_t size) const noexcept
 {
-    return thumbnail_.is_loaded(size);
+    return in_texture_cache_ &&
+           vfs::texture_cache::global().contains({this, std::to_underlying(get_raw_size(size))});
 }
 
 void
-vfs::file::thumbnail_data::set(const raw_size size,
-                               const Glib::RefPtr<Gdk::Texture>& texture) noexcept
+vfs::file::pin_thumbnail(const std::int32_t size) const noexcept
 {
-    if (size == raw_size::normal)
-    {
-        normal = texture;
-    }
-    else if (size == raw_size::large)
-    {
-        large = texture;
-    }
-    else if (size == raw_size::x_large)
-    {
-        x_large = texture;
-    }
-    else if (size == raw_size::xx_large)
-    {
-        xx_large = texture;
-    }
-    else
-    {
-        std::unreachable();
-    }
-}
-
-Glib::RefPtr<Gdk::Paintable>
-vfs::file::thumbnail_data::get(const std::int32_t size) const noexcept
-{
-    Glib::RefPtr<Gdk::Texture> thumbnail;
-    if (size <= 128)
-    {
-        thumbnail = normal;
-    }
-    else if (size <= 256)
-    {
-        thumbnail = large;
-    }
-    else if (size <= 512)
-    {
-        thumbnail = x_large;
-    }
-    else if (size <= 1024)
-    {
-        thumbnail = xx_large;
-    }
-    else
-    {
-        std::unreachable();
-    }
-
-    if (!thumbnail)
-    {
-        return nullptr;
-    }
-
-    const auto src_width = static_cast<std::float_t>(thumbnail->get_width());
-    const auto src_height = static_cast<std::float_t>(thumbnail->get_height());
-
-    const auto scale = std::min(static_cast<std::float_t>(size) / src_width,
-                                static_cast<std::float_t>(size) / src_height);
-
-    const auto scaled_width = src_width * scale;
-    const auto scaled_height = src_height * scale;
-
-    const auto final_width = scaled_width;
-    const auto final_height = scaled_height;
-
-    auto snapshot = Gtk::Snapshot::create();
-    snapshot->scale(scale, scale);
-    snapshot->append_texture(thumbnail, Gdk::Graphene::Rect(0.0f, 0.0f, src_width, src_height));
-
-    return snapshot->to_paintable(Gdk::Graphene::Size(final_width, final_height));
+    in_texture_cache_ = true;
+    vfs::texture_cache::global().pin({this, std::to_underlying(get_raw_size(size))});
 }
 
-bool
-vfs::file::thumbnail_data::is_loaded(const std::int32_t size) const noexcept
+void
+vfs::file::unpin_thumbnail(const std::int32_t size) const noexcept
 {
-    if (size <= 128)
-    {
-        return normal != nullptr;
-    }
-    else if (size <= 256)
-    {
-        return large != nullptr;
-    }
-    else if (size <= 512)
-    {
-        return x_large != nullptr;
-    }
-    else if (size <= 1024)
-    {
-        return xx_large != nullptr;
-    }
-    else
-    {
-        std::unreachable();
-    }
+    vfs::texture_cache::global().unpin({this, std::to_underlying(get_raw_size(size))});
 }
 
-vfs::file::thumbnail_data::raw_size
-vfs::file::thumbnail_data::get_raw_size(const std::int32_t size) noexcept
+vfs::file::raw_size
+vfs::file::get_raw_size(const std::int32_t size) noexcept
 {
     if (size <= 128)
     {
@@ -645,12 +763,3 @@ vfs::file::thumbnail_data::get_raw_size(const std::int32_t size) noexcept
         std::unreachable();
     }
 }
-
-void
-vfs::file::thumbnail_data::clear() noexcept
-{
-    normal = nullptr;
-    large = nullptr;
-    x_large = nullptr;
-    xx_large = nullptr;
-}
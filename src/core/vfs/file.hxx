@@ -17,8 +17,10 @@
 
 #pragma once
 
+#include <atomic>
 #include <filesystem>
 #include <memory>
+#include <optional>
 #include <string>
 #include <string_view>
 
@@ -28,6 +30,8 @@
 
 #include "vfs/mime-type.hxx"
 
+#include "vfs/linux/statx.hxx"
+
 // https://en.cppreference.com/w/cpp/memory/enable_shared_from_this
 
 namespace vfs
@@ -37,6 +41,9 @@ class file : public std::enable_shared_from_this<file>
   private:
     file() = delete;
     explicit file(const std::filesystem::path& file_path) noexcept;
+    file(const std::filesystem::path& file_path, const vfs::linux::statx& stat) noexcept;
+    file(const std::filesystem::path& file_path, const vfs::linux::statx& stat,
+         const std::shared_ptr<vfs::mime_type>& mime_type) noexcept;
     ~file() noexcept;
     file(const file& other) = delete;
     file(file&& other) = delete;
@@ -47,11 +54,29 @@ class file : public std::enable_shared_from_this<file>
     [[nodiscard]] static std::shared_ptr<vfs::file>
     create(const std::filesystem::path& path) noexcept;
 
+    /**
+     * Create from already resolved metadata, i.e. from vfs::linux::dir_scanner,
+     * the path will not be stat'd again. The content is not read, a file the
+     * filename did not match needs sniff_mime_type().
+     */
+    [[nodiscard]] static std::shared_ptr<vfs::file>
+    create(const std::filesystem::path& path, const vfs::linux::statx& stat) noexcept;
+
+    /**
+     * Create from already resolved metadata and mime type, i.e. from vfs::dir_snapshot,
+     * the path will not be stat'd and the mime type will not be detected.
+     */
+    [[nodiscard]] static std::shared_ptr<vfs::file>
+    create(const std::filesystem::path& path, const vfs::linux::statx& stat,
+           const std::shared_ptr<vfs::mime_type>& mime_type) noexcept;
+
     [[nodiscard]] std::string_view name() const noexcept;
 
     [[nodiscard]] const std::filesystem::path& path() const noexcept;
     [[nodiscard]] std::string uri() const noexcept;
 
+    [[nodiscard]] const vfs::linux::statx& stat() const noexcept;
+
     [[nodiscard]] u64 size() const noexcept;
     [[nodiscard]] u64 size_on_disk() const noexcept;
 
@@ -63,13 +88,27 @@ class file : public std::enable_shared_from_this<file>
 
     [[nodiscard]] const std::shared_ptr<vfs::mime_type>& mime_type() const noexcept;
 
+    /**
+     * The filename did not match a mime type and the content has not been
+     * read yet, the mime type is application/octet-stream or application/x-executable
+     * until sniff_mime_type() is called.
+     */
+    [[nodiscard]] bool is_mime_type_sniff_needed() const noexcept;
+
+    /**
+     * Read the start of the file and match it against the mime.cache magic rules.
+     *
+     * @return true if the mime type changed
+     */
+    bool sniff_mime_type() noexcept;
+
     [[nodiscard]] std::string_view display_owner() const noexcept;
     [[nodiscard]] std::string_view display_group() const noexcept;
     [[nodiscard]] std::string_view display_atime() const noexcept;
     [[nodiscard]] std::string_view display_btime() const noexcept;
     [[nodiscard]] std::string_view display_ctime() const noexcept;
     [[nodiscard]] std::string_view display_mtime() const noexcept;
-    [[nodiscard]] std::string_view display_permissions() noexcept;
+    [[nodiscard]] std::string_view display_permissions() const noexcept;
 
     [[nodiscard]] std::chrono::system_clock::time_point atime() const noexcept;
     [[nodiscard]] std::chrono::system_clock::time_point btime() const noexcept;
@@ -79,9 +118,15 @@ class file : public std::enable_shared_from_this<file>
     Glib::RefPtr<Gtk::IconPaintable> icon(const std::int32_t size) const noexcept;
     Glib::RefPtr<Gdk::Paintable> thumbnail(const std::int32_t size) const noexcept;
     void load_thumbnail(const std::int32_t size, bool force_reload = false) noexcept;
-    // void unload_thumbnail(const std::int32_t size) noexcept;
     [[nodiscard]] bool is_thumbnail_loaded(const std::int32_t size) const noexcept;
 
+    /**
+     * Keep the thumbnail at size in vfs::texture_cache while it is shown,
+     * every pin_thumbnail() needs an unpin_thumbnail() with the same size.
+     */
+    void pin_thumbnail(const std::int32_t size) const noexcept;
+    void unpin_thumbnail(const std::int32_t size) const noexcept;
+
     [[nodiscard]] bool is_directory() const noexcept;
     [[nodiscard]] bool is_regular_file() const noexcept;
     [[nodiscard]] bool is_symlink() const noexcept;
@@ -118,51 +163,60 @@ class file : public std::enable_shared_from_this<file>
     // update file info
     [[nodiscard]] bool update() noexcept;
 
+    /**
+     * The file was renamed on disk, a new vfs::file for path with the same stat.
+     * The mime type is only detected again if the extension changed, by name only,
+     * and the loaded thumbnails are moved to the new file. This file is left as is
+     * since other threads may still be reading its path.
+     */
+    [[nodiscard]] std::shared_ptr<vfs::file>
+    renamed(const std::filesystem::path& path) const noexcept;
+
   private:
-    ztd::statx stat_;
+    void init_name() noexcept;
+    void update_info(const bool read_content = true) noexcept;
+
+    vfs::linux::statx stat_;
 
     std::filesystem::path path_; // real path on file system
 
-    std::string name_;                          // real name on file system
-    std::string display_size_;                  // displayed human-readable file size
-    std::string display_size_bytes_;            // displayed file size in bytes
-    std::string display_disk_size_;             // displayed human-readable file size on disk
-    std::string display_owner_;                 // displayed owner
-    std::string display_group_;                 // displayed group
-    std::string display_atime_;                 // displayed accessed time
-    std::string display_btime_;                 // displayed created time
-    std::string display_ctime_;                 // displayed last status change time
-    std::string display_mtime_;                 // displayed modification time
-    std::string display_perm_;                  // displayed permission in string form
-    std::shared_ptr<vfs::mime_type> mime_type_; // mime type related information
+    // written by the mime sniffer threads and update() while the gui reads them
+    std::atomic<vfs::mime_type::id_type> mime_type_{vfs::mime_type::unknown_id}; // interned
+    std::atomic_bool mime_type_sniffed_{false}; // content was read, or it does not need to be
+
+    // display strings, each is built on first use and all are dropped by update().
+    // only accessed from the gui thread.
+    struct display_data final
+    {
+        std::optional<std::string> size;          // human-readable file size
+        std::optional<std::string> size_in_bytes; // file size in bytes
+        std::optional<std::string> size_on_disk;  // human-readable file size on disk
+        std::optional<std::string> owner;
+        std::optional<std::string> group;
+        std::optional<std::string> atime; // accessed time
+        std::optional<std::string> btime; // created time
+        std::optional<std::string> ctime; // last status change time
+        std::optional<std::string> mtime; // modification time
+        std::optional<std::string> permissions;
+    };
+    mutable std::unique_ptr<display_data> display_;
+    [[nodiscard]] display_data& display() const noexcept;
 
     bool is_special_desktop_entry_{false}; // is a .desktop file
     bool is_hidden_{false};                // if the filename starts with '.'
 
-    struct thumbnail_data final
+    enum class raw_size : std::int32_t
     {
-        enum class raw_size : std::int32_t
-        {
-            normal = 128,
-            large = 256,
-            x_large = 512,
-            xx_large = 1024,
-        };
-
-        [[nodiscard]] static raw_size get_raw_size(const std::int32_t size) noexcept;
-
-        void set(const raw_size size, const Glib::RefPtr<Gdk::Texture>& texture) noexcept;
-        [[nodiscard]] Glib::RefPtr<Gdk::Paintable> get(const std::int32_t size) const noexcept;
-        [[nodiscard]] bool is_loaded(const std::int32_t size) const noexcept;
-        void clear() noexcept;
-
-      private:
-        Glib::RefPtr<Gdk::Texture> normal;
-        Glib::RefPtr<Gdk::Texture> large;
-        Glib::RefPtr<Gdk::Texture> x_large;
-        Glib::RefPtr<Gdk::Texture> xx_large;
+        normal = 128,
+        large = 256,
+        x_large = 512,
+        xx_large = 1024,
     };
-    thumbnail_data thumbnail_;
+    [[nodiscard]] static raw_size get_raw_size(const std::int32_t size) noexcept;
+
+    // the textures live in vfs::texture_cache, set once a key of this file is
+    // put there so that files which never had a thumbnail skip it in ~file()
+    mutable std::atomic<bool> in_texture_cache_{false};
 
     [[nodiscard]] std::string create_file_perm_string() const noexcept;
 
@@ -0,0 +1,147 @@
+/**
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <expected>
+#include <filesystem>
+#include <memory>
+#include <ranges>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "vfs/linux/dir-scanner.hxx"
+#include "vfs/linux/statx-batch.hxx"
+#include "vfs/linux/statx.hxx"
+
+#include "logger.hxx"
+
+vfs::linux::dir_scanner::dir_scanner(const std::int32_t fd) noexcept
+    : fd_(fd), buffer_(std::make_unique_for_overwrite<std::byte[]>(BUFFER_SIZE)),
+      batch_(std::make_unique<vfs::linux::statx_batch>())
+{
+}
+
+vfs::linux::dir_scanner::~dir_scanner() noexcept
+{
+    if (fd_ != -1)
+    {
+        close(fd_);
+    }
+}
+
+vfs::linux::dir_scanner::dir_scanner(dir_scanner&& other) noexcept
+    : fd_(std::exchange(other.fd_, -1)), buffer_(std::move(other.buffer_)),
+      batch_(std::move(other.batch_)), names_(std::move(other.names_))
+{
+}
+
+vfs::linux::dir_scanner&
+vfs::linux::dir_scanner::operator=(dir_scanner&& other) noexcept
+{
+    if (this != &other)
+    {
+        if (fd_ != -1)
+        {
+            close(fd_);
+        }
+        fd_ = std::exchange(other.fd_, -1);
+        buffer_ = std::move(other.buffer_);
+        batch_ = std::move(other.batch_);
+        names_ = std::move(other.names_);
+    }
+    return *this;
+}
+
+std::expected<vfs::linux::dir_scanner, std::error_code>
+vfs::linux::dir_scanner::create(const std::filesystem::path& path) noexcept
+{
+    const auto fd = open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd == -1)
+    {
+        return std::unexpected(std::error_code(errno, std::generic_category()));
+    }
+    return dir_scanner(fd);
+}
+
+std::int32_t
+vfs::linux::dir_scanner::fd() const noexcept
+{
+    return fd_;
+}
+
+std::size_t
+vfs::linux::dir_scanner::next(std::vector<entry>& entries) noexcept
+{
+    if (fd_ == -1)
+    {
+        return 0;
+    }
+
+    const auto length = getdents64(fd_, buffer_.get(), BUFFER_SIZE);
+    if (length <= 0)
+    {
+        logger::error_if<logger::vfs>(length == -1,
+                                      "getdents64 failed: {}",
+                                      std::error_code(errno, std::generic_category()).message());
+        return 0;
+    }
+
+    names_.clear();
+    for (std::ptrdiff_t offset = 0; offset < length;)
+    {
+        const auto* dirent = reinterpret_cast<const struct dirent64*>(buffer_.get() + offset);
+        offset += dirent->d_reclen;
+
+        const std::string_view name = dirent->d_name;
+        if (name == "." || name == "..")
+        {
+            continue;
+        }
+
+        names_.emplace_back(name);
+    }
+
+    const auto stats = batch_->run(fd_, names_, vfs::linux::statx::symlink::no_follow);
+
+    std::size_t count = 0;
+    for (auto&& [name, stat] : std::views::zip(names_, stats))
+    {
+        if (!stat)
+        {
+            // removed after getdents64 listed it
+            continue;
+        }
+
+        entries.emplace_back(std::move(name), *stat);
+        count += 1;
+    }
+
+    if (count == 0)
+    {
+        // a buffer of only '.' and '..' or only removed entries, keep reading
+        return next(entries);
+    }
+
+    return count;
+}
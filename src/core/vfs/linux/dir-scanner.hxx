@@ -0,0 +1,88 @@
+/**
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <expected>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <cstddef>
+#include <cstdint>
+
+#include "vfs/linux/statx-batch.hxx"
+#include "vfs/linux/statx.hxx"
+
+namespace vfs::linux
+{
+/**
+ * Directory scanner that reads entries with large getdents64(2) buffers from
+ * an O_DIRECTORY fd and resolves the metadata for each entry using statx(2)
+ * relative to that fd, so no per-file path lookup is done.
+ *
+ * The statx(2) calls for one buffer are issued as a single vfs::linux::statx_batch.
+ *
+ * Symlinks are not followed.
+ */
+class dir_scanner final
+{
+  public:
+    struct entry final
+    {
+        std::string name;
+        vfs::linux::statx stat;
+    };
+
+    dir_scanner() = delete;
+    ~dir_scanner() noexcept;
+    dir_scanner(const dir_scanner& other) = delete;
+    dir_scanner(dir_scanner&& other) noexcept;
+    dir_scanner& operator=(const dir_scanner& other) = delete;
+    dir_scanner& operator=(dir_scanner&& other) noexcept;
+
+    [[nodiscard]] static std::expected<dir_scanner, std::error_code>
+    create(const std::filesystem::path& path) noexcept;
+
+    /**
+     * Read the next batch of directory entries, one getdents64(2) buffer worth.
+     * Entries that are removed between being listed and stat'd are skipped.
+     *
+     * @param[out] entries new entries are appended
+     *
+     * @return number of entries read, 0 once the end of the directory is reached
+     */
+    [[nodiscard]] std::size_t next(std::vector<entry>& entries) noexcept;
+
+    /**
+     * @return the open directory fd, owned by the scanner
+     */
+    [[nodiscard]] std::int32_t fd() const noexcept;
+
+  private:
+    explicit dir_scanner(const std::int32_t fd) noexcept;
+
+    // 256 KiB, about 8k entries with average length filenames
+    static constexpr std::size_t BUFFER_SIZE = 256uz * 1024uz;
+
+    std::int32_t fd_{-1};
+    std::unique_ptr<std::byte[]> buffer_;
+
+    std::unique_ptr<vfs::linux::statx_batch> batch_;
+    std::vector<std::string> names_;
+};
+} // namespace vfs::linux
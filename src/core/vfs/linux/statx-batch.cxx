@@ -0,0 +1,198 @@
+/**
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <optional>
+#include <ranges>
+#include <span>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <cerrno>
+#include <cstdint>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#if defined(HAVE_IO_URING)
+#include <liburing.h>
+#endif
+
+#include "vfs/linux/statx-batch.hxx"
+#include "vfs/linux/statx.hxx"
+
+#include "logger.hxx"
+
+vfs::linux::statx_batch::statx_batch() noexcept
+{
+#if defined(HAVE_IO_URING)
+    const auto ret = io_uring_queue_init(QUEUE_DEPTH, &ring_, 0);
+    if (ret < 0)
+    {
+        // kernel too old, io_uring disabled by sysctl, or blocked by a seccomp filter
+        logger::debug<logger::vfs>("io_uring unavailable, using statx: {}",
+                                   std::error_code(-ret, std::generic_category()).message());
+        return;
+    }
+    ring_valid_ = true;
+#endif
+}
+
+vfs::linux::statx_batch::~statx_batch() noexcept
+{
+#if defined(HAVE_IO_URING)
+    if (ring_valid_)
+    {
+        io_uring_queue_exit(&ring_);
+    }
+#endif
+}
+
+bool
+vfs::linux::statx_batch::is_async() const noexcept
+{
+#if defined(HAVE_IO_URING)
+    return ring_valid_;
+#else
+    return false;
+#endif
+}
+
+std::vector<std::optional<vfs::linux::statx>>
+vfs::linux::statx_batch::run(const std::int32_t dirfd, const std::span<const std::string> names,
+                             const vfs::linux::statx::symlink follow) noexcept
+{
+#if defined(HAVE_IO_URING)
+    // not worth the submission overhead for a single name
+    if (ring_valid_ && names.size() > 1)
+    {
+        return run_async(dirfd, names, follow);
+    }
+#endif
+    return run_sync(dirfd, names, follow);
+}
+
+std::vector<std::optional<vfs::linux::statx>>
+vfs::linux::statx_batch::run_sync(const std::int32_t dirfd,
+                                  const std::span<const std::string> names,
+                                  const vfs::linux::statx::symlink follow) noexcept
+{
+    std::vector<std::optional<vfs::linux::statx>> results;
+    results.reserve(names.size());
+    for (const auto& name : names)
+    {
+        const auto stat = vfs::linux::statx::create(dirfd, name.c_str(), follow);
+        if (stat)
+        {
+            results.emplace_back(*stat);
+        }
+        else
+        {
+            results.emplace_back(std::nullopt);
+        }
+    }
+    return results;
+}
+
+#if defined(HAVE_IO_URING)
+std::vector<std::optional<vfs::linux::statx>>
+vfs::linux::statx_batch::run_async(const std::int32_t dirfd,
+                                   const std::span<const std::string> names,
+                                   const vfs::linux::statx::symlink follow) noexcept
+{
+    const std::int32_t flags = follow == vfs::linux::statx::symlink::follow
+                                   ? AT_STATX_SYNC_AS_STAT
+                                   : AT_SYMLINK_NOFOLLOW;
+    constexpr std::uint32_t mask = STATX_BASIC_STATS | STATX_BTIME;
+
+    // the kernel writes into these until the matching cqe is reaped
+    std::vector<struct ::statx> buffers(names.size());
+    std::vector<bool> valid(names.size(), false);
+
+    std::size_t queued = 0;  // sqe prepared
+    std::size_t reaped = 0;  // cqe seen
+    while (reaped < names.size())
+    {
+        while (queued < names.size() && queued - reaped < QUEUE_DEPTH)
+        {
+            auto* sqe = io_uring_get_sqe(&ring_);
+            if (sqe == nullptr)
+            {
+                break;
+            }
+
+            io_uring_prep_statx(sqe, dirfd, names[queued].c_str(), flags, mask, &buffers[queued]);
+            io_uring_sqe_set_data64(sqe, queued);
+
+            queued += 1;
+        }
+
+        const auto ret = io_uring_submit_and_wait(&ring_, 1);
+        if (ret < 0 && ret != -EINTR && ret != -EAGAIN && ret != -EBUSY)
+        {
+            logger::error<logger::vfs>("io_uring submit failed, using statx: {}",
+                                       std::error_code(-ret, std::generic_category()).message());
+
+            // the buffers must outlive every request the kernel has accepted
+            const auto submitted = queued - io_uring_sq_ready(&ring_);
+            while (reaped < submitted)
+            {
+                struct io_uring_cqe* cqe = nullptr;
+                if (io_uring_wait_cqe(&ring_, &cqe) < 0)
+                {
+                    break;
+                }
+                io_uring_cqe_seen(&ring_, cqe);
+                reaped += 1;
+            }
+
+            io_uring_queue_exit(&ring_);
+            ring_valid_ = false;
+
+            return run_sync(dirfd, names, follow);
+        }
+
+        std::uint32_t head = 0;
+        std::uint32_t count = 0;
+        struct io_uring_cqe* cqe = nullptr;
+        io_uring_for_each_cqe(&ring_, head, cqe)
+        {
+            // cqe->res is -errno, i.e. -ENOENT when removed after getdents64
+            if (cqe->res == 0)
+            {
+                valid[io_uring_cqe_get_data64(cqe)] = true;
+            }
+            count += 1;
+        }
+        io_uring_cq_advance(&ring_, count);
+        reaped += count;
+    }
+
+    std::vector<std::optional<vfs::linux::statx>> results;
+    results.reserve(names.size());
+    for (const auto idx : std::views::iota(0uz, names.size()))
+    {
+        if (valid[idx])
+        {
+            results.emplace_back(vfs::linux::statx(buffers[idx]));
+        }
+        else
+        {
+            results.emplace_back(std::nullopt);
+        }
+    }
+    return results;
+}
+#endif
@@ -0,0 +1,84 @@
+/**
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+#include <cstdint>
+
+#if defined(HAVE_IO_URING)
+#include <liburing.h>
+#endif
+
+#include "vfs/linux/statx.hxx"
+
+namespace vfs::linux
+{
+/**
+ * Resolve statx(2) for many names relative to the same directory fd.
+ *
+ * When built with io_uring support the requests are submitted as
+ * IORING_OP_STATX and up to QUEUE_DEPTH of them are kept in flight, which
+ * hides the per file round trip on network filesystems and cold disks.
+ * If io_uring is not available at runtime, or not built, every name is
+ * resolved with a blocking statx(2) call instead.
+ */
+class statx_batch final
+{
+  public:
+    statx_batch() noexcept;
+    ~statx_batch() noexcept;
+    statx_batch(const statx_batch& other) = delete;
+    statx_batch(statx_batch&& other) = delete;
+    statx_batch& operator=(const statx_batch& other) = delete;
+    statx_batch& operator=(statx_batch&& other) = delete;
+
+    /**
+     * @param[in] dirfd open directory fd
+     * @param[in] names filenames relative to dirfd
+     *
+     * @return one result per name in the same order, std::nullopt if the
+     * statx for that name failed
+     */
+    [[nodiscard]] std::vector<std::optional<vfs::linux::statx>>
+    run(const std::int32_t dirfd, const std::span<const std::string> names,
+        const vfs::linux::statx::symlink follow) noexcept;
+
+    /**
+     * @return true if requests are submitted using io_uring
+     */
+    [[nodiscard]] bool is_async() const noexcept;
+
+  private:
+    [[nodiscard]] std::vector<std::optional<vfs::linux::statx>>
+    run_sync(const std::int32_t dirfd, const std::span<const std::string> names,
+             const vfs::linux::statx::symlink follow) noexcept;
+
+#if defined(HAVE_IO_URING)
+    [[nodiscard]] std::vector<std::optional<vfs::linux::statx>>
+    run_async(const std::int32_t dirfd, const std::span<const std::string> names,
+              const vfs::linux::statx::symlink follow) noexcept;
+
+    static constexpr std::uint32_t QUEUE_DEPTH = 256;
+
+    struct io_uring ring_{};
+    bool ring_valid_{false};
+#endif
+};
+} // namespace vfs::linux
@@ -0,0 +1,387 @@
+/**
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <chrono>
+#include <expected>
+#include <filesystem>
+#include <string>
+#include <system_error>
+
+#include <cerrno>
+#include <cstdint>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+
+#include <ztd/ztd.hxx>
+
+#include "vfs/linux/statx.hxx"
+
+static constexpr std::uint32_t STATX_MASK = STATX_BASIC_STATS | STATX_BTIME;
+
+[[nodiscard]] static std::int32_t
+statx_flags(const vfs::linux::statx::symlink follow) noexcept
+{
+    return follow == vfs::linux::statx::symlink::follow ? AT_STATX_SYNC_AS_STAT
+                                                        : AT_SYMLINK_NOFOLLOW;
+}
+
+[[nodiscard]] static std::chrono::system_clock::time_point
+to_time_point(const std::int64_t sec, const std::uint32_t nsec) noexcept
+{
+    return std::chrono::system_clock::time_point(
+        std::chrono::duration_cast<std::chrono::system_clock::duration>(
+            std::chrono::seconds(sec) + std::chrono::nanoseconds(nsec)));
+}
+
+vfs::linux::statx::statx(const struct ::statx& stat) noexcept
+    : attributes_(stat.stx_attributes), attributes_mask_(stat.stx_attributes_mask),
+      ino_(stat.stx_ino), size_(stat.stx_size), blocks_(stat.stx_blocks),
+      atime_sec_(stat.stx_atime.tv_sec), btime_sec_(stat.stx_btime.tv_sec),
+      ctime_sec_(stat.stx_ctime.tv_sec), mtime_sec_(stat.stx_mtime.tv_sec),
+      atime_nsec_(stat.stx_atime.tv_nsec), btime_nsec_(stat.stx_btime.tv_nsec),
+      ctime_nsec_(stat.stx_ctime.tv_nsec), mtime_nsec_(stat.stx_mtime.tv_nsec),
+      mask_(stat.stx_mask), blksize_(stat.stx_blksize), nlink_(stat.stx_nlink),
+      uid_(stat.stx_uid), gid_(stat.stx_gid), rdev_major_(stat.stx_rdev_major),
+      rdev_minor_(stat.stx_rdev_minor), dev_major_(stat.stx_dev_major),
+      dev_minor_(stat.stx_dev_minor), mode_(stat.stx_mode)
+{
+}
+
+std::expected<vfs::linux::statx, std::error_code>
+vfs::linux::statx::create(const std::filesystem::path& path, const symlink follow) noexcept
+{
+    return create(AT_FDCWD, path.c_str(), follow);
+}
+
+std::expected<vfs::linux::statx, std::error_code>
+vfs::linux::statx::create(const std::int32_t dirfd, const char* name,
+                          const symlink follow) noexcept
+{
+    struct ::statx stat{};
+    if (::statx(dirfd, name, statx_flags(follow), STATX_MASK, &stat) == -1)
+    {
+        return std::unexpected(std::error_code(errno, std::generic_category()));
+    }
+    return statx(stat);
+}
+
+struct ::statx
+vfs::linux::statx::data() const noexcept
+{
+    struct ::statx stat{};
+    stat.stx_mask = mask_;
+    stat.stx_blksize = blksize_;
+    stat.stx_attributes = attributes_;
+    stat.stx_nlink = nlink_;
+    stat.stx_uid = uid_;
+    stat.stx_gid = gid_;
+    stat.stx_mode = mode_;
+    stat.stx_ino = ino_;
+    stat.stx_size = size_;
+    stat.stx_blocks = blocks_;
+    stat.stx_attributes_mask = attributes_mask_;
+    stat.stx_atime.tv_sec = atime_sec_;
+    stat.stx_atime.tv_nsec = atime_nsec_;
+    stat.stx_btime.tv_sec = btime_sec_;
+    stat.stx_btime.tv_nsec = btime_nsec_;
+    stat.stx_ctime.tv_sec = ctime_sec_;
+    stat.stx_ctime.tv_nsec = ctime_nsec_;
+    stat.stx_mtime.tv_sec = mtime_sec_;
+    stat.stx_mtime.tv_nsec = mtime_nsec_;
+    stat.stx_rdev_major = rdev_major_;
+    stat.stx_rdev_minor = rdev_minor_;
+    stat.stx_dev_major = dev_major_;
+    stat.stx_dev_minor = dev_minor_;
+    return stat;
+}
+
+std::uint32_t
+vfs::linux::statx::mode() const noexcept
+{
+    return mode_;
+}
+
+std::filesystem::perms
+vfs::linux::statx::perms() const noexcept
+{
+    return static_cast<std::filesystem::perms>(mode_) & std::filesystem::perms::mask;
+}
+
+std::string
+vfs::linux::statx::perms_fancy() const noexcept
+{
+    // ls(1) style permission string, i.e. drwxr-xr-x
+    std::string perm = "----------";
+
+    if (is_directory())
+    {
+        perm[0] = 'd';
+    }
+    else if (is_symlink())
+    {
+        perm[0] = 'l';
+    }
+    else if (is_character_file())
+    {
+        perm[0] = 'c';
+    }
+    else if (is_block_file())
+    {
+        perm[0] = 'b';
+    }
+    else if (is_fifo())
+    {
+        perm[0] = 'p';
+    }
+    else if (is_socket())
+    {
+        perm[0] = 's';
+    }
+
+    const auto mode = mode_;
+
+    // owner
+    if (mode & S_IRUSR)
+    {
+        perm[1] = 'r';
+    }
+    if (mode & S_IWUSR)
+    {
+        perm[2] = 'w';
+    }
+    if (mode & S_ISUID)
+    {
+        perm[3] = (mode & S_IXUSR) ? 's' : 'S';
+    }
+    else if (mode & S_IXUSR)
+    {
+        perm[3] = 'x';
+    }
+
+    // group
+    if (mode & S_IRGRP)
+    {
+        perm[4] = 'r';
+    }
+    if (mode & S_IWGRP)
+    {
+        perm[5] = 'w';
+    }
+    if (mode & S_ISGID)
+    {
+        perm[6] = (mode & S_IXGRP) ? 's' : 'S';
+    }
+    else if (mode & S_IXGRP)
+    {
+        perm[6] = 'x';
+    }
+
+    // other
+    if (mode & S_IROTH)
+    {
+        perm[7] = 'r';
+    }
+    if (mode & S_IWOTH)
+    {
+        perm[8] = 'w';
+    }
+    if (mode & S_ISVTX)
+    {
+        perm[9] = (mode & S_IXOTH) ? 't' : 'T';
+    }
+    else if (mode & S_IXOTH)
+    {
+        perm[9] = 'x';
+    }
+
+    return perm;
+}
+
+u64
+vfs::linux::statx::ino() const noexcept
+{
+    return u64(ino_);
+}
+
+u64
+vfs::linux::statx::dev() const noexcept
+{
+    return u64(makedev(dev_major_, dev_minor_));
+}
+
+u64
+vfs::linux::statx::nlink() const noexcept
+{
+    return u64(nlink_);
+}
+
+u32
+vfs::linux::statx::uid() const noexcept
+{
+    return u32(uid_);
+}
+
+u32
+vfs::linux::statx::gid() const noexcept
+{
+    return u32(gid_);
+}
+
+u64
+vfs::linux::statx::size() const noexcept
+{
+    return u64(size_);
+}
+
+u64
+vfs::linux::statx::size_on_disk() const noexcept
+{
+    // stx_blocks is always in 512 byte units, independent of stx_blksize
+    return u64(blocks_ * 512);
+}
+
+u64
+vfs::linux::statx::blocks() const noexcept
+{
+    return u64(blocks_);
+}
+
+std::chrono::system_clock::time_point
+vfs::linux::statx::atime() const noexcept
+{
+    return to_time_point(atime_sec_, atime_nsec_);
+}
+
+std::chrono::system_clock::time_point
+vfs::linux::statx::btime() const noexcept
+{
+    return to_time_point(btime_sec_, btime_nsec_);
+}
+
+std::chrono::system_clock::time_point
+vfs::linux::statx::ctime() const noexcept
+{
+    return to_time_point(ctime_sec_, ctime_nsec_);
+}
+
+std::chrono::system_clock::time_point
+vfs::linux::statx::mtime() const noexcept
+{
+    return to_time_point(mtime_sec_, mtime_nsec_);
+}
+
+bool
+vfs::linux::statx::is_directory() const noexcept
+{
+    return S_ISDIR(mode_);
+}
+
+bool
+vfs::linux::statx::is_regular_file() const noexcept
+{
+    return S_ISREG(mode_);
+}
+
+bool
+vfs::linux::statx::is_symlink() const noexcept
+{
+    return S_ISLNK(mode_);
+}
+
+bool
+vfs::linux::statx::is_socket() const noexcept
+{
+    return S_ISSOCK(mode_);
+}
+
+bool
+vfs::linux::statx::is_fifo() const noexcept
+{
+    return S_ISFIFO(mode_);
+}
+
+bool
+vfs::linux::statx::is_block_file() const noexcept
+{
+    return S_ISBLK(mode_);
+}
+
+bool
+vfs::linux::statx::is_character_file() const noexcept
+{
+    return S_ISCHR(mode_);
+}
+
+bool
+vfs::linux::statx::has_attribute(const std::uint64_t attribute) const noexcept
+{
+    return (attributes_mask_ & attribute) && (attributes_ & attribute);
+}
+
+bool
+vfs::linux::statx::is_compressed() const noexcept
+{
+    return has_attribute(STATX_ATTR_COMPRESSED);
+}
+
+bool
+vfs::linux::statx::is_immutable() const noexcept
+{
+    return has_attribute(STATX_ATTR_IMMUTABLE);
+}
+
+bool
+vfs::linux::statx::is_append() const noexcept
+{
+    return has_attribute(STATX_ATTR_APPEND);
+}
+
+bool
+vfs::linux::statx::is_nodump() const noexcept
+{
+    return has_attribute(STATX_ATTR_NODUMP);
+}
+
+bool
+vfs::linux::statx::is_encrypted() const noexcept
+{
+    return has_attribute(STATX_ATTR_ENCRYPTED);
+}
+
+bool
+vfs::linux::statx::is_automount() const noexcept
+{
+    return has_attribute(STATX_ATTR_AUTOMOUNT);
+}
+
+bool
+vfs::linux::statx::is_mount_root() const noexcept
+{
+    return has_attribute(STATX_ATTR_MOUNT_ROOT);
+}
+
+bool
+vfs::linux::statx::is_verity() const noexcept
+{
+    return has_attribute(STATX_ATTR_VERITY);
+}
+
+bool
+vfs::linux::statx::is_dax() const noexcept
+{
+    return has_attribute(STATX_ATTR_DAX);
+}
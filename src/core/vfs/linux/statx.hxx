@@ -0,0 +1,132 @@
+/**
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <expected>
+#include <filesystem>
+#include <string>
+#include <system_error>
+
+#include <cstdint>
+
+#include <sys/stat.h>
+
+#include <ztd/ztd.hxx>
+
+namespace vfs::linux
+{
+/**
+ * Wrapper around struct statx.
+ *
+ * Same interface as ztd::statx but can also be created relative to an open
+ * directory fd, or from an already filled struct statx, so callers that
+ * already have the metadata do not need to resolve the path again.
+ */
+class statx final
+{
+  public:
+    enum class symlink : std::uint8_t
+    {
+        follow,
+        no_follow,
+    };
+
+    statx() = default;
+    explicit statx(const struct ::statx& stat) noexcept;
+
+    [[nodiscard]] static std::expected<statx, std::error_code>
+    create(const std::filesystem::path& path, const symlink follow = symlink::follow) noexcept;
+
+    /**
+     * @param[in] dirfd open directory fd
+     * @param[in] name null terminated filename relative to dirfd
+     */
+    [[nodiscard]] static std::expected<statx, std::error_code>
+    create(const std::int32_t dirfd, const char* name,
+           const symlink follow = symlink::follow) noexcept;
+
+    // rebuilt from the packed fields, only the fields in STATX_BASIC_STATS | STATX_BTIME are set
+    [[nodiscard]] struct ::statx data() const noexcept;
+
+    [[nodiscard]] std::uint32_t mode() const noexcept;
+    [[nodiscard]] std::filesystem::perms perms() const noexcept;
+    [[nodiscard]] std::string perms_fancy() const noexcept;
+
+    [[nodiscard]] u64 ino() const noexcept;
+    [[nodiscard]] u64 dev() const noexcept;
+    [[nodiscard]] u64 nlink() const noexcept;
+    [[nodiscard]] u32 uid() const noexcept;
+    [[nodiscard]] u32 gid() const noexcept;
+
+    [[nodiscard]] u64 size() const noexcept;
+    [[nodiscard]] u64 size_on_disk() const noexcept;
+    [[nodiscard]] u64 blocks() const noexcept;
+
+    [[nodiscard]] std::chrono::system_clock::time_point atime() const noexcept;
+    [[nodiscard]] std::chrono::system_clock::time_point btime() const noexcept;
+    [[nodiscard]] std::chrono::system_clock::time_point ctime() const noexcept;
+    [[nodiscard]] std::chrono::system_clock::time_point mtime() const noexcept;
+
+    [[nodiscard]] bool is_directory() const noexcept;
+    [[nodiscard]] bool is_regular_file() const noexcept;
+    [[nodiscard]] bool is_symlink() const noexcept;
+    [[nodiscard]] bool is_socket() const noexcept;
+    [[nodiscard]] bool is_fifo() const noexcept;
+    [[nodiscard]] bool is_block_file() const noexcept;
+    [[nodiscard]] bool is_character_file() const noexcept;
+
+    // File attributes
+    [[nodiscard]] bool is_compressed() const noexcept;
+    [[nodiscard]] bool is_immutable() const noexcept;
+    [[nodiscard]] bool is_append() const noexcept;
+    [[nodiscard]] bool is_nodump() const noexcept;
+    [[nodiscard]] bool is_encrypted() const noexcept;
+    [[nodiscard]] bool is_automount() const noexcept;
+    [[nodiscard]] bool is_mount_root() const noexcept;
+    [[nodiscard]] bool is_verity() const noexcept;
+    [[nodiscard]] bool is_dax() const noexcept;
+
+  private:
+    [[nodiscard]] bool has_attribute(const std::uint64_t attribute) const noexcept;
+
+    // struct statx is 256 bytes, most of it reserved padding. only the
+    // fields that are read are kept, grouped by size so nothing is padded.
+    std::uint64_t attributes_{0};
+    std::uint64_t attributes_mask_{0};
+    std::uint64_t ino_{0};
+    std::uint64_t size_{0};
+    std::uint64_t blocks_{0};
+    std::int64_t atime_sec_{0};
+    std::int64_t btime_sec_{0};
+    std::int64_t ctime_sec_{0};
+    std::int64_t mtime_sec_{0};
+    std::uint32_t atime_nsec_{0};
+    std::uint32_t btime_nsec_{0};
+    std::uint32_t ctime_nsec_{0};
+    std::uint32_t mtime_nsec_{0};
+    std::uint32_t mask_{0};
+    std::uint32_t blksize_{0};
+    std::uint32_t nlink_{0};
+    std::uint32_t uid_{0};
+    std::uint32_t gid_{0};
+    std::uint32_t rdev_major_{0};
+    std::uint32_t rdev_minor_{0};
+    std::uint32_t dev_major_{0};
+    std::uint32_t dev_minor_{0};
+    std::uint16_t mode_{0};
+};
+} // namespace vfs::linux
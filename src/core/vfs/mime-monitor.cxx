@@ -14,28 +14,146 @@
  */
 
 #include <filesystem>
-#include <thread>
+#include <memory>
+#include <vector>
 
+#include <glibmm.h>
+
+#include "vfs/desktop-index.hxx"
 #include "vfs/execute.hxx"
 #include "vfs/mime-monitor.hxx"
 #include "vfs/notify-cpp/controller.hxx"
 #include "vfs/user-dirs.hxx"
 
+#include "vfs/mime-type/mime-apps.hxx"
+#include "vfs/mime-type/mime-cache.hxx"
+#include "vfs/mime-type/mime-info.hxx"
+
 namespace
 {
-std::jthread thread;
+std::unique_ptr<notify::controller> notifier;
+// the mime dirs holding a mime.cache
+std::vector<std::unique_ptr<notify::controller>> cache_notifiers;
+// the dirs holding a mimeapps.list or mimeinfo.cache
+std::vector<std::unique_ptr<notify::controller>> apps_notifiers;
+
+void
+watch_mime_caches() noexcept
+{
+    std::vector<std::filesystem::path> dirs;
+    dirs.push_back(vfs::user::data() / "mime");
+    for (const std::filesystem::path sys_dir : Glib::get_system_data_dirs())
+    {
+        dirs.push_back(sys_dir / "mime");
+    }
+
+    auto slot = [](const std::filesystem::path& path)
+    {
+        if (path.filename() == "mime.cache")
+        {
+            vfs::detail::mime_type::mime_database::reload();
+            vfs::detail::mime_type::mime_info::reload();
+        }
+    };
+
+    for (const auto& dir : dirs)
+    {
+        if (!std::filesystem::is_directory(dir))
+        {
+            continue;
+        }
+
+        // update-mime-database writes mime.cache.new and renames it over mime.cache
+        auto cache_notifier = std::make_unique<notify::controller>(dir);
+        cache_notifier->signal_close_write().connect(slot);
+        cache_notifier->signal_moved_to().connect(slot);
+        cache_notifier->signal_rename().connect([slot](const auto&, const auto& path)
+                                                { slot(path); });
+        cache_notifier->signal_create().connect(slot);
+        cache_notifier->signal_delete().connect(slot);
+        cache_notifier->signal_queue_overflow().connect(
+            [](const auto&)
+            {
+                vfs::detail::mime_type::mime_database::reload();
+                vfs::detail::mime_type::mime_info::reload();
+            });
+        cache_notifier->start();
+
+        cache_notifiers.push_back(std::move(cache_notifier));
+    }
+}
+
+void
+watch_mime_apps() noexcept
+{
+    // mimeinfo.cache is rewritten by update-desktop-database when a desktop file changes
+    auto slot = [](const std::filesystem::path& path)
+    {
+        const auto filename = path.filename();
+        if (filename.extension() == ".desktop")
+        {
+            vfs::desktop_index::reload();
+            vfs::detail::mime_type::mime_apps::reload();
+        }
+        else if (filename == "mimeapps.list" || filename == "mimeinfo.cache")
+        {
+            vfs::detail::mime_type::mime_apps::reload();
+        }
+    };
+
+    for (const auto& dir : vfs::detail::mime_type::mime_apps::dirs())
+    {
+        if (!std::filesystem::is_directory(dir))
+        {
+            continue;
+        }
+
+        auto apps_notifier = std::make_unique<notify::controller>(dir);
+        apps_notifier->signal_close_write().connect(slot);
+        apps_notifier->signal_moved_to().connect(slot);
+        apps_notifier->signal_moved_from().connect(slot);
+        apps_notifier->signal_rename().connect(
+            [slot](const auto& from, const auto& to)
+            {
+                slot(from);
+                slot(to);
+            });
+        apps_notifier->signal_create().connect(slot);
+        apps_notifier->signal_delete().connect(slot);
+        apps_notifier->signal_queue_overflow().connect(
+            [](const auto&)
+            {
+                vfs::desktop_index::reload();
+                vfs::detail::mime_type::mime_apps::reload();
+            });
+        apps_notifier->start();
+
+        apps_notifiers.push_back(std::move(apps_notifier));
+    }
+}
 } // namespace
 
 void
 vfs::mime_monitor_init() noexcept
 {
+    if (notifier || !cache_notifiers.empty() || !apps_notifiers.empty())
+    {
+        return;
+    }
+
+    watch_mime_caches();
+    watch_mime_apps();
+
+    // the app chooser and open with menus use it, build it before they are shown
+    vfs::desktop_index::preload();
+
     const auto path = vfs::user::data() / "mime" / "packages";
     if (!std::filesystem::is_directory(path))
     {
         return;
     }
 
-    static notify::controller notifier(path);
+    notifier = std::make_unique<notify::controller>(path);
 
     auto slot = [](const std::filesystem::path&)
     {
@@ -51,20 +169,21 @@ vfs::mime_monitor_init() noexcept
         }
     };
 
-    notifier.signal_attrib().connect(slot);
-    notifier.signal_close_write().connect(slot);
-    notifier.signal_moved_from().connect(slot);
-    notifier.signal_moved_to().connect(slot);
-    notifier.signal_create().connect(slot);
-    notifier.signal_delete().connect(slot);
+    notifier->signal_attrib().connect(slot);
+    notifier->signal_close_write().connect(slot);
+    notifier->signal_moved_from().connect(slot);
+    notifier->signal_moved_to().connect(slot);
+    notifier->signal_rename().connect([slot](const auto&, const auto& path) { slot(path); });
+    notifier->signal_create().connect(slot);
+    notifier->signal_delete().connect(slot);
 
-    thread = std::jthread([&](const std::stop_token& stoken) { notifier.run(stoken); });
-    pthread_setname_np(thread.native_handle(), "mime notifier");
+    notifier->start();
 }
 
 void
 vfs::mime_monitor_shutdown() noexcept
 {
-    thread.request_stop();
-    thread.join();
+    notifier = nullptr;
+    cache_notifiers.clear();
+    apps_notifiers.clear();
 }
@@ -17,6 +17,11 @@
 
 namespace vfs
 {
+/**
+ * Watch the user mime packages to run update-mime-database, every
+ * mime dir for a new mime.cache to reload the mime database, and every
+ * applications dir for changed associations and desktop files.
+ */
 void mime_monitor_init() noexcept;
 void mime_monitor_shutdown() noexcept;
 } // namespace vfs
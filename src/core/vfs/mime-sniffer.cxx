@@ -0,0 +1,99 @@
+/**
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <memory>
+#include <mutex>
+#include <stop_token>
+#include <utility>
+#include <vector>
+
+#include "vfs/executor.hxx"
+#include "vfs/mime-sniffer.hxx"
+
+void
+vfs::mime_sniffer::request(const std::shared_ptr<vfs::file>& file) noexcept
+{
+    std::scoped_lock lock(mutex_);
+    queue_.push_back(file);
+
+    if (!running_)
+    {
+        running_ = true;
+        tasks_.submit([this](const std::stop_token& stoken) { run(stoken); });
+    }
+}
+
+void
+vfs::mime_sniffer::stop() noexcept
+{
+    {
+        std::scoped_lock lock(mutex_);
+        queue_.clear();
+    }
+
+    tasks_.shutdown();
+    tasks_.wait();
+}
+
+void
+vfs::mime_sniffer::run(const std::stop_token& stoken) noexcept
+{
+    std::vector<std::shared_ptr<vfs::file>> changed;
+
+    while (true)
+    {
+        std::vector<std::shared_ptr<vfs::file>> files;
+        {
+            std::scoped_lock lock(mutex_);
+            if (stoken.stop_requested() || queue_.empty())
+            {
+                running_ = false;
+                break;
+            }
+
+            // files are requested as they are bound, the first are the ones on screen
+            files = std::exchange(queue_, {});
+        }
+
+        for (const auto& file : files)
+        {
+            if (stoken.stop_requested())
+            {
+                break;
+            }
+
+            // the same file can be queued again by a rebind before it was read
+            if (!file->is_mime_type_sniff_needed())
+            {
+                continue;
+            }
+
+            if (file->sniff_mime_type())
+            {
+                changed.push_back(file);
+            }
+
+            if (changed.size() >= SIGNAL_BATCH_SIZE)
+            {
+                signal_mime_types_changed().emit(std::exchange(changed, {}));
+            }
+        }
+    }
+
+    if (!changed.empty() && !stoken.stop_requested())
+    {
+        signal_mime_types_changed().emit(std::move(changed));
+    }
+}
@@ -0,0 +1,74 @@
+/**
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <stop_token>
+#include <vector>
+
+#include <sigc++/sigc++.h>
+
+#include "vfs/executor.hxx"
+#include "vfs/file.hxx"
+
+namespace vfs
+{
+/**
+ * Reads the content of files whose mime type could not be found from the
+ * filename. Only files that are shown are requested, so a directory load
+ * never opens any file.
+ */
+class mime_sniffer
+{
+  public:
+    /**
+     * Queue a file, the queue is processed by a vfs::executor task
+     * that only exists while there are requests.
+     */
+    void request(const std::shared_ptr<vfs::file>& file) noexcept;
+
+    /**
+     * Drop all queued requests and wait for the running one to finish,
+     * requests made after this are never run.
+     */
+    void stop() noexcept;
+
+    /**
+     * Emitted from the executor with the files whose mime type
+     * changed, at most SIGNAL_BATCH_SIZE files at a time.
+     */
+    [[nodiscard]] auto
+    signal_mime_types_changed() noexcept
+    {
+        return signal_mime_types_changed_;
+    }
+
+  private:
+    void run(const std::stop_token& stoken) noexcept;
+
+    static constexpr std::size_t SIGNAL_BATCH_SIZE = 64;
+
+    std::vector<std::shared_ptr<vfs::file>> queue_;
+    bool running_{false};
+    std::mutex mutex_;
+
+    vfs::task_group tasks_;
+
+    // Signals
+    sigc::signal<void(std::vector<std::shared_ptr<vfs::file>>)> signal_mime_types_changed_;
+};
+} // namespace vfs
@@ -15,13 +15,16 @@
  * along with this program. If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <array>
+#include <atomic>
 #include <filesystem>
-#include <flat_map>
+#include <functional>
 #include <memory>
 #include <mutex>
 #include <optional>
 #include <string>
 #include <string_view>
+#include <utility>
 #include <vector>
 
 #include <glibmm.h>
@@ -39,56 +42,191 @@
 
 namespace global
 {
-static std::flat_map<std::string, std::shared_ptr<vfs::mime_type>> mime_map;
-static std::mutex mime_map_lock;
+// 16-bit ids, chunks are allocated as types are interned and never freed
+constexpr std::size_t MIME_CHUNK_SIZE = 256;
+constexpr std::size_t MIME_CHUNKS = 256;
+struct mime_chunk final
+{
+    std::array<std::shared_ptr<vfs::mime_type>, MIME_CHUNK_SIZE> types;
+};
+static std::array<std::atomic<mime_chunk*>, MIME_CHUNKS> mime_chunks;
+
+// name -> type, open addressing with linear probing, slots are only ever filled.
+// kept at most 3/4 full, a system has a few thousand mime types at most
+constexpr std::size_t MIME_INDEX_SIZE = 16384;
+constexpr std::size_t MIME_MAX_TYPES = MIME_INDEX_SIZE / 4 * 3;
+static std::array<std::atomic<const vfs::mime_type*>, MIME_INDEX_SIZE> mime_index;
+
+static std::size_t mime_count{0};
+static std::mutex mime_intern_lock; // only taken to intern a new type
 } // namespace global
 
-std::shared_ptr<vfs::mime_type>
+namespace
+{
+/**
+ * @return the index slot holding type, or the empty slot it would go in
+ */
+[[nodiscard]] std::size_t
+find_slot(const std::string_view type, const vfs::mime_type*& found) noexcept
+{
+    auto slot = std::hash<std::string_view>{}(type) & (global::MIME_INDEX_SIZE - 1);
+    while (true)
+    {
+        found = global::mime_index[slot].load(std::memory_order_acquire);
+        if (found == nullptr || found->type() == type)
+        {
+            return slot;
+        }
+        slot = (slot + 1) & (global::MIME_INDEX_SIZE - 1);
+    }
+}
+} // namespace
+
+const std::shared_ptr<vfs::mime_type>&
 vfs::mime_type::create(std::string_view type) noexcept
 {
-    std::scoped_lock lock(global::mime_map_lock);
-    if (global::mime_map.contains(type.data()))
+    const vfs::mime_type* found = nullptr;
+    (void)find_slot(type, found);
+    if (found != nullptr)
     {
-        return global::mime_map.at(type.data());
+        return from_id(found->id());
     }
 
     struct hack : public vfs::mime_type
     {
-        hack(std::string_view type) : mime_type(type) {}
+        hack(std::string_view type, const id_type id, std::string&& description)
+            : mime_type(type, id, std::move(description))
+        {
+        }
+    };
+
+    // not under mime_intern_lock, the first lookup builds the mime_info index
+    // and every thread interning a type would wait on it
+    const auto describe = [](const std::string_view type)
+    {
+        auto description = vfs::detail::mime_type::get_desc_icon(type)[1];
+        if (description.empty() && type != vfs::constants::mime_type::unknown)
+        {
+            logger::warn<logger::vfs>("mime-type {} has no description (comment)", type);
+            description =
+                vfs::detail::mime_type::get_desc_icon(vfs::constants::mime_type::unknown)[1];
+        }
+        return description;
+    };
+
+    // mime_intern_lock must be held
+    const auto intern = [](const std::string_view type,
+                           std::string&& description) -> const std::shared_ptr<vfs::mime_type>&
+    {
+        // interned by another thread while waiting
+        const vfs::mime_type* found = nullptr;
+        const auto slot = find_slot(type, found);
+        if (found != nullptr)
+        {
+            return from_id(found->id());
+        }
+
+        if (global::mime_count >= global::MIME_MAX_TYPES)
+        {
+            logger::error<logger::vfs>("mime type table is full, using {} for {}",
+                                       vfs::constants::mime_type::unknown,
+                                       type);
+            return from_id(unknown_id);
+        }
+
+        const auto id = static_cast<id_type>(global::mime_count);
+
+        auto& chunk = global::mime_chunks[id / global::MIME_CHUNK_SIZE];
+        if (chunk.load(std::memory_order_relaxed) == nullptr)
+        {
+            chunk.store(new global::mime_chunk, std::memory_order_release);
+        }
+
+        auto& entry = chunk.load(std::memory_order_relaxed)->types[id % global::MIME_CHUNK_SIZE];
+        entry = std::make_shared<hack>(type, id, std::move(description));
+
+        // publishes the table entry written above
+        global::mime_index[slot].store(entry.get(), std::memory_order_release);
+        global::mime_count += 1;
+
+        return entry;
     };
 
-    const auto mime_type = std::make_shared<hack>(type);
-    global::mime_map.insert({type.data(), mime_type});
-    return mime_type;
+    // the first chunk is allocated when application/octet-stream is interned
+    std::optional<std::string> unknown_description;
+    if (global::mime_chunks[0].load(std::memory_order_acquire) == nullptr)
+    {
+        unknown_description = describe(vfs::constants::mime_type::unknown);
+    }
+    auto description = describe(type);
+
+    std::scoped_lock lock(global::mime_intern_lock);
+
+    // application/octet-stream is always unknown_id
+    if (global::mime_count == 0)
+    {
+        (void)intern(vfs::constants::mime_type::unknown, std::move(*unknown_description));
+    }
+
+    return intern(type, std::move(description));
+}
+
+const std::shared_ptr<vfs::mime_type>&
+vfs::mime_type::from_id(const id_type id) noexcept
+{
+    const auto* chunk =
+        global::mime_chunks[id / global::MIME_CHUNK_SIZE].load(std::memory_order_acquire);
+    return chunk->types[id % global::MIME_CHUNK_SIZE];
+}
+
+vfs::mime_type::id_type
+vfs::mime_type::id() const noexcept
+{
+    return id_;
 }
 
-std::shared_ptr<vfs::mime_type>
+const std::shared_ptr<vfs::mime_type>&
 vfs::mime_type::create_from_file(const std::filesystem::path& path) noexcept
 {
     return vfs::mime_type::create(vfs::detail::mime_type::get_by_file(path));
 }
 
-std::shared_ptr<vfs::mime_type>
+const std::shared_ptr<vfs::mime_type>&
+vfs::mime_type::create_from_file(const std::filesystem::path& path,
+                                 const vfs::linux::statx& stat, const bool read_content) noexcept
+{
+    return vfs::mime_type::create(vfs::detail::mime_type::get_by_file(path, stat, read_content));
+}
+
+const std::shared_ptr<vfs::mime_type>&
+vfs::mime_type::create_from_content(const std::filesystem::path& path) noexcept
+{
+    return vfs::mime_type::create(vfs::detail::mime_type::get_by_content(path));
+}
+
+const std::shared_ptr<vfs::mime_type>&
 vfs::mime_type::create_from_type(std::string_view type) noexcept
 {
     return vfs::mime_type::create(type);
 }
 
-vfs::mime_type::mime_type(std::string_view type) noexcept : type_(type)
+vfs::mime_type::mime_type(std::string_view type, const id_type id,
+                          std::string&& description) noexcept
+    : type_(type), description_(std::move(description)), id_(id)
 {
-    const auto icon_data = vfs::detail::mime_type::get_desc_icon(type_);
-    description_ = icon_data[1];
-    if (description_.empty() && type_ != vfs::constants::mime_type::unknown)
+    const auto set = [this](const flag flag, const bool value)
     {
-        logger::warn<logger::vfs>("mime-type {} has no description (comment)", type_);
-
-        const auto mime_unknown =
-            vfs::mime_type::create_from_type(vfs::constants::mime_type::unknown);
-        if (mime_unknown)
+        if (value)
         {
-            description_ = mime_unknown->description();
+            flags_ |= std::to_underlying(flag);
         }
-    }
+    };
+    set(flag::archive, vfs::detail::mime_type::is_archive(type_));
+    set(flag::executable, vfs::detail::mime_type::is_executable(type_));
+    set(flag::text, vfs::detail::mime_type::is_text(type_));
+    set(flag::image, vfs::detail::mime_type::is_image(type_));
+    set(flag::video, vfs::detail::mime_type::is_video(type_));
+    set(flag::audio, vfs::detail::mime_type::is_audio(type_));
 }
 
 vfs::mime_type::~mime_type() noexcept
@@ -260,43 +398,50 @@ vfs::mime_type::add_action(std::string_view desktop_id) const noexcept
 bool
 vfs::mime_type::is_archive() const noexcept
 {
-    return vfs::detail::mime_type::is_archive(type_);
+    return has(flag::archive);
 }
 
 bool
 vfs::mime_type::is_executable() const noexcept
 {
-    return vfs::detail::mime_type::is_executable(type_);
+    return has(flag::executable);
 }
 
 bool
 vfs::mime_type::is_text() const noexcept
 {
-    return vfs::detail::mime_type::is_text(type_);
+    return has(flag::text);
 }
 
 bool
 vfs::mime_type::is_image() const noexcept
 {
-    return vfs::detail::mime_type::is_image(type_);
+    return has(flag::image);
 }
 
 bool
 vfs::mime_type::is_video() const noexcept
 {
-    return vfs::detail::mime_type::is_video(type_);
+    return has(flag::video);
 }
 
 bool
 vfs::mime_type::is_audio() const noexcept
 {
-    return vfs::detail::mime_type::is_audio(type_);
+    return has(flag::audio);
 }
 
 bool
 vfs::mime_type::is_media() const noexcept
 {
-    return is_image() || is_video() || is_audio();
+    return (flags_ & (std::to_underlying(flag::image) | std::to_underlying(flag::video) |
+                      std::to_underlying(flag::audio))) != 0;
+}
+
+bool
+vfs::mime_type::has(const flag flag) const noexcept
+{
+    return (flags_ & std::to_underlying(flag)) != 0;
 }
 
 std::optional<std::filesystem::path>
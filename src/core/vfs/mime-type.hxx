@@ -25,11 +25,15 @@
 #include <string_view>
 #include <vector>
 
+#include <cstdint>
+
 #include <gdkmm.h>
 #include <gtkmm.h>
 
 #include <ztd/ztd.hxx>
 
+#include "vfs/linux/statx.hxx"
+
 namespace vfs
 {
 namespace constants::mime_type
@@ -41,11 +45,22 @@ inline constexpr std::string_view plain_text{"text/plain"};
 inline constexpr std::string_view zerosize{"application/x-zerosize"};
 } // namespace constants::mime_type
 
+/**
+ * Every mime type is interned once into a process wide table and never
+ * freed, it is identified by a dense 16-bit id. Looking up a type by id or
+ * by name takes no lock, only interning a new type does.
+ */
 class mime_type
 {
+  public:
+    using id_type = std::uint16_t;
+
+    // id of application/octet-stream, also used once the table is full
+    static constexpr id_type unknown_id = 0;
+
   private:
     mime_type() = delete;
-    explicit mime_type(std::string_view type) noexcept;
+    mime_type(std::string_view type, const id_type id, std::string&& description) noexcept;
     ~mime_type() noexcept;
     mime_type(const mime_type& other) = delete;
     mime_type(mime_type&& other) = delete;
@@ -53,12 +68,30 @@ class mime_type
     mime_type& operator=(mime_type&& other) = delete;
 
   public:
-    [[nodiscard]] static std::shared_ptr<vfs::mime_type>
+    // the returned references are to the interned table and stay valid for the process
+
+    [[nodiscard]] static const std::shared_ptr<vfs::mime_type>&
     create_from_file(const std::filesystem::path& path) noexcept;
 
-    [[nodiscard]] static std::shared_ptr<vfs::mime_type>
+    // without read_content a file the filename did not match is not read,
+    // see create_from_content()
+    [[nodiscard]] static const std::shared_ptr<vfs::mime_type>&
+    create_from_file(const std::filesystem::path& path, const vfs::linux::statx& stat,
+                     const bool read_content = true) noexcept;
+
+    // read the start of the file, for files the filename did not match
+    [[nodiscard]] static const std::shared_ptr<vfs::mime_type>&
+    create_from_content(const std::filesystem::path& path) noexcept;
+
+    [[nodiscard]] static const std::shared_ptr<vfs::mime_type>&
     create_from_type(std::string_view type) noexcept;
 
+    // id must have been returned by id() of an interned type
+    [[nodiscard]] static const std::shared_ptr<vfs::mime_type>&
+    from_id(const id_type id) noexcept;
+
+    [[nodiscard]] id_type id() const noexcept;
+
     [[nodiscard]] Glib::RefPtr<Gtk::IconPaintable> icon(const std::int32_t size) noexcept;
 
     // Get mime-type string
@@ -88,10 +121,26 @@ class mime_type
     [[nodiscard]] bool is_media() const noexcept;
 
   private:
-    [[nodiscard]] static std::shared_ptr<vfs::mime_type> create(std::string_view type) noexcept;
+    [[nodiscard]] static const std::shared_ptr<vfs::mime_type>&
+    create(std::string_view type) noexcept;
+
+    // set once when the type is interned
+    enum class flag : std::uint8_t
+    {
+        none = 0,
+        archive = 1 << 0,
+        executable = 1 << 1,
+        text = 1 << 2,
+        image = 1 << 3,
+        video = 1 << 4,
+        audio = 1 << 5,
+    };
+    [[nodiscard]] bool has(const flag flag) const noexcept;
 
     std::string type_;
     std::string description_;
+    id_type id_;
+    std::uint8_t flags_{0};
 
     std::flat_map<std::int32_t, Glib::RefPtr<Gtk::IconPaintable>> icons_;
 };
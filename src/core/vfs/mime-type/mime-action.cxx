@@ -22,17 +22,15 @@
  *   Association between MIME types and applications 1.0.1
  *   http://standards.freedesktop.org/mime-apps-spec/mime-apps-spec-latest.html
  *
- * However, for reading the hierarchy and determining default and associated
- * applications, it uses a best-guess algorithm for better performance and
- * compatibility with older systems, and is NOT fully spec compliant.
+ * Default and associated applications are read from the process wide
+ * vfs::detail::mime_type::mime_apps index. Desktop specific mimeapps.list
+ * files and the associations of parent types are not read.
  */
 
 #include <algorithm>
-#include <array>
 #include <filesystem>
 #include <format>
 #include <optional>
-#include <ranges>
 #include <string>
 #include <string_view>
 #include <vector>
@@ -42,10 +40,12 @@
 
 #include <ztd/ztd.hxx>
 
+#include "vfs/desktop-index.hxx"
 #include "vfs/execute.hxx"
 #include "vfs/user-dirs.hxx"
 
 #include "vfs/mime-type/mime-action.hxx"
+#include "vfs/mime-type/mime-apps.hxx"
 #include "vfs/utils/file-ops.hxx"
 
 static void
@@ -55,213 +55,17 @@ update_desktop_database() noexcept
                                      vfs::user::data() / "applications");
 }
 
-/* Determine removed associations for this type */
-static void
-remove_actions(std::string_view mime_type, std::vector<std::string>& actions) noexcept
-{
-    // logger::info<logger::vfs>("remove_actions( {} )", type);
-
-    const auto kf = Glib::KeyFile::create();
-    try
-    {
-        // $XDG_CONFIG_HOME=[~/.config]/mimeapps.list
-        const auto path = vfs::user::config() / "mimeapps.list";
-
-        kf->load_from_file(path, Glib::KeyFile::Flags::NONE);
-    }
-    catch (const Glib::FileError& e)
-    {
-        try
-        {
-            // $XDG_DATA_HOME=[~/.local]/share/applications/mimeapps.list
-            const auto path = vfs::user::data() / "applications/mimeapps.list";
-
-            kf->load_from_file(path, Glib::KeyFile::Flags::NONE);
-        }
-        catch (const Glib::FileError& e)
-        {
-            return;
-        }
-    }
-
-    std::vector<Glib::ustring> removed;
-    try
-    {
-        removed = kf->get_string_list("Removed Associations", mime_type.data());
-        if (removed.empty())
-        {
-            return;
-        }
-    }
-    catch (...) // Glib::KeyFileError, Glib::FileError
-    {
-        return;
-    }
-
-    for (auto& r : removed)
-    {
-        const std::string rem = r;
-        if (std::ranges::contains(actions, rem))
-        {
-            std::erase_if(actions, [&](const auto& a) { return a == rem; });
-            // logger::info<logger::vfs>("        ACTION-REMOVED {}", rem);
-        }
-    }
-}
-
-/*
- * Get applications associated with this mime-type
- *
- * This is very roughly based on specs:
- * http://standards.freedesktop.org/mime-apps-spec/mime-apps-spec-latest.html
- *
- */
-static void
-get_actions(const std::filesystem::path& dir, std::string_view mime_type,
-            std::vector<std::string>& actions) noexcept
-{
-    // logger::info<logger::vfs>("get_actions( {}, {} )\n", dir, mime_type);
-    std::vector<Glib::ustring> removed;
-
-    static constexpr std::array<std::string_view, 2> names{
-        "mimeapps.list",
-        "mimeinfo.cache",
-    };
-    static constexpr std::array<std::string_view, 3> groups{
-        "Default Applications",
-        "Added Associations",
-        "MIME Cache",
-    };
-
-    // logger::info<logger::vfs>("get_actions( {}/, {} )", dir, mime_type);
-    for (const auto n : std::views::iota(0uz, names.size()))
-    {
-        const auto path = dir / names.at(n);
-        // logger::info<logger::vfs>( "    {}", path);
-        const auto kf = Glib::KeyFile::create();
-        try
-        {
-            kf->load_from_file(path, Glib::KeyFile::Flags::NONE);
-        }
-        catch (const Glib::FileError& e)
-        {
-            continue;
-        }
-
-        if (n == 0)
-        {
-            // get removed associations in this dir
-            try
-            {
-                removed = kf->get_string_list("Removed Associations", mime_type.data());
-                // if (removed.empty())
-                //     continue;
-            }
-            catch (...) // Glib::KeyFileError, Glib::FileError
-            {
-                continue;
-            }
-        }
-
-        // mimeinfo.cache has only MIME Cache; others do not have it
-        for (std::int32_t k = (n == 0 ? 0 : 2); k < (n == 0 ? 2 : 3); ++k)
-        {
-            // logger::info<logger::vfs>("        {} [{}]", groups[k], k);
-            bool is_removed = false;
-            std::vector<Glib::ustring> apps;
-            try
-            {
-                apps = kf->get_string_list(groups.at(static_cast<std::size_t>(k)).data(),
-                                           mime_type.data());
-                // if (apps.empty())
-                //     return nullptr;
-            }
-            catch (...) // Glib::KeyFileError, Glib::FileError
-            {
-                continue;
-            }
-            for (auto& a : apps)
-            {
-                //  logger::info<logger::vfs>("            {}", apps[i]);
-                //  check if removed
-                is_removed = false;
-                if (!removed.empty() && n > 0)
-                {
-                    for (auto& r : removed)
-                    {
-                        if (r == a)
-                        {
-                            // logger::info<logger::vfs>("                REMOVED");
-                            is_removed = true;
-                            break;
-                        }
-                    }
-                }
-                const std::string app = a;
-                if (!is_removed && !std::ranges::contains(actions, app))
-                {
-                    /* check for app existence */
-                    if (vfs::detail::mime_type::locate_desktop_file(app))
-                    {
-                        // logger::info<logger::vfs>("                EXISTS");
-                        actions.push_back(app);
-                    }
-                    else
-                    {
-                        // logger::info<logger::vfs>("                MISSING");
-                    }
-                }
-            }
-        }
-    }
-}
-
 std::vector<std::string>
 vfs::detail::mime_type::get_actions(std::string_view mime_type) noexcept
 {
-    std::vector<std::string> actions;
-
     /* FIXME: actions of parent types should be added, too. */
 
-    /* get all actions for this file type */
-
-    // $XDG_CONFIG_HOME=[~/.config]/mimeapps.list
-    ::get_actions(vfs::user::config(), mime_type, actions);
-
-    // $XDG_DATA_HOME=[~/.local]/share/applications/mimeapps.list
-    const auto dir = vfs::user::data() / "applications";
-    ::get_actions(dir, mime_type, actions);
-
-    // $XDG_DATA_DIRS=[/usr/[local/]share]/applications/mimeapps.list
-    for (const std::filesystem::path sys_dir : Glib::get_system_data_dirs())
-    {
-        const auto sdir = sys_dir / "applications";
-        ::get_actions(sdir, mime_type, actions);
-    }
-
-    /* remove actions for this file type */
-    remove_actions(mime_type, actions);
-
-    /* ensure default app is in the list */
-    const auto default_app = get_default_action(mime_type);
-    if (default_app)
+    const auto* entry = vfs::detail::mime_type::mime_apps::global()->lookup(mime_type);
+    if (entry == nullptr)
     {
-        if (!std::ranges::contains(actions, default_app.value()))
-        {
-            // default app is not in the list, add it!
-            actions.push_back(default_app.value());
-        }
-        else /* default app is in the list, move it to the first. */
-        {
-            const auto it = std::ranges::find(actions, default_app.value());
-            const auto index = std::ranges::distance(actions.cbegin(), it);
-            if (index != 0)
-            {
-                ztd::move(actions, static_cast<std::size_t>(index), 0);
-            }
-        }
+        return {};
     }
-    return actions;
+    return entry->apps;
 }
 
 /*
@@ -475,6 +279,8 @@ make_custom_desktop_file(std::string_view desktop_id, std::string_view mime_type
         if (!std::filesystem::exists(path))
         { /* this generated filename can be used */
             [[maybe_unused]] auto ec = vfs::utils::write_file(path, file_content.raw());
+            // not left to vfs::mime_monitor, the caller looks the new desktop id up next
+            vfs::desktop_index::reload();
             break;
         }
     }
@@ -541,24 +347,12 @@ vfs::detail::mime_type::locate_desktop_file(const std::filesystem::path& dir,
 std::optional<std::filesystem::path>
 vfs::detail::mime_type::locate_desktop_file(std::string_view desktop_id) noexcept
 {
-    const auto data_dir = vfs::user::data();
-
-    auto data_desktop = ::locate_desktop_file(data_dir, desktop_id);
-    if (data_desktop)
-    {
-        return data_desktop;
-    }
-
-    for (const std::filesystem::path sys_dir : Glib::get_system_data_dirs())
+    const auto* entry = vfs::desktop_index::global()->lookup(desktop_id);
+    if (entry == nullptr)
     {
-        auto sys_desktop = ::locate_desktop_file(sys_dir, desktop_id);
-        if (sys_desktop)
-        {
-            return sys_desktop;
-        }
+        return std::nullopt;
     }
-
-    return std::nullopt;
+    return entry->path;
 }
 
 std::optional<std::string>
@@ -566,13 +360,12 @@ vfs::detail::mime_type::get_default_action(std::string_view mime_type) noexcept
 {
     assert(mime_type.empty() != true);
 
-    const auto result = vfs::execute::command_line_sync("xdg-mime query default {}", mime_type);
-    if (result.standard_output.empty())
+    const auto* entry = vfs::detail::mime_type::mime_apps::global()->lookup(mime_type);
+    if (entry == nullptr)
     {
         return std::nullopt;
     }
-    // Need to remove '\n'
-    return ztd::strip(result.standard_output);
+    return entry->default_app;
 }
 
 void
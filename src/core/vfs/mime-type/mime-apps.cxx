@@ -0,0 +1,267 @@
+/**
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include <glibmm.h>
+
+#include "vfs/user-dirs.hxx"
+
+#include "vfs/mime-type/mime-action.hxx"
+#include "vfs/mime-type/mime-apps.hxx"
+
+#include "logger.hxx"
+
+namespace global
+{
+static std::atomic<std::shared_ptr<const vfs::detail::mime_type::mime_apps>> mime_apps;
+// only serializes building and dropping, readers never take it
+static std::mutex mime_apps_load_lock;
+} // namespace global
+
+namespace
+{
+/**
+ * Every key of group, the value split on ';'. Empty if the file or group does not exist.
+ */
+[[nodiscard]] std::vector<std::pair<std::string, std::vector<std::string>>>
+read_group(const Glib::RefPtr<Glib::KeyFile>& kf, const std::string_view group) noexcept
+{
+    std::vector<std::pair<std::string, std::vector<std::string>>> values;
+    try
+    {
+        if (!kf->has_group(group.data()))
+        {
+            return values;
+        }
+
+        for (const auto& key : kf->get_keys(group.data()))
+        {
+            std::vector<std::string> apps;
+            for (const auto& app : kf->get_string_list(group.data(), key))
+            {
+                if (!app.empty())
+                {
+                    apps.push_back(app);
+                }
+            }
+            values.emplace_back(key, std::move(apps));
+        }
+    }
+    catch (...) // Glib::KeyFileError
+    {
+    }
+    return values;
+}
+
+[[nodiscard]] Glib::RefPtr<Glib::KeyFile>
+load_key_file(const std::filesystem::path& path) noexcept
+{
+    const auto kf = Glib::KeyFile::create();
+    try
+    {
+        kf->load_from_file(path, Glib::KeyFile::Flags::NONE);
+    }
+    catch (...) // Glib::KeyFileError, Glib::FileError
+    {
+        return nullptr;
+    }
+    return kf;
+}
+} // namespace
+
+vfs::detail::mime_type::mime_apps
+vfs::detail::mime_type::mime_apps::create(const std::span<const std::filesystem::path> dirs,
+                                          const installed_function& installed) noexcept
+{
+    mime_apps index;
+
+    // each app is checked once, not once per type it handles
+    std::unordered_map<std::string, bool> is_installed;
+    const auto check = [&installed, &is_installed](const std::string& app)
+    {
+        const auto it = is_installed.find(app);
+        if (it != is_installed.cend())
+        {
+            return it->second;
+        }
+        const bool result = installed(app);
+        is_installed.insert({app, result});
+        return result;
+    };
+
+    // type -> apps removed by the dirs read so far
+    std::unordered_map<std::string, std::unordered_set<std::string>> removed;
+
+    const auto add = [&index, &removed, &check](const std::string& type,
+                                                const std::vector<std::string>& apps)
+    {
+        const auto hidden = removed.find(type);
+        auto& entry = index.types_[type];
+        for (const auto& app : apps)
+        {
+            if (hidden != removed.cend() && hidden->second.contains(app))
+            {
+                continue;
+            }
+            if (!std::ranges::contains(entry.apps, app) && check(app))
+            {
+                entry.apps.push_back(app);
+            }
+        }
+    };
+
+    for (const auto& dir : dirs)
+    {
+        const auto mimeapps = load_key_file(dir / "mimeapps.list");
+        if (mimeapps)
+        {
+            for (const auto& [type, apps] : read_group(mimeapps, "Default Applications"))
+            {
+                auto& entry = index.types_[type];
+                if (entry.default_app)
+                {
+                    continue;
+                }
+                const auto it = std::ranges::find_if(apps, check);
+                if (it != apps.cend())
+                {
+                    entry.default_app = *it;
+                }
+            }
+
+            // added before the removed of the same dir are known
+            for (const auto& [type, apps] : read_group(mimeapps, "Added Associations"))
+            {
+                add(type, apps);
+            }
+
+            for (const auto& [type, apps] : read_group(mimeapps, "Removed Associations"))
+            {
+                removed[type].insert(apps.cbegin(), apps.cend());
+            }
+        }
+
+        const auto mimeinfo = load_key_file(dir / "mimeinfo.cache");
+        if (mimeinfo)
+        {
+            for (const auto& [type, apps] : read_group(mimeinfo, "MIME Cache"))
+            {
+                add(type, apps);
+            }
+        }
+    }
+
+    for (auto& [type, entry] : index.types_)
+    {
+        if (!entry.default_app)
+        {
+            continue;
+        }
+
+        const auto it = std::ranges::find(entry.apps, entry.default_app.value());
+        if (it == entry.apps.cend())
+        {
+            entry.apps.insert(entry.apps.cbegin(), entry.default_app.value());
+        }
+        else
+        {
+            std::ranges::rotate(entry.apps.begin(), it, std::next(it));
+        }
+    }
+
+    return index;
+}
+
+std::vector<std::filesystem::path>
+vfs::detail::mime_type::mime_apps::dirs() noexcept
+{
+    std::vector<std::filesystem::path> dirs;
+    // $XDG_CONFIG_HOME=[~/.config]/mimeapps.list
+    dirs.push_back(vfs::user::config());
+    // $XDG_DATA_HOME=[~/.local]/share/applications/mimeapps.list
+    dirs.push_back(vfs::user::data() / "applications");
+    // $XDG_DATA_DIRS=[/usr/[local/]share]/applications/mimeapps.list
+    for (const std::filesystem::path sys_dir : Glib::get_system_data_dirs())
+    {
+        dirs.push_back(sys_dir / "applications");
+    }
+    return dirs;
+}
+
+std::shared_ptr<const vfs::detail::mime_type::mime_apps>
+vfs::detail::mime_type::mime_apps::global() noexcept
+{
+    auto apps = global::mime_apps.load(std::memory_order_acquire);
+    if (apps)
+    {
+        return apps;
+    }
+
+    std::scoped_lock lock(global::mime_apps_load_lock);
+
+    apps = global::mime_apps.load(std::memory_order_acquire);
+    if (apps)
+    {
+        return apps;
+    }
+
+    const auto installed = [](const std::string_view desktop_id)
+    { return vfs::detail::mime_type::locate_desktop_file(desktop_id).has_value(); };
+
+    apps = std::make_shared<const mime_apps>(create(dirs(), installed));
+
+    logger::debug<logger::vfs>("mime apps index built, {} types", apps->size());
+
+    global::mime_apps.store(apps, std::memory_order_release);
+    return apps;
+}
+
+void
+vfs::detail::mime_type::mime_apps::reload() noexcept
+{
+    // waits for a build in progress, it may have read the old files
+    std::scoped_lock lock(global::mime_apps_load_lock);
+
+    global::mime_apps.store(nullptr, std::memory_order_release);
+}
+
+const vfs::detail::mime_type::mime_apps::entry*
+vfs::detail::mime_type::mime_apps::lookup(const std::string_view type) const noexcept
+{
+    const auto it = types_.find(type);
+    if (it == types_.cend())
+    {
+        return nullptr;
+    }
+    return &it->second;
+}
+
+std::size_t
+vfs::detail::mime_type::mime_apps::size() const noexcept
+{
+    return types_.size();
+}
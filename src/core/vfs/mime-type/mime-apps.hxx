@@ -0,0 +1,101 @@
+/**
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <cstddef>
+
+namespace vfs::detail::mime_type
+{
+/**
+ * Applications associated with every mime type, built once from the
+ * mimeapps.list and mimeinfo.cache of each dir returned by dirs().
+ *
+ * http://standards.freedesktop.org/mime-apps-spec/mime-apps-spec-latest.html
+ *
+ * Dirs are read in order of precedence. The default app is the first installed
+ * entry of [Default Applications]. [Removed Associations] hide an app from the
+ * same and every less important dir, [Added Associations] of a dir are only
+ * hidden by the more important dirs. Apps from mimeinfo.cache come last.
+ *
+ * Lookups do not touch the disk, vfs::mime_monitor calls reload() when one
+ * of the source files changes.
+ */
+class mime_apps final
+{
+  public:
+    struct entry final
+    {
+        std::optional<std::string> default_app;
+        std::vector<std::string> apps; // default_app first, if set
+    };
+
+    // desktop id -> is installed
+    using installed_function = std::function<bool(std::string_view)>;
+
+    /**
+     * @param[in] dirs dirs holding a mimeapps.list or mimeinfo.cache, in order of precedence
+     * @param[in] installed only apps this returns true for are added
+     */
+    [[nodiscard]] static mime_apps create(const std::span<const std::filesystem::path> dirs,
+                                          const installed_function& installed) noexcept;
+
+    /**
+     * $XDG_CONFIG_HOME, $XDG_DATA_HOME/applications and $XDG_DATA_DIRS/applications
+     */
+    [[nodiscard]] static std::vector<std::filesystem::path> dirs() noexcept;
+
+    /**
+     * The process wide index, built on first use.
+     */
+    [[nodiscard]] static std::shared_ptr<const mime_apps> global() noexcept;
+
+    /**
+     * Drop the process wide index, called by vfs::mime_monitor.
+     * The next global() call rebuilds it.
+     */
+    static void reload() noexcept;
+
+    [[nodiscard]] const entry* lookup(const std::string_view type) const noexcept;
+
+    [[nodiscard]] std::size_t size() const noexcept;
+
+  private:
+    mime_apps() = default;
+
+    struct string_hash final
+    {
+        using is_transparent = void;
+
+        [[nodiscard]] std::size_t
+        operator()(const std::string_view str) const noexcept
+        {
+            return std::hash<std::string_view>{}(str);
+        }
+    };
+
+    std::unordered_map<std::string, entry, string_hash, std::equal_to<>> types_;
+};
+} // namespace vfs::detail::mime_type
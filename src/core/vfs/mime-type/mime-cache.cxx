@@ -0,0 +1,598 @@
+/**
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <expected>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include <cerrno>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <fnmatch.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <glibmm.h>
+
+#include "vfs/user-dirs.hxx"
+
+#include "vfs/mime-type/mime-cache.hxx"
+
+#include "logger.hxx"
+
+namespace global
+{
+static std::atomic<std::shared_ptr<const vfs::detail::mime_type::mime_database>> database;
+// only serializes loading, readers never take it
+static std::mutex database_load_lock;
+} // namespace global
+
+namespace
+{
+// header, every offset is a big endian CARD32
+constexpr std::size_t HEADER_SIZE = 40;
+constexpr std::size_t LITERAL_LIST_OFFSET = 12;
+constexpr std::size_t REVERSE_SUFFIX_TREE_OFFSET = 16;
+constexpr std::size_t GLOB_LIST_OFFSET = 20;
+
+// literal, glob and suffix tree entries are three CARD32
+constexpr std::size_t ENTRY_SIZE = 12;
+
+constexpr std::uint32_t WEIGHT_MASK = 0xff;
+constexpr std::uint32_t CASE_SENSITIVE = 0x100;
+
+[[nodiscard]] std::shared_ptr<const vfs::detail::mime_type::mime_database>
+load_database() noexcept
+{
+    std::vector<std::filesystem::path> paths;
+    paths.push_back(vfs::user::data() / "mime/mime.cache");
+    for (const std::filesystem::path sys_dir : Glib::get_system_data_dirs())
+    {
+        paths.push_back(sys_dir / "mime/mime.cache");
+    }
+    return std::make_shared<const vfs::detail::mime_type::mime_database>(paths);
+}
+
+/**
+ * Decode the utf-8 character that ends at name[end - 1], the suffix tree
+ * stores unicode code points. end is moved to the first byte of the
+ * character, an invalid sequence is read as a single byte.
+ */
+[[nodiscard]] std::uint32_t
+prev_character(const std::string_view name, std::size_t& end) noexcept
+{
+    const auto byte = [&name](const std::size_t i)
+    { return static_cast<std::uint32_t>(static_cast<unsigned char>(name[i])); };
+
+    auto start = end - 1;
+    while (start > 0 && end - start < 4 && (byte(start) & 0xc0) == 0x80)
+    {
+        start -= 1;
+    }
+
+    const auto lead = byte(start);
+    const auto length = end - start;
+
+    std::uint32_t c = 0;
+    std::size_t expected = 0;
+    if (lead < 0x80)
+    {
+        c = lead;
+        expected = 1;
+    }
+    else if ((lead & 0xe0) == 0xc0)
+    {
+        c = lead & 0x1f;
+        expected = 2;
+    }
+    else if ((lead & 0xf0) == 0xe0)
+    {
+        c = lead & 0x0f;
+        expected = 3;
+    }
+    else if ((lead & 0xf8) == 0xf0)
+    {
+        c = lead & 0x07;
+        expected = 4;
+    }
+
+    if (expected != length)
+    {
+        end -= 1;
+        return byte(end);
+    }
+
+    for (auto i = start + 1; i < end; ++i)
+    {
+        c = (c << 6) | (byte(i) & 0x3f);
+    }
+    end = start;
+    return c;
+}
+
+[[nodiscard]] bool
+is_better(const vfs::detail::mime_type::mime_cache::match& match,
+          const std::optional<vfs::detail::mime_type::mime_cache::match>& best) noexcept
+{
+    return !best || match.weight > best->weight ||
+           (match.weight == best->weight && match.length > best->length);
+}
+} // namespace
+
+vfs::detail::mime_type::mime_cache::mime_cache(const void* data, const std::size_t size) noexcept
+    : data_(static_cast<const std::byte*>(data)), size_(size)
+{
+}
+
+vfs::detail::mime_type::mime_cache::~mime_cache() noexcept
+{
+    if (data_ != nullptr)
+    {
+        munmap(const_cast<std::byte*>(data_), size_);
+    }
+}
+
+vfs::detail::mime_type::mime_cache::mime_cache(mime_cache&& other) noexcept
+    : data_(std::exchange(other.data_, nullptr)), size_(std::exchange(other.size_, 0))
+{
+}
+
+vfs::detail::mime_type::mime_cache&
+vfs::detail::mime_type::mime_cache::operator=(mime_cache&& other) noexcept
+{
+    if (this != &other)
+    {
+        if (data_ != nullptr)
+        {
+            munmap(const_cast<std::byte*>(data_), size_);
+        }
+        data_ = std::exchange(other.data_, nullptr);
+        size_ = std::exchange(other.size_, 0);
+    }
+    return *this;
+}
+
+std::expected<vfs::detail::mime_type::mime_cache, std::error_code>
+vfs::detail::mime_type::mime_cache::open(const std::filesystem::path& path) noexcept
+{
+    const auto fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1)
+    {
+        return std::unexpected(std::error_code(errno, std::generic_category()));
+    }
+
+    struct stat st{};
+    if (fstat(fd, &st) == -1 || std::cmp_less(st.st_size, HEADER_SIZE))
+    {
+        close(fd);
+        return std::unexpected(std::make_error_code(std::errc::invalid_argument));
+    }
+
+    const auto size = static_cast<std::size_t>(st.st_size);
+    auto* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+    {
+        return std::unexpected(std::error_code(errno, std::generic_category()));
+    }
+
+    auto cache = mime_cache(data, size);
+
+    // MAJOR_VERSION 1, weights were added to the lists in MINOR_VERSION 1
+    const auto* header = static_cast<const unsigned char*>(data);
+    const auto major = (header[0] << 8) | header[1];
+    const auto minor = (header[2] << 8) | header[3];
+    if (major != 1 || minor < 1)
+    {
+        return std::unexpected(std::make_error_code(std::errc::not_supported));
+    }
+
+    return cache;
+}
+
+std::uint32_t
+vfs::detail::mime_type::mime_cache::read(const std::size_t offset) const noexcept
+{
+    if (offset > size_ - 4 || (offset & 0x3) != 0)
+    {
+        return 0;
+    }
+
+    std::uint32_t value = 0;
+    std::memcpy(&value, data_ + offset, sizeof(value));
+    return ntohl(value);
+}
+
+std::string_view
+vfs::detail::mime_type::mime_cache::string(const std::size_t offset) const noexcept
+{
+    if (offset >= size_)
+    {
+        return {};
+    }
+
+    const auto* begin = reinterpret_cast<const char*>(data_) + offset;
+    const auto* end = static_cast<const char*>(std::memchr(begin, '\0', size_ - offset));
+    if (end == nullptr)
+    {
+        return {};
+    }
+    return {begin, end};
+}
+
+std::span<const std::byte>
+vfs::detail::mime_type::mime_cache::bytes(const std::size_t offset,
+                                          const std::size_t length) const noexcept
+{
+    if (offset > size_ || length > size_ - offset)
+    {
+        return {};
+    }
+    return {data_ + offset, length};
+}
+
+bool
+vfs::detail::mime_type::mime_cache::valid_array(const std::size_t offset, const std::size_t count,
+                                                const std::size_t entry_size) const noexcept
+{
+    return offset <= size_ && (offset & 0x3) == 0 && count <= (size_ - offset) / entry_size;
+}
+
+std::optional<vfs::detail::mime_type::mime_cache::match>
+vfs::detail::mime_type::mime_cache::literal(const std::string_view name,
+                                            const bool case_sensitive) const noexcept
+{
+    // LiteralList, N_LITERALS then LITERAL_OFFSET, MIME_TYPE_OFFSET, WEIGHT
+    // sorted by strcmp of the literal
+    const auto list = read(LITERAL_LIST_OFFSET);
+    const auto count = read(list);
+    if (!valid_array(list + 4, count, ENTRY_SIZE))
+    {
+        return std::nullopt;
+    }
+
+    std::size_t low = 0;
+    std::size_t high = count;
+    while (low < high)
+    {
+        const auto mid = low + ((high - low) / 2);
+        const auto entry = list + 4 + (ENTRY_SIZE * mid);
+
+        const auto cmp = string(read(entry)).compare(name);
+        if (cmp < 0)
+        {
+            low = mid + 1;
+        }
+        else if (cmp > 0)
+        {
+            high = mid;
+        }
+        else
+        {
+            const auto weight = read(entry + 8);
+            if (!case_sensitive && (weight & CASE_SENSITIVE) != 0)
+            {
+                return std::nullopt;
+            }
+            return match{string(read(entry + 4)), weight & WEIGHT_MASK, name.size()};
+        }
+    }
+    return std::nullopt;
+}
+
+std::optional<vfs::detail::mime_type::mime_cache::match>
+vfs::detail::mime_type::mime_cache::suffix(const std::string_view name,
+                                           const bool case_sensitive) const noexcept
+{
+    // ReverseSuffixTree, N_ROOTS then FIRST_ROOT_OFFSET
+    const auto tree = read(REVERSE_SUFFIX_TREE_OFFSET);
+    return suffix_node(read(tree), read(tree + 4), name, name.size(), case_sensitive);
+}
+
+std::optional<vfs::detail::mime_type::mime_cache::match>
+vfs::detail::mime_type::mime_cache::suffix_node(const std::uint32_t count,
+                                                const std::uint32_t offset,
+                                                const std::string_view name,
+                                                const std::size_t length,
+                                                const bool case_sensitive) const noexcept
+{
+    // ReverseSuffixTreeNode, CHARACTER, N_CHILDREN, FIRST_CHILD_OFFSET sorted by CHARACTER.
+    // Leaf nodes have a CHARACTER of 0 and sort first, MIME_TYPE_OFFSET, WEIGHT
+    if (length == 0 || !valid_array(offset, count, ENTRY_SIZE))
+    {
+        return std::nullopt;
+    }
+
+    auto end = length;
+    const auto character = prev_character(name, end);
+
+    std::size_t low = 0;
+    std::size_t high = count;
+    while (low < high)
+    {
+        const auto mid = low + ((high - low) / 2);
+        const auto entry = offset + (ENTRY_SIZE * mid);
+
+        const auto c = read(entry);
+        if (c < character)
+        {
+            low = mid + 1;
+        }
+        else if (c > character)
+        {
+            high = mid;
+        }
+        else
+        {
+            const auto children = read(entry + 4);
+            const auto first_child = read(entry + 8);
+
+            // the longest matching suffix wins
+            const auto longer = suffix_node(children, first_child, name, end, case_sensitive);
+            if (longer)
+            {
+                return longer;
+            }
+
+            if (!valid_array(first_child, children, ENTRY_SIZE))
+            {
+                return std::nullopt;
+            }
+
+            std::optional<match> result;
+            for (std::size_t i = 0; i < children; ++i)
+            {
+                const auto leaf = first_child + (ENTRY_SIZE * i);
+                if (read(leaf) != 0)
+                {
+                    break;
+                }
+
+                const auto weight = read(leaf + 8);
+                if (!case_sensitive && (weight & CASE_SENSITIVE) != 0)
+                {
+                    continue;
+                }
+
+                const auto candidate =
+                    match{string(read(leaf + 4)), weight & WEIGHT_MASK, name.size() - end};
+                if (is_better(candidate, result))
+                {
+                    result = candidate;
+                }
+            }
+            return result;
+        }
+    }
+    return std::nullopt;
+}
+
+std::optional<vfs::detail::mime_type::mime_cache::match>
+vfs::detail::mime_type::mime_cache::glob(const std::string_view name,
+                                         const bool case_sensitive) const noexcept
+{
+    // GlobList, N_GLOBS then GLOB_OFFSET, MIME_TYPE_OFFSET, WEIGHT
+    const auto list = read(GLOB_LIST_OFFSET);
+    const auto count = read(list);
+    if (!valid_array(list + 4, count, ENTRY_SIZE))
+    {
+        return std::nullopt;
+    }
+
+    std::optional<match> result;
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        const auto entry = list + 4 + (ENTRY_SIZE * i);
+
+        const auto weight = read(entry + 8);
+        if (!case_sensitive && (weight & CASE_SENSITIVE) != 0)
+        {
+            continue;
+        }
+
+        // string() only returns null terminated views
+        const auto pattern = string(read(entry));
+        if (pattern.empty() || fnmatch(pattern.data(), name.data(), 0) != 0)
+        {
+            continue;
+        }
+
+        const auto candidate = match{string(read(entry + 4)), weight & WEIGHT_MASK, pattern.size()};
+        if (is_better(candidate, result))
+        {
+            result = candidate;
+        }
+    }
+    return result;
+}
+
+vfs::detail::mime_type::mime_database::mime_database(
+    const std::span<const std::filesystem::path> paths) noexcept
+{
+    for (const auto& path : paths)
+    {
+        std::error_code ec;
+        const auto mtime = std::filesystem::last_write_time(path, ec);
+        if (ec)
+        {
+            files_.push_back({path, std::nullopt});
+            continue;
+        }
+        files_.push_back({path, mtime});
+
+        auto cache = mime_cache::open(path);
+        if (!cache)
+        {
+            logger::error<logger::vfs>("Failed to load mime.cache: {} {}",
+                                       path,
+                                       cache.error().message());
+            continue;
+        }
+        caches_.push_back(std::move(*cache));
+    }
+
+    magic_ = mime_magic(caches_);
+}
+
+std::shared_ptr<const vfs::detail::mime_type::mime_database>
+vfs::detail::mime_type::mime_database::global() noexcept
+{
+    auto database = global::database.load(std::memory_order_acquire);
+    if (database)
+    {
+        return database;
+    }
+
+    std::scoped_lock lock(global::database_load_lock);
+
+    // another thread may have loaded it while waiting
+    database = global::database.load(std::memory_order_acquire);
+    if (!database)
+    {
+        database = load_database();
+        global::database.store(database, std::memory_order_release);
+    }
+    return database;
+}
+
+void
+vfs::detail::mime_type::mime_database::reload() noexcept
+{
+    std::scoped_lock lock(global::database_load_lock);
+
+    const auto database = global::database.load(std::memory_order_acquire);
+    if (!database || !database->is_stale())
+    {
+        // not loaded yet, the first global() call loads the current files
+        return;
+    }
+
+    logger::info<logger::vfs>("mime.cache changed, reloading the mime database");
+
+    global::database.store(load_database(), std::memory_order_release);
+}
+
+std::string_view
+vfs::detail::mime_type::mime_database::lookup(const std::string_view filename) const noexcept
+{
+    if (filename.empty() || filename.size() > NAME_MAX)
+    {
+        return {};
+    }
+
+    // null terminated for fnmatch(3), ascii lower cased like xdgmime
+    std::array<char, NAME_MAX + 1> exact_buffer;
+    std::array<char, NAME_MAX + 1> lower_buffer;
+    std::ranges::copy(filename, exact_buffer.begin());
+    std::ranges::transform(filename,
+                           lower_buffer.begin(),
+                           [](const char c) { return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c; });
+    exact_buffer[filename.size()] = '\0';
+    lower_buffer[filename.size()] = '\0';
+
+    const std::string_view exact{exact_buffer.data(), filename.size()};
+    const std::string_view lower{lower_buffer.data(), filename.size()};
+
+    const auto best = [this](const auto& find)
+    {
+        std::optional<mime_cache::match> result;
+        for (const auto& cache : caches_)
+        {
+            const auto match = find(cache);
+            if (match && is_better(*match, result))
+            {
+                result = match;
+            }
+        }
+        return result;
+    };
+
+    // each section, the lower cased name and case insensitive patterns first
+    for (const auto& [name, case_sensitive] : {std::pair{lower, false}, std::pair{exact, true}})
+    {
+        const auto match = best([&](const mime_cache& cache)
+                                { return cache.literal(name, case_sensitive); });
+        if (match)
+        {
+            return match->type;
+        }
+    }
+
+    for (const auto& [name, case_sensitive] : {std::pair{lower, false}, std::pair{exact, true}})
+    {
+        const auto match = best([&](const mime_cache& cache)
+                                { return cache.suffix(name, case_sensitive); });
+        if (match)
+        {
+            return match->type;
+        }
+    }
+
+    for (const auto& [name, case_sensitive] : {std::pair{lower, false}, std::pair{exact, true}})
+    {
+        const auto match =
+            best([&](const mime_cache& cache) { return cache.glob(name, case_sensitive); });
+        if (match)
+        {
+            return match->type;
+        }
+    }
+
+    return {};
+}
+
+std::string_view
+vfs::detail::mime_type::mime_database::sniff(const std::span<const std::byte> data) const noexcept
+{
+    return magic_.match(data);
+}
+
+std::size_t
+vfs::detail::mime_type::mime_database::magic_extent() const noexcept
+{
+    return magic_.extent();
+}
+
+bool
+vfs::detail::mime_type::mime_database::is_stale() const noexcept
+{
+    return std::ranges::any_of(files_,
+                               [](const file& f)
+                               {
+                                   std::error_code ec;
+                                   const auto mtime = std::filesystem::last_write_time(f.path, ec);
+                                   if (ec)
+                                   {
+                                       return f.mtime.has_value();
+                                   }
+                                   return f.mtime != mtime;
+                               });
+}
@@ -0,0 +1,155 @@
+/**
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <expected>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+#include <cstddef>
+#include <cstdint>
+
+#include "vfs/mime-type/mime-magic.hxx"
+
+namespace vfs::detail::mime_type
+{
+/**
+ * A shared-mime-info mime.cache file, mapped read only with mmap(2) and
+ * read in place. Lookups walk the literal list, reverse suffix tree and
+ * glob list of the file directly, nothing is copied or allocated and the
+ * returned types point into the mapping.
+ *
+ * https://specifications.freedesktop.org/shared-mime-info-spec/latest/ar01s02.html#idm46292897757504
+ */
+class mime_cache final
+{
+  public:
+    struct match final
+    {
+        std::string_view type;
+        std::uint32_t weight{0};
+        std::size_t length{0}; // pattern length, a longer suffix is more specific
+    };
+
+    mime_cache() = delete;
+    ~mime_cache() noexcept;
+    mime_cache(const mime_cache& other) = delete;
+    mime_cache(mime_cache&& other) noexcept;
+    mime_cache& operator=(const mime_cache& other) = delete;
+    mime_cache& operator=(mime_cache&& other) noexcept;
+
+    [[nodiscard]] static std::expected<mime_cache, std::error_code>
+    open(const std::filesystem::path& path) noexcept;
+
+    /**
+     * Each section is looked up twice, once with the lower cased name where
+     * case sensitive patterns are skipped and once with the name as is.
+     *
+     * @param[in] name filename, not a path
+     * @param[in] case_sensitive name is not lower cased, match every pattern
+     */
+    [[nodiscard]] std::optional<match> literal(const std::string_view name,
+                                               const bool case_sensitive) const noexcept;
+    [[nodiscard]] std::optional<match> suffix(const std::string_view name,
+                                              const bool case_sensitive) const noexcept;
+    // name must be null terminated, for fnmatch(3)
+    [[nodiscard]] std::optional<match> glob(const std::string_view name,
+                                            const bool case_sensitive) const noexcept;
+
+  private:
+    friend class mime_magic;
+
+    mime_cache(const void* data, const std::size_t size) noexcept;
+
+    [[nodiscard]] std::uint32_t read(const std::size_t offset) const noexcept;
+    [[nodiscard]] std::string_view string(const std::size_t offset) const noexcept;
+    [[nodiscard]] std::span<const std::byte> bytes(const std::size_t offset,
+                                                   const std::size_t length) const noexcept;
+    [[nodiscard]] bool valid_array(const std::size_t offset, const std::size_t count,
+                                   const std::size_t entry_size) const noexcept;
+
+    // match the end of name[0, length) against count tree nodes at offset
+    [[nodiscard]] std::optional<match>
+    suffix_node(const std::uint32_t count, const std::uint32_t offset, const std::string_view name,
+                const std::size_t length, const bool case_sensitive) const noexcept;
+
+    const std::byte* data_{nullptr};
+    std::size_t size_{0};
+};
+
+/**
+ * Every mime.cache on the system, the user data dir first then the system
+ * data dirs. A filename is matched the same way as xdgmime, a literal name
+ * first, then the longest suffix, then the remaining globs, and the highest
+ * weight wins across all files.
+ */
+class mime_database final
+{
+  public:
+    explicit mime_database(const std::span<const std::filesystem::path> paths) noexcept;
+
+    /**
+     * The process wide database, an immutable snapshot that is
+     * loaded on first use. No lock is taken once it is loaded.
+     */
+    [[nodiscard]] static std::shared_ptr<const mime_database> global() noexcept;
+
+    /**
+     * Load a new snapshot if a mime.cache was added, removed or changed,
+     * called by vfs::mime_monitor. Callers of global() keep using the
+     * snapshot they have until they release it.
+     */
+    static void reload() noexcept;
+
+    /**
+     * @param[in] filename filename, not a path
+     *
+     * @return the mime type, empty if no pattern matched. The view is
+     * valid for the lifetime of the database.
+     */
+    [[nodiscard]] std::string_view lookup(const std::string_view filename) const noexcept;
+
+    /**
+     * Match the start of a file against the magic rules.
+     *
+     * @param[in] data the first magic_extent() bytes of the file, or all of it if smaller
+     *
+     * @return the mime type, empty if no rule matched
+     */
+    [[nodiscard]] std::string_view sniff(const std::span<const std::byte> data) const noexcept;
+
+    // the number of bytes sniff() needs to see
+    [[nodiscard]] std::size_t magic_extent() const noexcept;
+
+    // a mime.cache was added, removed or changed since loading
+    [[nodiscard]] bool is_stale() const noexcept;
+
+  private:
+    struct file final
+    {
+        std::filesystem::path path;
+        std::optional<std::filesystem::file_time_type> mtime;
+    };
+    std::vector<file> files_;
+    std::vector<mime_cache> caches_;
+    mime_magic magic_;
+};
+} // namespace vfs::detail::mime_type
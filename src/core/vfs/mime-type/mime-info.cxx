@@ -0,0 +1,610 @@
+/**
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <expected>
+#include <filesystem>
+#include <format>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <glibmm.h>
+
+#include <pugixml.hpp>
+
+#include <ztd/ztd.hxx>
+
+#include "vfs/user-dirs.hxx"
+
+#include "vfs/mime-type/mime-info.hxx"
+#include "vfs/utils/file-ops.hxx"
+
+#include "logger.hxx"
+
+namespace global
+{
+static std::atomic<std::shared_ptr<const vfs::detail::mime_type::mime_info>> mime_info;
+// only serializes building, readers never take it
+static std::mutex mime_info_load_lock;
+} // namespace global
+
+namespace
+{
+// native byte order, the index is never shared between machines
+constexpr std::array<char, 8> MAGIC{'S', 'F', 'M', 'M', 'I', 'M', 'E', '\0'};
+constexpr std::uint32_t VERSION = 1;
+
+// files in each mime dir, mime.cache is rewritten every time update-mime-database runs
+constexpr std::array<std::string_view, 4> SOURCE_FILES{
+    "mime.cache",
+    "generic-icons",
+    "icons",
+    "subclasses",
+};
+
+// deeper subclass chains do not exist, a loop in a broken subclasses file stops here
+constexpr std::size_t MAX_PARENT_DEPTH = 8;
+
+struct header final
+{
+    std::array<char, 8> magic;
+    std::uint32_t version;
+    std::uint32_t sources;
+    std::uint32_t count;
+    std::uint32_t pad;
+    std::uint64_t strings_size;
+};
+
+struct source final
+{
+    std::uint32_t path_offset; // offsets are into the string table
+    std::uint32_t path_size;
+    std::int64_t mtime_sec; // -1 if the file does not exist
+    std::int64_t mtime_nsec;
+};
+
+struct record final
+{
+    std::uint32_t type_offset;
+    std::uint32_t type_size;
+    std::uint32_t description_offset;
+    std::uint32_t description_size;
+    std::uint32_t icon_offset;
+    std::uint32_t icon_size;
+};
+
+static_assert(std::is_trivially_copyable_v<header>);
+static_assert(std::is_trivially_copyable_v<source>);
+static_assert(std::is_trivially_copyable_v<record>);
+
+[[nodiscard]] std::pair<std::int64_t, std::int64_t>
+mtime(const std::filesystem::path& path) noexcept
+{
+    struct stat st{};
+    if (::stat(path.c_str(), &st) == -1)
+    {
+        return {-1, 0};
+    }
+    return {st.st_mtim.tv_sec, st.st_mtim.tv_nsec};
+}
+
+[[nodiscard]] std::vector<std::filesystem::path>
+source_paths(const std::span<const std::filesystem::path> dirs) noexcept
+{
+    std::vector<std::filesystem::path> paths;
+    for (const auto& dir : dirs)
+    {
+        for (const auto file : SOURCE_FILES)
+        {
+            paths.push_back(dir / file);
+        }
+    }
+    return paths;
+}
+
+struct type_info final
+{
+    std::optional<std::string> description;
+    std::optional<std::string> icon;
+    std::optional<std::string> generic_icon;
+    std::optional<std::string> parent;
+};
+
+/**
+ * Lines of 'type<separator>value', only the first value of a type is kept.
+ */
+void
+parse_list(const std::filesystem::path& path, const char separator,
+           std::map<std::string, type_info>& types,
+           std::optional<std::string> type_info::* const member) noexcept
+{
+    const auto buffer = vfs::utils::read_file(path);
+    if (!buffer)
+    {
+        return;
+    }
+
+    for (const auto line : ztd::split(*buffer, "\n"))
+    {
+        const auto pos = line.find(separator);
+        if (pos == std::string_view::npos || pos == 0 || pos + 1 == line.size())
+        {
+            continue;
+        }
+
+        auto& value = types[std::string(line.substr(0, pos))].*member;
+        if (!value)
+        {
+            value = std::string(line.substr(pos + 1));
+        }
+    }
+}
+
+// the untranslated <comment>
+[[nodiscard]] std::optional<std::string>
+parse_comment(const std::filesystem::path& path) noexcept
+{
+    pugi::xml_document doc;
+    const pugi::xml_parse_result result = doc.load_file(path.c_str());
+    if (!result)
+    {
+        logger::error<logger::vfs>("XML parsing error: {} {}", path, result.description());
+        return std::nullopt;
+    }
+
+    for (const auto comment : doc.child("mime-type").children("comment"))
+    {
+        if (!comment.attribute("xml:lang"))
+        {
+            return comment.child_value();
+        }
+    }
+    return std::nullopt;
+}
+
+void
+parse_xml_dir(const std::filesystem::path& dir, std::map<std::string, type_info>& types) noexcept
+{
+    std::error_code ec;
+    for (const auto& media : std::filesystem::directory_iterator(dir, ec))
+    {
+        // packages holds the source XML, not per-type files
+        if (!media.is_directory(ec) || media.path().filename() == "packages")
+        {
+            continue;
+        }
+
+        for (const auto& file : std::filesystem::directory_iterator(media.path(), ec))
+        {
+            if (file.path().extension() != ".xml")
+            {
+                continue;
+            }
+
+            const auto type = std::format("{}/{}",
+                                          media.path().filename().string(),
+                                          file.path().stem().string());
+
+            auto& description = types[type].description;
+            if (!description)
+            {
+                description = parse_comment(file.path());
+            }
+        }
+    }
+}
+
+[[nodiscard]] std::vector<char>
+build(const std::span<const std::filesystem::path> dirs) noexcept
+{
+    std::map<std::string, type_info> types;
+    for (const auto& dir : dirs)
+    {
+        if (!std::filesystem::is_directory(dir))
+        {
+            continue;
+        }
+
+        parse_list(dir / "icons", ':', types, &type_info::icon);
+        parse_list(dir / "generic-icons", ':', types, &type_info::generic_icon);
+        parse_list(dir / "subclasses", ' ', types, &type_info::parent);
+        parse_xml_dir(dir, types);
+    }
+
+    const auto resolve_icon = [&types](const std::string& type) -> std::string_view
+    {
+        auto it = types.find(type);
+        for (std::size_t depth = 0; it != types.cend() && depth < MAX_PARENT_DEPTH; ++depth)
+        {
+            const auto& info = it->second;
+            if (info.icon)
+            {
+                return *info.icon;
+            }
+            if (info.generic_icon)
+            {
+                return *info.generic_icon;
+            }
+            if (!info.parent)
+            {
+                break;
+            }
+            it = types.find(*info.parent);
+        }
+        return {};
+    };
+
+    std::string strings;
+    const auto add_string = [&strings](const std::string_view str)
+    {
+        const auto offset = strings.size();
+        strings.append(str);
+        return static_cast<std::uint32_t>(offset);
+    };
+
+    std::vector<source> sources;
+    for (const auto& path : source_paths(dirs))
+    {
+        const auto [sec, nsec] = mtime(path);
+        sources.push_back({
+            .path_offset = add_string(path.native()),
+            .path_size = static_cast<std::uint32_t>(path.native().size()),
+            .mtime_sec = sec,
+            .mtime_nsec = nsec,
+        });
+    }
+
+    std::vector<record> records;
+    records.reserve(types.size());
+    for (const auto& [type, info] : types)
+    {
+        const auto description = std::string_view(info.description.value_or(""));
+        const auto icon = resolve_icon(type);
+
+        records.push_back({
+            .type_offset = add_string(type),
+            .type_size = static_cast<std::uint32_t>(type.size()),
+            .description_offset = add_string(description),
+            .description_size = static_cast<std::uint32_t>(description.size()),
+            .icon_offset = add_string(icon),
+            .icon_size = static_cast<std::uint32_t>(icon.size()),
+        });
+    }
+
+    if (strings.size() > std::numeric_limits<std::uint32_t>::max())
+    {
+        return {};
+    }
+
+    const auto hdr = header{
+        .magic = MAGIC,
+        .version = VERSION,
+        .sources = static_cast<std::uint32_t>(sources.size()),
+        .count = static_cast<std::uint32_t>(records.size()),
+        .pad = 0,
+        .strings_size = strings.size(),
+    };
+
+    std::vector<char> buffer;
+    buffer.reserve(sizeof(header) + (sources.size() * sizeof(source)) +
+                   (records.size() * sizeof(record)) + strings.size());
+    const auto append = [&buffer](const void* data, const std::size_t size)
+    {
+        const auto* begin = static_cast<const char*>(data);
+        buffer.insert(buffer.cend(), begin, begin + size);
+    };
+    append(&hdr, sizeof(hdr));
+    append(sources.data(), sources.size() * sizeof(source));
+    append(records.data(), records.size() * sizeof(record));
+    append(strings.data(), strings.size());
+    return buffer;
+}
+
+[[nodiscard]] std::vector<std::filesystem::path>
+mime_dirs() noexcept
+{
+    std::vector<std::filesystem::path> dirs;
+    dirs.push_back(vfs::user::data() / "mime");
+    for (const std::filesystem::path sys_dir : Glib::get_system_data_dirs())
+    {
+        dirs.push_back(sys_dir / "mime");
+    }
+    return dirs;
+}
+} // namespace
+
+vfs::detail::mime_type::mime_info::mime_info(void* data, const std::size_t size) noexcept
+    : data_(data), size_(size)
+{
+}
+
+vfs::detail::mime_type::mime_info::mime_info(std::vector<char>&& buffer) noexcept
+    : data_(buffer.empty() ? nullptr : buffer.data()), size_(buffer.size()),
+      buffer_(std::move(buffer))
+{
+}
+
+vfs::detail::mime_type::mime_info::~mime_info() noexcept
+{
+    if (data_ != nullptr && buffer_.empty())
+    {
+        munmap(data_, size_);
+    }
+}
+
+vfs::detail::mime_type::mime_info::mime_info(mime_info&& other) noexcept
+    : data_(std::exchange(other.data_, nullptr)), size_(std::exchange(other.size_, 0)),
+      buffer_(std::move(other.buffer_)), index_(std::move(other.index_))
+{
+}
+
+vfs::detail::mime_type::mime_info&
+vfs::detail::mime_type::mime_info::operator=(mime_info&& other) noexcept
+{
+    if (this != &other)
+    {
+        if (data_ != nullptr && buffer_.empty())
+        {
+            munmap(data_, size_);
+        }
+        data_ = std::exchange(other.data_, nullptr);
+        size_ = std::exchange(other.size_, 0);
+        buffer_ = std::move(other.buffer_);
+        index_ = std::move(other.index_);
+    }
+    return *this;
+}
+
+std::error_code
+vfs::detail::mime_type::mime_info::validate() noexcept
+{
+    if (size_ < sizeof(header))
+    {
+        return std::make_error_code(std::errc::invalid_argument);
+    }
+
+    const auto* hdr = static_cast<const header*>(data_);
+    const auto sources_size = std::size_t(hdr->sources) * sizeof(source);
+    const auto records_size = std::size_t(hdr->count) * sizeof(record);
+    if (hdr->magic != MAGIC || hdr->version != VERSION ||
+        size_ != sizeof(header) + sources_size + records_size + hdr->strings_size)
+    {
+        return std::make_error_code(std::errc::invalid_argument);
+    }
+
+    const auto* base = static_cast<const char*>(data_) + sizeof(header);
+    const auto* strings = base + sources_size + records_size;
+    const auto in_strings = [hdr](const std::uint32_t offset, const std::uint32_t size)
+    { return std::size_t(offset) + size <= hdr->strings_size; };
+
+    for (const auto& s : std::span(reinterpret_cast<const source*>(base), hdr->sources))
+    {
+        if (!in_strings(s.path_offset, s.path_size))
+        {
+            return std::make_error_code(std::errc::invalid_argument);
+        }
+    }
+
+    index_.reserve(hdr->count);
+    const auto records =
+        std::span(reinterpret_cast<const record*>(base + sources_size), hdr->count);
+    for (std::size_t i = 0; i < records.size(); ++i)
+    {
+        const auto& r = records[i];
+        if (!in_strings(r.type_offset, r.type_size) ||
+            !in_strings(r.description_offset, r.description_size) ||
+            !in_strings(r.icon_offset, r.icon_size))
+        {
+            return std::make_error_code(std::errc::invalid_argument);
+        }
+        index_.insert({std::string_view(strings + r.type_offset, r.type_size), i});
+    }
+
+    return {};
+}
+
+std::expected<vfs::detail::mime_type::mime_info, std::error_code>
+vfs::detail::mime_type::mime_info::open(const std::filesystem::path& path,
+                                        const std::span<const std::filesystem::path> dirs) noexcept
+{
+    const auto fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1)
+    {
+        return std::unexpected(std::error_code(errno, std::generic_category()));
+    }
+
+    struct stat st{};
+    if (fstat(fd, &st) == -1 || std::cmp_less(st.st_size, sizeof(header)))
+    {
+        close(fd);
+        return std::unexpected(std::make_error_code(std::errc::invalid_argument));
+    }
+
+    const auto size = static_cast<std::size_t>(st.st_size);
+    auto* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+    {
+        return std::unexpected(std::error_code(errno, std::generic_category()));
+    }
+
+    auto info = mime_info(data, size);
+    const auto ec = info.validate();
+    if (ec)
+    {
+        return std::unexpected(ec);
+    }
+
+    // built from the same files, and none of them changed since
+    const auto* hdr = static_cast<const header*>(data);
+    const auto* sources = reinterpret_cast<const source*>(static_cast<const char*>(data) +
+                                                          sizeof(header));
+    const auto* strings = static_cast<const char*>(data) + sizeof(header) +
+                          (std::size_t(hdr->sources) * sizeof(source)) +
+                          (std::size_t(hdr->count) * sizeof(record));
+
+    const auto paths = source_paths(dirs);
+    if (paths.size() != hdr->sources)
+    {
+        return std::unexpected(std::make_error_code(std::errc::invalid_argument));
+    }
+    for (std::size_t i = 0; i < paths.size(); ++i)
+    {
+        const auto& s = sources[i];
+        if (std::string_view(strings + s.path_offset, s.path_size) != paths[i].native() ||
+            mtime(paths[i]) != std::pair{s.mtime_sec, s.mtime_nsec})
+        {
+            return std::unexpected(std::make_error_code(std::errc::invalid_argument));
+        }
+    }
+
+    return info;
+}
+
+std::error_code
+vfs::detail::mime_type::mime_info::save(const std::filesystem::path& path,
+                                        const std::span<const std::filesystem::path> dirs) noexcept
+{
+    const auto buffer = build(dirs);
+    if (buffer.empty())
+    {
+        return std::make_error_code(std::errc::value_too_large);
+    }
+
+    std::error_code ec;
+    std::filesystem::create_directories(path.parent_path(), ec);
+
+    // write then rename so a reader never maps a partial index
+    const auto tmp = std::filesystem::path(std::format("{}.{}", path.string(), getpid()));
+    ec = vfs::utils::write_file(tmp, buffer);
+    if (ec)
+    {
+        std::filesystem::remove(tmp, ec);
+        return std::make_error_code(std::errc::io_error);
+    }
+    std::filesystem::rename(tmp, path, ec);
+    if (ec)
+    {
+        std::error_code remove_ec;
+        std::filesystem::remove(tmp, remove_ec);
+    }
+    return ec;
+}
+
+std::shared_ptr<const vfs::detail::mime_type::mime_info>
+vfs::detail::mime_type::mime_info::global() noexcept
+{
+    auto info = global::mime_info.load(std::memory_order_acquire);
+    if (info)
+    {
+        return info;
+    }
+
+    std::scoped_lock lock(global::mime_info_load_lock);
+
+    info = global::mime_info.load(std::memory_order_acquire);
+    if (info)
+    {
+        return info;
+    }
+
+    const auto dirs = mime_dirs();
+    const auto path = vfs::user::cache() / PACKAGE_NAME / "mime-info";
+
+    auto index = open(path, dirs);
+    if (!index)
+    {
+        const auto ec = save(path, dirs);
+        if (ec)
+        {
+            logger::warn<logger::vfs>("Failed to save mime info index: {} {}", path, ec.message());
+        }
+        index = open(path, dirs);
+    }
+
+    if (index)
+    {
+        info = std::make_shared<const mime_info>(std::move(*index));
+    }
+    else
+    {
+        // the cache dir is not writable, keep the index in memory
+        auto in_memory = mime_info(build(dirs));
+        if (in_memory.validate())
+        {
+            in_memory = mime_info(std::vector<char>{});
+        }
+        info = std::make_shared<const mime_info>(std::move(in_memory));
+    }
+
+    global::mime_info.store(info, std::memory_order_release);
+    return info;
+}
+
+void
+vfs::detail::mime_type::mime_info::reload() noexcept
+{
+    std::scoped_lock lock(global::mime_info_load_lock);
+    global::mime_info.store(nullptr, std::memory_order_release);
+}
+
+std::optional<vfs::detail::mime_type::mime_info::entry>
+vfs::detail::mime_type::mime_info::lookup(const std::string_view type) const noexcept
+{
+    const auto it = index_.find(type);
+    if (it == index_.cend())
+    {
+        return std::nullopt;
+    }
+
+    const auto* hdr = static_cast<const header*>(data_);
+    const auto* base = static_cast<const char*>(data_) + sizeof(header);
+    const auto sources_size = std::size_t(hdr->sources) * sizeof(source);
+    const auto* records = reinterpret_cast<const record*>(base + sources_size);
+    const auto* strings = base + sources_size + (std::size_t(hdr->count) * sizeof(record));
+
+    const auto& r = records[it->second];
+    return entry{
+        .description = std::string_view(strings + r.description_offset, r.description_size),
+        .icon = std::string_view(strings + r.icon_offset, r.icon_size),
+    };
+}
+
+std::size_t
+vfs::detail::mime_type::mime_info::size() const noexcept
+{
+    return index_.size();
+}
@@ -0,0 +1,106 @@
+/**
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <expected>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <system_error>
+#include <unordered_map>
+#include <vector>
+
+#include <cstddef>
+
+namespace vfs::detail::mime_type
+{
+/**
+ * Description and icon of every mime type, built once from the
+ * shared-mime-info dirs and stored in vfs::user::cache()/PACKAGE_NAME/mime-info.
+ * The index is read back using mmap(2) and looked up through a hash map of
+ * views into the mapping.
+ *
+ * Each mime dir contributes its generic-icons, icons and subclasses files and the
+ * comment of every <media>/<subtype>.xml. The first dir that has a value wins, the
+ * user dir comes first. A type without an icon uses the icon of its parent class.
+ *
+ * The index is only valid while the mtime of every source file is the same as when
+ * it was built, update-mime-database rewrites mime.cache each time it runs.
+ */
+class mime_info final
+{
+  public:
+    struct entry final
+    {
+        std::string_view description;
+        std::string_view icon;
+    };
+
+    mime_info() = delete;
+    ~mime_info() noexcept;
+    mime_info(const mime_info& other) = delete;
+    mime_info(mime_info&& other) noexcept;
+    mime_info& operator=(const mime_info& other) = delete;
+    mime_info& operator=(mime_info&& other) noexcept;
+
+    /**
+     * @param[in] path index file
+     * @param[in] dirs mime dirs, in order of precedence
+     *
+     * @return the index if it exists and was built from the current dirs
+     */
+    [[nodiscard]] static std::expected<mime_info, std::error_code>
+    open(const std::filesystem::path& path,
+         const std::span<const std::filesystem::path> dirs) noexcept;
+
+    /**
+     * Build the index from dirs and write it to path.
+     */
+    [[nodiscard]] static std::error_code
+    save(const std::filesystem::path& path,
+         const std::span<const std::filesystem::path> dirs) noexcept;
+
+    /**
+     * The process wide index, built if there is no valid one on disk.
+     */
+    [[nodiscard]] static std::shared_ptr<const mime_info> global() noexcept;
+
+    /**
+     * Drop the process wide index, called by vfs::mime_monitor.
+     * The next global() call validates and if needed rebuilds it.
+     */
+    static void reload() noexcept;
+
+    [[nodiscard]] std::optional<entry> lookup(const std::string_view type) const noexcept;
+
+    [[nodiscard]] std::size_t size() const noexcept;
+
+  private:
+    mime_info(void* data, const std::size_t size) noexcept;
+    // an index that could not be saved, kept in memory
+    explicit mime_info(std::vector<char>&& buffer) noexcept;
+
+    [[nodiscard]] std::error_code validate() noexcept;
+
+    void* data_{nullptr};
+    std::size_t size_{0};
+    std::vector<char> buffer_;
+
+    std::unordered_map<std::string_view, std::size_t> index_;
+};
+} // namespace vfs::detail::mime_type
@@ -0,0 +1,301 @@
+/**
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include <cstddef>
+#include <cstdint>
+
+#include "vfs/mime-type/mime-cache.hxx"
+#include "vfs/mime-type/mime-magic.hxx"
+
+namespace
+{
+// header, MAGIC_LIST_OFFSET is a big endian CARD32
+constexpr std::size_t MAGIC_LIST_OFFSET = 24;
+
+// Match, PRIORITY, MIME_TYPE_OFFSET, N_MATCHLETS, FIRST_MATCHLET_OFFSET
+constexpr std::size_t MATCH_SIZE = 16;
+// Matchlet, RANGE_START, RANGE_LENGTH, WORD_SIZE, VALUE_LENGTH,
+// VALUE_OFFSET, MASK_OFFSET, N_CHILDREN, FIRST_CHILD_OFFSET
+constexpr std::size_t MATCHLET_SIZE = 32;
+
+// shared-mime-info nests a few levels at most, a deeper tree is a corrupt file
+constexpr std::uint32_t MAX_DEPTH = 32;
+} // namespace
+
+vfs::detail::mime_type::mime_magic::mime_magic(const std::span<const mime_cache> caches) noexcept
+{
+    for (const auto& cache : caches)
+    {
+        compile(cache);
+    }
+
+    // stable, the user cache comes first and wins a tie
+    std::ranges::stable_sort(rules_,
+                             [](const rule& a, const rule& b) { return a.priority > b.priority; });
+
+    index();
+}
+
+void
+vfs::detail::mime_type::mime_magic::compile(const mime_cache& cache) noexcept
+{
+    // MagicList, N_MATCHES, MAX_EXTENT, FIRST_MATCH_OFFSET
+    // matches are sorted by priority, highest first
+    const auto list = cache.read(MAGIC_LIST_OFFSET);
+    const auto count = cache.read(list);
+    const auto first = cache.read(list + 8);
+    if (list == 0 || !cache.valid_array(first, count, MATCH_SIZE))
+    {
+        return;
+    }
+
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        const auto entry = first + (MATCH_SIZE * i);
+
+        const auto type = cache.string(cache.read(entry + 4));
+        const auto matchlets = cache.read(entry + 8);
+        if (type.empty() || matchlets == 0)
+        {
+            continue;
+        }
+
+        const auto first_matchlet = compile_matchlets(cache, matchlets, cache.read(entry + 12), 0);
+        if (first_matchlet == UINT32_MAX)
+        {
+            continue;
+        }
+
+        rules_.push_back({type, cache.read(entry), first_matchlet, matchlets});
+    }
+}
+
+std::uint32_t
+vfs::detail::mime_type::mime_magic::compile_matchlets(const mime_cache& cache,
+                                                      const std::uint32_t count,
+                                                      const std::uint32_t offset,
+                                                      const std::uint32_t depth) noexcept
+{
+    if (depth >= MAX_DEPTH || !cache.valid_array(offset, count, MATCHLET_SIZE))
+    {
+        return UINT32_MAX;
+    }
+
+    // siblings are stored next to each other, children are appended after them
+    const auto first = static_cast<std::uint32_t>(matchlets_.size());
+    matchlets_.resize(matchlets_.size() + count);
+
+    for (std::uint32_t i = 0; i < count; ++i)
+    {
+        const auto entry = offset + (MATCHLET_SIZE * i);
+
+        const auto range_start = cache.read(entry);
+        const auto range_length = cache.read(entry + 4);
+        const auto value_length = cache.read(entry + 12);
+        const auto value_offset = cache.read(entry + 16);
+        const auto mask_offset = cache.read(entry + 20);
+        const auto children = cache.read(entry + 24);
+        const auto first_child = cache.read(entry + 28);
+
+        // WORD_SIZE is not needed, update-mime-database already
+        // stores the values in the byte order of the file
+        const auto value = cache.bytes(value_offset, value_length);
+        const auto mask = mask_offset == 0 ? std::span<const std::byte>{}
+                                           : cache.bytes(mask_offset, value_length);
+        if (value.empty() || (mask_offset != 0 && mask.empty()) || range_length == 0)
+        {
+            // can never match, the rest of the tree is kept as is
+            matchlets_[first + i] = {0, 0, 0, 0, NO_MASK, 0, 0};
+            continue;
+        }
+
+        matchlet result{};
+        result.range_start = range_start;
+        result.range_length = range_length;
+        result.value_length = value_length;
+
+        result.value = static_cast<std::uint32_t>(bytes_.size());
+        bytes_.insert(bytes_.cend(), value.begin(), value.end());
+
+        result.mask = NO_MASK;
+        if (!mask.empty())
+        {
+            result.mask = static_cast<std::uint32_t>(bytes_.size());
+            bytes_.insert(bytes_.cend(), mask.begin(), mask.end());
+        }
+
+        if (children != 0)
+        {
+            result.first_child = compile_matchlets(cache, children, first_child, depth + 1);
+            result.children = result.first_child == UINT32_MAX ? 0 : children;
+        }
+
+        extent_ = std::max(extent_,
+                           std::size_t(range_start) + range_length - 1 + value_length);
+
+        // matchlets_ may have grown while compiling the children
+        matchlets_[first + i] = result;
+    }
+
+    return first;
+}
+
+void
+vfs::detail::mime_type::mime_magic::index() noexcept
+{
+    for (std::uint32_t i = 0; i < rules_.size(); ++i)
+    {
+        const auto& rule = rules_[i];
+        const auto top = std::span(matchlets_).subspan(rule.first_matchlet, rule.matchlets);
+
+        // every alternative has to be an unmasked value at offset 0
+        const bool at_start = std::ranges::all_of(
+            top,
+            [this](const matchlet& m)
+            {
+                return m.value_length != 0 && m.range_start == 0 && m.range_length == 1 &&
+                       (m.mask == NO_MASK || bytes_[m.mask] == std::byte{0xff});
+            });
+
+        if (!at_start)
+        {
+            any_offset_.push_back(i);
+            continue;
+        }
+
+        for (const auto& m : top)
+        {
+            auto& bucket = by_first_byte_[std::to_integer<std::size_t>(bytes_[m.value])];
+            if (bucket.empty() || bucket.back() != i)
+            {
+                bucket.push_back(i);
+            }
+        }
+    }
+}
+
+bool
+vfs::detail::mime_type::mime_magic::matches(const std::span<const std::byte> data,
+                                            const std::uint32_t index) const noexcept
+{
+    const auto& m = matchlets_[index];
+    if (m.value_length == 0)
+    {
+        return false;
+    }
+
+    const auto* value = bytes_.data() + m.value;
+    const auto* mask = m.mask == NO_MASK ? nullptr : bytes_.data() + m.mask;
+
+    // same as xdgmime, the value can start anywhere in [range_start, range_start + range_length)
+    const auto end = std::size_t(m.range_start) + m.range_length;
+    for (std::size_t i = m.range_start; i < end; ++i)
+    {
+        if (i + m.value_length > data.size())
+        {
+            return false;
+        }
+
+        bool found = true;
+        if (mask == nullptr)
+        {
+            found = std::ranges::equal(data.subspan(i, m.value_length),
+                                       std::span(value, m.value_length));
+        }
+        else
+        {
+            for (std::size_t j = 0; j < m.value_length; ++j)
+            {
+                if ((mask[j] & value[j]) != (mask[j] & data[i + j]))
+                {
+                    found = false;
+                    break;
+                }
+            }
+        }
+
+        if (found)
+        {
+            return m.children == 0 || matches(data, m.first_child, m.children);
+        }
+    }
+    return false;
+}
+
+bool
+vfs::detail::mime_type::mime_magic::matches(const std::span<const std::byte> data,
+                                            const std::uint32_t first,
+                                            const std::uint32_t count) const noexcept
+{
+    for (std::uint32_t i = first; i < first + count; ++i)
+    {
+        if (matches(data, i))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::string_view
+vfs::detail::mime_type::mime_magic::match(const std::span<const std::byte> data) const noexcept
+{
+    if (data.empty() || rules_.empty())
+    {
+        return {};
+    }
+
+    // merge the two index lists, both are in priority order
+    const auto& first_byte = by_first_byte_[std::to_integer<std::size_t>(data[0])];
+
+    auto a = first_byte.cbegin();
+    auto b = any_offset_.cbegin();
+    while (a != first_byte.cend() || b != any_offset_.cend())
+    {
+        std::uint32_t index = 0;
+        if (b == any_offset_.cend() || (a != first_byte.cend() && *a < *b))
+        {
+            index = *a++;
+        }
+        else
+        {
+            index = *b++;
+        }
+
+        const auto& rule = rules_[index];
+        if (matches(data, rule.first_matchlet, rule.matchlets))
+        {
+            return rule.type;
+        }
+    }
+    return {};
+}
+
+std::size_t
+vfs::detail::mime_type::mime_magic::extent() const noexcept
+{
+    return extent_;
+}
+
+bool
+vfs::detail::mime_type::mime_magic::empty() const noexcept
+{
+    return rules_.empty();
+}
@@ -0,0 +1,103 @@
+/**
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <array>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace vfs::detail::mime_type
+{
+class mime_cache;
+
+/**
+ * The MagicList of every mime.cache compiled into flat arrays.
+ *
+ * Rules are ordered by priority, ties keep the order of the caches. Rules
+ * that can only match at offset 0 are indexed by the first byte of their
+ * values, so most rules are never looked at for a given file.
+ *
+ * The types point into the mime.cache mappings and are valid for as long
+ * as the caches are.
+ */
+class mime_magic final
+{
+  public:
+    mime_magic() = default;
+    explicit mime_magic(const std::span<const mime_cache> caches) noexcept;
+
+    /**
+     * @param[in] data the start of the file, at least extent() bytes if the file is that large
+     *
+     * @return the mime type of the highest priority matching rule, empty if none matched
+     */
+    [[nodiscard]] std::string_view match(const std::span<const std::byte> data) const noexcept;
+
+    // the number of bytes that any rule needs to read
+    [[nodiscard]] std::size_t extent() const noexcept;
+
+    [[nodiscard]] bool empty() const noexcept;
+
+  private:
+    static constexpr std::uint32_t NO_MASK = UINT32_MAX;
+
+    struct matchlet final
+    {
+        std::uint32_t range_start;
+        std::uint32_t range_length;
+        std::uint32_t value; // offset into bytes_
+        std::uint32_t value_length;
+        std::uint32_t mask; // offset into bytes_ or NO_MASK
+        std::uint32_t first_child;
+        std::uint32_t children;
+    };
+
+    struct rule final
+    {
+        std::string_view type;
+        std::uint32_t priority;
+        std::uint32_t first_matchlet;
+        std::uint32_t matchlets;
+    };
+
+    [[nodiscard]] bool matches(const std::span<const std::byte> data,
+                               const std::uint32_t index) const noexcept;
+    [[nodiscard]] bool matches(const std::span<const std::byte> data, const std::uint32_t first,
+                               const std::uint32_t count) const noexcept;
+
+    void compile(const mime_cache& cache) noexcept;
+    // copy count matchlets at offset in the cache, returns the index of the first
+    [[nodiscard]] std::uint32_t compile_matchlets(const mime_cache& cache,
+                                                  const std::uint32_t count,
+                                                  const std::uint32_t offset,
+                                                  const std::uint32_t depth) noexcept;
+    void index() noexcept;
+
+    std::vector<rule> rules_;
+    std::vector<matchlet> matchlets_;
+    std::vector<std::byte> bytes_;
+
+    // rule indices, in priority order
+    std::array<std::vector<std::uint32_t>, 256> by_first_byte_;
+    std::vector<std::uint32_t> any_offset_;
+
+    std::size_t extent_{0};
+};
+} // namespace vfs::detail::mime_type
@@ -20,29 +20,89 @@
 #include <algorithm>
 #include <array>
 #include <filesystem>
-#include <format>
-#include <fstream>
-#include <iostream>
 #include <optional>
+#include <span>
 #include <string>
 #include <string_view>
+#include <vector>
 
-#include <pugixml.hpp>
+#include <cstddef>
 
-#include <glibmm.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 #include <ztd/ztd.hxx>
 
 #include "vfs/mime-type.hxx"
-#include "vfs/user-dirs.hxx"
 
-#include "vfs/mime-type/chrome/mime-utils.hxx"
+#include "vfs/mime-type/mime-cache.hxx"
+#include "vfs/mime-type/mime-info.hxx"
 #include "vfs/mime-type/mime-type.hxx"
 #include "vfs/utils/file-ops.hxx"
 #include "vfs/utils/permissions.hxx"
 
 #include "logger.hxx"
 
+std::string
+vfs::detail::mime_type::get_by_content(const std::filesystem::path& path) noexcept
+{
+    // https://www.rfc-editor.org/rfc/rfc6838#section-4.2
+    constexpr std::size_t MIME_HEADER_MAX_SIZE = 127;
+    // a corrupt or hostile mime.cache can claim any extent
+    constexpr std::size_t MAGIC_MAX_EXTENT = 32 * 1024;
+
+    const auto database = vfs::detail::mime_type::mime_database::global();
+
+    const auto fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC | O_NOCTTY);
+    if (fd == -1)
+    {
+        return vfs::constants::mime_type::unknown.data();
+    }
+
+    // one read covers both the magic rules and the plain text check
+    std::vector<std::byte> buffer(
+        std::clamp(database->magic_extent(), MIME_HEADER_MAX_SIZE, MAGIC_MAX_EXTENT));
+    const auto length = pread(fd, buffer.data(), buffer.size(), 0);
+    close(fd);
+    if (length <= 0)
+    {
+        return vfs::constants::mime_type::unknown.data();
+    }
+
+    const auto data = std::span(buffer).first(static_cast<std::size_t>(length));
+
+    const auto type = database->sniff(data);
+    if (!type.empty())
+    {
+        return std::string(type);
+    }
+
+    const auto header = data.first(std::min(data.size(), MIME_HEADER_MAX_SIZE));
+    if (std::ranges::none_of(header, [](const auto byte) { return byte == std::byte{0}; }))
+    {
+        return vfs::constants::mime_type::plain_text.data();
+    }
+
+    return vfs::constants::mime_type::unknown.data();
+}
+
+[[nodiscard]] static std::string
+get_by_name(const std::filesystem::path& path) noexcept
+{
+    const auto& native = path.native();
+    const auto slash = native.rfind('/');
+    const auto filename = slash == std::string::npos ? std::string_view(native)
+                                                     : std::string_view(native).substr(slash + 1);
+
+    const auto database = vfs::detail::mime_type::mime_database::global();
+    const auto type = database->lookup(filename);
+    if (type.empty())
+    {
+        return vfs::constants::mime_type::unknown.data();
+    }
+    return std::string(type);
+}
+
 std::string
 vfs::detail::mime_type::get_by_file(const std::filesystem::path& path) noexcept
 {
@@ -63,20 +123,21 @@ vfs::detail::mime_type::get_by_file(const std::filesystem::path& path) noexcept
         return vfs::constants::mime_type::directory.data();
     }
 
-    auto type = chrome::GetFileMimeType(path);
+    auto type = get_by_name(path);
     if (type != vfs::constants::mime_type::unknown)
     {
         return type;
     }
 
-    if (std::filesystem::is_other(status))
+    if (std::filesystem::file_size(path) == 0)
     {
-        return vfs::constants::mime_type::plain_text.data();
+        return vfs::constants::mime_type::zerosize.data();
     }
 
-    if (std::filesystem::file_size(path) == 0)
+    type = get_by_content(path);
+    if (type != vfs::constants::mime_type::unknown)
     {
-        return vfs::constants::mime_type::zerosize.data();
+        return type;
     }
 
     /* Check for executable file */
@@ -85,139 +146,67 @@ vfs::detail::mime_type::get_by_file(const std::filesystem::path& path) noexcept
         return vfs::constants::mime_type::executable.data();
     }
 
-    auto read_mime_header = [](const std::filesystem::path& path) -> std::string
-    {
-        // https://www.rfc-editor.org/rfc/rfc6838#section-4.2
-        constexpr std::size_t MIME_HEADER_MAX_SIZE = 127;
-
-        std::ifstream file(path, std::ios::in | std::ios::binary);
-        if (!file)
-        {
-            return "";
-        }
-
-        std::string buffer(MIME_HEADER_MAX_SIZE, '\0');
-        file.read(&buffer[0], MIME_HEADER_MAX_SIZE);
-
-        buffer.resize(static_cast<std::size_t>(file.gcount()));
-        return buffer;
-    };
+    return type;
+}
 
-    const auto buffer = read_mime_header(path);
-    if (!buffer.empty())
+std::string
+vfs::detail::mime_type::get_by_file(const std::filesystem::path& path,
+                                    const vfs::linux::statx& stat,
+                                    const bool read_content) noexcept
+{
+    if (stat.is_symlink())
     {
-        constexpr auto is_data_plain_text = [](std::string_view data)
-        {
-            if (data.empty())
-            {
-                return false;
-            }
-            return std::ranges::all_of(data, [](const auto& byte) { return byte != '\0'; });
-        };
-
-        if (is_data_plain_text(buffer))
-        {
-            type = vfs::constants::mime_type::plain_text.data();
-        }
+        // the mime-type is for the symlink target
+        return get_by_file(path);
+    }
 
-        return type;
+    if (stat.is_directory())
+    {
+        return vfs::constants::mime_type::directory.data();
     }
-    else
+
+    if (!stat.is_regular_file())
     {
         return vfs::constants::mime_type::unknown.data();
     }
 
-    return vfs::constants::mime_type::unknown.data();
-}
-
-// returns - icon_name, icon_desc
-[[nodiscard]] static std::optional<std::array<std::string, 2>>
-parse_xml_file(const std::filesystem::path& path, bool is_local) noexcept
-{
-    // logger::info<logger::vfs>("MIME XML = {}", path);
-
-    pugi::xml_document doc;
-    const pugi::xml_parse_result result = doc.load_file(path.c_str());
-
-    if (!result)
+    auto type = get_by_name(path);
+    if (type != vfs::constants::mime_type::unknown)
     {
-        logger::error<logger::vfs>("XML parsing error: {}", result.description());
-        return std::nullopt;
+        return type;
     }
 
-    std::string comment;
-    const pugi::xml_node mime_type_node = doc.child("mime-type");
-    const pugi::xml_node comment_node = mime_type_node.child("comment");
-    if (comment_node)
+    if (stat.size() == 0)
     {
-        comment = comment_node.child_value();
+        return vfs::constants::mime_type::zerosize.data();
     }
 
-    std::string icon_name;
-    if (is_local)
+    if (read_content)
     {
-        const pugi::xml_node icon_node = mime_type_node.child("icon");
-        if (icon_node)
+        type = get_by_content(path);
+        if (type != vfs::constants::mime_type::unknown)
         {
-            const pugi::xml_attribute name_attr = icon_node.attribute("name");
-            if (name_attr)
-            {
-                icon_name = name_attr.value();
-            }
+            return type;
         }
     }
-    else
+
+    if (vfs::utils::has_execute_permission(stat))
     {
-        const pugi::xml_node generic_icon_node = mime_type_node.child("generic-icon");
-        if (generic_icon_node)
-        {
-            const pugi::xml_attribute name_attr = generic_icon_node.attribute("name");
-            if (name_attr)
-            {
-                icon_name = name_attr.value();
-            }
-        }
+        return vfs::constants::mime_type::executable.data();
     }
 
-    // logger::info<logger::vfs>("MIME XML | icon_name = {} | comment = {}", icon_name, comment);
-    return std::array{icon_name, comment};
+    return vfs::constants::mime_type::unknown.data();
 }
 
 std::array<std::string, 2>
 vfs::detail::mime_type::get_desc_icon(std::string_view type) noexcept
 {
-    /*  //sfm 0.7.7+ FIXED:
-     * According to specs on freedesktop.org, user_data_dir has
-     * higher priority than system_data_dirs, but in most cases, there was
-     * no file, or very few files in user_data_dir, so checking it first will
-     * result in many unnecessary open() system calls, yealding bad performance.
-     * Since the spec really sucks, we do not follow it here.
-     */
-
-    const auto user_path = vfs::user::data() / "mime" / std::format("{}.xml", type);
-    if (faccessat(0, user_path.c_str(), F_OK, AT_EACCESS) != -1)
+    const auto info = vfs::detail::mime_type::mime_info::global()->lookup(type);
+    if (!info)
     {
-        const auto icon_data = parse_xml_file(user_path, true);
-        if (icon_data)
-        {
-            return icon_data.value();
-        }
-    }
-
-    // look in system dirs
-    for (const std::filesystem::path sys_dir : Glib::get_system_data_dirs())
-    {
-        const auto sys_path = sys_dir / "mime" / std::format("{}.xml", type);
-        if (faccessat(0, sys_path.c_str(), F_OK, AT_EACCESS) != -1)
-        {
-            const auto icon_data = parse_xml_file(sys_path, false);
-            if (icon_data)
-            {
-                return icon_data.value();
-            }
-        }
+        return {"", ""};
     }
-    return {"", ""};
+    return {std::string(info->icon), std::string(info->description)};
 }
 
 bool
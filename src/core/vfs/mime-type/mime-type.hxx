@@ -22,6 +22,8 @@
 #include <string>
 #include <string_view>
 
+#include "vfs/linux/statx.hxx"
+
 namespace vfs::detail::mime_type
 {
 /*
@@ -32,6 +34,25 @@ namespace vfs::detail::mime_type
  */
 [[nodiscard]] std::string get_by_file(const std::filesystem::path& path) noexcept;
 
+/*
+ * Same as above but uses the already resolved, not followed, stat of the file.
+ * Only symlinks need to touch the filesystem for the file type.
+ *
+ * Without read_content a file that is not matched by name is
+ * application/x-executable or application/octet-stream until get_by_content()
+ * is used, for directory loads where the content is read in the background.
+ */
+[[nodiscard]] std::string get_by_file(const std::filesystem::path& path,
+                                      const vfs::linux::statx& stat,
+                                      const bool read_content = true) noexcept;
+
+/*
+ * Match the start of the file against the magic rules of mime.cache,
+ * the file is read with a single pread(2). Falls back to text/plain
+ * if there are no null bytes, application/octet-stream otherwise.
+ */
+[[nodiscard]] std::string get_by_content(const std::filesystem::path& path) noexcept;
+
 [[nodiscard]] bool is_text(std::string_view mime_type) noexcept;
 [[nodiscard]] bool is_executable(std::string_view mime_type) noexcept;
 [[nodiscard]] bool is_archive(std::string_view mime_type) noexcept;
@@ -42,9 +63,9 @@ namespace vfs::detail::mime_type
 
 /* Get human-readable description and icon name of the mime-type.
  *
- * Note: Spec is not followed for icon.  If icon tag is found in .local
- * xml file, it is used.  Otherwise vfs_mime_type_get_icon guesses the icon.
- * The Freedesktop spec /usr/share/mime/generic-icons is NOT parsed.
+ * Read from the mime_info index, the icon is the one from the icons or
+ * generic-icons files, or the icon of a parent class. If there is none
+ * vfs::mime_type::icon() guesses the icon.
  */
 [[nodiscard]] std::array<std::string, 2> get_desc_icon(std::string_view type) noexcept;
 } // namespace vfs::detail::mime_type
@@ -21,95 +21,157 @@
  * SOFTWARE.
  */
 
+#include <atomic>
 #include <filesystem>
-#include <stop_token>
+#include <stdexcept>
 #include <utility>
 
 #include "vfs/notify-cpp/controller.hxx"
+#include "vfs/notify-cpp/fanotify.hxx"
+
+namespace global
+{
+static std::atomic<notify::backend> backend{notify::backend::inotify};
+}
+
+void
+notify::set_backend(const backend backend) noexcept
+{
+    global::backend.store(backend);
+}
+
+notify::backend
+notify::get_backend() noexcept
+{
+    return global::backend.load();
+}
 
 notify::controller::controller(const std::filesystem::path& path, std::set<event> events)
-    : notify_(path, events)
+    : path_(path), events_(std::move(events))
+{
+}
+
+notify::controller::~controller() noexcept
 {
+    stop();
 }
 
 void
-notify::controller::run(const std::stop_token& stoken) noexcept
+notify::controller::start()
 {
-    // std::stop_callback cb(stoken, [this]() { notify_.stop(); });
+    if (id_ != 0)
+    {
+        return;
+    }
 
-    while (!stoken.stop_requested())
+    if (get_backend() == backend::fanotify)
     {
-        run_once(stoken);
+        auto* fanotify = fanotify::instance();
+        if (fanotify != nullptr)
+        {
+            try
+            {
+                id_ = fanotify->add_watch(path_,
+                                          events_,
+                                          [this](const auto& fse) { on_event(fse); });
+                backend_ = backend::fanotify;
+                return;
+            }
+            catch (const std::runtime_error&)
+            {
+                // filesystem cannot be marked, use inotify for this path
+            }
+        }
     }
+
+    id_ = inotify::instance().add_watch(path_,
+                                        events_,
+                                        [this](const auto& fse) { on_event(fse); });
+    backend_ = backend::inotify;
 }
 
 void
-notify::controller::run_once(const std::stop_token& stoken) noexcept
+notify::controller::stop() noexcept
 {
-    std::stop_callback cb(stoken, [this]() { notify_.stop(); });
-
-    const auto fse = notify_.get_next_event(stoken);
-    if (!fse)
+    if (id_ != 0)
     {
-        return;
+        if (backend_ == backend::fanotify)
+        {
+            fanotify::instance()->remove_watch(id_);
+        }
+        else
+        {
+            inotify::instance().remove_watch(id_);
+        }
+        id_ = 0;
     }
+}
 
-    switch (fse->event)
+void
+notify::controller::on_event(const inotify::file_system_event& fse) noexcept
+{
+    switch (fse.event)
     {
         case event::access:
-            signal_access().emit(fse->path);
+            signal_access().emit(fse.path);
             return;
         case event::modify:
-            signal_modify().emit(fse->path);
+            signal_modify().emit(fse.path);
             return;
         case event::attrib:
-            signal_attrib().emit(fse->path);
+            signal_attrib().emit(fse.path);
             return;
         case event::close_write:
-            signal_close_write().emit(fse->path);
-            signal_close().emit(fse->path);
+            signal_close_write().emit(fse.path);
+            signal_close().emit(fse.path);
             return;
         case event::close_nowrite:
-            signal_close_nowrite().emit(fse->path);
-            signal_close().emit(fse->path);
+            signal_close_nowrite().emit(fse.path);
+            signal_close().emit(fse.path);
             return;
         case event::open:
-            signal_open().emit(fse->path);
+            signal_open().emit(fse.path);
             return;
         case event::moved_from:
-            signal_moved_from().emit(fse->path);
-            signal_move().emit(fse->path);
+            signal_moved_from().emit(fse.path);
+            signal_move().emit(fse.path);
             return;
         case event::moved_to:
-            signal_moved_to().emit(fse->path);
-            signal_move().emit(fse->path);
+            signal_moved_to().emit(fse.path);
+            signal_move().emit(fse.path);
             return;
         case event::create:
-            signal_create().emit(fse->path);
+            signal_create().emit(fse.path);
             return;
         case event::delete_sub:
-            signal_delete().emit(fse->path);
+            signal_delete().emit(fse.path);
             return;
         case event::delete_self:
-            signal_delete_self().emit(fse->path);
+            signal_delete_self().emit(fse.path);
             return;
         case event::move_self:
-            signal_move_self().emit(fse->path);
+            signal_move_self().emit(fse.path);
             return;
         case event::umount:
-            signal_umount().emit(fse->path);
+            signal_umount().emit(fse.path);
             return;
         case event::queue_overflow:
-            signal_queue_overflow().emit(fse->path);
+            signal_queue_overflow().emit(fse.path);
             return;
         case event::ignored:
-            signal_ignored().emit(fse->path);
+            signal_ignored().emit(fse.path);
             return;
         case event::close:
-            signal_close().emit(fse->path);
+            signal_close().emit(fse.path);
             return;
         case event::move:
-            signal_move().emit(fse->path);
+            if (!fse.from.empty())
+            {
+                // paired IN_MOVED_FROM and IN_MOVED_TO
+                signal_rename().emit(fse.from, fse.path);
+                signal_move().emit(fse.from);
+            }
+            signal_move().emit(fse.path);
             return;
         case event::none:
         case event::all:
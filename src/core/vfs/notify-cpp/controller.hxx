@@ -25,7 +25,8 @@
 
 #include <filesystem>
 #include <set>
-#include <stop_token>
+
+#include <cstdint>
 
 #include <sigc++/sigc++.h>
 
@@ -33,16 +34,51 @@
 
 namespace notify
 {
+enum class backend : std::uint8_t
+{
+    inotify,
+    fanotify,
+};
+
+/**
+ * Select the backend used by controllers started after this call.
+ * fanotify falls back to inotify if it is not available, or if the
+ * filesystem of the watched path cannot be marked.
+ */
+void set_backend(const backend backend) noexcept;
+[[nodiscard]] backend get_backend() noexcept;
+
+/**
+ * Watch a single path using the shared notify::inotify or notify::fanotify
+ * instance, signals are emitted from the notifier thread once start() is called.
+ */
 class controller
 {
   public:
     controller(const std::filesystem::path& path, std::set<event> events = {event::all});
-
-    void run(const std::stop_token& stoken) noexcept;
-    void run_once(const std::stop_token& stoken) noexcept;
+    ~controller() noexcept;
+    controller(const controller& other) = delete;
+    controller(controller&& other) = delete;
+    controller& operator=(const controller& other) = delete;
+    controller& operator=(controller&& other) = delete;
+
+    /**
+     * Add the watch, connect to the signals before calling this.
+     */
+    void start();
+
+    /**
+     * Remove the watch, no signals are emitted once this returns.
+     */
+    void stop() noexcept;
 
   private:
-    inotify notify_;
+    void on_event(const inotify::file_system_event& fse) noexcept;
+
+    std::filesystem::path path_;
+    std::set<event> events_;
+    std::uint64_t id_ = 0;
+    backend backend_ = backend::inotify; // backend id_ belongs to
 
   public:
     // Supported events
@@ -153,6 +189,17 @@ class controller
         return signal_move_;
     }
 
+    /**
+     * A file was renamed inside the watched directory, emitted with the old
+     * and the new path instead of signal_moved_from() and signal_moved_to().
+     * Those are still emitted for a move into or out of the directory.
+     */
+    [[nodiscard]] auto
+    signal_rename() noexcept
+    {
+        return signal_rename_;
+    }
+
   private:
     sigc::signal<void(std::filesystem::path)> signal_access_;
     sigc::signal<void(std::filesystem::path)> signal_modify_;
@@ -173,5 +220,6 @@ class controller
 
     sigc::signal<void(std::filesystem::path)> signal_close_;
     sigc::signal<void(std::filesystem::path)> signal_move_;
+    sigc::signal<void(std::filesystem::path, std::filesystem::path)> signal_rename_;
 };
 } // namespace notify
@@ -0,0 +1,497 @@
+/**
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <array>
+#include <filesystem>
+#include <format>
+#include <memory>
+#include <mutex>
+#include <ranges>
+#include <set>
+#include <stdexcept>
+#include <stop_token>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/fanotify.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <sys/statfs.h>
+#include <unistd.h>
+
+#include "vfs/notify-cpp/fanotify.hxx"
+
+// fanotify uses the inotify bit values for the events both support, so
+// masks and notify::event values can be used for either backend
+static_assert(FAN_ACCESS == IN_ACCESS);
+static_assert(FAN_MODIFY == IN_MODIFY);
+static_assert(FAN_ATTRIB == IN_ATTRIB);
+static_assert(FAN_CLOSE_WRITE == IN_CLOSE_WRITE);
+static_assert(FAN_CLOSE_NOWRITE == IN_CLOSE_NOWRITE);
+static_assert(FAN_OPEN == IN_OPEN);
+static_assert(FAN_MOVED_FROM == IN_MOVED_FROM);
+static_assert(FAN_MOVED_TO == IN_MOVED_TO);
+static_assert(FAN_CREATE == IN_CREATE);
+static_assert(FAN_DELETE == IN_DELETE);
+static_assert(FAN_DELETE_SELF == IN_DELETE_SELF);
+static_assert(FAN_MOVE_SELF == IN_MOVE_SELF);
+static_assert(FAN_Q_OVERFLOW == IN_Q_OVERFLOW);
+
+static_assert(sizeof(fsid_t) == sizeof(__kernel_fsid_t));
+
+namespace
+{
+// dispatch order for merged events, entries are added before they are
+// modified and modified before they are removed
+constexpr std::array<std::uint32_t, 12> EVENT_ORDER{
+    FAN_CREATE,
+    FAN_MOVED_TO,
+    FAN_OPEN,
+    FAN_ACCESS,
+    FAN_MODIFY,
+    FAN_ATTRIB,
+    FAN_CLOSE_WRITE,
+    FAN_CLOSE_NOWRITE,
+    FAN_MOVED_FROM,
+    FAN_DELETE,
+    FAN_MOVE_SELF,
+    FAN_DELETE_SELF,
+};
+
+constexpr std::uint32_t SUPPORTED_EVENTS = FAN_CREATE | FAN_MOVED_TO | FAN_OPEN | FAN_ACCESS |
+                                           FAN_MODIFY | FAN_ATTRIB | FAN_CLOSE_WRITE |
+                                           FAN_CLOSE_NOWRITE | FAN_MOVED_FROM | FAN_DELETE |
+                                           FAN_MOVE_SELF | FAN_DELETE_SELF;
+
+std::string
+make_key(const void* fsid, const file_handle* handle) noexcept
+{
+    std::string key(static_cast<const char*>(fsid), sizeof(__kernel_fsid_t));
+    key.append(reinterpret_cast<const char*>(&handle->handle_type), sizeof(handle->handle_type));
+    key.append(reinterpret_cast<const char*>(handle->f_handle), handle->handle_bytes);
+    return key;
+}
+
+/**
+ * @return the mount point of the filesystem path is on, the last parent on the same device
+ */
+std::filesystem::path
+mount_path(const std::filesystem::path& path) noexcept
+{
+    std::error_code ec;
+    auto current = std::filesystem::canonical(path, ec);
+    if (ec)
+    {
+        return path;
+    }
+
+    struct stat st{};
+    if (stat(current.c_str(), &st) == -1)
+    {
+        return current;
+    }
+    const auto device = st.st_dev;
+
+    while (current != current.root_path())
+    {
+        const auto parent = current.parent_path();
+        if (stat(parent.c_str(), &st) == -1 || st.st_dev != device)
+        {
+            break;
+        }
+        current = parent;
+    }
+    return current;
+}
+} // namespace
+
+notify::fanotify::fanotify()
+{
+    fanotify_fd_ = fanotify_init(FAN_CLASS_NOTIF | FAN_REPORT_DFID_NAME | FAN_NONBLOCK | FAN_CLOEXEC,
+                                 O_RDONLY | O_LARGEFILE);
+    if (fanotify_fd_ == -1)
+    {
+        throw std::runtime_error(std::format("fanotify init failed: {}", std::strerror(errno)));
+    }
+
+    event_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (event_fd_ == -1)
+    {
+        close(fanotify_fd_);
+        throw std::runtime_error(std::format("eventfd init failed: {}", std::strerror(errno)));
+    }
+
+    epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd_ == -1)
+    {
+        close(fanotify_fd_);
+        close(event_fd_);
+        throw std::runtime_error(std::format("epoll init failed: {}", std::strerror(errno)));
+    }
+
+    std::int32_t result = 0;
+    epoll_event event{};
+
+    event = {.events = EPOLLIN, .data = {.fd = event_fd_}};
+    result = epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, event_fd_, &event);
+    if (result != -1)
+    {
+        event = {.events = EPOLLIN, .data = {.fd = fanotify_fd_}};
+        result = epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fanotify_fd_, &event);
+    }
+    if (result == -1)
+    {
+        const auto error = errno;
+        close(fanotify_fd_);
+        close(event_fd_);
+        close(epoll_fd_);
+        throw std::runtime_error(
+            std::format("failed to add fanotify to epoll: {}", std::strerror(error)));
+    }
+
+    thread_ = std::jthread([this](const std::stop_token& stoken) { run(stoken); });
+    pthread_setname_np(thread_.native_handle(), "fanotify");
+}
+
+notify::fanotify::~fanotify() noexcept
+{
+    thread_.request_stop();
+
+    std::uint64_t value = 1;
+    auto _ = write(event_fd_, &value, sizeof(value));
+
+    thread_.join();
+
+    close(fanotify_fd_);
+    close(event_fd_);
+    close(epoll_fd_);
+}
+
+notify::fanotify*
+notify::fanotify::instance() noexcept
+{
+    static notify::fanotify* instance = []() -> notify::fanotify*
+    {
+        try
+        {
+            static notify::fanotify instance;
+            return &instance;
+        }
+        catch (const std::runtime_error&)
+        {
+            return nullptr;
+        }
+    }();
+    return instance;
+}
+
+std::uint64_t
+notify::fanotify::add_watch(const std::filesystem::path& path, const std::set<event>& events,
+                            callback&& callback)
+{
+    std::uint32_t mask = 0;
+    for (const auto& e : events)
+    {
+        mask |= std::to_underlying(e);
+    }
+    if ((mask & SUPPORTED_EVENTS) == 0)
+    {
+        throw std::runtime_error(std::format("no fanotify events requested for path '{}'", path));
+    }
+
+    struct statfs fs{};
+    if (statfs(path.c_str(), &fs) == -1)
+    {
+        throw std::runtime_error(
+            std::format("statfs failed with '{}' for path '{}'", std::strerror(errno), path));
+    }
+    const auto fsid = std::string(reinterpret_cast<const char*>(&fs.f_fsid), sizeof(fs.f_fsid));
+
+    struct
+    {
+        file_handle handle;
+        std::array<unsigned char, MAX_HANDLE_SZ> data;
+    } buffer{};
+    buffer.handle.handle_bytes = MAX_HANDLE_SZ;
+    std::int32_t mount_id = 0;
+    if (name_to_handle_at(AT_FDCWD, path.c_str(), &buffer.handle, &mount_id, AT_SYMLINK_FOLLOW) ==
+        -1)
+    {
+        throw std::runtime_error(std::format("name_to_handle_at failed with '{}' for path '{}'",
+                                             std::strerror(errno),
+                                             path));
+    }
+    const auto key = make_key(&fs.f_fsid, &buffer.handle);
+
+    std::scoped_lock lock(lock_);
+
+    // the mark covers the whole filesystem, only widen it if this
+    // subscriber wants events the current mark does not report
+    const auto mark_mask = (mask & SUPPORTED_EVENTS) | FAN_ONDIR;
+    auto& mark = marks_[fsid];
+    if ((mark.mask & mark_mask) != mark_mask)
+    {
+        if (fanotify_mark(fanotify_fd_,
+                          FAN_MARK_ADD | FAN_MARK_FILESYSTEM,
+                          mark_mask,
+                          AT_FDCWD,
+                          path.c_str()) == -1)
+        {
+            const auto error = errno;
+            if (mark.count == 0)
+            {
+                marks_.erase(fsid);
+            }
+            throw std::runtime_error(
+                std::format("adding fanotify filesystem mark failed with '{}' for path '{}'",
+                            std::strerror(error),
+                            path));
+        }
+        if (mark.count == 0)
+        {
+            mark.mount_path = mount_path(path);
+        }
+        mark.mask |= mark_mask;
+    }
+    mark.count += 1;
+
+    const auto id = next_id_++;
+
+    auto& watch = watches_[key];
+    if (watch.subscribers.empty())
+    {
+        watch.fsid = fsid;
+    }
+    watch.subscribers.insert(
+        {id,
+         {.path = path,
+          .mask = mask,
+          .callback = std::make_shared<fanotify::callback>(std::move(callback))}});
+    ids_.insert({id, key});
+
+    return id;
+}
+
+void
+notify::fanotify::remove_watch(const std::uint64_t id) noexcept
+{
+    {
+        std::scoped_lock lock(lock_);
+
+        const auto it = ids_.find(id);
+        if (it == ids_.cend())
+        {
+            return;
+        }
+        const auto key = it->second;
+        ids_.erase(it);
+
+        const auto watch = watches_.find(key);
+        if (watch != watches_.cend())
+        {
+            const auto fsid = watch->second.fsid;
+
+            watch->second.subscribers.erase(id);
+            if (watch->second.subscribers.empty())
+            {
+                watches_.erase(watch);
+            }
+
+            const auto mark = marks_.find(fsid);
+            if (mark != marks_.cend() && --mark->second.count == 0)
+            {
+                // best effort, the kernel drops the mark itself on unmount
+                fanotify_mark(fanotify_fd_,
+                              FAN_MARK_REMOVE | FAN_MARK_FILESYSTEM,
+                              mark->second.mask,
+                              AT_FDCWD,
+                              mark->second.mount_path.c_str());
+                marks_.erase(mark);
+            }
+        }
+    }
+
+    if (thread_.get_id() != std::this_thread::get_id())
+    {
+        // wait for a dispatch that may still be running the removed callback
+        std::scoped_lock lock(dispatch_lock_);
+    }
+}
+
+void
+notify::fanotify::run(const std::stop_token& stoken) noexcept
+{
+    while (!stoken.stop_requested())
+    {
+        std::array<epoll_event, 2> events{};
+
+        const auto nfds = epoll_wait(epoll_fd_, events.data(), events.size(), -1);
+        if (nfds == -1)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return;
+        }
+
+        for (const auto& event : events | std::views::take(nfds))
+        {
+            if (event.data.fd == fanotify_fd_)
+            {
+                read_events();
+            }
+        }
+    }
+}
+
+void
+notify::fanotify::read_events() noexcept
+{
+    // only one reader, keep the buffer off the stack
+    alignas(fanotify_event_metadata) static std::array<char, 256 * 1024> buffer{};
+
+    while (true)
+    {
+        auto length = read(fanotify_fd_, buffer.data(), buffer.size());
+        if (length <= 0)
+        {
+            // EAGAIN, queue drained
+            return;
+        }
+
+        std::scoped_lock lock(dispatch_lock_);
+
+        for (const auto* metadata = reinterpret_cast<const fanotify_event_metadata*>(buffer.data());
+             FAN_EVENT_OK(metadata, length);
+             metadata = FAN_EVENT_NEXT(metadata, length))
+        {
+            if (metadata->vers != FANOTIFY_METADATA_VERSION)
+            {
+                return;
+            }
+
+            if (metadata->fd >= 0)
+            {
+                // not used with fid reporting
+                close(metadata->fd);
+            }
+
+            if (metadata->mask & FAN_Q_OVERFLOW)
+            {
+                dispatch_overflow();
+                continue;
+            }
+
+            const auto* info = reinterpret_cast<const fanotify_event_info_fid*>(
+                reinterpret_cast<const char*>(metadata) + metadata->metadata_len);
+            if (metadata->event_len <= metadata->metadata_len ||
+                (info->hdr.info_type != FAN_EVENT_INFO_TYPE_DFID_NAME &&
+                 info->hdr.info_type != FAN_EVENT_INFO_TYPE_DFID))
+            {
+                continue;
+            }
+
+            const auto* handle = reinterpret_cast<const file_handle*>(info->handle);
+
+            std::string_view name;
+            if (info->hdr.info_type == FAN_EVENT_INFO_TYPE_DFID_NAME)
+            {
+                name = reinterpret_cast<const char*>(handle->f_handle + handle->handle_bytes);
+                if (name == ".")
+                {
+                    // event on the directory itself
+                    name = {};
+                }
+            }
+
+            dispatch(make_key(&info->fsid, handle),
+                     static_cast<std::uint32_t>(metadata->mask) & SUPPORTED_EVENTS,
+                     name);
+        }
+    }
+}
+
+void
+notify::fanotify::dispatch(const std::string& key, const std::uint32_t mask,
+                           const std::string_view name) noexcept
+{
+    std::vector<std::pair<file_system_event, std::shared_ptr<callback>>> pending;
+    {
+        std::scoped_lock lock(lock_);
+
+        const auto it = watches_.find(key);
+        if (it == watches_.cend())
+        {
+            return;
+        }
+
+        for (const auto bit : EVENT_ORDER)
+        {
+            if ((mask & bit) == 0)
+            {
+                continue;
+            }
+            for (const auto& subscriber : it->second.subscribers | std::views::values)
+            {
+                if (subscriber.mask & bit)
+                {
+                    const auto path = name.empty() ? subscriber.path : subscriber.path / name;
+                    pending.push_back({{path, static_cast<event>(bit), 0, {}}, subscriber.callback});
+                }
+            }
+        }
+    }
+
+    // run without lock_ held so callbacks can add or remove watches
+    for (const auto& [event, callback] : pending)
+    {
+        (*callback)(event);
+    }
+}
+
+void
+notify::fanotify::dispatch_overflow() noexcept
+{
+    std::vector<std::pair<file_system_event, std::shared_ptr<callback>>> pending;
+    {
+        std::scoped_lock lock(lock_);
+
+        for (const auto& watch : watches_ | std::views::values)
+        {
+            for (const auto& subscriber : watch.subscribers | std::views::values)
+            {
+                pending.push_back(
+                    {{subscriber.path, event::queue_overflow, 0, {}}, subscriber.callback});
+            }
+        }
+    }
+
+    for (const auto& [event, callback] : pending)
+    {
+        (*callback)(event);
+    }
+}
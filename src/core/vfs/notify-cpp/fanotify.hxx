@@ -0,0 +1,126 @@
+/**
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <stop_token>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+
+#include <cstdint>
+
+#include "vfs/notify-cpp/notify.hxx"
+
+namespace notify
+{
+/**
+ * Process wide fanotify instance.
+ *
+ * Uses one FAN_MARK_FILESYSTEM mark per filesystem instead of one watch per
+ * directory, so it is not limited by max_user_watches. Events are reported
+ * with FAN_REPORT_DFID_NAME and routed to the subscribers of the directory
+ * whose file handle matches the event's parent directory handle.
+ *
+ * Filesystem marks need CAP_SYS_ADMIN, instance() returns nullptr if the
+ * fanotify group cannot be created. add_watch() throws if the path's
+ * filesystem cannot be marked, callers are expected to fall back to
+ * notify::inotify in both cases.
+ *
+ * fanotify has no unmount or ignored events, and events on the same object
+ * may be merged, those are dispatched one at a time in a fixed order.
+ */
+class fanotify
+{
+  public:
+    fanotify(const fanotify& other) = delete;
+    fanotify(fanotify&& other) = delete;
+    fanotify& operator=(const fanotify& other) = delete;
+    fanotify& operator=(fanotify&& other) = delete;
+
+    [[nodiscard]] static fanotify* instance() noexcept;
+
+    using file_system_event = inotify::file_system_event;
+    using callback = inotify::callback;
+
+    /**
+     * @brief Subscribe to events for directory path, callback is run on the fanotify thread.
+     * @return subscription id used to remove the watch
+     */
+    [[nodiscard]] std::uint64_t add_watch(const std::filesystem::path& path,
+                                          const std::set<event>& events, callback&& callback);
+
+    /**
+     * @brief Remove a subscription. When this returns the callback is not
+     *        running and will not be run again, unless called from the
+     *        callback itself.
+     */
+    void remove_watch(const std::uint64_t id) noexcept;
+
+  private:
+    fanotify();
+    ~fanotify() noexcept;
+
+    void run(const std::stop_token& stoken) noexcept;
+    void read_events() noexcept;
+    void dispatch(const std::string& key, const std::uint32_t mask,
+                  const std::string_view name) noexcept;
+    void dispatch_overflow() noexcept;
+
+    struct subscriber final
+    {
+        // the path this subscriber watched, see notify::inotify
+        std::filesystem::path path;
+        std::uint32_t mask;
+        std::shared_ptr<fanotify::callback> callback;
+    };
+
+    struct watch final
+    {
+        std::string fsid;
+        std::map<std::uint64_t, subscriber> subscribers;
+    };
+
+    struct filesystem_mark final
+    {
+        // used to remove the mark, the watched directories may be gone by then.
+        // not an open fd, that would keep the filesystem from being unmounted
+        std::filesystem::path mount_path;
+        std::uint32_t mask;
+        std::size_t count; // watches on this filesystem
+    };
+
+    std::int32_t fanotify_fd_ = 0;
+    std::int32_t event_fd_ = 0;
+    std::int32_t epoll_fd_ = 0;
+
+    std::mutex lock_;
+    std::unordered_map<std::string, watch> watches_;         // fsid + dir handle -> watch
+    std::unordered_map<std::uint64_t, std::string> ids_;     // subscription id -> handle
+    std::unordered_map<std::string, filesystem_mark> marks_; // fsid -> filesystem mark
+    std::uint64_t next_id_ = 1;
+
+    // held while callbacks run so remove_watch() can wait for them
+    std::mutex dispatch_lock_;
+
+    std::jthread thread_;
+};
+} // namespace notify
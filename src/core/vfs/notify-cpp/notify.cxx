@@ -24,14 +24,24 @@
 #include <array>
 #include <filesystem>
 #include <format>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <ranges>
 #include <set>
 #include <stop_token>
+#include <string>
+#include <string_view>
+#include <thread>
 #include <utility>
+#include <vector>
 
 #include <cerrno>
 #include <cstddef>
 #include <cstring>
 
+#include <poll.h>
+#include <pthread.h>
 #include <sys/epoll.h>
 #include <sys/eventfd.h>
 #include <sys/inotify.h>
@@ -44,16 +54,15 @@
 #include <print>
 #endif
 
-notify::inotify::inotify(const std::filesystem::path& path, std::set<notify::event> events)
-    : path_(path)
+notify::inotify::inotify()
 {
-    inotify_fd_ = inotify_init1(IN_NONBLOCK);
+    inotify_fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
     if (inotify_fd_ == -1)
     {
         throw std::runtime_error(std::format("inotify init failed: {}", std::strerror(errno)));
     }
 
-    event_fd_ = eventfd(0, EFD_NONBLOCK);
+    event_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
     if (event_fd_ == -1)
     {
         throw std::runtime_error(std::format("eventfd init failed: {}", std::strerror(errno)));
@@ -84,8 +93,38 @@ notify::inotify::inotify(const std::filesystem::path& path, std::set<notify::eve
             std::format("failed to add inotify to epoll: {}", std::strerror(errno)));
     }
 
+    thread_ = std::jthread([this](const std::stop_token& stoken) { run(stoken); });
+    pthread_setname_np(thread_.native_handle(), "notifier");
+}
+
+notify::inotify::~inotify() noexcept
+{
+    // std::println("notify::~notify({})", static_cast<void*>(this));
+    thread_.request_stop();
+
+    std::uint64_t value = 1;
+    auto _ = write(event_fd_, &value, sizeof(value));
+
+    thread_.join();
+
+    close(inotify_fd_);
+    close(event_fd_);
+    close(epoll_fd_);
+}
+
+notify::inotify&
+notify::inotify::instance()
+{
+    static notify::inotify instance;
+    return instance;
+}
+
+std::uint64_t
+notify::inotify::add_watch(const std::filesystem::path& path, const std::set<event>& events,
+                           callback&& callback)
+{
     const auto mask = std::invoke(
-        [](std::set<notify::event> events) noexcept
+        [](const std::set<notify::event>& events) noexcept
         {
             std::uint32_t mask = 0;
             for (const auto& e : events)
@@ -96,11 +135,13 @@ notify::inotify::inotify(const std::filesystem::path& path, std::set<notify::eve
         },
         events);
 
-    wd_ = inotify_add_watch(inotify_fd_, path.c_str(), mask);
+    std::scoped_lock lock(lock_);
 
-    if (wd_ == -1)
+    // IN_MASK_ADD so other subscribers of the same inode keep their events
+    const auto wd = inotify_add_watch(inotify_fd_, path.c_str(), mask | IN_MASK_ADD);
+    if (wd == -1)
     {
-        if (errno == 28)
+        if (errno == ENOSPC)
         {
             throw std::runtime_error(
                 std::format("adding inotify watch failed with '{}' (Help: increase "
@@ -112,113 +153,316 @@ notify::inotify::inotify(const std::filesystem::path& path, std::set<notify::eve
                                              std::strerror(errno),
                                              path));
     }
-}
 
-notify::inotify::~inotify() noexcept
-{
-    // std::println("notify::~notify({})", static_cast<void*>(this));
-    close(inotify_fd_);
-    close(event_fd_);
-    close(epoll_fd_);
+    const auto id = next_id_++;
+
+    watches_[wd].subscribers.insert(
+        {id,
+         {.path = path,
+          .mask = mask,
+          .callback = std::make_shared<inotify::callback>(std::move(callback))}});
+    ids_.insert({id, wd});
+
+    return id;
 }
 
 void
-notify::inotify::stop() const noexcept
+notify::inotify::remove_watch(const std::uint64_t id) noexcept
 {
-    std::uint64_t value = 1;
-    auto _ = write(event_fd_, &value, sizeof(value));
+    {
+        std::scoped_lock lock(lock_);
+
+        const auto it = ids_.find(id);
+        if (it == ids_.cend())
+        {
+            return;
+        }
+        const auto wd = it->second;
+        ids_.erase(it);
+
+        const auto watch = watches_.find(wd);
+        if (watch != watches_.cend())
+        {
+            watch->second.subscribers.erase(id);
+            if (watch->second.subscribers.empty())
+            {
+                inotify_rm_watch(inotify_fd_, wd);
+                watches_.erase(watch);
+            }
+            // inotify can only change a mask through a path, which may now
+            // resolve to another inode, so the mask of a shared watch is left
+            // as is. dispatch() filters events by each subscribers own mask.
+        }
+    }
+
+    if (thread_.get_id() != std::this_thread::get_id())
+    {
+        // wait for a dispatch that may still be running the removed callback
+        std::scoped_lock lock(dispatch_lock_);
+    }
 }
 
-notify::inotify::file_system_event
-notify::inotify::get_next_event_from_queue() noexcept
+void
+notify::inotify::run(const std::stop_token& stoken) noexcept
 {
-    auto event = queue_.front();
-    queue_.pop();
-    return event;
+    while (!stoken.stop_requested())
+    {
+        std::array<epoll_event, 2> events{};
+
+        const auto nfds = epoll_wait(epoll_fd_, events.data(), events.size(), -1);
+        if (nfds == -1)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return;
+        }
+
+        for (const auto& event : events | std::views::take(nfds))
+        {
+            if (event.data.fd == inotify_fd_)
+            {
+                read_events();
+            }
+        }
+    }
 }
 
-std::optional<notify::inotify::file_system_event>
-notify::inotify::get_next_event(const std::stop_token& stoken)
+void
+notify::inotify::read_events() noexcept
 {
     static constexpr std::size_t MAX_EVENTS = 4096;
     static constexpr std::size_t EVENT_SIZE = (sizeof(inotify_event));
     static constexpr std::size_t EVENT_BUF_LEN = (MAX_EVENTS * (EVENT_SIZE + 16));
 
-    if (!queue_.empty())
-    {
-        return get_next_event_from_queue();
-    }
+    // how long an IN_MOVED_FROM at the end of a read waits for its IN_MOVED_TO,
+    // both are queued together so this only matters if a read splits them
+    static constexpr std::int32_t MOVE_PAIR_TIMEOUT_MS = 10;
 
-    std::ptrdiff_t length = 0;
-    std::array<char, EVENT_BUF_LEN> buffer{};
+    // only one reader, keep the buffer off the stack
+    static std::array<char, EVENT_BUF_LEN> buffer{};
 
-    while (!stoken.stop_requested())
+    struct raw_event final
+    {
+        std::int32_t wd;
+        std::uint32_t mask;
+        std::uint32_t cookie;
+        std::string_view name;
+    };
+    std::vector<raw_event> events;
+
+    struct held_move final
     {
-        std::array<epoll_event, 1> events{};
+        std::int32_t wd;
+        std::uint32_t cookie;
+        std::string name;
+    };
+    std::optional<held_move> held;
 
-        const auto nfds = epoll_pwait(epoll_fd_, events.data(), events.size(), -1, nullptr);
-        if (nfds == -1)
+    while (true)
+    {
+        const auto length = read(inotify_fd_, buffer.data(), buffer.size());
+        if (length <= 0)
         {
-            return std::nullopt;
+            // EAGAIN, queue drained
+            if (held)
+            {
+                pollfd pfd{.fd = inotify_fd_, .events = POLLIN, .revents = 0};
+                if (poll(&pfd, 1, MOVE_PAIR_TIMEOUT_MS) > 0)
+                {
+                    continue;
+                }
+
+                // moved out of the watched directory
+                std::scoped_lock lock(dispatch_lock_);
+                dispatch(held->wd, IN_MOVED_FROM, held->cookie, held->name);
+            }
+            return;
         }
 
-        if (nfds == 0)
+        events.clear();
+        std::size_t i = 0;
+        while (std::cmp_less(i, length))
         {
-            continue;
+            const auto* event = reinterpret_cast<inotify_event*>(&buffer[i]);
+
+            // remove IN_ISDIR bit from event mask, if the
+            // mask is i.e. (IN_CREATE | IN_ISDIR) we only want IN_CREATE
+            events.push_back({event->wd,
+                              event->mask & ~static_cast<std::uint32_t>(IN_ISDIR),
+                              event->cookie,
+                              event->len ? std::string_view(event->name) : std::string_view()});
+
+            i += EVENT_SIZE + event->len;
         }
 
-        const auto& event = events.front();
+        // find the IN_MOVED_TO on the same watch that pairs with an IN_MOVED_FROM
+        const auto find_pair = [&events](const std::size_t first, const std::int32_t wd,
+                                         const std::uint32_t cookie) -> std::optional<std::size_t>
+        {
+            for (std::size_t index = first; index < events.size(); ++index)
+            {
+                const auto& event = events[index];
+                if (event.mask == IN_MOVED_TO && event.cookie == cookie)
+                {
+                    if (event.wd != wd)
+                    {
+                        // moved to another watched directory, not a rename
+                        return std::nullopt;
+                    }
+                    return index;
+                }
+            }
+            return std::nullopt;
+        };
+
+        std::scoped_lock lock(dispatch_lock_);
 
-        if (event.data.fd == inotify_fd_)
+        std::vector<bool> paired(events.size(), false);
+
+        if (held)
         {
-            buffer.fill('\0');
+            const auto pair = find_pair(0, held->wd, held->cookie);
+            if (pair)
+            {
+                paired[*pair] = true;
+                dispatch_rename(held->wd, held->cookie, held->name, events[*pair].name);
+            }
+            else
+            {
+                dispatch(held->wd, IN_MOVED_FROM, held->cookie, held->name);
+            }
+            held = std::nullopt;
+        }
 
-            length = read(inotify_fd_, buffer.data(), buffer.size());
-            if (length == -1)
+        for (std::size_t index = 0; index < events.size(); ++index)
+        {
+            if (paired[index])
             {
-                if (errno != EINTR)
+                continue;
+            }
+
+            const auto& event = events[index];
+            if (event.mask == IN_MOVED_FROM && event.cookie != 0)
+            {
+                const auto pair = find_pair(index + 1, event.wd, event.cookie);
+                if (pair)
                 {
+                    paired[*pair] = true;
+                    dispatch_rename(event.wd, event.cookie, event.name, events[*pair].name);
+                    continue;
+                }
+
+                if (index + 1 == events.size())
+                {
+                    // the IN_MOVED_TO may be in the next read
+                    held = held_move{event.wd, event.cookie, std::string(event.name)};
                     continue;
                 }
             }
-            break;
-        }
-        else if (event.data.fd == event_fd_)
-        {
-            continue;
+
+            dispatch(event.wd, event.mask, event.cookie, event.name);
         }
     }
+}
+
+void
+notify::inotify::dispatch(const std::int32_t wd, const std::uint32_t mask,
+                          const std::uint32_t cookie, const std::string_view name) noexcept
+{
+    // always delivered, not part of any requested mask
+    static constexpr std::uint32_t KERNEL_EVENTS = IN_UNMOUNT | IN_Q_OVERFLOW | IN_IGNORED;
 
-    std::size_t i = 0;
-    while (std::cmp_less(i, length) && !stoken.stop_requested())
+    std::vector<std::pair<file_system_event, std::shared_ptr<callback>>> pending;
     {
-        const auto* event = reinterpret_cast<inotify_event*>(&buffer[i]);
-        if (!event)
+        std::scoped_lock lock(lock_);
+
+        const auto deliver = [this, mask, cookie, name, &pending](const watch& watch)
         {
-            return std::nullopt;
-        }
+            for (const auto& subscriber : watch.subscribers | std::views::values)
+            {
+                if ((subscriber.mask & mask) != 0 || (mask & KERNEL_EVENTS) != 0)
+                {
+                    const auto path = name.empty() ? subscriber.path : subscriber.path / name;
+                    pending.push_back({{path, get_inotify(mask), cookie, {}}, subscriber.callback});
+                }
+            }
+        };
 
-        // remove IN_ISDIR bit from event mask, if the
-        // mask is i.e. (IN_CREATE | IN_ISDIR) we only want IN_CREATE
-        const auto mask = event->mask & static_cast<std::uint32_t>(IN_ISDIR)
-                              ? event->mask & ~static_cast<std::uint32_t>(IN_ISDIR)
-                              : event->mask;
+        if (wd == -1)
+        {
+            // IN_Q_OVERFLOW is not for any one watch
+            for (const auto& watch : watches_ | std::views::values)
+            {
+                deliver(watch);
+            }
+        }
+        else if (const auto it = watches_.find(wd); it != watches_.cend())
+        {
+            deliver(it->second);
 
-        queue_.push(file_system_event(event->len ? path_ / event->name : path_, get_inotify(mask)));
+            if (mask & IN_IGNORED)
+            {
+                // the kernel already removed the watch
+                watches_.erase(it);
+            }
+        }
 
 #if defined(PRINT_DBG)
-        std::println("event = {}\t| {}", event->mask, event->len ? (path_ / event->name) : path_);
+        std::println("event = {}\t| {}", mask, name);
 #endif
+    }
 
-        i += EVENT_SIZE + event->len;
+    // run without lock_ held so callbacks can add or remove watches
+    for (const auto& [event, callback] : pending)
+    {
+        (*callback)(event);
     }
+}
 
-    if (stoken.stop_requested() || queue_.empty())
+void
+notify::inotify::dispatch_rename(const std::int32_t wd, const std::uint32_t cookie,
+                                 const std::string_view from, const std::string_view to) noexcept
+{
+    std::vector<std::pair<file_system_event, std::shared_ptr<callback>>> pending;
     {
-        return std::nullopt;
+        std::scoped_lock lock(lock_);
+
+        const auto it = watches_.find(wd);
+        if (it == watches_.cend())
+        {
+            return;
+        }
+
+        for (const auto& subscriber : it->second.subscribers | std::views::values)
+        {
+            const auto from_path = subscriber.path / from;
+            const auto to_path = subscriber.path / to;
+
+            if ((subscriber.mask & IN_MOVE) == IN_MOVE)
+            {
+                pending.push_back({{to_path, event::move, cookie, from_path}, subscriber.callback});
+                continue;
+            }
+
+            // only asked for one side of the rename
+            if (subscriber.mask & IN_MOVED_FROM)
+            {
+                pending.push_back({{from_path, event::moved_from, cookie, {}}, subscriber.callback});
+            }
+            if (subscriber.mask & IN_MOVED_TO)
+            {
+                pending.push_back({{to_path, event::moved_to, cookie, {}}, subscriber.callback});
+            }
+        }
     }
 
-    return get_next_event_from_queue();
+    // run without lock_ held so callbacks can add or remove watches
+    for (const auto& [event, callback] : pending)
+    {
+        (*callback)(event);
+    }
 }
 
 notify::event
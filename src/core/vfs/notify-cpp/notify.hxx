@@ -24,9 +24,15 @@
 #pragma once
 
 #include <filesystem>
-#include <queue>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <set>
 #include <stop_token>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
 
 #include <cstdint>
 
@@ -67,43 +73,96 @@ enum class event : std::uint32_t
     all = IN_ALL_EVENTS,
 };
 
+/**
+ * Process wide inotify instance.
+ *
+ * Owns a single inotify fd and epoll loop running on one thread, every
+ * watched path is added to that fd and events are dispatched to the
+ * subscribers of the event's watch descriptor. Multiple subscribers of the
+ * same inode share one watch descriptor with the union of their masks, the
+ * mask only shrinks once the last subscriber is removed.
+ *
+ * IN_MOVED_FROM and IN_MOVED_TO with the same cookie on the same watch are
+ * delivered as one event::move to subscribers of both events. A move into
+ * or out of the watched directory is delivered as the single event.
+ */
 class inotify
 {
   public:
-    inotify(const std::filesystem::path& path, std::set<event> events);
-    ~inotify() noexcept;
+    inotify(const inotify& other) = delete;
+    inotify(inotify&& other) = delete;
+    inotify& operator=(const inotify& other) = delete;
+    inotify& operator=(inotify&& other) = delete;
+
+    [[nodiscard]] static inotify& instance();
 
     struct file_system_event final
     {
         // absoulte path + filename
         std::filesystem::path path;
         event event;
+        // links IN_MOVED_FROM and IN_MOVED_TO of the same rename, otherwise 0
+        std::uint32_t cookie;
+        // set for a rename inside one watched directory, IN_MOVED_FROM and
+        // IN_MOVED_TO are paired into a single event::move from -> path
+        std::filesystem::path from;
     };
 
+    using callback = std::function<void(const file_system_event&)>;
+
     /**
-     * @brief Blocking wait on new events of watched files/directories
-     *        specified on the eventmask. file_system_event's
-     *        will be returned one by one. Thus this
-     *        function can be called in some while(true)
-     *        loop.
-     * @return A new file_system_event
+     * @brief Subscribe to events for path, callback is run on the inotify thread.
+     * @return subscription id used to remove the watch
      */
-    [[nodiscard]] std::optional<file_system_event> get_next_event(const std::stop_token& stoken);
+    [[nodiscard]] std::uint64_t add_watch(const std::filesystem::path& path,
+                                          const std::set<event>& events, callback&& callback);
 
-    void stop() const noexcept;
+    /**
+     * @brief Remove a subscription. When this returns the callback is not
+     *        running and will not be run again, unless called from the
+     *        callback itself.
+     */
+    void remove_watch(const std::uint64_t id) noexcept;
 
   private:
-    [[nodiscard]] file_system_event get_next_event_from_queue() noexcept;
+    inotify();
+    ~inotify() noexcept;
+
+    void run(const std::stop_token& stoken) noexcept;
+    void read_events() noexcept;
+    void dispatch(const std::int32_t wd, const std::uint32_t mask, const std::uint32_t cookie,
+                  const std::string_view name) noexcept;
+    void dispatch_rename(const std::int32_t wd, const std::uint32_t cookie,
+                         const std::string_view from, const std::string_view to) noexcept;
 
     [[nodiscard]] event get_inotify(const std::uint32_t event) noexcept;
 
+    struct subscriber final
+    {
+        // the path this subscriber watched, other subscribers of the same
+        // inode may have reached it through a symlink or bind mount
+        std::filesystem::path path;
+        std::uint32_t mask;
+        std::shared_ptr<inotify::callback> callback;
+    };
+
+    struct watch final
+    {
+        std::map<std::uint64_t, subscriber> subscribers;
+    };
+
     std::int32_t inotify_fd_ = 0;
     std::int32_t event_fd_ = 0;
     std::int32_t epoll_fd_ = 0;
 
-    std::int32_t wd_ = 0;
-    std::filesystem::path path_;
+    std::mutex lock_;
+    std::unordered_map<std::int32_t, watch> watches_;     // wd -> watch
+    std::unordered_map<std::uint64_t, std::int32_t> ids_; // subscription id -> wd
+    std::uint64_t next_id_ = 1;
+
+    // held while callbacks run so remove_watch() can wait for them
+    std::mutex dispatch_lock_;
 
-    std::queue<file_system_event> queue_;
+    std::jthread thread_;
 };
 } // namespace notify
@@ -35,6 +35,8 @@
 #include "vfs/task-manager.hxx"
 #include "vfs/trash-can.hxx"
 
+#include "vfs/utils/id-cache.hxx"
+
 #include "logger.hxx"
 
 // Notes:
@@ -208,16 +210,16 @@ vfs::task_manager::add(const vfs::chown_task& task) noexcept
 {
     auto slot = [task](const std::stop_token& stoken, const std::shared_ptr<task_item>& item)
     {
-        const auto pw = ztd::passwd::create(task.user);
-        const auto gr = ztd::group::create(task.group);
+        const auto user = vfs::utils::user_id(task.user);
+        const auto group = vfs::utils::group_id(task.group);
 
-        if (!pw || !gr)
+        if (!user || !group)
         {
             throw std::runtime_error("Invalid user or group name");
         }
 
-        const uid_t uid = pw->uid();
-        const gid_t gid = gr->gid();
+        const uid_t uid = *user;
+        const gid_t gid = *group;
 
         auto chown_wrapper = [uid, gid](const std::filesystem::path& path)
         {
@@ -0,0 +1,236 @@
+/**
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <iterator>
+#include <mutex>
+#include <utility>
+
+#include <cstddef>
+
+#include <gdkmm.h>
+#include <glibmm.h>
+
+#include "vfs/texture-cache.hxx"
+
+#include "logger.hxx"
+
+vfs::texture_cache::texture_cache(const std::size_t budget) noexcept : budget_(budget) {}
+
+vfs::texture_cache&
+vfs::texture_cache::global() noexcept
+{
+    // never destroyed, vfs::file erases from it in its destructor and files
+    // are still held by other statics, i.e. the dir cache, at exit
+    static auto* cache = new vfs::texture_cache;
+    return *cache;
+}
+
+void
+vfs::texture_cache::set_budget(const std::size_t bytes) noexcept
+{
+    std::scoped_lock lock(mutex_);
+    budget_ = bytes;
+    evict();
+
+    logger::debug<logger::vfs>("texture cache budget {} bytes, using {} bytes", budget_, bytes_);
+}
+
+std::size_t
+vfs::texture_cache::budget() const noexcept
+{
+    std::scoped_lock lock(mutex_);
+    return budget_;
+}
+
+void
+vfs::texture_cache::insert(const key& key, const Glib::RefPtr<Gdk::Texture>& texture,
+                           const std::size_t bytes) noexcept
+{
+    std::scoped_lock lock(mutex_);
+
+    auto& entry = entries_[key];
+
+    // a pinned key is on screen. anything else is prefetched and goes to the
+    // cold end, so prefetching past the budget does not evict what was used
+    const auto position = entry.pins != 0 ? lru_.begin() : lru_.end();
+    if (entry.loaded)
+    {
+        bytes_ -= entry.bytes;
+        lru_.splice(position, lru_, entry.lru);
+    }
+    else
+    {
+        entry.lru = lru_.insert(position, key);
+        entry.loaded = true;
+        textures_ += 1;
+    }
+    entry.texture = texture;
+    entry.bytes = bytes;
+    bytes_ += bytes;
+
+    evict();
+}
+
+Glib::RefPtr<Gdk::Texture>
+vfs::texture_cache::get(const key& key) noexcept
+{
+    std::scoped_lock lock(mutex_);
+
+    const auto it = entries_.find(key);
+    if (it == entries_.cend() || !it->second.loaded)
+    {
+        misses_ += 1;
+        return nullptr;
+    }
+
+    hits_ += 1;
+    lru_.splice(lru_.begin(), lru_, it->second.lru);
+    return it->second.texture;
+}
+
+bool
+vfs::texture_cache::contains(const key& key) const noexcept
+{
+    std::scoped_lock lock(mutex_);
+
+    const auto it = entries_.find(key);
+    return it != entries_.cend() && it->second.loaded;
+}
+
+void
+vfs::texture_cache::erase(const key& key) noexcept
+{
+    std::scoped_lock lock(mutex_);
+
+    const auto it = entries_.find(key);
+    if (it == entries_.cend())
+    {
+        return;
+    }
+    unload(it->second);
+    if (it->second.pins == 0)
+    {
+        entries_.erase(it);
+    }
+}
+
+void
+vfs::texture_cache::move(const key& from, const key& to) noexcept
+{
+    std::scoped_lock lock(mutex_);
+
+    const auto it = entries_.find(from);
+    if (it == entries_.cend() || !it->second.loaded || from == to)
+    {
+        return;
+    }
+    // a reference, entries_[to] can rehash
+    auto& source = it->second;
+
+    auto& target = entries_[to];
+    unload(target);
+
+    target.texture = std::move(source.texture);
+    target.bytes = source.bytes;
+    target.loaded = true;
+    target.lru = source.lru;
+    *target.lru = to;
+
+    source.texture = nullptr;
+    source.bytes = 0;
+    source.loaded = false;
+    if (source.pins == 0)
+    {
+        entries_.erase(from);
+    }
+}
+
+void
+vfs::texture_cache::pin(const key& key) noexcept
+{
+    std::scoped_lock lock(mutex_);
+    entries_[key].pins += 1;
+}
+
+void
+vfs::texture_cache::unpin(const key& key) noexcept
+{
+    std::scoped_lock lock(mutex_);
+
+    const auto it = entries_.find(key);
+    if (it == entries_.cend() || it->second.pins == 0)
+    {
+        return;
+    }
+
+    it->second.pins -= 1;
+    if (it->second.pins == 0)
+    {
+        if (!it->second.loaded)
+        {
+            entries_.erase(it);
+        }
+        else if (bytes_ > budget_)
+        {
+            // held over budget by this pin
+            evict();
+        }
+    }
+}
+
+vfs::texture_cache::stats
+vfs::texture_cache::statistics() const noexcept
+{
+    std::scoped_lock lock(mutex_);
+    return {hits_, misses_, evictions_, bytes_, textures_};
+}
+
+void
+vfs::texture_cache::evict() noexcept
+{
+    // pinned entries are skipped, they are near the front anyway
+    auto it = lru_.end();
+    while (bytes_ > budget_ && it != lru_.begin())
+    {
+        --it;
+        const auto entry = entries_.find(*it);
+        if (entry->second.pins != 0)
+        {
+            continue;
+        }
+
+        // unload() erases it from lru_, step past it first
+        it = std::next(it);
+        unload(entry->second);
+        entries_.erase(entry);
+        evictions_ += 1;
+    }
+}
+
+void
+vfs::texture_cache::unload(entry& entry) noexcept
+{
+    if (!entry.loaded)
+    {
+        return;
+    }
+
+    lru_.erase(entry.lru);
+    bytes_ -= entry.bytes;
+    textures_ -= 1;
+    entry.loaded = false;
+    entry.bytes = 0;
+    entry.texture = nullptr;
+}
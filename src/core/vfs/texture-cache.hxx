@@ -0,0 +1,158 @@
+/**
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <functional>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
+#include <cstddef>
+#include <cstdint>
+
+#include <gdkmm.h>
+#include <glibmm.h>
+
+namespace vfs
+{
+class file;
+
+/**
+ * Process wide cache of the decoded thumbnail textures of every vfs::file,
+ * bounded by the bytes of their pixels.
+ *
+ * Once the budget is exceeded the least recently used textures are dropped,
+ * except pinned ones. Views pin the thumbnail of each list item they have
+ * bound, so what is on screen is never evicted even if it alone is over
+ * budget. A key can be pinned before its texture is loaded.
+ *
+ * Textures inserted for a key that is not pinned were prefetched and go in
+ * as the least recently used, once the budget is reached a prefetched
+ * texture is dropped before anything that was shown.
+ */
+class texture_cache final
+{
+  public:
+    struct key final
+    {
+        const vfs::file* file;
+        std::int32_t size;
+
+        [[nodiscard]] bool operator==(const key& other) const noexcept = default;
+    };
+
+    struct stats final
+    {
+        std::uint64_t hits{0};
+        std::uint64_t misses{0};
+        std::uint64_t evictions{0};
+        std::size_t bytes{0};
+        std::size_t textures{0};
+    };
+
+    static constexpr std::size_t DEFAULT_BUDGET = 256 * 1024 * 1024;
+
+    explicit texture_cache(const std::size_t budget = DEFAULT_BUDGET) noexcept;
+    ~texture_cache() = default;
+    texture_cache(const texture_cache& other) = delete;
+    texture_cache(texture_cache&& other) = delete;
+    texture_cache& operator=(const texture_cache& other) = delete;
+    texture_cache& operator=(texture_cache&& other) = delete;
+
+    /**
+     * Process wide cache used by vfs::file, never destroyed.
+     */
+    [[nodiscard]] static vfs::texture_cache& global() noexcept;
+
+    /**
+     * Evicts down to the new budget right away.
+     */
+    void set_budget(const std::size_t bytes) noexcept;
+    [[nodiscard]] std::size_t budget() const noexcept;
+
+    /**
+     * Most recently used if key is pinned, least recently used otherwise.
+     *
+     * @param[in] bytes size of the decoded pixels of texture
+     */
+    void insert(const key& key, const Glib::RefPtr<Gdk::Texture>& texture,
+                const std::size_t bytes) noexcept;
+
+    /**
+     * Counted as a hit or a miss, a hit becomes the most recently used.
+     */
+    [[nodiscard]] Glib::RefPtr<Gdk::Texture> get(const key& key) noexcept;
+
+    /**
+     * Not counted and does not change the order of eviction.
+     */
+    [[nodiscard]] bool contains(const key& key) const noexcept;
+
+    /**
+     * Drop the texture of key, a pinned key stays pinned.
+     */
+    void erase(const key& key) noexcept;
+
+    /**
+     * Give the texture of from to to, keeping its place in the eviction order.
+     * Pins are not moved, used when a vfs::file is replaced by a renamed one.
+     */
+    void move(const key& from, const key& to) noexcept;
+
+    void pin(const key& key) noexcept;
+    void unpin(const key& key) noexcept;
+
+    [[nodiscard]] stats statistics() const noexcept;
+
+  private:
+    struct key_hash final
+    {
+        [[nodiscard]] std::size_t
+        operator()(const key& key) const noexcept
+        {
+            return std::hash<const vfs::file*>{}(key.file) ^
+                   (std::hash<std::int32_t>{}(key.size) << 1);
+        }
+    };
+
+    struct entry final
+    {
+        Glib::RefPtr<Gdk::Texture> texture;
+        std::size_t bytes{0};
+        bool loaded{false};
+        std::uint32_t pins{0};
+        std::list<key>::iterator lru; // only valid if loaded
+    };
+
+    // mutex_ must be held
+    void evict() noexcept;
+    void unload(entry& entry) noexcept;
+
+    std::unordered_map<key, entry, key_hash> entries_;
+    // loaded entries, most recently used first
+    std::list<key> lru_;
+
+    std::size_t budget_;
+    std::size_t bytes_{0};
+    std::size_t textures_{0};
+
+    std::uint64_t hits_{0};
+    std::uint64_t misses_{0};
+    std::uint64_t evictions_{0};
+
+    mutable std::mutex mutex_;
+};
+} // namespace vfs
@@ -0,0 +1,355 @@
+/**
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <stop_token>
+#include <utility>
+#include <vector>
+
+#include <cstdint>
+
+#include "vfs/executor.hxx"
+#include "vfs/file.hxx"
+#include "vfs/thumbnail-scheduler.hxx"
+
+vfs::thumbnail_scheduler::thumbnail_scheduler(const std::size_t workers, loader&& loader,
+                                              vfs::executor& executor) noexcept
+    : workers_(std::max<std::size_t>(1, workers)), loader_(std::move(loader)), tasks_(executor)
+{
+}
+
+vfs::thumbnail_scheduler::~thumbnail_scheduler() noexcept
+{
+    tasks_.shutdown();
+    tasks_.wait();
+}
+
+vfs::thumbnail_scheduler&
+vfs::thumbnail_scheduler::global() noexcept
+{
+    // leave half of the executor for directory loads and mime sniffing
+    static vfs::thumbnail_scheduler scheduler(
+        vfs::executor::global().size() / 2,
+        [](const std::shared_ptr<vfs::file>& file, const std::int32_t size)
+        {
+            if (!file->is_thumbnail_loaded(size))
+            {
+                file->load_thumbnail(size);
+            }
+        });
+    return scheduler;
+}
+
+vfs::thumbnail_scheduler::owner_id
+vfs::thumbnail_scheduler::add_owner(callback&& callback) noexcept
+{
+    std::scoped_lock lock(mutex_);
+    const auto owner = next_owner_++;
+    owners_[owner].on_loaded = std::move(callback);
+    return owner;
+}
+
+void
+vfs::thumbnail_scheduler::remove_owner(const owner_id owner) noexcept
+{
+    cancel(owner);
+
+    std::unique_lock lock(mutex_);
+    idle_cv_.wait(lock,
+                  [this, owner]
+                  {
+                      const auto it = owners_.find(owner);
+                      return it == owners_.cend() || it->second.busy == 0;
+                  });
+    owners_.erase(owner);
+}
+
+void
+vfs::thumbnail_scheduler::request(const owner_id owner, const std::shared_ptr<vfs::file>& file,
+                                  const std::int32_t size, const std::uint32_t position) noexcept
+{
+    std::scoped_lock lock(mutex_);
+    const auto data = owners_.find(owner);
+    if (data == owners_.cend())
+    {
+        return;
+    }
+
+    const auto it = index_.find(file.get());
+    if (distance(data->second, position) > PREFETCH_DISTANCE)
+    {
+        if (it != index_.cend())
+        {
+            erase_waiters(it->second, owner);
+        }
+        return;
+    }
+
+    if (it == index_.cend())
+    {
+        index_.insert({file.get(), queue_.size()});
+        queue_.push_back({file, {{owner, position, size}}, sequence_++});
+    }
+    else
+    {
+        auto& waiters = queue_[it->second].waiters;
+        auto waiter = std::ranges::find_if(waiters,
+                                           [owner, size](const auto& w)
+                                           { return w.owner == owner && w.size == size; });
+        if (waiter == waiters.end())
+        {
+            waiters.push_back({owner, position, size});
+        }
+        else
+        {
+            waiter->position = position;
+        }
+    }
+
+    submit_worker();
+}
+
+void
+vfs::thumbnail_scheduler::cancel(const owner_id owner,
+                                 const std::shared_ptr<vfs::file>& file) noexcept
+{
+    std::scoped_lock lock(mutex_);
+
+    const auto it = index_.find(file.get());
+    if (it == index_.cend())
+    {
+        return;
+    }
+
+    erase_waiters(it->second, owner);
+}
+
+void
+vfs::thumbnail_scheduler::cancel(const owner_id owner) noexcept
+{
+    std::scoped_lock lock(mutex_);
+
+    // erase() moves the last job into the erased slot, which was already checked
+    for (auto i = queue_.size(); i-- > 0;)
+    {
+        erase_waiters(i, owner);
+    }
+}
+
+void
+vfs::thumbnail_scheduler::set_visible_range(const owner_id owner, const std::uint32_t first,
+                                            const std::uint32_t last) noexcept
+{
+    std::scoped_lock lock(mutex_);
+
+    const auto it = owners_.find(owner);
+    if (it == owners_.cend())
+    {
+        return;
+    }
+    auto& data = it->second;
+    data.first = std::min(first, last);
+    data.last = std::max(first, last);
+
+    // erase() moves the last job into the erased slot, which was already checked
+    for (auto i = queue_.size(); i-- > 0;)
+    {
+        const auto far = [owner, &data](const waiter& w)
+        { return w.owner == owner && distance(data, w.position) > PREFETCH_DISTANCE; };
+        std::erase_if(queue_[i].waiters, far);
+        if (queue_[i].waiters.empty())
+        {
+            erase(i);
+        }
+    }
+}
+
+std::size_t
+vfs::thumbnail_scheduler::pending() const noexcept
+{
+    std::scoped_lock lock(mutex_);
+    return queue_.size();
+}
+
+void
+vfs::thumbnail_scheduler::run(const std::stop_token& stoken) noexcept
+{
+    while (true)
+    {
+        job next;
+        {
+            std::scoped_lock lock(mutex_);
+            if (stoken.stop_requested() || !pop(next))
+            {
+                running_ -= 1;
+                return;
+            }
+            loading_.insert(next.file.get());
+        }
+
+        std::vector<std::int32_t> sizes;
+        for (const auto& waiter : next.waiters)
+        {
+            if (!std::ranges::contains(sizes, waiter.size))
+            {
+                sizes.push_back(waiter.size);
+            }
+        }
+        for (const auto size : sizes)
+        {
+            if (!stoken.stop_requested())
+            {
+                loader_(next.file, size);
+            }
+        }
+
+        std::vector<owner_data*> notify;
+        {
+            std::scoped_lock lock(mutex_);
+            loading_.erase(next.file.get());
+            for (const auto& waiter : next.waiters)
+            {
+                const auto it = owners_.find(waiter.owner);
+                if (it != owners_.cend() && !std::ranges::contains(notify, &it->second))
+                {
+                    // remove_owner() waits for busy to drop to zero
+                    it->second.busy += 1;
+                    notify.push_back(&it->second);
+                }
+            }
+        }
+
+        for (auto* owner : notify)
+        {
+            if (!stoken.stop_requested() && owner->on_loaded)
+            {
+                owner->on_loaded(next.file);
+            }
+        }
+
+        if (!notify.empty())
+        {
+            {
+                std::scoped_lock lock(mutex_);
+                for (auto* owner : notify)
+                {
+                    owner->busy -= 1;
+                }
+            }
+            idle_cv_.notify_all();
+        }
+    }
+}
+
+bool
+vfs::thumbnail_scheduler::pop(job& item) noexcept
+{
+    auto best = queue_.size();
+    auto best_distance = std::numeric_limits<std::uint64_t>::max();
+    for (std::size_t i = 0; i < queue_.size(); ++i)
+    {
+        if (loading_.contains(queue_[i].file.get()))
+        {
+            // requested again while loading, runs once that load is done
+            continue;
+        }
+
+        const auto d = distance(queue_[i]);
+        if (best == queue_.size() || d < best_distance ||
+            (d == best_distance && queue_[i].sequence < queue_[best].sequence))
+        {
+            best = i;
+            best_distance = d;
+        }
+    }
+
+    if (best == queue_.size())
+    {
+        return false;
+    }
+
+    // erase() needs the file of the job to update index_
+    item = queue_[best];
+    erase(best);
+    return true;
+}
+
+std::uint64_t
+vfs::thumbnail_scheduler::distance(const job& item) const noexcept
+{
+    auto distance = std::numeric_limits<std::uint64_t>::max();
+    for (const auto& waiter : item.waiters)
+    {
+        const auto it = owners_.find(waiter.owner);
+        if (it == owners_.cend())
+        {
+            continue;
+        }
+
+        distance = std::min(distance, this->distance(it->second, waiter.position));
+    }
+    return distance;
+}
+
+std::uint64_t
+vfs::thumbnail_scheduler::distance(const owner_data& owner, const std::uint32_t position) noexcept
+{
+    if (position < owner.first)
+    {
+        return owner.first - position;
+    }
+    if (position > owner.last)
+    {
+        return position - owner.last;
+    }
+    return 0;
+}
+
+void
+vfs::thumbnail_scheduler::erase(const std::size_t index) noexcept
+{
+    index_.erase(queue_[index].file.get());
+    if (index != queue_.size() - 1)
+    {
+        queue_[index] = std::move(queue_.back());
+        index_[queue_[index].file.get()] = index;
+    }
+    queue_.pop_back();
+}
+
+void
+vfs::thumbnail_scheduler::erase_waiters(const std::size_t index, const owner_id owner) noexcept
+{
+    std::erase_if(queue_[index].waiters, [owner](const auto& w) { return w.owner == owner; });
+    if (queue_[index].waiters.empty())
+    {
+        erase(index);
+    }
+}
+
+void
+vfs::thumbnail_scheduler::submit_worker() noexcept
+{
+    if (running_ >= workers_ || running_ >= queue_.size())
+    {
+        return;
+    }
+
+    running_ += 1;
+    tasks_.submit([this](const std::stop_token& stoken) { run(stoken); });
+}
@@ -0,0 +1,172 @@
+/**
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stop_token>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <cstddef>
+#include <cstdint>
+
+#include "vfs/executor.hxx"
+#include "vfs/file.hxx"
+
+namespace vfs
+{
+/**
+ * Process wide thumbnail queue, processed by at most workers vfs::executor
+ * tasks that only exist while there are requests.
+ *
+ * Every file view is an owner. A request carries the position of the file in
+ * its owners view and the owner reports the range of positions it has bound,
+ * the request closest to the bound range of its owner is loaded first. A file
+ * requested by several owners is loaded once and every owner is told.
+ *
+ * Only positions within PREFETCH_DISTANCE of the bound range are queued,
+ * requests that fall outside once the range moves are dropped. The queue
+ * stays the size of a few screens however large the directory is, owners
+ * request again what comes back into range.
+ */
+class thumbnail_scheduler final
+{
+  public:
+    using owner_id = std::uint64_t;
+
+    static constexpr std::uint32_t PREFETCH_DISTANCE = 256;
+
+    /**
+     * Called from the executor once the thumbnails of file are loaded.
+     */
+    using callback = std::function<void(const std::shared_ptr<vfs::file>&)>;
+
+    /**
+     * Load the thumbnail of file at size, replaced in tests.
+     */
+    using loader = std::function<void(const std::shared_ptr<vfs::file>&, const std::int32_t)>;
+
+    explicit thumbnail_scheduler(const std::size_t workers, loader&& loader,
+                                 vfs::executor& executor = vfs::executor::global()) noexcept;
+    ~thumbnail_scheduler() noexcept;
+    thumbnail_scheduler(const thumbnail_scheduler& other) = delete;
+    thumbnail_scheduler(thumbnail_scheduler&& other) = delete;
+    thumbnail_scheduler& operator=(const thumbnail_scheduler& other) = delete;
+    thumbnail_scheduler& operator=(thumbnail_scheduler&& other) = delete;
+
+    /**
+     * Process wide scheduler used by the file views, started on first use.
+     */
+    [[nodiscard]] static vfs::thumbnail_scheduler& global() noexcept;
+
+    [[nodiscard]] owner_id add_owner(callback&& callback) noexcept;
+
+    /**
+     * Cancel every request of owner and wait for its running callbacks to return,
+     * the callback is not called after this.
+     */
+    void remove_owner(const owner_id owner) noexcept;
+
+    /**
+     * Queue file, or move it to position if owner already requested it.
+     * Dropped if position is farther than PREFETCH_DISTANCE from the visible range.
+     */
+    void request(const owner_id owner, const std::shared_ptr<vfs::file>& file,
+                 const std::int32_t size, const std::uint32_t position) noexcept;
+
+    /**
+     * Drop the request owner made for file, a thumbnail that is
+     * already being loaded is finished.
+     */
+    void cancel(const owner_id owner, const std::shared_ptr<vfs::file>& file) noexcept;
+
+    /**
+     * Drop every request owner made.
+     */
+    void cancel(const owner_id owner) noexcept;
+
+    /**
+     * The positions owner currently shows, both inclusive.
+     * Drops the requests of owner that are now out of the prefetch range.
+     */
+    void set_visible_range(const owner_id owner, const std::uint32_t first,
+                           const std::uint32_t last) noexcept;
+
+    /**
+     * Queued requests, not counting the ones being loaded.
+     */
+    [[nodiscard]] std::size_t pending() const noexcept;
+
+  private:
+    struct waiter final
+    {
+        owner_id owner;
+        std::uint32_t position;
+        std::int32_t size;
+    };
+
+    struct job final
+    {
+        std::shared_ptr<vfs::file> file;
+        std::vector<waiter> waiters;
+        std::uint64_t sequence{0};
+    };
+
+    struct owner_data final
+    {
+        callback on_loaded;
+        std::uint32_t first{0};
+        std::uint32_t last{0};
+        std::size_t busy{0}; // running callbacks
+    };
+
+    void run(const std::stop_token& stoken) noexcept;
+
+    // mutex_ must be held
+    [[nodiscard]] bool pop(job& item) noexcept;
+    [[nodiscard]] std::uint64_t distance(const job& item) const noexcept;
+    [[nodiscard]] static std::uint64_t distance(const owner_data& owner,
+                                                const std::uint32_t position) noexcept;
+    void erase(const std::size_t index) noexcept;
+    void erase_waiters(const std::size_t index, const owner_id owner) noexcept;
+    void submit_worker() noexcept;
+
+    std::size_t workers_;
+    std::size_t running_{0};
+    loader loader_;
+
+    // unordered, pop() picks the closest job because the visible ranges
+    // change far more often than jobs are popped. bounded by PREFETCH_DISTANCE
+    // so the scan is over a few hundred jobs per owner.
+    std::vector<job> queue_;
+    std::unordered_map<const vfs::file*, std::size_t> index_; // position in queue_
+    std::unordered_set<const vfs::file*> loading_;
+    std::uint64_t sequence_{0};
+
+    // owner_data is not moved by a rehash, callbacks run without the lock
+    std::unordered_map<owner_id, owner_data> owners_;
+    owner_id next_owner_{1};
+
+    mutable std::mutex mutex_;
+    std::condition_variable idle_cv_;
+
+    vfs::task_group tasks_;
+};
+} // namespace vfs
@@ -0,0 +1,272 @@
+/**
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <array>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <cstdint>
+
+#include "vfs/thumbnails/png.hxx"
+
+namespace
+{
+// https://www.w3.org/TR/png/#5PNG-file-signature
+constexpr std::string_view PNG_SIGNATURE{"\x89PNG\r\n\x1a\n", 8};
+// length + type + 13 bytes of data + crc
+constexpr std::size_t IHDR_SIZE = 4 + 4 + 13 + 4;
+
+constexpr auto crc_table = []
+{
+    std::array<std::uint32_t, 256> table{};
+    for (std::uint32_t n = 0; n < table.size(); ++n)
+    {
+        std::uint32_t c = n;
+        for (std::int32_t k = 0; k < 8; ++k)
+        {
+            c = (c & 1) != 0 ? 0xedb88320u ^ (c >> 1) : c >> 1;
+        }
+        table[n] = c;
+    }
+    return table;
+}();
+
+[[nodiscard]] std::uint32_t
+crc32(const std::string_view data) noexcept
+{
+    std::uint32_t c = 0xffffffffu;
+    for (const auto byte : data)
+    {
+        c = crc_table[(c ^ static_cast<std::uint8_t>(byte)) & 0xff] ^ (c >> 8);
+    }
+    return c ^ 0xffffffffu;
+}
+
+void
+append_be32(std::string& out, const std::uint32_t value) noexcept
+{
+    out.push_back(static_cast<char>((value >> 24) & 0xff));
+    out.push_back(static_cast<char>((value >> 16) & 0xff));
+    out.push_back(static_cast<char>((value >> 8) & 0xff));
+    out.push_back(static_cast<char>(value & 0xff));
+}
+
+[[nodiscard]] std::uint32_t
+read_be32(const std::string_view data, const std::size_t offset) noexcept
+{
+    return (static_cast<std::uint32_t>(static_cast<std::uint8_t>(data[offset])) << 24) |
+           (static_cast<std::uint32_t>(static_cast<std::uint8_t>(data[offset + 1])) << 16) |
+           (static_cast<std::uint32_t>(static_cast<std::uint8_t>(data[offset + 2])) << 8) |
+           static_cast<std::uint32_t>(static_cast<std::uint8_t>(data[offset + 3]));
+}
+} // namespace
+
+vfs::detail::thumbnail::pixels
+vfs::detail::thumbnail::downscale(const std::span<const std::uint8_t> src,
+                                  const std::uint32_t width, const std::uint32_t height,
+                                  const std::size_t stride, const std::uint32_t size) noexcept
+{
+    pixels dst;
+    if (width == 0 || height == 0 || size == 0 || src.size() < stride * (height - 1) + width * 4)
+    {
+        return dst;
+    }
+
+    if (width <= size && height <= size)
+    {
+        dst.width = width;
+        dst.height = height;
+    }
+    else if (width >= height)
+    {
+        dst.width = size;
+        dst.height = std::max(1u, static_cast<std::uint32_t>((std::uint64_t{height} * size) / width));
+    }
+    else
+    {
+        dst.width = std::max(1u, static_cast<std::uint32_t>((std::uint64_t{width} * size) / height));
+        dst.height = size;
+    }
+    dst.data.resize(std::size_t{dst.width} * dst.height * 4);
+
+    // dst is never larger than src, so every dst pixel covers at least one src pixel
+    const auto bounds = [](const std::uint32_t src_size, const std::uint32_t dst_size)
+    {
+        std::vector<std::uint32_t> bounds(dst_size + 1);
+        for (std::uint32_t i = 0; i <= dst_size; ++i)
+        {
+            bounds[i] = static_cast<std::uint32_t>((std::uint64_t{i} * src_size) / dst_size);
+        }
+        return bounds;
+    };
+    const auto xs = bounds(width, dst.width);
+    const auto ys = bounds(height, dst.height);
+
+    // premultiplied, so averaging every channel including alpha is correct
+    std::vector<std::uint64_t> sums(std::size_t{dst.width} * 4);
+    for (std::uint32_t dy = 0; dy < dst.height; ++dy)
+    {
+        std::ranges::fill(sums, 0);
+        for (auto y = ys[dy]; y < ys[dy + 1]; ++y)
+        {
+            const auto* row = src.data() + (std::size_t{y} * stride);
+            for (std::uint32_t dx = 0; dx < dst.width; ++dx)
+            {
+                auto* sum = &sums[std::size_t{dx} * 4];
+                for (auto x = xs[dx]; x < xs[dx + 1]; ++x)
+                {
+                    const auto* pixel = row + (std::size_t{x} * 4);
+                    sum[0] += pixel[0];
+                    sum[1] += pixel[1];
+                    sum[2] += pixel[2];
+                    sum[3] += pixel[3];
+                }
+            }
+        }
+
+        auto* out = dst.data.data() + (std::size_t{dy} * dst.width * 4);
+        for (std::uint32_t dx = 0; dx < dst.width; ++dx)
+        {
+            const std::uint64_t count =
+                std::uint64_t{xs[dx + 1] - xs[dx]} * (ys[dy + 1] - ys[dy]);
+            for (std::size_t c = 0; c < 4; ++c)
+            {
+                const auto i = (std::size_t{dx} * 4) + c;
+                out[i] = static_cast<std::uint8_t>((sums[i] + (count / 2)) / count); // rounded
+            }
+        }
+    }
+
+    return dst;
+}
+
+std::string
+vfs::detail::thumbnail::add_text(const std::string_view png,
+                                 const std::span<const text_chunk> text) noexcept
+{
+    if (!png.starts_with(PNG_SIGNATURE) || png.size() < PNG_SIGNATURE.size() + IHDR_SIZE ||
+        png.substr(PNG_SIGNATURE.size() + 4, 4) != "IHDR")
+    {
+        return {};
+    }
+
+    const auto header = png.substr(0, PNG_SIGNATURE.size() + IHDR_SIZE);
+
+    std::string out;
+    out.reserve(png.size() + 256);
+    out.append(header);
+
+    for (const auto& [key, value] : text)
+    {
+        std::string chunk{"tEXt"};
+        chunk.append(key);
+        chunk.push_back('\0');
+        chunk.append(value);
+
+        append_be32(out, static_cast<std::uint32_t>(chunk.size() - 4));
+        out.append(chunk);
+        append_be32(out, crc32(chunk));
+    }
+
+    out.append(png.substr(header.size()));
+    return out;
+}
+
+std::string
+vfs::detail::thumbnail::set_text(const std::string_view png,
+                                 const std::span<const text_chunk> text) noexcept
+{
+    if (!png.starts_with(PNG_SIGNATURE))
+    {
+        return {};
+    }
+
+    std::string out(PNG_SIGNATURE);
+    out.reserve(png.size());
+
+    std::size_t offset = PNG_SIGNATURE.size();
+    while (offset + 12 <= png.size())
+    {
+        const auto length = read_be32(png, offset);
+        const auto type = png.substr(offset + 4, 4);
+        if (length > png.size() - offset - 12)
+        {
+            return {};
+        }
+
+        const auto chunk = png.substr(offset, 12 + length);
+        offset += 12 + length;
+
+        if (type == "tEXt")
+        {
+            const auto data = chunk.substr(8, length);
+            const auto key = data.substr(0, data.find('\0'));
+            if (std::ranges::any_of(text, [key](const auto& entry) { return entry.first == key; }))
+            {
+                continue;
+            }
+        }
+
+        out.append(chunk);
+        if (type == "IEND")
+        {
+            break;
+        }
+    }
+
+    return add_text(out, text);
+}
+
+std::optional<std::string>
+vfs::detail::thumbnail::get_text(const std::string_view png, const std::string_view key) noexcept
+{
+    if (!png.starts_with(PNG_SIGNATURE))
+    {
+        return std::nullopt;
+    }
+
+    std::size_t offset = PNG_SIGNATURE.size();
+    while (offset + 12 <= png.size())
+    {
+        const auto length = read_be32(png, offset);
+        const auto type = png.substr(offset + 4, 4);
+        if (length > png.size() - offset - 12)
+        {
+            break;
+        }
+
+        if (type == "tEXt")
+        {
+            const auto data = png.substr(offset + 8, length);
+            const auto separator = data.find('\0');
+            if (separator != std::string_view::npos && data.substr(0, separator) == key)
+            {
+                return std::string(data.substr(separator + 1));
+            }
+        }
+        else if (type == "IEND")
+        {
+            break;
+        }
+
+        offset += 12 + length;
+    }
+
+    return std::nullopt;
+}
@@ -0,0 +1,74 @@
+/**
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <cstdint>
+
+namespace vfs::detail::thumbnail
+{
+/**
+ * 4 bytes per pixel with premultiplied alpha, rows are packed.
+ * The channel order does not matter to downscale().
+ */
+struct pixels final
+{
+    std::uint32_t width{0};
+    std::uint32_t height{0};
+    std::vector<std::uint8_t> data;
+};
+
+/**
+ * Area average src so that its longest side is size, never upscales.
+ *
+ * @param[in] stride bytes per row of src
+ */
+[[nodiscard]] pixels downscale(const std::span<const std::uint8_t> src, const std::uint32_t width,
+                               const std::uint32_t height, const std::size_t stride,
+                               const std::uint32_t size) noexcept;
+
+using text_chunk = std::pair<std::string_view, std::string_view>;
+
+/**
+ * Insert a tEXt chunk after the IHDR chunk of png for each key value pair,
+ * used for the Thumb:: keys of the thumbnail spec.
+ *
+ * @return the new png, empty if png is not a png
+ */
+[[nodiscard]] std::string add_text(const std::string_view png,
+                                   const std::span<const text_chunk> text) noexcept;
+
+/**
+ * Same as add_text() but the existing tEXt chunks with the same keys are dropped,
+ * used to update the Thumb::URI of a thumbnail of a renamed file.
+ *
+ * @return the new png, empty if png is not a png
+ */
+[[nodiscard]] std::string set_text(const std::string_view png,
+                                   const std::span<const text_chunk> text) noexcept;
+
+/**
+ * @return the value of the first tEXt chunk with key
+ */
+[[nodiscard]] std::optional<std::string> get_text(const std::string_view png,
+                                                  const std::string_view key) noexcept;
+} // namespace vfs::detail::thumbnail
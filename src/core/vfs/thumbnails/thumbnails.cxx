@@ -13,12 +13,19 @@
  * along with this program. If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <array>
 #include <chrono>
 #include <filesystem>
 #include <format>
 #include <memory>
 #include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
 #include <utility>
+#include <vector>
+
+#include <cstdint>
 
 #include <gdkmm.h>
 #include <glibmm.h>
@@ -36,7 +43,10 @@
 #include "vfs/file.hxx"
 #include "vfs/user-dirs.hxx"
 
+#include "vfs/thumbnails/png.hxx"
 #include "vfs/thumbnails/thumbnails.hxx"
+#include "vfs/thumbnails/video.hxx"
+#include "vfs/utils/file-ops.hxx"
 
 #include "glycin/glycin.hxx"
 #include "logger.hxx"
@@ -91,57 +101,162 @@ enum class thumbnail_mode : std::uint8_t
     video,
 };
 
+/**
+ * Thumbnails written by older versions and by external thumbnailers may not have
+ * every Thumb:: key, only the keys that are present are checked.
+ */
 [[nodiscard]] static bool
-is_metadata_valid(Glib::RefPtr<Gly::Image> image, const std::shared_ptr<vfs::file>& file) noexcept
+is_metadata_valid(const std::string_view png, const std::shared_ptr<vfs::file>& file) noexcept
 {
-    if (!image || !file)
+    const auto uri = vfs::detail::thumbnail::get_text(png, "Thumb::URI");
+    if (uri && *uri != file->uri())
+    {
+        return false;
+    }
+
+    const auto mtime = vfs::detail::thumbnail::get_text(png, "Thumb::MTime");
+    if (mtime)
+    {
+        const auto file_mtime = std::chrono::system_clock::to_time_t(file->mtime());
+        if (ztd::from_string<std::time_t>(*mtime).value_or(0) != file_mtime)
+        {
+            return false;
+        }
+    }
+
+    const auto size = vfs::detail::thumbnail::get_text(png, "Thumb::Size");
+    if (size && ztd::from_string<std::uint64_t>(*size).value_or(0) != file->size().data())
     {
         return false;
     }
 
-#if 1
-    // TODO
-    // glycin-thumbnailer does not set Thumb metadata keys.
-    // What a waste of time to figure this out.
-    // $ exiftool -list <path> | grep Thumb
     return true;
-#else
-    // MTime
-    const auto mtime_val = image->get_metadata_key_value("Thumb::MTime");
-    auto mtime = mtime_val ? std::chrono::system_clock::from_time_t(
-                                 ztd::from_string<std::time_t>(*mtime_val).value_or(0))
-                           : std::chrono::system_clock::time_point{};
+}
 
-    // URI
-    const auto uri_val = image->get_metadata_key_value("Thumb::URI");
-    std::string uri = uri_val.value_or("");
+[[nodiscard]] static Glib::RefPtr<Gdk::Texture>
+load_texture(const std::string_view png) noexcept
+{
+    try
+    {
+        return Gdk::Texture::create_from_bytes(Glib::Bytes::create(png.data(), png.size()));
+    }
+    catch (const Glib::Error& e)
+    {
+        logger::error<logger::vfs>("Texture loading failed with: {}", e.what());
+        return nullptr;
+    }
+}
 
-    // Size
-    const auto size_val = image->get_metadata_key_value("Thumb::Size");
-    usize size = size_val ? usize::create(*size_val).value_or(0) : usize{0};
+/**
+ * Decode the source with glycin and scale it down in process.
+ */
+[[nodiscard]] static Glib::RefPtr<Gdk::Texture>
+create_image_texture(const std::shared_ptr<vfs::file>& file, const std::int32_t size) noexcept
+{
+    Glib::RefPtr<Gdk::Texture> source;
+    try
+    {
+        auto loader = Gly::Loader::create(Gio::File::create_for_path(file->path()));
+        auto image = loader->load();
+        auto frame = image->next_frame();
+        source = frame->get_texture();
+    }
+    catch (const Glib::Error& e)
+    {
+        logger::error<logger::vfs>("Loading '{}' failed with: {}", file->path(), e.what());
+        return nullptr;
+    }
+    if (!source)
+    {
+        return nullptr;
+    }
 
-    // logger::trace<logger::vfs>("uri={}, mtime={}, size={}", uri, std::chrono::duration_cast<std::chrono::seconds>(mtime.time_since_epoch()).count(), size);
+    const auto width = static_cast<std::uint32_t>(source->get_width());
+    const auto height = static_cast<std::uint32_t>(source->get_height());
+    const std::size_t stride = std::size_t{width} * 4;
+
+    // GDK_MEMORY_DEFAULT is premultiplied, as downscale() expects
+    std::vector<std::uint8_t> pixels(stride * height);
+    source->download(pixels.data(), stride);
+    source = nullptr;
+
+    auto scaled = vfs::detail::thumbnail::downscale(pixels,
+                                                    width,
+                                                    height,
+                                                    stride,
+                                                    static_cast<std::uint32_t>(size));
+    if (scaled.data.empty())
+    {
+        return nullptr;
+    }
 
-    // validate //
+    return Gdk::MemoryTexture::create(static_cast<std::int32_t>(scaled.width),
+                                      static_cast<std::int32_t>(scaled.height),
+                                      static_cast<Gdk::MemoryFormat>(GDK_MEMORY_DEFAULT),
+                                      Glib::Bytes::create(scaled.data.data(), scaled.data.size()),
+                                      std::size_t{scaled.width} * 4);
+}
 
-    // MTime
-    const auto file_mtime = std::chrono::time_point_cast<std::chrono::seconds>(file->mtime());
-    const auto meta_mtime = std::chrono::time_point_cast<std::chrono::seconds>(mtime);
-    if (file_mtime != meta_mtime)
+/**
+ * Write texture as a png with the Thumb:: keys, to a temporary file that is
+ * renamed into place so other readers never see a partial thumbnail.
+ */
+[[nodiscard]] static bool
+save_thumbnail(const Glib::RefPtr<Gdk::Texture>& texture, const std::shared_ptr<vfs::file>& file,
+               const std::filesystem::path& path) noexcept
+{
+    const auto bytes = texture->save_to_png_bytes();
+    gsize size = 0;
+    const auto* data = static_cast<const char*>(bytes->get_data(size));
+
+    const auto uri = file->uri();
+    const auto mtime = std::format("{}", std::chrono::system_clock::to_time_t(file->mtime()));
+    const auto file_size = std::format("{}", file->size().data());
+    const auto text = std::array{
+        vfs::detail::thumbnail::text_chunk{"Thumb::URI", uri},
+        vfs::detail::thumbnail::text_chunk{"Thumb::MTime", mtime},
+        vfs::detail::thumbnail::text_chunk{"Thumb::Size", file_size},
+        vfs::detail::thumbnail::text_chunk{"Thumb::Mimetype", file->mime_type()->type()},
+        vfs::detail::thumbnail::text_chunk{"Software", PACKAGE_NAME},
+    };
+    const auto png = vfs::detail::thumbnail::add_text({data, size}, text);
+    if (png.empty())
     {
-        // logger::trace<logger::vfs>("MTime mismatch for '{}': expected {}, got {}", uri, meta_mtime.time_since_epoch().count(), file_mtime.time_since_epoch().count());
         return false;
     }
 
-    // Size
-    if (file->size() != size)
+    const auto tmp = std::filesystem::path(
+        std::format("{}.{}.tmp", path.string(), std::this_thread::get_id()));
+    std::error_code ec = vfs::utils::write_file(tmp, png);
+    if (!ec)
+    {
+        std::filesystem::permissions(tmp,
+                                     std::filesystem::perms::owner_read |
+                                         std::filesystem::perms::owner_write,
+                                     ec);
+    }
+    if (!ec)
+    {
+        std::filesystem::rename(tmp, path, ec);
+    }
+    if (ec)
     {
-        // logger::trace<logger::vfs>("Size mismatch for '{}': expected {}, got {}", uri, size, file->size());
+        logger::error<logger::vfs>("Failed to write thumbnail: {} {}", tmp, ec.message());
+        std::filesystem::remove(tmp, ec);
         return false;
     }
-
     return true;
-#endif
+}
+
+/**
+ * @return the thumbnail filename of uri, without the extension
+ */
+[[nodiscard]] static std::string
+uri_hash(const std::string_view uri) noexcept
+{
+    const auto md5 = Botan::HashFunction::create("MD5");
+    md5->update(uri);
+    return Botan::hex_encode(md5->final(), false);
 }
 
 static Glib::RefPtr<Gdk::Texture>
@@ -176,14 +291,7 @@ thumbnail_create(const std::shared_ptr<vfs::file>& file, const i32 thumb_size,
         },
         thumb_size);
 
-    const auto hash = std::invoke(
-        [](const auto& file)
-        {
-            const auto md5 = Botan::HashFunction::create("MD5");
-            md5->update(file->uri());
-            return Botan::hex_encode(md5->final(), false);
-        },
-        file);
+    const auto hash = uri_hash(file->uri());
 
     const auto thumbnail_file = thumbnail_cache / std::format("{}.png", hash);
     const auto fail_file = cache_dirs.fail / std::format("{}.json", hash);
@@ -205,106 +313,105 @@ thumbnail_create(const std::shared_ptr<vfs::file>& file, const i32 thumb_size,
         return nullptr;
     }
 
-    auto glycin_load_image = [](const std::filesystem::path& filepath) -> Glib::RefPtr<Gly::Image>
-    {
-        auto file = Gio::File::create_for_path(filepath);
-
-        try
-        {
-            auto loader = Gly::Loader::create(file);
-            auto image = loader->load();
-
-            return image;
-        }
-        catch (const Glib::Error& e)
-        {
-            logger::error<logger::vfs>("Loading '{}' failed with: {}", file->get_path(), e.what());
-            return nullptr;
-        }
-    };
-
-    auto glycin_get_texture = [](Glib::RefPtr<Gly::Image> image) -> Glib::RefPtr<Gdk::Texture>
+    if (std::filesystem::is_regular_file(thumbnail_file))
     {
-        try
-        {
-            auto frame = image->next_frame();
-            auto texture = frame->get_texture();
-
-            return texture;
-        }
-        catch (const Glib::Error& e)
+        // logger::debug<logger::vfs>("Existing thumb: {}", thumbnail_file);
+        const auto png = vfs::utils::read_file(thumbnail_file);
+        if (png && is_metadata_valid(*png, file))
         {
-            logger::error<logger::vfs>("Texture loading failed with: {}", e.what());
-            return nullptr;
+            auto texture = load_texture(*png);
+            if (texture)
+            {
+                return texture;
+            }
         }
-    };
+        std::filesystem::remove(thumbnail_file);
+    }
 
-    Glib::RefPtr<Gly::Image> thumbnail;
+    // logger::debug<logger::vfs>("New thumb for '{}', {}", file->path(), thumbnail_file);
 
-    if (std::filesystem::is_regular_file(thumbnail_file))
+    // Need to create thumbnail directory if it is missing,
+    // neither save_thumbnail() nor ffmpegthumbnailer create missing directories.
+    // Have this check run everytime because if the cache is
+    // deleted while running then thumbnail loading will break.
+    // TODO - have a monitor watch this directory and recreate if deleted.
+    if (!std::filesystem::is_directory(thumbnail_cache))
     {
-        // logger::debug<logger::vfs>("Existing thumb: {}", thumbnail_file);
-        thumbnail = glycin_load_image(thumbnail_file);
-        if (!thumbnail)
-        {
-            std::filesystem::remove(thumbnail_file);
-        }
+        std::filesystem::create_directories(thumbnail_cache);
     }
 
-    if (!thumbnail || !is_metadata_valid(thumbnail, file))
+    switch (mode)
     {
-        // logger::debug<logger::vfs>("New thumb for '{}', {}", file->path(), thumbnail_file);
-
-        // Need to create thumbnail directory if it is missing,
-        // ffmpegthumbnailer will not create missing directories.
-        // Have this check run everytime because if the cache is
-        // deleted while running then thumbnail loading will break.
-        // TODO - have a monitor watch this directory and recreate if deleted.
-        if (!std::filesystem::is_directory(thumbnail_cache))
+        case thumbnail_mode::image:
         {
-            std::filesystem::create_directories(thumbnail_cache);
-        }
+            auto texture = create_image_texture(file, thumbnail_create_size);
+            if (!texture)
+            {
+                create_fail(file, fail_file);
+                return nullptr;
+            }
 
-        // create new thumbnail
-        std::string command;
-        switch (mode)
+            // the texture is used even if the cache could not be written
+            if (!save_thumbnail(texture, file, thumbnail_file))
+            {
+                logger::error<logger::vfs>("Failed to save thumbnail for '{}'", file->path());
+            }
+            return texture;
+        }
+        case thumbnail_mode::video:
         {
-            case thumbnail_mode::image:
+#if defined(HAVE_MEDIA)
+            // a broken or network file must not hold a thumbnail worker forever
+            static constexpr std::chrono::seconds timeout{10};
+
+            auto texture = vfs::detail::thumbnail::video_frame(
+                file->path(),
+                static_cast<std::uint32_t>(thumbnail_create_size),
+                timeout);
+            if (!texture)
             {
-                command = std::format("glycin-thumbnailer -s {} -i {} -o {}",
-                                      thumbnail_create_size,
-                                      vfs::execute::quote(file->uri()),
-                                      vfs::execute::quote(thumbnail_file));
-                break;
+                logger::error<logger::vfs>("Failed to create thumbnail for '{}'", file->path());
+                create_fail(file, fail_file);
+                return nullptr;
             }
-            case thumbnail_mode::video:
+
+            if (!save_thumbnail(texture, file, thumbnail_file))
             {
-                command = std::format("ffmpegthumbnailer -f -s {} -i {} -o {}",
-                                      thumbnail_create_size,
-                                      vfs::execute::quote(file->path()),
-                                      vfs::execute::quote(thumbnail_file));
-                break;
+                logger::error<logger::vfs>("Failed to save thumbnail for '{}'", file->path());
             }
-        }
-        const auto result = vfs::execute::command_line_sync(command);
+            return texture;
+#else
+            const auto command = std::format("ffmpegthumbnailer -f -s {} -i {} -o {}",
+                                             thumbnail_create_size,
+                                             vfs::execute::quote(file->path()),
+                                             vfs::execute::quote(thumbnail_file));
+            const auto result = vfs::execute::command_line_sync(command);
 
-        if (result.exit_status != 0 || !std::filesystem::exists(thumbnail_file))
-        {
-            logger::error<logger::vfs>("Failed to create thumbnail for '{}'", file->path());
-            create_fail(file, fail_file);
-            return nullptr;
-        }
+            if (result.exit_status != 0 || !std::filesystem::exists(thumbnail_file))
+            {
+                logger::error<logger::vfs>("Failed to create thumbnail for '{}'", file->path());
+                create_fail(file, fail_file);
+                return nullptr;
+            }
 
-        thumbnail = glycin_load_image(thumbnail_file);
-        if (!thumbnail)
-        {
-            create_fail(file, fail_file);
-            std::filesystem::remove(thumbnail_file);
-            return nullptr;
+            Glib::RefPtr<Gdk::Texture> texture;
+            const auto png = vfs::utils::read_file(thumbnail_file);
+            if (png)
+            {
+                texture = load_texture(*png);
+            }
+            if (!texture)
+            {
+                create_fail(file, fail_file);
+                std::filesystem::remove(thumbnail_file);
+                return nullptr;
+            }
+            return texture;
+#endif
         }
     }
 
-    return glycin_get_texture(thumbnail);
+    std::unreachable();
 }
 
 Glib::RefPtr<Gdk::Texture>
@@ -320,3 +427,54 @@ vfs::detail::thumbnail::video(const std::shared_ptr<vfs::file>& file,
 {
     return thumbnail_create(file, thumb_size, thumbnail_mode::video);
 }
+
+void
+vfs::detail::thumbnail::rename(const std::shared_ptr<vfs::file>& from,
+                               const std::shared_ptr<vfs::file>& to) noexcept
+{
+    const auto cache_dirs = vfs::user::thumbnail_cache();
+
+    const auto uri = to->uri();
+    const auto from_hash = uri_hash(from->uri());
+    const auto to_hash = uri_hash(uri);
+    const auto text = std::array{vfs::detail::thumbnail::text_chunk{"Thumb::URI", uri}};
+
+    for (const auto& dir :
+         {cache_dirs.normal, cache_dirs.large, cache_dirs.x_large, cache_dirs.xx_large})
+    {
+        const auto source = dir / std::format("{}.png", from_hash);
+        const auto png = vfs::utils::read_file(source);
+        if (!png)
+        {
+            continue;
+        }
+
+        // the Thumb::URI key is checked when loading, so it must be rewritten
+        const auto updated = vfs::detail::thumbnail::set_text(*png, text);
+        std::error_code ec;
+        if (!updated.empty())
+        {
+            const auto target = dir / std::format("{}.png", to_hash);
+            const auto tmp = std::filesystem::path(
+                std::format("{}.{}.tmp", target.string(), std::this_thread::get_id()));
+            ec = vfs::utils::write_file(tmp, updated);
+            if (!ec)
+            {
+                std::filesystem::permissions(tmp,
+                                             std::filesystem::perms::owner_read |
+                                                 std::filesystem::perms::owner_write,
+                                             ec);
+            }
+            if (!ec)
+            {
+                std::filesystem::rename(tmp, target, ec);
+            }
+            if (ec)
+            {
+                logger::error<logger::vfs>("Failed to move thumbnail: {} {}", tmp, ec.message());
+                std::filesystem::remove(tmp, ec);
+            }
+        }
+        std::filesystem::remove(source, ec);
+    }
+}
@@ -31,4 +31,11 @@ Glib::RefPtr<Gdk::Texture> image(const std::shared_ptr<vfs::file>& file,
                                  const std::int32_t thumb_size) noexcept;
 Glib::RefPtr<Gdk::Texture> video(const std::shared_ptr<vfs::file>& file,
                                  const std::int32_t thumb_size) noexcept;
+
+/**
+ * Move the cached thumbnails of every size of from, a file that was renamed
+ * to to, so they are not created again. Reads and writes the cache, not for
+ * the gui thread.
+ */
+void rename(const std::shared_ptr<vfs::file>& from, const std::shared_ptr<vfs::file>& to) noexcept;
 } // namespace vfs::detail::thumbnail
@@ -0,0 +1,266 @@
+/**
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#if defined(HAVE_MEDIA)
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include <cstdint>
+
+#include <gdkmm.h>
+#include <glibmm.h>
+
+extern "C"
+{
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libavutil/avutil.h>
+#include <libswscale/swscale.h>
+}
+
+#include "vfs/thumbnails/video.hxx"
+
+#include "logger.hxx"
+
+namespace
+{
+struct format_deleter final
+{
+    void
+    operator()(AVFormatContext* ctx) const noexcept
+    {
+        avformat_close_input(&ctx);
+    }
+};
+
+struct codec_deleter final
+{
+    void
+    operator()(AVCodecContext* ctx) const noexcept
+    {
+        avcodec_free_context(&ctx);
+    }
+};
+
+struct packet_deleter final
+{
+    void
+    operator()(AVPacket* packet) const noexcept
+    {
+        av_packet_free(&packet);
+    }
+};
+
+struct frame_deleter final
+{
+    void
+    operator()(AVFrame* frame) const noexcept
+    {
+        av_frame_free(&frame);
+    }
+};
+
+struct sws_deleter final
+{
+    void
+    operator()(SwsContext* ctx) const noexcept
+    {
+        sws_freeContext(ctx);
+    }
+};
+
+using deadline_clock = std::chrono::steady_clock;
+
+/**
+ * AVIOInterruptCB, a non zero return aborts the blocking libavformat call.
+ */
+int
+interrupt(void* opaque) noexcept
+{
+    const auto* deadline = static_cast<const deadline_clock::time_point*>(opaque);
+    return deadline_clock::now() > *deadline ? 1 : 0;
+}
+
+/**
+ * Display size of frame, with the sample aspect ratio applied.
+ */
+[[nodiscard]] std::pair<std::uint32_t, std::uint32_t>
+display_size(const AVFrame* frame) noexcept
+{
+    auto width = static_cast<std::uint64_t>(frame->width);
+    const auto height = static_cast<std::uint64_t>(frame->height);
+    const auto sar = frame->sample_aspect_ratio;
+    if (sar.num > 0 && sar.den > 0)
+    {
+        width = std::max<std::uint64_t>(1, (width * static_cast<std::uint64_t>(sar.num)) /
+                                               static_cast<std::uint64_t>(sar.den));
+    }
+    return {static_cast<std::uint32_t>(width), static_cast<std::uint32_t>(height)};
+}
+} // namespace
+
+Glib::RefPtr<Gdk::Texture>
+vfs::detail::thumbnail::video_frame(const std::filesystem::path& path, const std::uint32_t size,
+                                    const std::chrono::milliseconds timeout) noexcept
+{
+    auto deadline = deadline_clock::now() + timeout;
+
+    AVFormatContext* raw_format = avformat_alloc_context();
+    if (raw_format == nullptr)
+    {
+        return nullptr;
+    }
+    raw_format->interrupt_callback.callback = interrupt;
+    raw_format->interrupt_callback.opaque = &deadline;
+    // frees raw_format on failure
+    if (avformat_open_input(&raw_format, path.c_str(), nullptr, nullptr) != 0)
+    {
+        logger::debug<logger::vfs>("video thumbnail: failed to open '{}'", path.string());
+        return nullptr;
+    }
+    const std::unique_ptr<AVFormatContext, format_deleter> format(raw_format);
+
+    if (avformat_find_stream_info(format.get(), nullptr) < 0)
+    {
+        return nullptr;
+    }
+
+    const AVCodec* codec = nullptr;
+    const auto index = av_find_best_stream(format.get(), AVMEDIA_TYPE_VIDEO, -1, -1, &codec, 0);
+    if (index < 0 || codec == nullptr)
+    {
+        return nullptr;
+    }
+    const auto* stream = format->streams[index];
+
+    const std::unique_ptr<AVCodecContext, codec_deleter> decoder(avcodec_alloc_context3(codec));
+    if (!decoder || avcodec_parameters_to_context(decoder.get(), stream->codecpar) < 0)
+    {
+        return nullptr;
+    }
+    // many thumbnails are created in parallel, one thread each is enough
+    decoder->thread_count = 1;
+    // the decoder drops everything but keyframes, no need to decode up to the seek target
+    decoder->skip_frame = AVDISCARD_NONKEY;
+    if (avcodec_open2(decoder.get(), codec, nullptr) < 0)
+    {
+        return nullptr;
+    }
+
+    // cover art is a single packet at the start of the stream, seeking would skip it
+    const bool is_cover_art = (stream->disposition & AV_DISPOSITION_ATTACHED_PIC) != 0;
+    if (!is_cover_art && format->duration > 0)
+    {
+        const auto start = stream->start_time != AV_NOPTS_VALUE ? stream->start_time : 0;
+        const auto target =
+            start + av_rescale_q(format->duration / 10, AV_TIME_BASE_Q, stream->time_base);
+        // on failure the frame comes from the start of the file
+        av_seek_frame(format.get(), index, target, AVSEEK_FLAG_BACKWARD);
+    }
+
+    const std::unique_ptr<AVPacket, packet_deleter> packet(av_packet_alloc());
+    const std::unique_ptr<AVFrame, frame_deleter> frame(av_frame_alloc());
+    if (!packet || !frame)
+    {
+        return nullptr;
+    }
+
+    bool decoded = false;
+    while (!decoded && deadline_clock::now() < deadline &&
+           av_read_frame(format.get(), packet.get()) >= 0)
+    {
+        if (packet->stream_index == index && avcodec_send_packet(decoder.get(), packet.get()) >= 0)
+        {
+            decoded = avcodec_receive_frame(decoder.get(), frame.get()) >= 0;
+        }
+        av_packet_unref(packet.get());
+    }
+    if (!decoded && deadline_clock::now() < deadline)
+    {
+        // end of file, the decoder may still hold a frame
+        avcodec_send_packet(decoder.get(), nullptr);
+        decoded = avcodec_receive_frame(decoder.get(), frame.get()) >= 0;
+    }
+    if (!decoded)
+    {
+        logger::debug<logger::vfs>("video thumbnail: no frame decoded from '{}'", path.string());
+        return nullptr;
+    }
+
+    const auto [width, height] = display_size(frame.get());
+    std::uint32_t dst_width = width;
+    std::uint32_t dst_height = height;
+    if (width > size || height > size)
+    {
+        if (width >= height)
+        {
+            dst_width = size;
+            dst_height =
+                std::max(1u, static_cast<std::uint32_t>((std::uint64_t{height} * size) / width));
+        }
+        else
+        {
+            dst_width =
+                std::max(1u, static_cast<std::uint32_t>((std::uint64_t{width} * size) / height));
+            dst_height = size;
+        }
+    }
+
+    // BGRA matches Gdk::MemoryFormat::B8G8R8A8, alpha is opaque for sources without alpha
+    const std::unique_ptr<SwsContext, sws_deleter> scaler(
+        sws_getContext(frame->width,
+                       frame->height,
+                       static_cast<AVPixelFormat>(frame->format),
+                       static_cast<std::int32_t>(dst_width),
+                       static_cast<std::int32_t>(dst_height),
+                       AV_PIX_FMT_BGRA,
+                       SWS_AREA,
+                       nullptr,
+                       nullptr,
+                       nullptr));
+    if (!scaler)
+    {
+        return nullptr;
+    }
+
+    const std::size_t stride = std::size_t{dst_width} * 4;
+    std::vector<std::uint8_t> pixels(stride * dst_height);
+    const std::array<std::uint8_t*, 4> dst_data{pixels.data(), nullptr, nullptr, nullptr};
+    const std::array<std::int32_t, 4> dst_stride{static_cast<std::int32_t>(stride), 0, 0, 0};
+    if (sws_scale(scaler.get(),
+                  frame->data,
+                  frame->linesize,
+                  0,
+                  frame->height,
+                  dst_data.data(),
+                  dst_stride.data()) <= 0)
+    {
+        return nullptr;
+    }
+
+    return Gdk::MemoryTexture::create(static_cast<std::int32_t>(dst_width),
+                                      static_cast<std::int32_t>(dst_height),
+                                      Gdk::MemoryFormat::B8G8R8A8,
+                                      Glib::Bytes::create(pixels.data(), pixels.size()),
+                                      stride);
+}
+
+#endif
@@ -0,0 +1,45 @@
+/**
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#if defined(HAVE_MEDIA)
+
+#include <chrono>
+#include <filesystem>
+
+#include <cstdint>
+
+#include <gdkmm.h>
+#include <glibmm.h>
+
+namespace vfs::detail::thumbnail
+{
+/**
+ * Decode a single keyframe from about 10% into the video with libavformat,
+ * scaled so that its longest side is size, never upscales. Files with embedded
+ * cover art use the cover art.
+ *
+ * @param[in] timeout for the whole file, blocking reads are interrupted once
+ * it has passed
+ *
+ * @return nullptr if no frame could be decoded in time
+ */
+[[nodiscard]] Glib::RefPtr<Gdk::Texture>
+video_frame(const std::filesystem::path& path, const std::uint32_t size,
+            const std::chrono::milliseconds timeout) noexcept;
+} // namespace vfs::detail::thumbnail
+
+#endif
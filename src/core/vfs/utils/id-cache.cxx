@@ -0,0 +1,169 @@
+/**
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include <sys/types.h>
+
+#include <ztd/ztd.hxx>
+
+#include "vfs/utils/id-cache.hxx"
+
+namespace
+{
+constexpr std::chrono::seconds POSITIVE_TTL{300};
+constexpr std::chrono::seconds NEGATIVE_TTL{30};
+
+struct string_hash final
+{
+    using is_transparent = void;
+
+    [[nodiscard]] std::size_t
+    operator()(const std::string_view str) const noexcept
+    {
+        return std::hash<std::string_view>{}(str);
+    }
+};
+
+template<typename Key, typename Value, typename Hash = std::hash<Key>>
+class ttl_cache final
+{
+  public:
+    template<typename K, typename Lookup>
+    [[nodiscard]] std::optional<Value>
+    get(const K& key, Lookup&& lookup) noexcept
+    {
+        const auto now = std::chrono::steady_clock::now();
+        {
+            std::shared_lock lock(lock_);
+            const auto it = entries_.find(key);
+            if (it != entries_.cend() && it->second.expires > now)
+            {
+                return it->second.value;
+            }
+        }
+
+        // resolved without the lock held, concurrent misses may both look it up
+        auto value = lookup(key);
+
+        std::unique_lock lock(lock_);
+        entries_.insert_or_assign(
+            Key(key),
+            entry{.value = value, .expires = now + (value ? POSITIVE_TTL : NEGATIVE_TTL)});
+        return value;
+    }
+
+    void
+    clear() noexcept
+    {
+        std::unique_lock lock(lock_);
+        entries_.clear();
+    }
+
+  private:
+    struct entry final
+    {
+        std::optional<Value> value;
+        std::chrono::steady_clock::time_point expires;
+    };
+
+    std::shared_mutex lock_;
+    std::unordered_map<Key, entry, Hash, std::equal_to<>> entries_;
+};
+} // namespace
+
+namespace global
+{
+static ttl_cache<uid_t, std::string> user_names;
+static ttl_cache<gid_t, std::string> group_names;
+static ttl_cache<std::string, uid_t, string_hash> user_ids;
+static ttl_cache<std::string, gid_t, string_hash> group_ids;
+} // namespace global
+
+std::optional<std::string>
+vfs::utils::user_name(const uid_t uid) noexcept
+{
+    return global::user_names.get(uid,
+                                  [](const uid_t id) -> std::optional<std::string>
+                                  {
+                                      const auto pw = ztd::passwd::create(id);
+                                      if (!pw)
+                                      {
+                                          return std::nullopt;
+                                      }
+                                      return std::string(pw->name());
+                                  });
+}
+
+std::optional<std::string>
+vfs::utils::group_name(const gid_t gid) noexcept
+{
+    return global::group_names.get(gid,
+                                   [](const gid_t id) -> std::optional<std::string>
+                                   {
+                                       const auto gr = ztd::group::create(id);
+                                       if (!gr)
+                                       {
+                                           return std::nullopt;
+                                       }
+                                       return std::string(gr->name());
+                                   });
+}
+
+std::optional<uid_t>
+vfs::utils::user_id(const std::string_view name) noexcept
+{
+    return global::user_ids.get(name,
+                                [](const std::string_view key) -> std::optional<uid_t>
+                                {
+                                    const auto pw = ztd::passwd::create(std::string(key));
+                                    if (!pw)
+                                    {
+                                        return std::nullopt;
+                                    }
+                                    return pw->uid();
+                                });
+}
+
+std::optional<gid_t>
+vfs::utils::group_id(const std::string_view name) noexcept
+{
+    return global::group_ids.get(name,
+                                 [](const std::string_view key) -> std::optional<gid_t>
+                                 {
+                                     const auto gr = ztd::group::create(std::string(key));
+                                     if (!gr)
+                                     {
+                                         return std::nullopt;
+                                     }
+                                     return gr->gid();
+                                 });
+}
+
+void
+vfs::utils::flush_id_cache() noexcept
+{
+    global::user_names.clear();
+    global::group_names.clear();
+    global::user_ids.clear();
+    global::group_ids.clear();
+}
@@ -0,0 +1,44 @@
+/**
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include <sys/types.h>
+
+/**
+ * Process wide cache for user and group lookups.
+ *
+ * Every lookup goes through NSS, which can be a network round trip with
+ * LDAP or SSSD. Results are cached for a few minutes and failed lookups for
+ * a few seconds, so a directory with thousands of files owned by the same
+ * user costs one lookup. Safe to use from any thread.
+ */
+namespace vfs::utils
+{
+[[nodiscard]] std::optional<std::string> user_name(const uid_t uid) noexcept;
+[[nodiscard]] std::optional<std::string> group_name(const gid_t gid) noexcept;
+
+[[nodiscard]] std::optional<uid_t> user_id(const std::string_view name) noexcept;
+[[nodiscard]] std::optional<gid_t> group_id(const std::string_view name) noexcept;
+
+/**
+ * Drop every cached entry, i.e. after users or groups were changed.
+ */
+void flush_id_cache() noexcept;
+} // namespace vfs::utils
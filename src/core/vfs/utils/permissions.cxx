@@ -17,6 +17,7 @@
 
 #include <ztd/ztd.hxx>
 
+#include "vfs/linux/statx.hxx"
 #include "vfs/utils/permissions.hxx"
 
 bool
@@ -106,6 +107,24 @@ vfs::utils::has_execute_permission(const std::filesystem::path& path) noexcept
     return (permissions & std::filesystem::perms::others_exec) != std::filesystem::perms::none;
 }
 
+bool
+vfs::utils::has_execute_permission(const vfs::linux::statx& stat) noexcept
+{
+    const auto uid = getuid();
+    const auto gid = getgid();
+    const auto permissions = stat.perms();
+
+    if (stat.uid() == uid)
+    {
+        return (permissions & std::filesystem::perms::owner_exec) != std::filesystem::perms::none;
+    }
+    if (stat.gid() == gid)
+    {
+        return (permissions & std::filesystem::perms::group_exec) != std::filesystem::perms::none;
+    }
+    return (permissions & std::filesystem::perms::others_exec) != std::filesystem::perms::none;
+}
+
 bool
 vfs::utils::check_directory_permissions(const std::filesystem::path& path) noexcept
 {
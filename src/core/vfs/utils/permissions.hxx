@@ -17,10 +17,13 @@
 
 #include <filesystem>
 
+#include "vfs/linux/statx.hxx"
+
 namespace vfs::utils
 {
 [[nodiscard]] bool has_read_permission(const std::filesystem::path& path) noexcept;
 [[nodiscard]] bool has_write_permission(const std::filesystem::path& path) noexcept;
 [[nodiscard]] bool has_execute_permission(const std::filesystem::path& path) noexcept;
+[[nodiscard]] bool has_execute_permission(const vfs::linux::statx& stat) noexcept;
 [[nodiscard]] bool check_directory_permissions(const std::filesystem::path& path) noexcept;
 } // namespace vfs::utils
@@ -29,8 +29,11 @@
 
 #include "commandline/commandline.hxx"
 
+#include "vfs/dir-snapshot.hxx"
 #include "vfs/user-dirs.hxx"
 
+#include "vfs/notify-cpp/controller.hxx"
+
 #include "logger.hxx"
 
 struct opts_data final
@@ -46,6 +49,9 @@ struct opts_data final
 
     std::filesystem::path config_dir;
 
+    std::string notify_backend;
+    bool snapshots{false};
+
     std::vector<std::string> raw_log_levels;
     std::flat_map<std::string, std::string> log_levels;
     // std::filesystem::path logfile{"/tmp/test.log"};
@@ -92,6 +98,17 @@ run_commandline(const std::shared_ptr<opts_data>& opt) noexcept
 #endif
 
     logger::initialize(opt->log_levels, opt->logfile);
+
+    if (!opt->notify_backend.empty())
+    {
+        const auto backend = magic_enum::enum_cast<notify::backend>(opt->notify_backend);
+        if (backend)
+        {
+            notify::set_backend(*backend);
+        }
+    }
+
+    vfs::dir_snapshot::enable(opt->snapshots);
 }
 
 static void
@@ -124,6 +141,25 @@ setup_commandline(CLI::App& app, const std::shared_ptr<opts_data>& opt) noexcept
                 return std::format("Config path must be absolute: {}", input);
             });
 
+    app.add_option("--notify",
+                   opt->notify_backend,
+                   "Set the file change notification backend, fanotify needs CAP_SYS_ADMIN "
+                   "and falls back to inotify")
+        ->expected(1)
+        ->check(
+            [](const std::string& input)
+            {
+                if (magic_enum::enum_cast<notify::backend>(input))
+                {
+                    return std::string();
+                }
+                return std::format("Invalid notify backend: {}", input);
+            });
+
+    app.add_flag("--snapshots",
+                 opt->snapshots,
+                 "Cache large directory listings on disk to show them faster when reopened");
+
     app.add_option("--loglevel", opt->raw_log_levels, "Set the loglevel. Format: domain=level")
         ->check(
             [&opt](const auto& value)
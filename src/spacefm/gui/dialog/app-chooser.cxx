@@ -13,7 +13,10 @@
  * along with this program. If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
 #include <print>
+#include <string>
+#include <vector>
 
 #include <glibmm.h>
 #include <gtkmm.h>
@@ -141,9 +144,9 @@ gui::dialog::app_chooser::on_button_ok_clicked()
         auto* list = dynamic_cast<Gtk::ListView*>(page->get_child());
         auto model = std::dynamic_pointer_cast<Gio::ListModel>(list->get_model());
         auto item = model->get_object(page->position_);
-        if (auto app_info = std::dynamic_pointer_cast<Gio::AppInfo>(item))
+        if (auto app_item = std::dynamic_pointer_cast<ModelColumns>(item))
         {
-            app = app_info->get_id();
+            app = app_item->id_;
         }
     }
 
@@ -189,20 +192,39 @@ Glib::RefPtr<Gio::ListModel>
 gui::dialog::app_chooser::page::create_application_list(
     const std::shared_ptr<vfs::mime_type>& mime_type)
 {
-    auto store = Gio::ListStore<Gio::AppInfo>::create();
+    auto store = Gio::ListStore<ModelColumns>::create();
+
+    const auto index = vfs::desktop_index::global();
 
     if (mime_type == nullptr)
     { // load all apps
-        for (const auto& app : Gio::AppInfo::get_all())
+        for (const auto& entry : index->entries())
         {
-            store->append(app);
+            if (!entry.no_display)
+            {
+                store->append(ModelColumns::create(entry));
+            }
         }
     }
     else
     {
-        for (const auto& app : Gio::AppInfo::get_all_for_type(mime_type->type().data()))
+        // associated apps first, default app at the top
+        std::vector<std::string> added;
+        for (const auto& action : mime_type->actions())
         {
-            store->append(app);
+            const auto* entry = index->lookup(action);
+            if (entry != nullptr)
+            {
+                store->append(ModelColumns::create(*entry));
+                added.push_back(action);
+            }
+        }
+        for (const auto* entry : index->lookup_type(mime_type->type()))
+        {
+            if (!std::ranges::contains(added, entry->id))
+            {
+                store->append(ModelColumns::create(*entry));
+            }
         }
     }
 
@@ -228,10 +250,18 @@ gui::dialog::app_chooser::page::on_bind_item(const Glib::RefPtr<Gtk::ListItem>&
     {
         if (auto* label = dynamic_cast<Gtk::Label*>(image->get_next_sibling()))
         {
-            if (auto app_info = std::dynamic_pointer_cast<Gio::AppInfo>(item->get_item()))
+            if (auto app = std::dynamic_pointer_cast<ModelColumns>(item->get_item()))
             {
-                image->set(app_info->get_icon());
-                label->set_label(app_info->get_display_name());
+                if (app->icon_.starts_with('/'))
+                {
+                    image->set(app->icon_);
+                }
+                else
+                {
+                    image->set_from_icon_name(app->icon_.empty() ? "application-x-executable"
+                                                                 : app->icon_);
+                }
+                label->set_label(app->name_);
             }
         }
     }
@@ -19,6 +19,7 @@
 
 #include <gtkmm.h>
 
+#include "vfs/desktop-index.hxx"
 #include "vfs/file.hxx"
 
 // https://github.com/GNOME/gtkmm/blob/master/demos/gtk-demo/example_listview_applauncher.cc
@@ -40,6 +41,27 @@ class app_chooser : public Gtk::ApplicationWindow
                 bool focus_all_apps, bool show_command, bool show_default);
 
   protected:
+    class ModelColumns : public Glib::Object
+    {
+      public:
+        std::string id_;
+        std::string name_;
+        std::string icon_;
+
+        static Glib::RefPtr<ModelColumns>
+        create(const vfs::desktop_index::entry& entry) noexcept
+        {
+            return Glib::make_refptr_for_instance<ModelColumns>(new ModelColumns(entry));
+        }
+
+      protected:
+        explicit ModelColumns(const vfs::desktop_index::entry& entry) noexcept
+            : Glib::ObjectBase(typeid(ModelColumns)), id_(entry.id), name_(entry.name),
+              icon_(entry.icon)
+        {
+        }
+    };
+
     class page : public Gtk::ScrolledWindow
     {
       public:
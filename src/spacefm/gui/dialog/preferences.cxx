@@ -26,6 +26,8 @@
 #include "gui/dialog/preferences.hxx"
 #include "gui/dialog/widgets/button-box.hxx"
 
+#include "vfs/texture-cache.hxx"
+
 class preference_page : public Gtk::ScrolledWindow
 {
   public:
@@ -199,6 +201,26 @@ gui::dialog::preferences::init_general_tab() noexcept
     page->add_checkbox("Auto Open Mounted Volumes", settings_->general.auto_open_mounted_volumes);
     page->add_checkbox("Save Tabs", settings_->general.load_saved_tabs);
     page->add_checkbox("Use SI Units", settings_->general.use_si_prefix);
+
+    {
+        auto& opt = settings_->general.thumbnail_cache_size;
+
+        auto adjust = Gtk::Adjustment::create(opt, 16, 4096);
+        adjust->set_step_increment(16);
+        adjust->set_page_increment(128);
+        adjust->signal_value_changed().connect(
+            [&opt, adjust]()
+            {
+                opt = static_cast<std::uint32_t>(adjust->get_value());
+                vfs::texture_cache::global().set_budget(std::size_t{opt} * 1024 * 1024);
+            });
+
+        auto button = Gtk::make_managed<Gtk::SpinButton>();
+        button->set_value(opt);
+        button->set_adjustment(adjust);
+
+        page->add_row("Thumbnail memory (MiB)", *button);
+    }
 }
 
 void
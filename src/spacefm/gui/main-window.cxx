@@ -31,6 +31,8 @@
 #include "gui/dialog/preferences.hxx"
 #include "gui/dialog/text.hxx"
 
+#include "vfs/texture-cache.hxx"
+
 #include "logger.hxx"
 
 gui::main_window::main_window(const Glib::RefPtr<Gtk::Application>& app)
@@ -58,6 +60,9 @@ gui::main_window::main_window(const Glib::RefPtr<Gtk::Application>& app)
         });
     config_manager_->load();
 
+    vfs::texture_cache::global().set_budget(std::size_t{settings_->general.thumbnail_cache_size} *
+                                            1024 * 1024);
+
     bookmark_manager_->signal_load_error().connect(
         [this](std::string_view msg)
         {
@@ -160,6 +165,14 @@ gui::main_window::main_window(const Glib::RefPtr<Gtk::Application>& app)
 gui::main_window::~main_window()
 {
     config_manager_->save();
+
+    const auto stats = vfs::texture_cache::global().statistics();
+    logger::debug("texture cache: {} hits, {} misses, {} evictions, {} textures in {} bytes",
+                  stats.hits,
+                  stats.misses,
+                  stats.evictions,
+                  stats.textures,
+                  stats.bytes);
 }
 
 void
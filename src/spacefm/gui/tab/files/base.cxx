@@ -18,8 +18,10 @@
 #include <limits>
 #include <memory>
 #include <optional>
+#include <ranges>
 #include <span>
 #include <string>
+#include <utility>
 
 #include <fnmatch.h>
 
@@ -32,24 +34,62 @@
 #include "gui/tab/files/base.hxx"
 
 #include "vfs/task-manager.hxx"
+#include "vfs/thumbnail-scheduler.hxx"
 
 #include "logger.hxx"
 #include "natsort/natsort.hxx"
 
+/**
+ * @return the positions the scheduler queues around a visible range, both inclusive
+ */
+[[nodiscard]] static std::pair<std::uint32_t, std::uint32_t>
+prefetch_range(const std::uint32_t first, const std::uint32_t last) noexcept
+{
+    constexpr auto distance = vfs::thumbnail_scheduler::PREFETCH_DISTANCE;
+    return {first - std::min(first, distance), last + distance};
+}
+
 gui::files_base::files_base(const std::shared_ptr<vfs::task_manager>& task_manager,
                             const std::shared_ptr<config::settings>& settings)
     : task_manager_(task_manager), settings_(settings)
 {
     dir_model_ = Gio::ListStore<ModelColumns>::create();
     selection_model_ = Gtk::MultiSelection::create(dir_model_);
+
+    // called from the executor, remove_owner() does not wait for the idle source
+    thumbnail_owner_ = vfs::thumbnail_scheduler::global().add_owner(
+        [this, alive = std::weak_ptr(alive_)](const auto& file)
+        {
+            Glib::signal_idle().connect_once(
+                [this, alive, file]()
+                {
+                    if (!alive.expired())
+                    {
+                        on_thumbnail_loaded(file);
+                    }
+                },
+                Glib::PRIORITY_DEFAULT);
+        });
+
+    // an insert or remove moves the bound items without binding them again
+    signal_items_changed = dir_model_->signal_items_changed().connect(
+        [this](guint, guint, guint) { queue_update_visible_range(); });
 }
 
 gui::files_base::~files_base()
 {
+    signal_files_loaded.disconnect();
+    signal_dir_loaded.disconnect();
     signal_files_changed.disconnect();
     signal_files_created.disconnect();
     signal_files_deleted.disconnect();
-    signal_thumbnail_loaded.disconnect();
+    signal_files_renamed.disconnect();
+    signal_mime_types_changed.disconnect();
+    signal_items_changed.disconnect();
+
+    // tab closed
+    vfs::thumbnail_scheduler::global().remove_owner(thumbnail_owner_);
+    unpin_thumbnails();
 }
 
 std::shared_ptr<vfs::file>
@@ -186,9 +226,16 @@ gui::files_base::update() noexcept
 {
     dir_model_->remove_all();
 
+    // if still loading the rest of the files will be added by on_files_loaded().
+    // not is_loading(), a refresh never emits signal_directory_loaded()
+    streaming_ = dir_->is_initial_load();
+
+    const auto files = dir_->files();
+    loaded_count_ = files.size();
+
     std::vector<Glib::RefPtr<ModelColumns>> items;
-    items.reserve(dir_->files().size());
-    for (const auto& file : dir_->files())
+    items.reserve(files.size());
+    for (const auto& file : files)
     {
         if ((sorting_.show_hidden || !file->is_hidden()) && is_pattern_match(file->name()))
         {
@@ -199,13 +246,19 @@ gui::files_base::update() noexcept
 
     sort();
 
-    signal_model_loaded().emit();
+    if (!streaming_)
+    {
+        signal_model_loaded().emit();
+    }
 }
 
 void
 gui::files_base::sort() noexcept
 {
     dir_model_->sort(sigc::mem_fun(*this, &files_base::model_sort));
+
+    // queued positions are stale
+    load_thumbnails();
 }
 
 bool
@@ -350,15 +403,61 @@ gui::files_base::set_dir(const std::shared_ptr<vfs::dir>& dir, const config::sor
         return;
     }
 
+    signal_files_loaded.disconnect();
+    signal_dir_loaded.disconnect();
     signal_files_changed.disconnect();
     signal_files_created.disconnect();
     signal_files_deleted.disconnect();
-    signal_thumbnail_loaded.disconnect();
+    signal_files_renamed.disconnect();
+    signal_mime_types_changed.disconnect();
+
+    // the files of the previous dir are no longer shown
+    vfs::thumbnail_scheduler::global().cancel(thumbnail_owner_);
+    unpin_thumbnails();
+    bound_items_.clear();
 
     dir_ = dir;
+    streaming_ = false;
+    loaded_count_ = 0;
     sorting_ = sorting;
     grid_state_ = grid_state.value_or({});
     list_state_ = list_state.value_or({});
+    // only the grid view shows thumbnails
+    enable_thumbnail_ = grid_state && grid_state->thumbnails;
+
+    // captured here, the handlers below must not read members from other threads
+    const auto generation = ++dir_generation_;
+    const auto alive = std::weak_ptr(alive_);
+    const auto is_current = [this, alive, generation]()
+    { return !alive.expired() && generation == dir_generation_; };
+
+    // emitted from the loader thread
+    signal_files_loaded = dir_->signal_files_loaded().connect(
+        [this, is_current](const auto offset, const auto& files)
+        {
+            Glib::signal_idle().connect_once(
+                [this, is_current, offset, files]()
+                {
+                    if (is_current())
+                    {
+                        on_files_loaded(offset, files);
+                    }
+                },
+                Glib::PRIORITY_DEFAULT);
+        });
+    signal_dir_loaded = dir_->signal_directory_loaded().connect(
+        [this, is_current]()
+        {
+            Glib::signal_idle().connect_once(
+                [this, is_current]()
+                {
+                    if (is_current())
+                    {
+                        on_directory_loaded();
+                    }
+                },
+                Glib::PRIORITY_DEFAULT);
+        });
 
     signal_files_changed = dir_->signal_files_changed().connect([this](const auto& files)
                                                                 { on_files_changed(files); });
@@ -366,9 +465,23 @@ gui::files_base::set_dir(const std::shared_ptr<vfs::dir>& dir, const config::sor
                                                                 { on_files_created(files); });
     signal_files_deleted = dir_->signal_files_deleted().connect([this](const auto& files)
                                                                 { on_files_deleted(files); });
-
-    signal_thumbnail_loaded =
-        dir_->signal_thumbnail_loaded().connect([this](auto f) { on_thumbnail_loaded(f); });
+    signal_files_renamed = dir_->signal_files_renamed().connect([this](const auto& files)
+                                                                { on_files_renamed(files); });
+
+    // emitted from the executor
+    signal_mime_types_changed = dir_->signal_mime_types_changed().connect(
+        [this, is_current](const auto& files)
+        {
+            Glib::signal_idle().connect_once(
+                [this, is_current, files]()
+                {
+                    if (is_current())
+                    {
+                        on_mime_types_changed(files);
+                    }
+                },
+                Glib::PRIORITY_DEFAULT);
+        });
 
     signal_directory_loaded().emit();
 }
@@ -412,6 +525,8 @@ gui::files_base::set_state(const config::grid_state& state, const bool update_mo
         [this, state, update_model]()
         {
             grid_state_ = state;
+            enable_thumbnail_ = state.thumbnails;
+            thumbnail_size_ = state.icon_size;
 
             if (update_model)
             {
@@ -473,6 +588,50 @@ gui::files_base::find_file(const std::shared_ptr<vfs::file>& file) noexcept
     return {false, std::numeric_limits<std::uint32_t>::max()};
 }
 
+void
+gui::files_base::on_files_loaded(const std::size_t offset,
+                                 const std::span<const std::shared_ptr<vfs::file>> files) noexcept
+{
+    if (!streaming_ || offset + files.size() <= loaded_count_)
+    {
+        // already in the model from update()
+        return;
+    }
+
+    const auto skip = loaded_count_ > offset ? loaded_count_ - offset : 0;
+
+    std::vector<Glib::RefPtr<ModelColumns>> items;
+    items.reserve(files.size() - skip);
+    for (const auto& file : files | std::views::drop(skip))
+    {
+        if ((sorting_.show_hidden || !file->is_hidden()) && is_pattern_match(file->name()))
+        {
+            items.push_back(ModelColumns::create(file));
+        }
+    }
+
+    // keep each chunk ordered, the full model is sorted once loading is done
+    std::ranges::sort(items, [this](const auto& a, const auto& b) { return model_sort(a, b) < 0; });
+
+    dir_model_->splice(dir_model_->get_n_items(), 0, items);
+
+    loaded_count_ = offset + files.size();
+}
+
+void
+gui::files_base::on_directory_loaded() noexcept
+{
+    if (!streaming_)
+    {
+        return;
+    }
+    streaming_ = false;
+
+    sort();
+
+    signal_model_loaded().emit();
+}
+
 void
 gui::files_base::on_files_created(const std::span<const std::shared_ptr<vfs::file>> files) noexcept
 {
@@ -486,8 +645,9 @@ gui::files_base::on_files_created(const std::span<const std::shared_ptr<vfs::fil
         }
 
 #if 1
-        dir_model_->insert_sorted(ModelColumns::create(file),
-                                  sigc::mem_fun(*this, &files_base::model_sort));
+        const auto position = dir_model_->insert_sorted(
+            ModelColumns::create(file),
+            sigc::mem_fun(*this, &files_base::model_sort));
 #else
         Glib::signal_idle().connect_once(
             [this, file]()
@@ -498,15 +658,7 @@ gui::files_base::on_files_created(const std::span<const std::shared_ptr<vfs::fil
             Glib::PRIORITY_DEFAULT);
 #endif
 
-        if (enable_thumbnail_ && (file->mime_type()->is_video() || file->mime_type()->is_image()))
-        {
-            const auto size = std::to_underlying(thumbnail_size_);
-
-            if (!file->is_thumbnail_loaded(size))
-            {
-                dir_->load_thumbnail(file, size);
-            }
-        }
+        request_thumbnail(file, position);
     }
 }
 
@@ -556,23 +708,88 @@ gui::files_base::on_files_changed(const std::span<const std::shared_ptr<vfs::fil
         }
 
         const auto [found, position] = find_file(file);
-        if (found)
+        if (!found)
         {
-            auto item = dir_model_->get_item(position);
-            item->signal_changed().emit();
+            continue;
         }
 
+        auto item = dir_model_->get_item(position);
+        item->signal_changed().emit();
+
         const auto now = std::chrono::system_clock::now();
-        if (enable_thumbnail_ && (now - file->mtime() > std::chrono::seconds(5)) &&
-            (file->mime_type()->is_video() || file->mime_type()->is_image()))
+        if (now - file->mtime() > std::chrono::seconds(5))
         {
-            const auto size = std::to_underlying(thumbnail_size_);
+            request_thumbnail(file, position);
+        }
+    }
+}
+
+void
+gui::files_base::on_files_renamed(const std::span<const vfs::dir::renamed_file> files) noexcept
+{
+    // logger::debug("gui::grid::on_files_renamed({})", files.size());
+
+    for (const auto& [from, file] : files)
+    {
+        const bool visible =
+            (sorting_.show_hidden || !file->is_hidden()) && is_pattern_match(file->name());
+
+        const auto [found, position] = find_file(from);
+        if (!found)
+        {
+            if (visible)
+            {
+                // renamed from a hidden or filtered name
+                dir_model_->insert_sorted(ModelColumns::create(file),
+                                          sigc::mem_fun(*this, &files_base::model_sort));
+            }
+            continue;
+        }
+
+        if (!visible)
+        {
+            dir_model_->remove(position);
+            continue;
+        }
 
-            if (!file->is_thumbnail_loaded(size))
+        auto item = dir_model_->get_item(position);
+        item->file = file;
+        item->signal_changed().emit();
+        item->signal_update_thumbnail().emit();
+
+        for (auto& bound : bound_items_ | std::views::values)
+        {
+            if (bound.file == from)
             {
-                dir_->load_thumbnail(file, size);
+                // pinned before the old key is unpinned, so the moved texture is not evicted
+                auto previous = bound;
+                bound.file = file;
+                bound.pinned = 0;
+                pin_thumbnail(bound);
+                unpin_thumbnail(previous);
             }
         }
+        request_thumbnail(file, position);
+
+        // the row, and its selection, is kept if it is still in order
+        const auto n_items = dir_model_->get_n_items();
+        const bool after_previous =
+            position == 0 || model_sort(dir_model_->get_item(position - 1), item) <= 0;
+        const bool before_next =
+            position + 1 >= n_items || model_sort(item, dir_model_->get_item(position + 1)) <= 0;
+        if (after_previous && before_next)
+        {
+            continue;
+        }
+
+        const bool selected = selection_model_->is_selected(position);
+        dir_model_->remove(position);
+        const auto new_position =
+            dir_model_->insert_sorted(item, sigc::mem_fun(*this, &files_base::model_sort));
+        if (selected)
+        {
+            selection_model_->select_item(new_position, false);
+        }
     }
 }
 
@@ -588,3 +805,200 @@ gui::files_base::on_thumbnail_loaded(const std::shared_ptr<vfs::file>& file) noe
         item->signal_update_thumbnail().emit();
     }
 }
+
+void
+gui::files_base::on_mime_types_changed(
+    const std::span<const std::shared_ptr<vfs::file>> files) noexcept
+{
+    // logger::debug("gui::grid::on_mime_types_changed({})", files.size());
+
+    for (const auto& file : files)
+    {
+        const auto [found, position] = find_file(file);
+        if (!found)
+        {
+            continue;
+        }
+
+        // the icon and the type columns
+        auto item = dir_model_->get_item(position);
+        item->signal_update_thumbnail().emit();
+        item->signal_changed().emit();
+
+        request_thumbnail(file, position);
+    }
+}
+
+void
+gui::files_base::load_thumbnails() noexcept
+{
+    // the thumbnail size or state may have changed
+    for (auto& item : bound_items_ | std::views::values)
+    {
+        unpin_thumbnail(item);
+        pin_thumbnail(item);
+    }
+
+    if (!enable_thumbnail_)
+    {
+        vfs::thumbnail_scheduler::global().cancel(thumbnail_owner_);
+        return;
+    }
+
+    const auto [first, last] = prefetch_range(visible_first_, visible_last_);
+    const auto n_items = dir_model_->get_n_items();
+    for (auto i = first; i <= last && i < n_items; ++i)
+    {
+        request_thumbnail(dir_model_->get_item(i)->file, i);
+    }
+}
+
+void
+gui::files_base::request_thumbnail(const std::shared_ptr<vfs::file>& file,
+                                   const std::uint32_t position) noexcept
+{
+    if (!enable_thumbnail_ || !(file->mime_type()->is_video() || file->mime_type()->is_image()))
+    {
+        return;
+    }
+
+    const auto size = std::to_underlying(thumbnail_size_);
+    if (!file->is_thumbnail_loaded(size))
+    {
+        vfs::thumbnail_scheduler::global().request(thumbnail_owner_, file, size, position);
+    }
+}
+
+void
+gui::files_base::on_item_bound(const Glib::RefPtr<Gtk::ListItem>& item) noexcept
+{
+    auto col = std::dynamic_pointer_cast<ModelColumns>(item->get_item());
+    if (!col)
+    {
+        return;
+    }
+
+    const auto position = item->get_position();
+    auto& bound = bound_items_[item->gobj()];
+    unpin_thumbnail(bound);
+    bound.file = col->file;
+    pin_thumbnail(bound);
+    update_visible_range();
+
+    request_thumbnail(col->file, position);
+}
+
+void
+gui::files_base::on_item_unbound(const Glib::RefPtr<Gtk::ListItem>& item) noexcept
+{
+    const auto it = bound_items_.find(item->gobj());
+    if (it != bound_items_.cend())
+    {
+        unpin_thumbnail(it->second);
+        bound_items_.erase(it);
+    }
+    update_visible_range();
+
+    // scrolled out of view, requested again if it is bound again
+    auto col = std::dynamic_pointer_cast<ModelColumns>(item->get_item());
+    if (col)
+    {
+        vfs::thumbnail_scheduler::global().cancel(thumbnail_owner_, col->file);
+    }
+}
+
+void
+gui::files_base::update_visible_range() noexcept
+{
+    if (bound_items_.empty())
+    {
+        return;
+    }
+
+    auto positions =
+        bound_items_ | std::views::keys |
+        std::views::transform([](auto* item) { return gtk_list_item_get_position(item); }) |
+        std::views::filter([](const auto position)
+                           { return position != GTK_INVALID_LIST_POSITION; });
+    if (std::ranges::empty(positions))
+    {
+        return;
+    }
+
+    const auto [first, last] = std::ranges::minmax(positions);
+    if (first == visible_first_ && last == visible_last_)
+    {
+        return;
+    }
+    vfs::thumbnail_scheduler::global().set_visible_range(thumbnail_owner_, first, last);
+
+    // the scheduler dropped what is now out of range, request what came into range
+    const auto previous = prefetch_range(visible_first_, visible_last_);
+    const auto current = prefetch_range(first, last);
+    visible_first_ = first;
+    visible_last_ = last;
+
+    const auto n_items = dir_model_->get_n_items();
+    for (auto i = current.first; i <= current.second && i < n_items; ++i)
+    {
+        if (i < previous.first || i > previous.second)
+        {
+            request_thumbnail(dir_model_->get_item(i)->file, i);
+        }
+    }
+}
+
+void
+gui::files_base::queue_update_visible_range() noexcept
+{
+    if (visible_range_queued_)
+    {
+        return;
+    }
+    visible_range_queued_ = true;
+
+    // after the view has moved its list items
+    Glib::signal_idle().connect_once(
+        [this, alive = std::weak_ptr(alive_)]()
+        {
+            if (alive.expired())
+            {
+                return;
+            }
+            visible_range_queued_ = false;
+            update_visible_range();
+        },
+        Glib::PRIORITY_LOW);
+}
+
+void
+gui::files_base::pin_thumbnail(bound_item& item) noexcept
+{
+    if (!enable_thumbnail_ || !item.file ||
+        !(item.file->mime_type()->is_video() || item.file->mime_type()->is_image()))
+    {
+        return;
+    }
+
+    item.pinned = std::to_underlying(thumbnail_size_);
+    item.file->pin_thumbnail(item.pinned);
+}
+
+void
+gui::files_base::unpin_thumbnail(bound_item& item) noexcept
+{
+    if (item.pinned != 0)
+    {
+        item.file->unpin_thumbnail(item.pinned);
+        item.pinned = 0;
+    }
+}
+
+void
+gui::files_base::unpin_thumbnails() noexcept
+{
+    for (auto& item : bound_items_ | std::views::values)
+    {
+        unpin_thumbnail(item);
+    }
+}
@@ -20,6 +20,7 @@
 #include <optional>
 #include <span>
 #include <string>
+#include <unordered_map>
 
 #include <gtkmm.h>
 #include <sigc++/sigc++.h>
@@ -29,6 +30,7 @@
 #include "vfs/dir.hxx"
 #include "vfs/file.hxx"
 #include "vfs/task-manager.hxx"
+#include "vfs/thumbnail-scheduler.hxx"
 
 namespace gui
 {
@@ -131,6 +133,37 @@ class files_base
     config::icon_size thumbnail_size_ = config::icon_size::normal;
     bool enable_thumbnail_{true};
 
+    // this view in vfs::thumbnail_scheduler::global()
+    vfs::thumbnail_scheduler::owner_id thumbnail_owner_;
+    // every bound list item, the visible range reported to the scheduler.
+    // positions are read from the list item, they change when the model does
+    struct bound_item final
+    {
+        std::shared_ptr<vfs::file> file;
+        std::int32_t pinned{0}; // thumbnail size pinned in vfs::texture_cache, 0 if none
+    };
+    std::unordered_map<GtkListItem*, bound_item> bound_items_;
+    std::uint32_t visible_first_{0};
+    std::uint32_t visible_last_{0};
+    bool visible_range_queued_{false};
+
+    /**
+     * Request the thumbnails within vfs::thumbnail_scheduler::PREFETCH_DISTANCE
+     * of the bound items, the rest is requested as the bound range moves.
+     */
+    void load_thumbnails() noexcept;
+    void request_thumbnail(const std::shared_ptr<vfs::file>& file,
+                           const std::uint32_t position) noexcept;
+
+    // called by the item factory bind and unbind handlers
+    void on_item_bound(const Glib::RefPtr<Gtk::ListItem>& item) noexcept;
+    void on_item_unbound(const Glib::RefPtr<Gtk::ListItem>& item) noexcept;
+    void update_visible_range() noexcept;
+    void queue_update_visible_range() noexcept;
+    void pin_thumbnail(bound_item& item) noexcept;
+    void unpin_thumbnail(bound_item& item) noexcept;
+    void unpin_thumbnails() noexcept;
+
     std::int32_t model_sort(const Glib::RefPtr<const ModelColumns>& a,
                             const Glib::RefPtr<const ModelColumns>& b) const noexcept;
 
@@ -140,10 +173,25 @@ class files_base
 
     std::pair<bool, std::uint32_t> find_file(const std::shared_ptr<vfs::file>& file) noexcept;
 
+    // streaming load, files are appended to the model as the dir is read
+    std::size_t loaded_count_{0};
+    bool streaming_{false};
+
+    // idle sources queued from other threads run after their checks on the gui thread.
+    // alive_ expires with this view and dir_generation_ changes with every set_dir(),
+    // so chunks still queued for a previous dir are dropped.
+    std::shared_ptr<bool> alive_{std::make_shared<bool>(true)};
+    std::uint64_t dir_generation_{0};
+    void on_files_loaded(const std::size_t offset,
+                         const std::span<const std::shared_ptr<vfs::file>> files) noexcept;
+    void on_directory_loaded() noexcept;
+
     void on_files_created(const std::span<const std::shared_ptr<vfs::file>> files) noexcept;
     void on_files_deleted(const std::span<const std::shared_ptr<vfs::file>> files) noexcept;
     void on_files_changed(const std::span<const std::shared_ptr<vfs::file>> files) noexcept;
+    void on_files_renamed(const std::span<const vfs::dir::renamed_file> files) noexcept;
     void on_thumbnail_loaded(const std::shared_ptr<vfs::file>& file) noexcept;
+    void on_mime_types_changed(const std::span<const std::shared_ptr<vfs::file>> files) noexcept;
 
   public:
     [[nodiscard]] auto
@@ -176,10 +224,14 @@ class files_base
     sigc::signal<void()> signal_update_view_state_;
 
     // Signals we connect to
+    sigc::connection signal_files_loaded;
+    sigc::connection signal_dir_loaded;
     sigc::connection signal_files_created;
     sigc::connection signal_files_deleted;
     sigc::connection signal_files_changed;
-    sigc::connection signal_thumbnail_loaded;
+    sigc::connection signal_files_renamed;
+    sigc::connection signal_mime_types_changed;
     sigc::connection signal_icon_size_changed;
+    sigc::connection signal_items_changed;
 };
 } // namespace gui
@@ -96,14 +96,8 @@ gui::grid::grid(const config::grid_state& state,
                 Glib::PRIORITY_DEFAULT);
         });
 
-    signal_update_view_state().connect(
-        [this]()
-        {
-            if (grid_state_.thumbnails)
-            {
-                dir_->load_thumbnails(std::to_underlying(grid_state_.icon_size));
-            }
-        });
+    // thumbnails toggled or the icon size changed
+    signal_update_view_state().connect([this]() { load_thumbnails(); });
 }
 
 void
@@ -167,6 +161,14 @@ gui::grid::on_bind_item(const Glib::RefPtr<Gtk::ListItem>& item) noexcept
     auto* label = dynamic_cast<Gtk::Label*>(picture->get_next_sibling());
 #endif
 
+    // only files that are shown have their content read
+    if (dir_ && col->file->is_mime_type_sniff_needed())
+    {
+        dir_->sniff_mime_type(col->file);
+    }
+
+    on_item_bound(item);
+
     auto connections = std::make_unique<std::vector<sigc::connection>>();
 
     if (col->file->is_directory())
@@ -308,6 +310,8 @@ gui::grid::on_unbind_item(const Glib::RefPtr<Gtk::ListItem>& item) noexcept
     // auto* label = dynamic_cast<Gtk::Label*>(picture->get_next_sibling());
 #endif
 
+    on_item_unbound(item);
+
     if (col->drop_target)
     {
         box->remove_controller(col->drop_target);
@@ -265,6 +265,15 @@ gui::list::on_bind_name(const Glib::RefPtr<Gtk::ListItem>& item) noexcept
     auto* image = dynamic_cast<Gtk::Image*>(box->get_first_child());
     auto* label = dynamic_cast<Gtk::Label*>(image->get_next_sibling());
 
+    // only files that are shown have their content read
+    if (dir_ && col->file->is_mime_type_sniff_needed())
+    {
+        dir_->sniff_mime_type(col->file);
+    }
+
+    // the name column is bound once per row
+    on_item_bound(item);
+
     auto connections = std::make_unique<std::vector<sigc::connection>>();
 
     if (col->file->is_directory())
@@ -704,6 +713,8 @@ gui::list::on_unbind_name(const Glib::RefPtr<Gtk::ListItem>& item) noexcept
     // auto* image = dynamic_cast<Gtk::Image*>(box->get_first_child());
     // auto* label = dynamic_cast<Gtk::Label*>(image->get_next_sibling());
 
+    on_item_unbound(item);
+
     if (col->drop_target)
     {
         box->remove_controller(col->drop_target);
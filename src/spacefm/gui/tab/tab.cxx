@@ -2084,6 +2084,7 @@ gui::tab::on_dir_file_listed() noexcept
     signal_file_created_.disconnect();
     signal_file_changed_.disconnect();
     signal_file_deleted_.disconnect();
+    signal_file_renamed_.disconnect();
     signal_self_deleted_.disconnect();
 
     signal_file_created_ = dir_->signal_files_created().connect(
@@ -2104,11 +2105,15 @@ gui::tab::on_dir_file_listed() noexcept
             signal_change_content().emit();
             on_update_statusbar();
         });
+    signal_file_renamed_ = dir_->signal_files_renamed().connect(
+        [this](const auto&)
+        {
+            signal_change_content().emit();
+            on_update_statusbar();
+        });
     signal_self_deleted_ =
         dir_->signal_directory_deleted().connect([this]() { signal_close_tab().emit(); });
 
-    update_model();
-
     signal_chdir_after().emit();
     signal_change_content().emit();
     signal_change_selection().emit();
@@ -2210,30 +2215,17 @@ gui::tab::chdir(const std::filesystem::path& path, const gui::lib::history::mode
     // load new dir
 
     signal_directory_loaded_.disconnect();
-    signal_directory_refresh_.disconnect();
 
     dir_ = vfs::dir::create(path);
 
     signal_chdir_begin().emit();
 
-    signal_directory_loaded_ = dir_->signal_directory_loaded().connect(
-        [this]()
-        {
-            on_dir_file_listed();
+    // the view requests thumbnails for the files it shows
+    signal_directory_loaded_ =
+        dir_->signal_directory_loaded().connect([this]() { on_dir_file_listed(); });
 
-            if (view_mode_ == config::view_mode::grid)
-            {
-                dir_->load_thumbnails(std::to_underlying(grid_state_.icon_size));
-            }
-        });
-    signal_directory_refresh_ = dir_->signal_directory_refresh().connect(
-        [this]()
-        {
-            if (view_mode_ == config::view_mode::grid)
-            {
-                dir_->load_thumbnails(std::to_underlying(grid_state_.icon_size));
-            }
-        });
+    // set the model now so files are shown as they are loaded
+    update_model();
 
     if (dir_->is_loaded())
     {
@@ -26,6 +26,8 @@
 
 #include "gui/main-window.hxx"
 
+#include "vfs/mime-monitor.hxx"
+
 int
 main(int argc, char* argv[])
 {
@@ -37,5 +39,7 @@ main(int argc, char* argv[])
     }
 
     auto app = Gtk::Application::create("org.thermitegod.experimental.spacefm");
+    app->signal_startup().connect([]() { vfs::mime_monitor_init(); });
+    app->signal_shutdown().connect([]() { vfs::mime_monitor_shutdown(); });
     return app->make_window_and_run<gui::main_window>(0, nullptr, app);
 }
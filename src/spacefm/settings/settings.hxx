@@ -191,6 +191,8 @@ struct settings_on_disk
         bool load_saved_tabs{true};
 
         bool use_si_prefix{false};
+
+        std::uint32_t thumbnail_cache_size{256}; // MiB of decoded thumbnails kept in memory
     };
     general general;
 
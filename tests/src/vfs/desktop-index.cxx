@@ -0,0 +1,139 @@
+/**
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <array>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include <doctest/doctest.h>
+
+#include "utils.hxx"
+
+#include "vfs/desktop-index.hxx"
+
+TEST_SUITE("vfs::desktop_index" * doctest::description(""))
+{
+    const auto root = std::filesystem::temp_directory_path() / PACKAGE_NAME / "desktop-index";
+
+    TEST_CASE("desktop_index")
+    {
+        if (std::filesystem::exists(root))
+        {
+            std::filesystem::remove_all(root);
+        }
+
+        const auto user = root / "user" / "applications";
+        const auto system = root / "system" / "applications";
+        const auto dirs = std::array{user, system};
+
+        create_file(system / "editor.desktop",
+                    "[Desktop Entry]\n"
+                    "Type=Application\n"
+                    "Name=System Editor\n"
+                    "Exec=editor %F\n"
+                    "Icon=accessories-text-editor\n"
+                    "MimeType=text/plain;text/x-csrc;\n");
+        create_file(user / "editor.desktop",
+                    "[Desktop Entry]\n"
+                    "Type=Application\n"
+                    "Name=Editor\n"
+                    "Exec=editor --user %F\n"
+                    "Terminal=true\n"
+                    "MimeType=text/plain;\n");
+        create_file(system / "viewer.desktop",
+                    "[Desktop Entry]\n"
+                    "Type=Application\n"
+                    "Name=Viewer\n"
+                    "Exec=viewer %f\n"
+                    "NoDisplay=true\n"
+                    "MimeType=text/plain;image/png;\n");
+        create_file(user / "hidden.desktop",
+                    "[Desktop Entry]\n"
+                    "Type=Application\n"
+                    "Name=Hidden\n"
+                    "Hidden=true\n");
+        create_file(system / "hidden.desktop",
+                    "[Desktop Entry]\n"
+                    "Type=Application\n"
+                    "Name=Hidden\n"
+                    "Exec=hidden\n");
+        create_file(system / "vendor" / "app.desktop",
+                    "[Desktop Entry]\n"
+                    "Type=Application\n"
+                    "Name=app\n"
+                    "Exec=app\n");
+        create_file(system / "link.desktop",
+                    "[Desktop Entry]\n"
+                    "Type=Link\n"
+                    "Name=Link\n"
+                    "URL=https://example.com\n");
+        create_file(system / "noname.desktop",
+                    "[Desktop Entry]\n"
+                    "Type=Application\n"
+                    "Exec=noname\n");
+
+        const auto index = vfs::desktop_index::create(dirs);
+
+        CHECK_EQ(index.size(), 3);
+
+        SUBCASE("the most important dir wins")
+        {
+            const auto* entry = index.lookup("editor.desktop");
+            REQUIRE(entry != nullptr);
+            CHECK_EQ(entry->name, "Editor");
+            CHECK_EQ(entry->exec, "editor --user %F");
+            CHECK_EQ(entry->path, user / "editor.desktop");
+            CHECK(entry->terminal);
+            CHECK_EQ(entry->mime_types, std::vector<std::string>{"text/plain"});
+        }
+
+        SUBCASE("hidden, other types and entries without a name are dropped")
+        {
+            CHECK_EQ(index.lookup("hidden.desktop"), nullptr);
+            CHECK_EQ(index.lookup("link.desktop"), nullptr);
+            CHECK_EQ(index.lookup("noname.desktop"), nullptr);
+        }
+
+        SUBCASE("subdirs are part of the desktop id")
+        {
+            const auto* entry = index.lookup("vendor-app.desktop");
+            REQUIRE(entry != nullptr);
+            CHECK_EQ(entry->name, "app");
+        }
+
+        SUBCASE("lookup by mime type")
+        {
+            const auto apps = index.lookup_type("text/plain");
+            REQUIRE_EQ(apps.size(), 2);
+            CHECK_EQ(apps[0]->id, "editor.desktop");
+            CHECK_EQ(apps[1]->id, "viewer.desktop");
+            CHECK(apps[1]->no_display);
+
+            CHECK(index.lookup_type("text/x-csrc").empty());
+        }
+
+        SUBCASE("entries are sorted by name")
+        {
+            const auto entries = index.entries();
+            REQUIRE_EQ(entries.size(), 3);
+            CHECK_EQ(entries[0].name, "app");
+            CHECK_EQ(entries[1].name, "Editor");
+            CHECK_EQ(entries[2].name, "Viewer");
+        }
+
+        std::filesystem::remove_all(root);
+    }
+}
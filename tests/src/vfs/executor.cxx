@@ -0,0 +1,133 @@
+/**
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <ranges>
+#include <stop_token>
+#include <thread>
+
+#include <doctest/doctest.h>
+
+#include "vfs/executor.hxx"
+
+TEST_SUITE("vfs::executor" * doctest::description(""))
+{
+    TEST_CASE("vfs::task_group")
+    {
+        vfs::executor executor(4);
+        REQUIRE_EQ(executor.size(), 4);
+
+        SUBCASE("run all tasks")
+        {
+            std::atomic<std::size_t> count{0};
+
+            vfs::task_group group(executor);
+            for ([[maybe_unused]] const auto _ : std::views::iota(0, 10000))
+            {
+                group.submit([&count](const std::stop_token&) { count += 1; });
+            }
+            group.wait();
+
+            CHECK_EQ(count.load(), 10000);
+            CHECK_FALSE(group.is_running());
+        }
+
+        SUBCASE("submit from a task")
+        {
+            std::atomic<std::size_t> count{0};
+
+            vfs::task_group group(executor);
+            group.submit(
+                [&group, &count](const std::stop_token&)
+                {
+                    for ([[maybe_unused]] const auto _ : std::views::iota(0, 100))
+                    {
+                        group.submit([&count](const std::stop_token&) { count += 1; });
+                    }
+                });
+
+            // the nested tasks are counted before the outer one finishes
+            group.wait();
+
+            CHECK_EQ(count.load(), 100);
+        }
+
+        SUBCASE("cancel")
+        {
+            std::atomic<bool> started{false};
+            std::atomic<bool> stopped{false};
+
+            vfs::task_group group(executor);
+            group.submit(
+                [&started, &stopped](const std::stop_token& stoken)
+                {
+                    started = true;
+                    while (!stoken.stop_requested())
+                    {
+                        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                    }
+                    stopped = true;
+                });
+
+            while (!started)
+            {
+                std::this_thread::yield();
+            }
+            CHECK(group.is_running());
+
+            group.cancel();
+            group.wait();
+
+            CHECK(stopped);
+            CHECK_FALSE(group.is_running());
+
+            // new tasks get a new stop_token
+            std::atomic<bool> ran{false};
+            group.submit([&ran](const std::stop_token& stoken) { ran = !stoken.stop_requested(); });
+            group.wait();
+
+            CHECK(ran);
+        }
+
+        SUBCASE("shutdown")
+        {
+            std::atomic<std::size_t> count{0};
+
+            vfs::task_group group(executor);
+            group.submit(
+                [&group, &count](const std::stop_token& stoken)
+                {
+                    while (!stoken.stop_requested())
+                    {
+                        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                    }
+
+                    // like a load queueing a refresh once it is done
+                    group.submit([&count](const std::stop_token&) { count += 1; });
+                });
+
+            group.shutdown();
+            group.wait();
+
+            CHECK_EQ(count.load(), 0);
+            CHECK_FALSE(group.is_running());
+
+            group.submit([&count](const std::stop_token&) { count += 1; });
+            CHECK_FALSE(group.is_running());
+            CHECK_EQ(count.load(), 0);
+        }
+    }
+}
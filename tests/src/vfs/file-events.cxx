@@ -0,0 +1,213 @@
+/**
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <format>
+#include <ranges>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include <cstdint>
+
+#include <doctest/doctest.h>
+
+#include "vfs/file-events.hxx"
+
+using event_type = vfs::file_events::event_type;
+
+static bool
+contains(const std::vector<std::string>& names, const std::string& name)
+{
+    return std::ranges::contains(names, name);
+}
+
+TEST_SUITE("vfs::file_events" * doctest::description(""))
+{
+    TEST_CASE("created then deleted is only a delete")
+    {
+        vfs::file_events events;
+        events.push(event_type::created, "tmp.o");
+        events.push(event_type::changed, "tmp.o");
+        events.push(event_type::deleted, "tmp.o");
+        CHECK_FALSE(events.empty());
+
+        const auto batch = events.take();
+        CHECK(events.empty());
+        CHECK_EQ(batch.events, 3);
+        CHECK(batch.created.empty());
+        CHECK(batch.changed.empty());
+        CHECK_EQ(batch.deleted, std::vector<std::string>{"tmp.o"});
+    }
+
+    TEST_CASE("repeated changes are one change")
+    {
+        vfs::file_events events;
+        for ([[maybe_unused]] const auto _ : std::views::iota(0, 100))
+        {
+            events.push(event_type::changed, "log.txt");
+        }
+
+        const auto batch = events.take();
+        CHECK_EQ(batch.events, 100);
+        CHECK_EQ(batch.changed, std::vector<std::string>{"log.txt"});
+    }
+
+    TEST_CASE("deleted then created is a create")
+    {
+        vfs::file_events events;
+        events.push(event_type::changed, "a");
+        events.push(event_type::deleted, "a");
+        events.push(event_type::created, "a");
+        events.push(event_type::changed, "a");
+
+        const auto batch = events.take();
+        CHECK(batch.deleted.empty());
+        CHECK(batch.changed.empty());
+        CHECK_EQ(batch.created, std::vector<std::string>{"a"});
+    }
+
+    TEST_CASE("renames")
+    {
+        SUBCASE("a change moves to the new name")
+        {
+            vfs::file_events events;
+            events.push(event_type::changed, "a");
+            events.push(event_type::renamed, "a", "b");
+
+            const auto batch = events.take();
+            REQUIRE_EQ(batch.renamed.size(), 1);
+            CHECK_EQ(batch.renamed[0].first, "a");
+            CHECK_EQ(batch.renamed[0].second, "b");
+            CHECK_EQ(batch.changed, std::vector<std::string>{"b"});
+        }
+
+        SUBCASE("a rename replaces a pending delete of the new name")
+        {
+            vfs::file_events events;
+            events.push(event_type::deleted, "b");
+            events.push(event_type::renamed, "a", "b");
+
+            const auto batch = events.take();
+            CHECK_EQ(batch.renamed.size(), 1);
+            CHECK(batch.deleted.empty());
+        }
+
+        SUBCASE("a created file that is renamed is a create of the new name")
+        {
+            vfs::file_events events;
+            events.push(event_type::created, "a.part");
+            events.push(event_type::renamed, "a.part", "a");
+
+            const auto batch = events.take();
+            CHECK(batch.renamed.empty());
+            CHECK_EQ(batch.created, std::vector<std::string>{"a"});
+            CHECK_EQ(batch.deleted, std::vector<std::string>{"a.part"});
+        }
+
+        SUBCASE("renames keep their order")
+        {
+            vfs::file_events events;
+            events.push(event_type::renamed, "a", "b");
+            events.push(event_type::renamed, "b", "c");
+
+            const auto batch = events.take();
+            REQUIRE_EQ(batch.renamed.size(), 2);
+            CHECK_EQ(batch.renamed[0].first, "a");
+            CHECK_EQ(batch.renamed[1].first, "b");
+        }
+    }
+
+    TEST_CASE("a full ring spills without losing events")
+    {
+        vfs::file_events events(8);
+        for (const auto i : std::views::iota(0, 100))
+        {
+            events.push(event_type::created, std::format("{}", i));
+        }
+        // order is kept across the ring and the spill
+        events.push(event_type::deleted, "0");
+
+        const auto batch = events.take();
+        CHECK(events.empty());
+        CHECK_EQ(batch.events, 101);
+        CHECK_EQ(batch.created.size(), 99);
+        CHECK_EQ(batch.deleted, std::vector<std::string>{"0"});
+
+        // the ring is usable after a spill
+        events.push(event_type::changed, "x");
+        CHECK_EQ(events.take().changed, std::vector<std::string>{"x"});
+    }
+
+    TEST_CASE("concurrent producers")
+    {
+        static constexpr std::int32_t threads = 4;
+        static constexpr std::int32_t count = 5000;
+
+        vfs::file_events events(64);
+        std::vector<std::string> created;
+
+        {
+            std::vector<std::jthread> producers;
+            for (const auto t : std::views::iota(0, threads))
+            {
+                producers.emplace_back(
+                    [&events, t]()
+                    {
+                        for (const auto i : std::views::iota(0, count))
+                        {
+                            events.push(event_type::created, std::format("{}-{}", t, i));
+                        }
+                    });
+            }
+
+            // consume while producing
+            while (created.size() < static_cast<std::size_t>(threads * count))
+            {
+                auto batch = events.take();
+                created.insert(created.cend(), batch.created.cbegin(), batch.created.cend());
+            }
+        }
+
+        CHECK(events.empty());
+        std::ranges::sort(created);
+        CHECK(std::ranges::adjacent_find(created) == created.cend());
+        CHECK(contains(created, "0-0"));
+        CHECK(contains(created, std::format("{}-{}", threads - 1, count - 1)));
+    }
+
+    TEST_CASE("the interval follows the event rate")
+    {
+        vfs::file_events events;
+        CHECK_EQ(events.interval(), vfs::file_events::MIN_INTERVAL);
+
+        // far more than BUSY_RATE events per second
+        for (const auto i : std::views::iota(0, 10000))
+        {
+            events.push(event_type::changed, std::format("{}", i % 10));
+        }
+        const auto batch = events.take();
+        CHECK_EQ(batch.changed.size(), 10);
+        CHECK_GT(events.interval(), vfs::file_events::MIN_INTERVAL);
+
+        // quiet again
+        for ([[maybe_unused]] const auto _ : std::views::iota(0, 8))
+        {
+            std::ignore = events.take();
+        }
+        CHECK_EQ(events.interval(), vfs::file_events::MIN_INTERVAL);
+    }
+}
@@ -0,0 +1,258 @@
+/**
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <format>
+#include <memory>
+#include <ranges>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <cstdint>
+
+#include <sys/stat.h>
+
+#include <doctest/doctest.h>
+
+#include <ztd/ztd.hxx>
+
+#include "vfs/file-table.hxx"
+#include "vfs/file.hxx"
+#include "vfs/mime-type.hxx"
+
+#include "vfs/linux/dir-scanner.hxx"
+#include "vfs/linux/statx.hxx"
+
+static std::shared_ptr<vfs::file>
+make_file(const std::string_view name, const std::uint64_t size,
+          const std::string_view mime_type = "text/plain")
+{
+    struct ::statx stat{};
+    stat.stx_mode = S_IFREG | 0644;
+    stat.stx_ino = size + 1;
+    stat.stx_size = size;
+    stat.stx_mtime.tv_sec = 1000;
+
+    return vfs::file::create(std::format("/tmp/{}", name),
+                             vfs::linux::statx(stat),
+                             vfs::mime_type::create_from_type(mime_type));
+}
+
+TEST_SUITE("vfs::file_table" * doctest::description(""))
+{
+    TEST_CASE("insert and find")
+    {
+        vfs::file_table table;
+        CHECK(table.empty());
+
+        const auto a = table.insert(make_file("a.txt", 10));
+        const auto b = table.insert(make_file("b.png", 20, "image/png"));
+
+        CHECK_EQ(table.size(), 2);
+        CHECK_EQ(a.index, 0);
+        CHECK_EQ(b.index, 1);
+
+        const auto found = table.find("b.png");
+        REQUIRE(found.has_value());
+        CHECK_EQ(*found, b);
+        CHECK_EQ(table.name(b), "b.png");
+        CHECK_EQ(table.file(b)->size(), u64(20));
+        CHECK_EQ(table.file(b)->name(), "b.png");
+
+        CHECK_FALSE(table.find("c.txt").has_value());
+    }
+
+    TEST_CASE("insert replaces a file with the same name")
+    {
+        vfs::file_table table;
+        const auto a = table.insert(make_file("a.txt", 1));
+        const auto replaced = table.insert(make_file("a.txt", 2));
+
+        CHECK_EQ(a, replaced);
+        CHECK_EQ(table.size(), 1);
+        CHECK_EQ(table.file(a)->size(), u64(2));
+
+        // the name key now points into the new file, the old one is gone
+        CHECK_EQ(*table.find("a.txt"), a);
+    }
+
+    TEST_CASE("erase keeps other handles stable")
+    {
+        vfs::file_table table;
+        const auto a = table.insert(make_file("a.txt", 1));
+        const auto b = table.insert(make_file("b.txt", 2));
+        const auto c = table.insert(make_file("c.txt", 3));
+
+        table.erase(b);
+
+        CHECK_EQ(table.size(), 2);
+        CHECK_FALSE(table.contains(b));
+        CHECK_EQ(table.file(b), nullptr);
+        CHECK_FALSE(table.find("b.txt").has_value());
+
+        CHECK(table.contains(a));
+        CHECK(table.contains(c));
+        CHECK_EQ(table.name(a), "a.txt");
+        CHECK_EQ(table.name(c), "c.txt");
+
+        // the free slot is reused with a new generation
+        const auto d = table.insert(make_file("d.txt", 4));
+        CHECK_EQ(d.index, b.index);
+        CHECK_NE(d, b);
+        CHECK_FALSE(table.contains(b));
+        CHECK(table.contains(d));
+
+        CHECK_EQ(table.files().size(), 3);
+        CHECK_EQ(table.handles().size(), 3);
+    }
+
+    TEST_CASE("rename keeps the handle")
+    {
+        vfs::file_table table;
+        const auto a = table.insert(make_file("a.txt", 1));
+        const auto b = table.insert(make_file("b.txt", 2));
+
+        const auto from = table.file(a);
+        table.rename(a, from->renamed("/tmp/c.txt"));
+
+        // the old vfs::file is left as is
+        CHECK_EQ(from->name(), "a.txt");
+
+        CHECK(table.contains(a));
+        CHECK_EQ(table.name(a), "c.txt");
+        CHECK_EQ(table.file(a)->name(), "c.txt");
+        CHECK_EQ(*table.find("c.txt"), a);
+        CHECK_FALSE(table.find("a.txt").has_value());
+
+        // renaming over an existing file replaces it
+        table.rename(a, table.file(a)->renamed("/tmp/b.txt"));
+
+        CHECK_EQ(table.size(), 1);
+        CHECK_FALSE(table.contains(b));
+        CHECK_EQ(*table.find("b.txt"), a);
+        CHECK_EQ(table.file(a)->size(), u64(1));
+    }
+
+    TEST_CASE("lookup survives slot reuse")
+    {
+        vfs::file_table table;
+
+        const auto name = [](const std::size_t i) { return std::format("{:0>8}", i); };
+
+        for (const auto i : std::views::iota(0uz, 2000uz))
+        {
+            table.insert(make_file(name(i), i));
+        }
+
+        for (const auto i : std::views::iota(0uz, 2000uz))
+        {
+            if (i % 4 != 0)
+            {
+                table.erase(*table.find(name(i)));
+            }
+        }
+
+        CHECK_EQ(table.size(), 500);
+        for (const auto i : std::views::iota(0uz, 2000uz))
+        {
+            const auto found = table.find(name(i));
+            if (i % 4 == 0)
+            {
+                REQUIRE(found.has_value());
+                CHECK_EQ(table.name(*found), name(i));
+                CHECK_EQ(table.file(*found)->size(), u64(i));
+            }
+            else
+            {
+                CHECK_FALSE(found.has_value());
+            }
+        }
+
+        // refill the free slots under new names
+        for (const auto i : std::views::iota(2000uz, 3500uz))
+        {
+            table.insert(make_file(name(i), i));
+        }
+
+        CHECK_EQ(table.size(), 2000);
+        CHECK_EQ(table.handles().back().index, 1999);
+        for (const auto i : std::views::iota(2000uz, 3500uz))
+        {
+            const auto found = table.find(name(i));
+            REQUIRE(found.has_value());
+            CHECK_EQ(table.name(*found), name(i));
+        }
+    }
+
+    TEST_CASE("diff against a directory listing")
+    {
+        vfs::file_table table;
+        table.insert(make_file("same.txt", 1));
+        table.insert(make_file("modified.txt", 2));
+        table.insert(make_file("replaced.txt", 3));
+        table.insert(make_file("deleted.txt", 4));
+
+        const auto entry = [](const std::string_view name, const std::uint64_t ino,
+                              const std::int64_t mtime)
+        {
+            struct ::statx stat{};
+            stat.stx_mode = S_IFREG | 0644;
+            stat.stx_ino = ino;
+            stat.stx_mtime.tv_sec = mtime;
+            return vfs::linux::dir_scanner::entry{std::string(name), vfs::linux::statx(stat)};
+        };
+
+        // make_file uses size + 1 as the inode and 1000 as the mtime
+        const std::vector<vfs::linux::dir_scanner::entry> first{
+            entry("same.txt", 2, 1000),
+            entry("modified.txt", 3, 2000),
+        };
+        const std::vector<vfs::linux::dir_scanner::entry> second{
+            entry("replaced.txt", 99, 1000),
+            entry("created.txt", 6, 1000),
+        };
+
+        // fed in chunks like the dir scanner
+        vfs::file_table::diff diff;
+        table.diff_entries(diff, first);
+        table.diff_entries(diff, second);
+        table.diff_finish(diff);
+
+        CHECK_EQ(diff.created, std::vector<std::string>{"created.txt"});
+        const std::vector<std::string> changed{"modified.txt", "replaced.txt"};
+        CHECK_EQ(diff.changed, changed);
+        CHECK_EQ(diff.deleted, std::vector<std::string>{"deleted.txt"});
+
+        vfs::file_table::diff unchanged;
+        table.diff_entries(unchanged, std::vector{entry("same.txt", 2, 1000)});
+        CHECK(unchanged.changed.empty());
+    }
+
+    TEST_CASE("clear")
+    {
+        vfs::file_table table;
+        const auto a = table.insert(make_file("a.txt", 1));
+
+        table.clear();
+
+        CHECK(table.empty());
+        CHECK_FALSE(table.contains(a));
+        CHECK_FALSE(table.find("a.txt").has_value());
+
+        const auto b = table.insert(make_file("a.txt", 1));
+        CHECK_EQ(b.index, 0);
+        CHECK_NE(a, b);
+    }
+}
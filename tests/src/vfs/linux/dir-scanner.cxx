@@ -0,0 +1,169 @@
+/**
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <filesystem>
+#include <format>
+#include <ranges>
+#include <string>
+#include <vector>
+
+#include <doctest/doctest.h>
+
+#include "vfs/linux/dir-scanner.hxx"
+#include "vfs/linux/statx-batch.hxx"
+#include "vfs/linux/statx.hxx"
+
+#include "utils.hxx"
+
+TEST_SUITE("vfs::linux::dir_scanner" * doctest::description(""))
+{
+    const auto root = std::filesystem::temp_directory_path() / PACKAGE_NAME / "dir-scanner";
+
+    TEST_CASE("vfs::linux::dir_scanner")
+    {
+        if (std::filesystem::exists(root))
+        {
+            std::filesystem::remove_all(root);
+        }
+        std::filesystem::create_directories(root);
+        REQUIRE(std::filesystem::exists(root));
+
+        SUBCASE("missing directory")
+        {
+            auto scanner = vfs::linux::dir_scanner::create(root / "missing");
+            CHECK_FALSE(scanner);
+        }
+
+        SUBCASE("not a directory")
+        {
+            create_file(root / "file");
+
+            auto scanner = vfs::linux::dir_scanner::create(root / "file");
+            CHECK_FALSE(scanner);
+        }
+
+        SUBCASE("empty directory")
+        {
+            auto scanner = vfs::linux::dir_scanner::create(root);
+            REQUIRE(scanner);
+
+            std::vector<vfs::linux::dir_scanner::entry> entries;
+            CHECK_EQ(scanner->next(entries), 0);
+            CHECK(entries.empty());
+        }
+
+        SUBCASE("entries")
+        {
+            create_file(root / "a.txt", "a");
+            create_file(root / "b.txt", "bb");
+            std::filesystem::create_directory(root / "dir");
+            std::filesystem::create_symlink("missing", root / "link");
+
+            auto scanner = vfs::linux::dir_scanner::create(root);
+            REQUIRE(scanner);
+
+            std::vector<vfs::linux::dir_scanner::entry> entries;
+            while (scanner->next(entries) != 0)
+            {
+            }
+            REQUIRE_EQ(entries.size(), 4);
+
+            std::ranges::sort(entries, {}, &vfs::linux::dir_scanner::entry::name);
+
+            CHECK_EQ(entries[0].name, "a.txt");
+            CHECK(entries[0].stat.is_regular_file());
+            CHECK_EQ(entries[0].stat.size(), 1);
+
+            CHECK_EQ(entries[1].name, "b.txt");
+            CHECK(entries[1].stat.is_regular_file());
+            CHECK_EQ(entries[1].stat.size(), 2);
+
+            CHECK_EQ(entries[2].name, "dir");
+            CHECK(entries[2].stat.is_directory());
+
+            // symlinks are not followed
+            CHECK_EQ(entries[3].name, "link");
+            CHECK(entries[3].stat.is_symlink());
+        }
+
+        SUBCASE("many entries")
+        {
+            constexpr auto count = 10000uz;
+            for (const auto i : std::views::iota(0uz, count))
+            {
+                create_file(root / std::format("file-{:05}", i));
+            }
+
+            auto scanner = vfs::linux::dir_scanner::create(root);
+            REQUIRE(scanner);
+
+            std::vector<vfs::linux::dir_scanner::entry> entries;
+            while (scanner->next(entries) != 0)
+            {
+            }
+            CHECK_EQ(entries.size(), count);
+        }
+
+        std::filesystem::remove_all(root);
+    }
+
+    TEST_CASE("vfs::linux::statx_batch")
+    {
+        if (std::filesystem::exists(root))
+        {
+            std::filesystem::remove_all(root);
+        }
+        create_file(root / "a.txt", "a");
+        create_file(root / "b.txt", "bb");
+
+        auto scanner = vfs::linux::dir_scanner::create(root);
+        REQUIRE(scanner);
+
+        const std::vector<std::string> names = {"a.txt", "missing", "b.txt"};
+
+        vfs::linux::statx_batch batch;
+        const auto results =
+            batch.run(scanner->fd(), names, vfs::linux::statx::symlink::no_follow);
+        REQUIRE_EQ(results.size(), names.size());
+
+        REQUIRE(results[0]);
+        CHECK_EQ(results[0]->size(), 1);
+
+        CHECK_FALSE(results[1]);
+
+        REQUIRE(results[2]);
+        CHECK_EQ(results[2]->size(), 2);
+
+        std::filesystem::remove_all(root);
+    }
+
+    TEST_CASE("vfs::linux::statx")
+    {
+        SUBCASE("missing")
+        {
+            auto stat = vfs::linux::statx::create(root / "missing");
+            CHECK_FALSE(stat);
+        }
+
+        SUBCASE("perms_fancy")
+        {
+            auto stat = vfs::linux::statx::create("/tmp");
+            REQUIRE(stat);
+            CHECK(stat->is_directory());
+            CHECK_EQ(stat->perms_fancy(), "drwxrwxrwt");
+        }
+    }
+}
@@ -0,0 +1,109 @@
+/**
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <array>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <doctest/doctest.h>
+
+#include "utils.hxx"
+
+#include "vfs/mime-type/mime-apps.hxx"
+
+TEST_SUITE("vfs::detail::mime_type::mime_apps" * doctest::description(""))
+{
+    using namespace vfs::detail::mime_type;
+
+    const auto root = std::filesystem::temp_directory_path() / PACKAGE_NAME / "mime-apps";
+
+    TEST_CASE("mime_apps")
+    {
+        if (std::filesystem::exists(root))
+        {
+            std::filesystem::remove_all(root);
+        }
+
+        const auto config = root / "config";
+        const auto user = root / "user" / "applications";
+        const auto system = root / "system" / "applications";
+        const auto dirs = std::array{config, user, system};
+
+        create_file(config / "mimeapps.list",
+                    "[Default Applications]\n"
+                    "text/plain=missing.desktop;editor.desktop;\n"
+                    "\n"
+                    "[Added Associations]\n"
+                    "text/plain=viewer.desktop;\n"
+                    "\n"
+                    "[Removed Associations]\n"
+                    "text/plain=pager.desktop;\n"
+                    "image/png=viewer.desktop;\n");
+        create_file(user / "mimeapps.list",
+                    "[Default Applications]\n"
+                    "text/plain=other.desktop;\n"
+                    "image/png=paint.desktop;\n");
+        create_file(system / "mimeinfo.cache",
+                    "[MIME Cache]\n"
+                    "text/plain=pager.desktop;editor.desktop;other.desktop;\n"
+                    "image/png=viewer.desktop;paint.desktop;\n"
+                    "audio/ogg=missing.desktop;\n");
+
+        const auto installed = [](const std::string_view desktop_id)
+        { return desktop_id != "missing.desktop"; };
+
+        const auto index = mime_apps::create(dirs, installed);
+
+        SUBCASE("default is the first installed app of the most important dir")
+        {
+            const auto* entry = index.lookup("text/plain");
+            REQUIRE(entry != nullptr);
+            CHECK_EQ(entry->default_app, "editor.desktop");
+        }
+
+        SUBCASE("associations in order of precedence, default first")
+        {
+            const auto* entry = index.lookup("text/plain");
+            REQUIRE(entry != nullptr);
+            CHECK_EQ(entry->apps,
+                     std::vector<std::string>{"editor.desktop", "viewer.desktop", "other.desktop"});
+        }
+
+        SUBCASE("removed associations hide less important dirs")
+        {
+            const auto* entry = index.lookup("image/png");
+            REQUIRE(entry != nullptr);
+            CHECK_EQ(entry->default_app, "paint.desktop");
+            CHECK_EQ(entry->apps, std::vector<std::string>{"paint.desktop"});
+        }
+
+        SUBCASE("apps that are not installed are skipped")
+        {
+            const auto* entry = index.lookup("audio/ogg");
+            REQUIRE(entry != nullptr);
+            CHECK_FALSE(entry->default_app.has_value());
+            CHECK(entry->apps.empty());
+        }
+
+        SUBCASE("unknown type")
+        {
+            CHECK_EQ(index.lookup("video/x-nothing"), nullptr);
+        }
+
+        std::filesystem::remove_all(root);
+    }
+}
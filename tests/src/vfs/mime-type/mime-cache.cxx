@@ -0,0 +1,125 @@
+/**
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <array>
+#include <filesystem>
+#include <span>
+#include <string_view>
+
+#include <doctest/doctest.h>
+
+#include "vfs/mime-type/mime-cache.hxx"
+
+TEST_SUITE("vfs::detail::mime_type::mime_cache" * doctest::description(""))
+{
+    using namespace vfs::detail::mime_type;
+
+    TEST_CASE("open missing file")
+    {
+        const auto cache = mime_cache::open("/nonexistent/mime/mime.cache");
+
+        CHECK_FALSE(cache.has_value());
+    }
+
+    TEST_CASE("open invalid file")
+    {
+        // smaller than the header
+        const auto cache = mime_cache::open("/dev/null");
+
+        CHECK_FALSE(cache.has_value());
+    }
+
+    TEST_CASE("mime_database")
+    {
+        const auto paths = std::array{std::filesystem::path("/usr/share/mime/mime.cache")};
+        const auto database = mime_database(paths);
+
+        SUBCASE("empty")
+        {
+            CHECK(database.lookup("").empty());
+        }
+
+        SUBCASE("no ext")
+        {
+            CHECK(database.lookup("file").empty());
+        }
+
+        SUBCASE("suffix")
+        {
+            CHECK_EQ(database.lookup("file.jpg"), "image/jpeg");
+            CHECK_EQ(database.lookup("file.jpeg"), "image/jpeg");
+            CHECK_EQ(database.lookup("file.png"), "image/png");
+            CHECK_EQ(database.lookup("file.txt"), "text/plain");
+        }
+
+        SUBCASE("suffix upper case")
+        {
+            CHECK_EQ(database.lookup("FILE.JPG"), "image/jpeg");
+            CHECK_EQ(database.lookup("File.Png"), "image/png");
+        }
+
+        SUBCASE("longest suffix")
+        {
+            CHECK_EQ(database.lookup("file.tar.gz"), "application/x-compressed-tar");
+            CHECK_EQ(database.lookup("file.gz"), "application/gzip");
+        }
+
+        SUBCASE("literal")
+        {
+            CHECK_EQ(database.lookup("Makefile"), "text/x-makefile");
+        }
+
+        SUBCASE("glob")
+        {
+            CHECK_EQ(database.lookup("README.developers"), "text/x-readme");
+        }
+
+        SUBCASE("magic extent")
+        {
+            CHECK_GT(database.magic_extent(), 0);
+        }
+
+        SUBCASE("magic")
+        {
+            const auto sniff = [&database](const std::string_view data)
+            { return database.sniff(std::as_bytes(std::span(data))); };
+
+            CHECK_EQ(sniff("\x89PNG\r\n\x1a\n"), "image/png");
+            CHECK_EQ(sniff("%PDF-1.7\n"), "application/pdf");
+            CHECK_EQ(sniff("#!/bin/sh\necho\n"), "application/x-shellscript");
+        }
+
+        SUBCASE("magic no match")
+        {
+            CHECK(database.sniff({}).empty());
+            CHECK(database.sniff(std::as_bytes(std::span(std::string_view("\x01\x02\x03")))).empty());
+        }
+
+        SUBCASE("not stale")
+        {
+            CHECK_FALSE(database.is_stale());
+        }
+    }
+
+    TEST_CASE("mime_database missing file")
+    {
+        const auto paths = std::array{std::filesystem::path("/nonexistent/mime/mime.cache")};
+        const auto database = mime_database(paths);
+
+        CHECK(database.lookup("file.jpg").empty());
+        CHECK_EQ(database.magic_extent(), 0);
+        CHECK_FALSE(database.is_stale());
+    }
+}
@@ -0,0 +1,140 @@
+/**
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <array>
+#include <chrono>
+#include <filesystem>
+#include <string_view>
+
+#include <doctest/doctest.h>
+
+#include "utils.hxx"
+
+#include "vfs/mime-type/mime-info.hxx"
+
+TEST_SUITE("vfs::detail::mime_type::mime_info" * doctest::description(""))
+{
+    using namespace vfs::detail::mime_type;
+
+    const auto root = std::filesystem::temp_directory_path() / PACKAGE_NAME / "mime-info";
+
+    TEST_CASE("mime_info")
+    {
+        if (std::filesystem::exists(root))
+        {
+            std::filesystem::remove_all(root);
+        }
+
+        const auto user = root / "user" / "mime";
+        const auto system = root / "system" / "mime";
+        const auto index = root / "mime-info";
+        const auto dirs = std::array{user, system};
+
+        create_file(system / "mime.cache", "cache");
+        create_file(system / "generic-icons", "image/x-test:image-x-generic\n");
+        create_file(system / "icons", "image/x-icon-test:image-x-icon-test\n");
+        create_file(system / "subclasses", "image/x-child image/x-test\n");
+        create_file(system / "image" / "x-test.xml",
+                    R"(<?xml version="1.0" encoding="utf-8"?>
+<mime-type xmlns="http://www.freedesktop.org/standards/shared-mime-info" type="image/x-test">
+  <comment xml:lang="de">Testbild</comment>
+  <comment>Test image</comment>
+  <generic-icon name="image-x-generic"/>
+</mime-type>
+)");
+        create_file(system / "packages" / "test.xml", "<mime-info/>");
+
+        create_file(user / "image" / "x-test.xml",
+                    R"(<?xml version="1.0" encoding="utf-8"?>
+<mime-type xmlns="http://www.freedesktop.org/standards/shared-mime-info" type="image/x-test">
+  <comment>User test image</comment>
+</mime-type>
+)");
+
+        REQUIRE_EQ(mime_info::save(index, dirs), std::error_code{});
+
+        SUBCASE("lookup")
+        {
+            const auto info = mime_info::open(index, dirs);
+            REQUIRE(info);
+
+            const auto entry = info->lookup("image/x-test");
+            REQUIRE(entry);
+            // the user dir comes first
+            CHECK_EQ(entry->description, "User test image");
+            CHECK_EQ(entry->icon, "image-x-generic");
+        }
+
+        SUBCASE("icons")
+        {
+            const auto info = mime_info::open(index, dirs);
+            REQUIRE(info);
+
+            const auto entry = info->lookup("image/x-icon-test");
+            REQUIRE(entry);
+            CHECK(entry->description.empty());
+            CHECK_EQ(entry->icon, "image-x-icon-test");
+        }
+
+        SUBCASE("parent icon")
+        {
+            const auto info = mime_info::open(index, dirs);
+            REQUIRE(info);
+
+            const auto entry = info->lookup("image/x-child");
+            REQUIRE(entry);
+            CHECK_EQ(entry->icon, "image-x-generic");
+        }
+
+        SUBCASE("missing type")
+        {
+            const auto info = mime_info::open(index, dirs);
+            REQUIRE(info);
+
+            CHECK_FALSE(info->lookup("image/x-missing").has_value());
+        }
+
+        SUBCASE("packages are skipped")
+        {
+            const auto info = mime_info::open(index, dirs);
+            REQUIRE(info);
+
+            CHECK_FALSE(info->lookup("packages/test").has_value());
+        }
+
+        SUBCASE("stale after update-mime-database")
+        {
+            std::filesystem::last_write_time(system / "mime.cache",
+                                             std::filesystem::last_write_time(system / "mime.cache") +
+                                                 std::chrono::seconds(10));
+
+            CHECK_FALSE(mime_info::open(index, dirs).has_value());
+        }
+
+        SUBCASE("stale with different dirs")
+        {
+            const auto other = std::array{system};
+
+            CHECK_FALSE(mime_info::open(index, other).has_value());
+        }
+    }
+
+    TEST_CASE("mime_info missing index")
+    {
+        const auto dirs = std::array{root / "missing"};
+
+        CHECK_FALSE(mime_info::open(root / "missing-index", dirs).has_value());
+    }
+}
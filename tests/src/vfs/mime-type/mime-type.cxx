@@ -0,0 +1,77 @@
+/**
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <thread>
+#include <vector>
+
+#include <doctest/doctest.h>
+
+#include "vfs/mime-type.hxx"
+
+TEST_SUITE("vfs::mime_type" * doctest::description(""))
+{
+    TEST_CASE("unknown is id 0")
+    {
+        const auto& mime_type = vfs::mime_type::create_from_type(vfs::constants::mime_type::unknown);
+        CHECK_EQ(mime_type->id(), vfs::mime_type::unknown_id);
+        CHECK_EQ(vfs::mime_type::from_id(vfs::mime_type::unknown_id)->type(),
+                 vfs::constants::mime_type::unknown);
+    }
+
+    TEST_CASE("types are interned")
+    {
+        const auto& a = vfs::mime_type::create_from_type("image/png");
+        const auto& b = vfs::mime_type::create_from_type("image/png");
+        const auto& c = vfs::mime_type::create_from_type("text/plain");
+
+        CHECK_EQ(a.get(), b.get());
+        CHECK_EQ(a->id(), b->id());
+        CHECK_NE(a->id(), c->id());
+        CHECK_EQ(vfs::mime_type::from_id(a->id()).get(), a.get());
+    }
+
+    TEST_CASE("predicates")
+    {
+        const auto& png = vfs::mime_type::create_from_type("image/png");
+        CHECK(png->is_image());
+        CHECK(png->is_media());
+        CHECK_FALSE(png->is_text());
+
+        const auto& text = vfs::mime_type::create_from_type("text/plain");
+        CHECK(text->is_text());
+        CHECK_FALSE(text->is_media());
+    }
+
+    TEST_CASE("concurrent interning")
+    {
+        std::vector<std::thread> threads;
+        std::vector<vfs::mime_type::id_type> ids(8);
+        for (std::size_t i = 0; i < ids.size(); ++i)
+        {
+            threads.emplace_back(
+                [&ids, i]
+                { ids[i] = vfs::mime_type::create_from_type("application/x-intern-test")->id(); });
+        }
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+
+        for (const auto id : ids)
+        {
+            CHECK_EQ(id, ids.front());
+        }
+    }
+}
@@ -22,8 +22,9 @@
  */
 
 #include <filesystem>
-#include <stop_token>
 #include <thread>
+#include <utility>
+#include <vector>
 
 #include <doctest/doctest.h>
 
@@ -120,7 +121,7 @@ TEST_SUITE("notify-cpp" * doctest::description(""))
         notifier.signal_move().connect([&](const auto&) { counter.move++; });
         // clang-format on
 
-        std::jthread thread([&notifier](const std::stop_token& stoken) { notifier.run(stoken); });
+        notifier.start();
 
         REQUIRE_EQ(counter.access, 0);
         REQUIRE_EQ(counter.modify, 0);
@@ -239,8 +240,192 @@ TEST_SUITE("notify-cpp" * doctest::description(""))
             }
         }
 
-        thread.request_stop();
-        thread.join();
+        notifier.stop();
+
+        if (std::filesystem::exists(test_path))
+        {
+            std::filesystem::remove_all(test_path);
+        }
+    }
+
+    TEST_CASE("notify-cpp shared watch")
+    {
+        const auto test_path = root / "shared";
+        if (std::filesystem::exists(test_path))
+        {
+            std::filesystem::remove_all(test_path);
+        }
+        std::filesystem::create_directories(test_path);
+
+        using namespace std::chrono_literals;
+
+        std::int32_t create_a = 0;
+        std::int32_t create_b = 0;
+        std::int32_t modify_a = 0;
+        std::int32_t modify_b = 0;
+
+        // same inode, different masks
+        auto notifier_a = notify::controller(test_path, {notify::event::create});
+        notifier_a.signal_create().connect([&](const auto&) { create_a++; });
+        notifier_a.signal_modify().connect([&](const auto&) { modify_a++; });
+        notifier_a.start();
+
+        auto notifier_b =
+            notify::controller(test_path, {notify::event::create, notify::event::modify});
+        notifier_b.signal_create().connect([&](const auto&) { create_b++; });
+        notifier_b.signal_modify().connect([&](const auto&) { modify_b++; });
+        notifier_b.start();
+
+        create_file(test_path / "a.test");
+        std::this_thread::sleep_for(50ms);
+
+        CHECK_EQ(create_a, 1);
+        CHECK_EQ(create_b, 1);
+        CHECK_EQ(modify_a, 0);
+        CHECK_EQ(modify_b, 1);
+
+        notifier_b.stop();
+
+        create_file(test_path / "b.test");
+        std::this_thread::sleep_for(50ms);
+
+        CHECK_EQ(create_a, 2);
+        CHECK_EQ(create_b, 1);
+        CHECK_EQ(modify_a, 0);
+        CHECK_EQ(modify_b, 1);
+
+        notifier_a.stop();
+
+        if (std::filesystem::exists(test_path))
+        {
+            std::filesystem::remove_all(test_path);
+        }
+    }
+
+    TEST_CASE("notify-cpp rename")
+    {
+        const auto test_path = root / "rename";
+        const auto other_path = root / "rename-other";
+        for (const auto& path : {test_path, other_path})
+        {
+            if (std::filesystem::exists(path))
+            {
+                std::filesystem::remove_all(path);
+            }
+            std::filesystem::create_directories(path);
+        }
+
+        using namespace std::chrono_literals;
+
+        std::int32_t moved_from = 0;
+        std::int32_t moved_to = 0;
+        std::int32_t move = 0;
+        std::vector<std::pair<std::filesystem::path, std::filesystem::path>> renamed;
+
+        auto notifier =
+            notify::controller(test_path, {notify::event::moved_from, notify::event::moved_to});
+        notifier.signal_moved_from().connect([&](const auto&) { moved_from++; });
+        notifier.signal_moved_to().connect([&](const auto&) { moved_to++; });
+        notifier.signal_move().connect([&](const auto&) { move++; });
+        notifier.signal_rename().connect([&](const auto& from, const auto& to)
+                                         { renamed.emplace_back(from, to); });
+        notifier.start();
+
+        create_file(test_path / "a.test");
+        create_file(other_path / "b.test");
+        std::this_thread::sleep_for(50ms);
+
+        SUBCASE("rename inside the directory")
+        {
+            std::filesystem::rename(test_path / "a.test", test_path / "c.test");
+            std::this_thread::sleep_for(50ms);
+
+            REQUIRE_EQ(renamed.size(), 1);
+            CHECK_EQ(renamed[0].first, test_path / "a.test");
+            CHECK_EQ(renamed[0].second, test_path / "c.test");
+            CHECK_EQ(moved_from, 0);
+            CHECK_EQ(moved_to, 0);
+            CHECK_EQ(move, 2);
+        }
+
+        SUBCASE("move out of the directory")
+        {
+            std::filesystem::rename(test_path / "a.test", other_path / "a.test");
+            std::this_thread::sleep_for(50ms);
+
+            CHECK(renamed.empty());
+            CHECK_EQ(moved_from, 1);
+            CHECK_EQ(moved_to, 0);
+            CHECK_EQ(move, 1);
+        }
+
+        SUBCASE("move into the directory")
+        {
+            std::filesystem::rename(other_path / "b.test", test_path / "b.test");
+            std::this_thread::sleep_for(50ms);
+
+            CHECK(renamed.empty());
+            CHECK_EQ(moved_from, 0);
+            CHECK_EQ(moved_to, 1);
+            CHECK_EQ(move, 1);
+        }
+
+        notifier.stop();
+
+        for (const auto& path : {test_path, other_path})
+        {
+            if (std::filesystem::exists(path))
+            {
+                std::filesystem::remove_all(path);
+            }
+        }
+    }
+
+    TEST_CASE("notify-cpp fanotify backend")
+    {
+        const auto test_path = root / "fanotify";
+        if (std::filesystem::exists(test_path))
+        {
+            std::filesystem::remove_all(test_path);
+        }
+        std::filesystem::create_directories(test_path);
+
+        using namespace std::chrono_literals;
+
+        // without CAP_SYS_ADMIN this falls back to inotify, events must be the same
+        notify::set_backend(notify::backend::fanotify);
+
+        std::int32_t create = 0;
+        std::int32_t delete_sub = 0;
+
+        auto notifier =
+            notify::controller(test_path, {notify::event::create, notify::event::delete_sub});
+        notifier.signal_create().connect([&](const auto&) { create++; });
+        notifier.signal_delete().connect([&](const auto&) { delete_sub++; });
+        notifier.start();
+
+        notify::set_backend(notify::backend::inotify);
+
+        create_file(test_path / "a.test");
+        std::this_thread::sleep_for(50ms);
+
+        CHECK_EQ(create, 1);
+        CHECK_EQ(delete_sub, 0);
+
+        // only the new subdirectory is reported, not the file inside it
+        create_file(test_path / "sub" / "b.test");
+        std::this_thread::sleep_for(50ms);
+
+        CHECK_EQ(create, 2);
+        CHECK_EQ(delete_sub, 0);
+
+        std::filesystem::remove(test_path / "a.test");
+        std::this_thread::sleep_for(50ms);
+
+        CHECK_EQ(create, 2);
+        CHECK_EQ(delete_sub, 1);
+
+        notifier.stop();
 
         if (std::filesystem::exists(test_path))
         {
@@ -0,0 +1,252 @@
+/**
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <format>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+#include <cstdint>
+
+#include <sys/stat.h>
+
+#include <doctest/doctest.h>
+
+#include "vfs/file.hxx"
+#include "vfs/mime-type.hxx"
+#include "vfs/texture-cache.hxx"
+
+#include "vfs/linux/statx.hxx"
+
+static std::shared_ptr<vfs::file>
+make_file(const std::string_view name)
+{
+    struct ::statx stat{};
+    stat.stx_mode = S_IFREG | 0644;
+    stat.stx_mtime.tv_sec = 1000;
+
+    return vfs::file::create(std::format("/tmp/{}", name),
+                             vfs::linux::statx(stat),
+                             vfs::mime_type::create_from_type("image/png"));
+}
+
+static std::vector<std::shared_ptr<vfs::file>>
+make_files(const std::uint32_t count)
+{
+    std::vector<std::shared_ptr<vfs::file>> files;
+    for (std::uint32_t i = 0; i < count; ++i)
+    {
+        files.push_back(make_file(std::format("{}.png", i)));
+    }
+    return files;
+}
+
+// the cache only counts bytes, no texture is needed
+TEST_SUITE("vfs::texture_cache" * doctest::description(""))
+{
+    TEST_CASE("least recently used is evicted first")
+    {
+        const auto files = make_files(4);
+        vfs::texture_cache cache(300);
+
+        cache.insert({files[0].get(), 128}, nullptr, 100);
+        cache.insert({files[1].get(), 128}, nullptr, 100);
+        cache.insert({files[2].get(), 128}, nullptr, 100);
+
+        // 0 becomes the most recently used, then 2
+        (void)cache.get({files[2].get(), 128});
+        (void)cache.get({files[0].get(), 128});
+
+        // shown, goes in as the most recently used
+        cache.pin({files[3].get(), 128});
+        cache.insert({files[3].get(), 128}, nullptr, 100);
+
+        CHECK(cache.contains({files[0].get(), 128}));
+        CHECK_FALSE(cache.contains({files[1].get(), 128}));
+        CHECK(cache.contains({files[2].get(), 128}));
+        CHECK(cache.contains({files[3].get(), 128}));
+
+        const auto stats = cache.statistics();
+        CHECK_EQ(stats.evictions, 1);
+        CHECK_EQ(stats.bytes, 300);
+        CHECK_EQ(stats.textures, 3);
+    }
+
+    TEST_CASE("prefetched textures do not evict used ones")
+    {
+        const auto files = make_files(4);
+        vfs::texture_cache cache(300);
+
+        cache.insert({files[0].get(), 128}, nullptr, 100);
+        cache.insert({files[1].get(), 128}, nullptr, 100);
+        cache.insert({files[2].get(), 128}, nullptr, 100);
+        (void)cache.get({files[2].get(), 128});
+
+        // not pinned, goes in as the least recently used and is the first out
+        cache.insert({files[3].get(), 128}, nullptr, 100);
+
+        CHECK(cache.contains({files[0].get(), 128}));
+        CHECK(cache.contains({files[1].get(), 128}));
+        CHECK(cache.contains({files[2].get(), 128}));
+        CHECK_FALSE(cache.contains({files[3].get(), 128}));
+        CHECK_EQ(cache.statistics().evictions, 1);
+    }
+
+    TEST_CASE("sizes are separate keys")
+    {
+        const auto files = make_files(1);
+        vfs::texture_cache cache(1000);
+
+        cache.insert({files[0].get(), 128}, nullptr, 100);
+        cache.insert({files[0].get(), 256}, nullptr, 400);
+        CHECK_EQ(cache.statistics().bytes, 500);
+
+        cache.erase({files[0].get(), 256});
+        CHECK(cache.contains({files[0].get(), 128}));
+        CHECK_FALSE(cache.contains({files[0].get(), 256}));
+        CHECK_EQ(cache.statistics().bytes, 100);
+
+        // replacing a texture does not count it twice
+        cache.insert({files[0].get(), 128}, nullptr, 200);
+        CHECK_EQ(cache.statistics().bytes, 200);
+        CHECK_EQ(cache.statistics().textures, 1);
+    }
+
+    TEST_CASE("pinned textures are not evicted")
+    {
+        const auto files = make_files(3);
+        vfs::texture_cache cache(200);
+
+        // pinned before it is loaded, like a list item bound before its thumbnail
+        cache.pin({files[0].get(), 128});
+        CHECK_FALSE(cache.contains({files[0].get(), 128}));
+
+        cache.insert({files[0].get(), 128}, nullptr, 100);
+        cache.insert({files[1].get(), 128}, nullptr, 100);
+
+        // 0 becomes the least recently used
+        (void)cache.get({files[1].get(), 128});
+
+        cache.pin({files[2].get(), 128});
+        cache.insert({files[2].get(), 128}, nullptr, 100);
+
+        CHECK(cache.contains({files[0].get(), 128}));
+        CHECK_FALSE(cache.contains({files[1].get(), 128}));
+        CHECK(cache.contains({files[2].get(), 128}));
+
+        SUBCASE("everything pinned may go over budget")
+        {
+            cache.insert({files[1].get(), 128}, nullptr, 100);
+            CHECK(cache.contains({files[0].get(), 128}));
+            CHECK_FALSE(cache.contains({files[1].get(), 128}));
+            CHECK(cache.contains({files[2].get(), 128}));
+
+            cache.pin({files[1].get(), 128});
+            cache.insert({files[1].get(), 128}, nullptr, 100);
+            CHECK_EQ(cache.statistics().bytes, 300);
+
+            // unpinning brings it back under budget
+            cache.unpin({files[2].get(), 128});
+            CHECK_FALSE(cache.contains({files[2].get(), 128}));
+            CHECK_EQ(cache.statistics().bytes, 200);
+        }
+
+        SUBCASE("erase keeps the pin")
+        {
+            cache.erase({files[0].get(), 128});
+            CHECK_FALSE(cache.contains({files[0].get(), 128}));
+
+            cache.insert({files[0].get(), 128}, nullptr, 100);
+            (void)cache.get({files[2].get(), 128});
+            cache.unpin({files[2].get(), 128});
+
+            cache.pin({files[1].get(), 128});
+            cache.insert({files[1].get(), 128}, nullptr, 100);
+            CHECK(cache.contains({files[0].get(), 128}));
+            CHECK(cache.contains({files[1].get(), 128}));
+            CHECK_FALSE(cache.contains({files[2].get(), 128}));
+        }
+    }
+
+    TEST_CASE("move keeps the eviction order")
+    {
+        const auto files = make_files(4);
+        vfs::texture_cache cache(300);
+
+        cache.pin({files[0].get(), 128});
+        cache.insert({files[0].get(), 128}, nullptr, 100);
+        cache.insert({files[1].get(), 128}, nullptr, 100);
+
+        // files[2] is files[0] renamed, the pin is moved by the view
+        cache.move({files[0].get(), 128}, {files[2].get(), 128});
+        cache.pin({files[2].get(), 128});
+        cache.unpin({files[0].get(), 128});
+
+        CHECK_FALSE(cache.contains({files[0].get(), 128}));
+        CHECK(cache.contains({files[2].get(), 128}));
+        CHECK_EQ(cache.statistics().bytes, 200);
+        CHECK_EQ(cache.statistics().textures, 2);
+
+        // still the most recently used
+        cache.insert({files[3].get(), 128}, nullptr, 100);
+        cache.set_budget(200);
+        CHECK(cache.contains({files[2].get(), 128}));
+        CHECK(cache.contains({files[1].get(), 128}));
+        CHECK_FALSE(cache.contains({files[3].get(), 128}));
+
+        // nothing loaded to move
+        cache.move({files[0].get(), 256}, {files[3].get(), 256});
+        CHECK_FALSE(cache.contains({files[3].get(), 256}));
+    }
+
+    TEST_CASE("set_budget evicts")
+    {
+        const auto files = make_files(4);
+        vfs::texture_cache cache(1000);
+
+        for (const auto& file : files)
+        {
+            cache.insert({file.get(), 128}, nullptr, 100);
+        }
+        CHECK_EQ(cache.statistics().bytes, 400);
+
+        cache.set_budget(150);
+        CHECK_EQ(cache.budget(), 150);
+        CHECK_EQ(cache.statistics().bytes, 100);
+        CHECK_EQ(cache.statistics().evictions, 3);
+        CHECK(cache.contains({files[0].get(), 128}));
+    }
+
+    TEST_CASE("hits and misses")
+    {
+        const auto files = make_files(2);
+        vfs::texture_cache cache(1000);
+
+        cache.insert({files[0].get(), 128}, nullptr, 100);
+
+        (void)cache.get({files[0].get(), 128});
+        (void)cache.get({files[0].get(), 128});
+        (void)cache.get({files[0].get(), 256});
+        (void)cache.get({files[1].get(), 128});
+
+        // contains() is not counted
+        (void)cache.contains({files[0].get(), 128});
+
+        const auto stats = cache.statistics();
+        CHECK_EQ(stats.hits, 2);
+        CHECK_EQ(stats.misses, 2);
+        CHECK_EQ(stats.evictions, 0);
+    }
+}
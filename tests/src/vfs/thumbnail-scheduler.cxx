@@ -0,0 +1,300 @@
+/**
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <format>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <cstdint>
+
+#include <sys/stat.h>
+
+#include <doctest/doctest.h>
+
+#include "vfs/executor.hxx"
+#include "vfs/file.hxx"
+#include "vfs/mime-type.hxx"
+#include "vfs/thumbnail-scheduler.hxx"
+
+#include "vfs/linux/statx.hxx"
+
+static std::shared_ptr<vfs::file>
+make_file(const std::string_view name)
+{
+    struct ::statx stat{};
+    stat.stx_mode = S_IFREG | 0644;
+    stat.stx_mtime.tv_sec = 1000;
+
+    return vfs::file::create(std::format("/tmp/{}", name),
+                             vfs::linux::statx(stat),
+                             vfs::mime_type::create_from_type("image/png"));
+}
+
+static bool
+wait_for(const std::function<bool()>& predicate)
+{
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (!predicate())
+    {
+        if (std::chrono::steady_clock::now() > deadline)
+        {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+/**
+ * Records the order files are loaded in, the first load blocks
+ * until released so the queue can be filled.
+ */
+struct recorder final
+{
+    std::mutex lock;
+    std::vector<std::string> loaded;
+    std::atomic<bool> started{false};
+    std::atomic<bool> released{false};
+
+    vfs::thumbnail_scheduler::loader
+    loader()
+    {
+        return [this](const std::shared_ptr<vfs::file>& file, const std::int32_t)
+        {
+            if (!started.exchange(true))
+            {
+                while (!released)
+                {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                }
+            }
+
+            std::scoped_lock guard(lock);
+            loaded.emplace_back(file->name());
+        };
+    }
+
+    std::size_t
+    count()
+    {
+        std::scoped_lock guard(lock);
+        return loaded.size();
+    }
+};
+
+TEST_SUITE("vfs::thumbnail_scheduler" * doctest::description(""))
+{
+    TEST_CASE("closest to the visible range first")
+    {
+        vfs::executor executor(2);
+        recorder record;
+        vfs::thumbnail_scheduler scheduler(1, record.loader(), executor);
+
+        std::atomic<std::size_t> created{0};
+        const auto owner = scheduler.add_owner([&created](const auto&) { created += 1; });
+
+        std::vector<std::shared_ptr<vfs::file>> files;
+        for (std::uint32_t i = 0; i < 10; ++i)
+        {
+            files.push_back(make_file(std::format("{}.png", i)));
+        }
+
+        scheduler.request(owner, files[0], 128, 0);
+        REQUIRE(wait_for([&record] { return record.started.load(); }));
+
+        for (std::uint32_t i = 1; i < 10; ++i)
+        {
+            scheduler.request(owner, files[i], 128, i);
+        }
+        CHECK_EQ(scheduler.pending(), 9);
+
+        scheduler.set_visible_range(owner, 6, 7);
+        record.released = true;
+
+        REQUIRE(wait_for([&created] { return created == 10; }));
+        CHECK_EQ(record.loaded,
+                 std::vector<std::string>{"0.png",
+                                          "6.png",
+                                          "7.png",
+                                          "5.png",
+                                          "8.png",
+                                          "4.png",
+                                          "9.png",
+                                          "3.png",
+                                          "2.png",
+                                          "1.png"});
+
+        scheduler.remove_owner(owner);
+    }
+
+    TEST_CASE("duplicate requests are loaded once")
+    {
+        vfs::executor executor(2);
+        recorder record;
+        vfs::thumbnail_scheduler scheduler(1, record.loader(), executor);
+
+        std::atomic<std::size_t> a_created{0};
+        std::atomic<std::size_t> b_created{0};
+        const auto a = scheduler.add_owner([&a_created](const auto&) { a_created += 1; });
+        const auto b = scheduler.add_owner([&b_created](const auto&) { b_created += 1; });
+
+        const auto blocker = make_file("blocker.png");
+        const auto file = make_file("file.png");
+
+        scheduler.request(a, blocker, 128, 0);
+        REQUIRE(wait_for([&record] { return record.started.load(); }));
+
+        scheduler.request(a, file, 128, 1);
+        scheduler.request(a, file, 128, 2);
+        scheduler.request(b, file, 128, 0);
+        CHECK_EQ(scheduler.pending(), 1);
+
+        record.released = true;
+
+        REQUIRE(wait_for([&a_created, &b_created] { return a_created == 2 && b_created == 1; }));
+        CHECK_EQ(record.loaded, std::vector<std::string>{"blocker.png", "file.png"});
+
+        scheduler.remove_owner(a);
+        scheduler.remove_owner(b);
+    }
+
+    TEST_CASE("cancel")
+    {
+        vfs::executor executor(2);
+        recorder record;
+        vfs::thumbnail_scheduler scheduler(1, record.loader(), executor);
+
+        std::atomic<std::size_t> a_created{0};
+        std::atomic<std::size_t> b_created{0};
+        const auto a = scheduler.add_owner([&a_created](const auto&) { a_created += 1; });
+        const auto b = scheduler.add_owner([&b_created](const auto&) { b_created += 1; });
+
+        const auto blocker = make_file("blocker.png");
+        const auto shared = make_file("shared.png");
+        const auto one = make_file("one.png");
+        const auto two = make_file("two.png");
+
+        scheduler.request(a, blocker, 128, 0);
+        REQUIRE(wait_for([&record] { return record.started.load(); }));
+
+        scheduler.request(a, shared, 128, 1);
+        scheduler.request(b, shared, 128, 1);
+        scheduler.request(a, one, 128, 2);
+        scheduler.request(a, two, 128, 3);
+        CHECK_EQ(scheduler.pending(), 3);
+
+        SUBCASE("an item left the viewport")
+        {
+            scheduler.cancel(a, one);
+            CHECK_EQ(scheduler.pending(), 2);
+
+            // still wanted by b
+            scheduler.cancel(a, shared);
+            CHECK_EQ(scheduler.pending(), 2);
+
+            record.released = true;
+            REQUIRE(wait_for([&a_created, &b_created] { return a_created == 2 && b_created == 1; }));
+            CHECK_EQ(record.loaded,
+                     std::vector<std::string>{"blocker.png", "shared.png", "two.png"});
+        }
+
+        SUBCASE("the tab was closed")
+        {
+            scheduler.cancel(a);
+            CHECK_EQ(scheduler.pending(), 1);
+
+            record.released = true;
+            REQUIRE(wait_for([&b_created] { return b_created == 1; }));
+            CHECK_EQ(record.loaded, std::vector<std::string>{"blocker.png", "shared.png"});
+        }
+
+        scheduler.remove_owner(a);
+        scheduler.remove_owner(b);
+    }
+
+    TEST_CASE("only the prefetch range is queued")
+    {
+        vfs::executor executor(2);
+        recorder record;
+        vfs::thumbnail_scheduler scheduler(1, record.loader(), executor);
+
+        std::atomic<std::size_t> created{0};
+        const auto owner = scheduler.add_owner([&created](const auto&) { created += 1; });
+
+        constexpr auto distance = vfs::thumbnail_scheduler::PREFETCH_DISTANCE;
+
+        const auto blocker = make_file("blocker.png");
+        const auto near = make_file("near.png");
+        const auto far = make_file("far.png");
+
+        scheduler.request(owner, blocker, 128, 0);
+        REQUIRE(wait_for([&record] { return record.started.load(); }));
+
+        // visible range is 0..0 until it is set
+        scheduler.request(owner, near, 128, distance);
+        scheduler.request(owner, far, 128, distance + 1);
+        CHECK_EQ(scheduler.pending(), 1);
+
+        // scrolled so near is out of range and far is in range
+        scheduler.set_visible_range(owner, (distance * 2) + 1, (distance * 2) + 10);
+        CHECK_EQ(scheduler.pending(), 0);
+
+        scheduler.request(owner, far, 128, distance + 1);
+        CHECK_EQ(scheduler.pending(), 1);
+
+        // a queued request that moved out of range is dropped
+        scheduler.request(owner, far, 128, 0);
+        CHECK_EQ(scheduler.pending(), 0);
+
+        record.released = true;
+        REQUIRE(wait_for([&created] { return created == 1; }));
+        CHECK_EQ(record.loaded, std::vector<std::string>{"blocker.png"});
+
+        scheduler.remove_owner(owner);
+    }
+
+    TEST_CASE("remove_owner")
+    {
+        vfs::executor executor(2);
+        recorder record;
+        vfs::thumbnail_scheduler scheduler(1, record.loader(), executor);
+
+        std::atomic<std::size_t> created{0};
+        const auto owner = scheduler.add_owner([&created](const auto&) { created += 1; });
+
+        scheduler.request(owner, make_file("blocker.png"), 128, 0);
+        REQUIRE(wait_for([&record] { return record.started.load(); }));
+        scheduler.request(owner, make_file("file.png"), 128, 1);
+
+        scheduler.remove_owner(owner);
+        CHECK_EQ(scheduler.pending(), 0);
+
+        // requests for a removed owner are ignored
+        scheduler.request(owner, make_file("late.png"), 128, 0);
+        CHECK_EQ(scheduler.pending(), 0);
+
+        record.released = true;
+        REQUIRE(wait_for([&record] { return record.count() == 1; }));
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        CHECK_EQ(created, 0);
+    }
+}
@@ -0,0 +1,148 @@
+/**
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <array>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <cstdint>
+
+#include <doctest/doctest.h>
+
+#include "vfs/thumbnails/png.hxx"
+
+TEST_SUITE("vfs::detail::thumbnail" * doctest::description(""))
+{
+    using namespace vfs::detail::thumbnail;
+
+    // signature, 1x1 IHDR and IEND, the CRCs are not checked
+    const std::string png = std::string("\x89PNG\r\n\x1a\n", 8) +
+                            std::string("\0\0\0\x0dIHDR\0\0\0\x01\0\0\0\x01\x08\x06\0\0\0\0\0\0\0", 25) +
+                            std::string("\0\0\0\0IEND\xae\x42\x60\x82", 12);
+
+    TEST_CASE("add_text")
+    {
+        const auto text = std::array{
+            text_chunk{"Thumb::URI", "file:///tmp/a.png"},
+            text_chunk{"Thumb::MTime", "1700000000"},
+        };
+
+        const auto result = add_text(png, text);
+        REQUIRE_FALSE(result.empty());
+
+        // the header is unchanged and the chunks go after IHDR
+        CHECK(result.starts_with(png.substr(0, 33)));
+        CHECK_EQ(result.substr(37, 4), "tEXt");
+        CHECK(result.ends_with(png.substr(33)));
+
+        // length, type, key, separator, value and crc for each chunk
+        const auto first_length = 10 + 1 + 17;
+        CHECK_EQ(result.size(), png.size() + (12 + first_length) + (12 + 12 + 1 + 10));
+
+        CHECK_EQ(get_text(result, "Thumb::URI"), "file:///tmp/a.png");
+        CHECK_EQ(get_text(result, "Thumb::MTime"), "1700000000");
+        CHECK_FALSE(get_text(result, "Thumb::Size").has_value());
+        CHECK_FALSE(get_text(png, "Thumb::URI").has_value());
+    }
+
+    TEST_CASE("add_text not a png")
+    {
+        const auto text = std::array{text_chunk{"Thumb::URI", "file:///tmp/a.png"}};
+        CHECK(add_text("not a png", text).empty());
+        CHECK_FALSE(get_text("not a png", "Thumb::URI").has_value());
+    }
+
+    TEST_CASE("set_text")
+    {
+        const auto text = std::array{
+            text_chunk{"Thumb::URI", "file:///tmp/a.png"},
+            text_chunk{"Thumb::MTime", "1700000000"},
+        };
+        const auto original = add_text(png, text);
+
+        const auto renamed = std::array{text_chunk{"Thumb::URI", "file:///tmp/b.png"}};
+        const auto result = set_text(original, renamed);
+        REQUIRE_FALSE(result.empty());
+
+        CHECK_EQ(result.size(), original.size());
+        CHECK_EQ(get_text(result, "Thumb::URI"), "file:///tmp/b.png");
+        CHECK_EQ(get_text(result, "Thumb::MTime"), "1700000000");
+        CHECK(result.ends_with(png.substr(33)));
+
+        CHECK(set_text("not a png", renamed).empty());
+    }
+
+    TEST_CASE("get_text truncated")
+    {
+        const auto text = std::array{text_chunk{"Thumb::URI", "file:///tmp/a.png"}};
+        const auto result = add_text(png, text);
+        CHECK_FALSE(get_text(std::string_view(result).substr(0, 45), "Thumb::URI").has_value());
+    }
+
+    TEST_CASE("downscale")
+    {
+        // 4x2, left half 0, right half 200
+        std::vector<std::uint8_t> src;
+        for (std::int32_t y = 0; y < 2; ++y)
+        {
+            for (std::int32_t x = 0; x < 4; ++x)
+            {
+                const std::uint8_t v = x < 2 ? 0 : 200;
+                src.insert(src.end(), {v, v, v, 255});
+            }
+        }
+
+        SUBCASE("longest side is size")
+        {
+            const auto dst = downscale(src, 4, 2, 16, 2);
+            CHECK_EQ(dst.width, 2);
+            CHECK_EQ(dst.height, 1);
+            REQUIRE_EQ(dst.data.size(), 8);
+            CHECK_EQ(dst.data[0], 0);
+            CHECK_EQ(dst.data[3], 255);
+            CHECK_EQ(dst.data[4], 200);
+            CHECK_EQ(dst.data[7], 255);
+        }
+
+        SUBCASE("never upscales")
+        {
+            const auto dst = downscale(src, 4, 2, 16, 128);
+            CHECK_EQ(dst.width, 4);
+            CHECK_EQ(dst.height, 2);
+            CHECK_EQ(dst.data, src);
+        }
+
+        SUBCASE("stride")
+        {
+            std::vector<std::uint8_t> padded;
+            for (std::size_t y = 0; y < 2; ++y)
+            {
+                padded.insert(padded.end(), src.begin() + (y * 16), src.begin() + ((y + 1) * 16));
+                padded.insert(padded.end(), 8, 0xff);
+            }
+            const auto dst = downscale(padded, 4, 2, 24, 1);
+            CHECK_EQ(dst.width, 1);
+            CHECK_EQ(dst.height, 1);
+            REQUIRE_EQ(dst.data.size(), 4);
+            CHECK_EQ(dst.data[0], 100);
+        }
+
+        SUBCASE("too small")
+        {
+            CHECK(downscale(src, 4, 4, 16, 2).data.empty());
+        }
+    }
+}
@@ -0,0 +1,72 @@
+/**
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <doctest/doctest.h>
+
+#include <grp.h>
+#include <pwd.h>
+#include <unistd.h>
+
+#include "vfs/utils/id-cache.hxx"
+
+TEST_SUITE("utils::id_cache" * doctest::description(""))
+{
+    TEST_CASE("user")
+    {
+        const auto uid = getuid();
+        const auto* pw = getpwuid(uid);
+        REQUIRE(pw != nullptr);
+
+        const auto name = vfs::utils::user_name(uid);
+        REQUIRE(name.has_value());
+        CHECK_EQ(*name, pw->pw_name);
+        // cached
+        CHECK_EQ(vfs::utils::user_name(uid), name);
+
+        const auto id = vfs::utils::user_id(*name);
+        REQUIRE(id.has_value());
+        CHECK_EQ(*id, uid);
+    }
+
+    TEST_CASE("group")
+    {
+        const auto gid = getgid();
+        const auto* gr = getgrgid(gid);
+        REQUIRE(gr != nullptr);
+
+        const auto name = vfs::utils::group_name(gid);
+        REQUIRE(name.has_value());
+        CHECK_EQ(*name, gr->gr_name);
+
+        const auto id = vfs::utils::group_id(*name);
+        REQUIRE(id.has_value());
+        CHECK_EQ(*id, gid);
+    }
+
+    TEST_CASE("missing")
+    {
+        CHECK_FALSE(vfs::utils::user_id("spacefm-no-such-user").has_value());
+        // negative cached
+        CHECK_FALSE(vfs::utils::user_id("spacefm-no-such-user").has_value());
+        CHECK_FALSE(vfs::utils::group_id("spacefm-no-such-group").has_value());
+    }
+
+    TEST_CASE("flush")
+    {
+        const auto name = vfs::utils::user_name(getuid());
+        vfs::utils::flush_id_cache();
+        CHECK_EQ(vfs::utils::user_name(getuid()), name);
+    }
+}
@@ -0,0 +1,153 @@
+/**
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <print>
+#include <ranges>
+#include <string>
+#include <vector>
+
+#include <cstdint>
+#include <cstdlib>
+
+#include <CLI/CLI.hpp>
+
+#include <ztd/ztd.hxx>
+
+#include "vfs/file.hxx"
+
+#include "vfs/linux/dir-scanner.hxx"
+#include "vfs/linux/statx.hxx"
+
+#include "logger.hxx"
+
+static void
+benchmark(const std::string_view name, const std::uint32_t runs,
+          const std::function<std::size_t()>& func) noexcept
+{
+    std::size_t count = 0;
+    std::chrono::nanoseconds total{0};
+    std::chrono::nanoseconds best = std::chrono::nanoseconds::max();
+
+    for ([[maybe_unused]] const auto _ : std::views::iota(0u, runs))
+    {
+        const auto start = std::chrono::steady_clock::now();
+        count = func();
+        const auto elapsed = std::chrono::steady_clock::now() - start;
+
+        total += elapsed;
+        best = std::min(best, std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed));
+    }
+
+    const auto average = total / runs;
+    std::println("{:<32} {:>8} entries  avg {:>10.3f} ms  best {:>10.3f} ms",
+                 name,
+                 count,
+                 std::chrono::duration<double, std::milli>(average).count(),
+                 std::chrono::duration<double, std::milli>(best).count());
+}
+
+int
+main(std::int32_t argc, char** argv)
+{
+    CLI::App app{"Benchmark directory loading"};
+
+    std::filesystem::path path;
+    app.add_option("path", path, "Directory to load")->required()->check(CLI::ExistingDirectory);
+
+    std::uint32_t runs = 0;
+    app.add_option("-r,--runs", runs, "Number of runs")
+        ->default_val(10)
+        ->check(CLI::PositiveNumber);
+
+    CLI11_PARSE(app, argc, argv);
+
+    logger::initialize();
+
+    benchmark("directory_iterator + statx",
+              runs,
+              [&path]()
+              {
+                  std::size_t count = 0;
+                  for (const auto& dfile : std::filesystem::directory_iterator(path))
+                  {
+                      const auto stat =
+                          vfs::linux::statx::create(dfile.path(),
+                                                    vfs::linux::statx::symlink::no_follow);
+                      if (stat)
+                      {
+                          count += 1;
+                      }
+                  }
+                  return count;
+              });
+
+    benchmark("getdents64 + statx(dirfd)",
+              runs,
+              [&path]()
+              {
+                  auto scanner = vfs::linux::dir_scanner::create(path);
+                  if (!scanner)
+                  {
+                      return 0uz;
+                  }
+
+                  std::vector<vfs::linux::dir_scanner::entry> entries;
+                  while (scanner->next(entries) != 0)
+                  {
+                  }
+                  return entries.size();
+              });
+
+    benchmark("directory_iterator + vfs::file",
+              runs,
+              [&path]()
+              {
+                  std::vector<std::shared_ptr<vfs::file>> files;
+                  for (const auto& dfile : std::filesystem::directory_iterator(path))
+                  {
+                      files.push_back(vfs::file::create(dfile.path()));
+                  }
+                  return files.size();
+              });
+
+    benchmark("getdents64 + vfs::file",
+              runs,
+              [&path]()
+              {
+                  auto scanner = vfs::linux::dir_scanner::create(path);
+                  if (!scanner)
+                  {
+                      return 0uz;
+                  }
+
+                  std::vector<std::shared_ptr<vfs::file>> files;
+                  std::vector<vfs::linux::dir_scanner::entry> entries;
+                  while (scanner->next(entries) != 0)
+                  {
+                      for (const auto& entry : entries)
+                      {
+                          files.push_back(vfs::file::create(path / entry.name, entry.stat));
+                      }
+                      entries.clear();
+                  }
+                  return files.size();
+              });
+
+    return EXIT_SUCCESS;
+}
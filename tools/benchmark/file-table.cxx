@@ -0,0 +1,233 @@
+/**
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <print>
+#include <ranges>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <cstdint>
+#include <cstdlib>
+
+#include <malloc.h>
+
+#include <CLI/CLI.hpp>
+
+#include <ztd/ztd.hxx>
+
+#include "vfs/file-table.hxx"
+#include "vfs/file.hxx"
+
+#include "vfs/linux/dir-scanner.hxx"
+#include "vfs/linux/statx.hxx"
+
+#include "logger.hxx"
+
+static void
+benchmark(const std::string_view name, const std::uint32_t runs,
+          const std::function<std::size_t()>& func) noexcept
+{
+    std::size_t count = 0;
+    std::chrono::nanoseconds total{0};
+    std::chrono::nanoseconds best = std::chrono::nanoseconds::max();
+
+    for ([[maybe_unused]] const auto _ : std::views::iota(0u, runs))
+    {
+        const auto start = std::chrono::steady_clock::now();
+        count = func();
+        const auto elapsed = std::chrono::steady_clock::now() - start;
+
+        total += elapsed;
+        best = std::min(best, std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed));
+    }
+
+    const auto average = total / runs;
+    std::println("{:<32} {:>8} entries  avg {:>10.3f} ms  best {:>10.3f} ms",
+                 name,
+                 count,
+                 std::chrono::duration<double, std::milli>(average).count(),
+                 std::chrono::duration<double, std::milli>(best).count());
+}
+
+static void
+memory(const std::string_view name, const std::size_t count, const std::size_t bytes) noexcept
+{
+    std::println("{:<32} {:>8} entries  {:>10.3f} MiB  {:>6} bytes/entry",
+                 name,
+                 count,
+                 static_cast<double>(bytes) / (1024.0 * 1024.0),
+                 count == 0 ? 0 : bytes / count);
+}
+
+[[nodiscard]] static std::size_t
+heap_used() noexcept
+{
+    return mallinfo2().uordblks;
+}
+
+[[nodiscard]] static std::vector<vfs::linux::dir_scanner::entry>
+scan(const std::filesystem::path& path) noexcept
+{
+    std::vector<vfs::linux::dir_scanner::entry> entries;
+
+    auto scanner = vfs::linux::dir_scanner::create(path);
+    if (scanner)
+    {
+        while (scanner->next(entries) != 0)
+        {
+        }
+    }
+    return entries;
+}
+
+// the layout vfs::dir used before vfs::file_table
+struct file_vector final
+{
+    std::vector<std::shared_ptr<vfs::file>> files;
+    std::unordered_map<std::string, std::size_t> index;
+
+    void
+    insert(const std::shared_ptr<vfs::file>& file) noexcept
+    {
+        index.insert_or_assign(std::string(file->name()), files.size());
+        files.push_back(file);
+    }
+};
+
+int
+main(std::int32_t argc, char** argv)
+{
+    CLI::App app{"Benchmark the vfs::dir file table against a vector of vfs::file"};
+
+    std::filesystem::path path;
+    app.add_option("path", path, "Directory to load")->required()->check(CLI::ExistingDirectory);
+
+    std::uint32_t runs = 0;
+    app.add_option("-r,--runs", runs, "Number of runs")
+        ->default_val(10)
+        ->check(CLI::PositiveNumber);
+
+    CLI11_PARSE(app, argc, argv);
+
+    logger::initialize();
+
+    const auto entries = scan(path);
+
+    std::println("sizeof(vfs::file) {} bytes, sizeof(vfs::linux::statx) {} bytes",
+                 sizeof(vfs::file),
+                 sizeof(vfs::linux::statx));
+    std::println();
+
+    // memory, both hold the same vfs::file
+
+    {
+        const auto before = heap_used();
+        file_vector files;
+        for (const auto& entry : entries)
+        {
+            files.insert(vfs::file::create(path / entry.name, entry.stat));
+        }
+        memory("vector<shared_ptr<vfs::file>>", files.files.size(), heap_used() - before);
+    }
+
+    {
+        const auto before = heap_used();
+        vfs::file_table files;
+        for (const auto& entry : entries)
+        {
+            files.insert(vfs::file::create(path / entry.name, entry.stat));
+        }
+        memory("vfs::file_table", files.size(), heap_used() - before);
+    }
+
+    std::println();
+
+    // load
+
+    benchmark("load vector<shared_ptr<vfs::file>>",
+              runs,
+              [&path, &entries]()
+              {
+                  file_vector files;
+                  for (const auto& entry : entries)
+                  {
+                      files.insert(vfs::file::create(path / entry.name, entry.stat));
+                  }
+                  return files.files.size();
+              });
+
+    benchmark("load vfs::file_table",
+              runs,
+              [&path, &entries]()
+              {
+                  vfs::file_table files;
+                  for (const auto& entry : entries)
+                  {
+                      files.insert(vfs::file::create(path / entry.name, entry.stat));
+                  }
+                  return files.size();
+              });
+
+    // refresh diff, every entry is looked up by name and compared
+
+    file_vector vector_files;
+    vfs::file_table table_files;
+    for (const auto& entry : entries)
+    {
+        const auto file = vfs::file::create(path / entry.name, entry.stat);
+        vector_files.insert(file);
+        table_files.insert(file);
+    }
+
+    benchmark("diff vector<shared_ptr<vfs::file>>",
+              runs,
+              [&entries, &vector_files]()
+              {
+                  std::size_t changed = 0;
+                  for (const auto& entry : entries)
+                  {
+                      const auto it = vector_files.index.find(entry.name);
+                      if (it == vector_files.index.cend())
+                      {
+                          continue;
+                      }
+                      const auto& file = vector_files.files[it->second];
+                      if (file->mtime() != entry.stat.mtime() ||
+                          file->ctime() != entry.stat.ctime() || file->size() != entry.stat.size())
+                      {
+                          changed += 1;
+                      }
+                  }
+                  return entries.size() - changed;
+              });
+
+    benchmark("diff vfs::file_table",
+              runs,
+              [&entries, &table_files]()
+              {
+                  vfs::file_table::diff diff;
+                  table_files.diff_entries(diff, entries);
+                  table_files.diff_finish(diff);
+                  return entries.size() - diff.changed.size();
+              });
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,176 @@
+/**
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <print>
+#include <ranges>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <cstdint>
+#include <cstdlib>
+
+#include <malloc.h>
+
+#include <CLI/CLI.hpp>
+
+#include "vfs/mime-type.hxx"
+
+#include "vfs/linux/dir-scanner.hxx"
+
+#include "vfs/mime-type/chrome/mime-utils.hxx"
+#include "vfs/mime-type/mime-cache.hxx"
+
+#include "logger.hxx"
+
+static void
+benchmark(const std::string_view name, const std::uint32_t runs,
+          const std::function<std::size_t()>& func) noexcept
+{
+    std::size_t count = 0;
+    std::chrono::nanoseconds total{0};
+    std::chrono::nanoseconds best = std::chrono::nanoseconds::max();
+
+    for ([[maybe_unused]] const auto _ : std::views::iota(0u, runs))
+    {
+        const auto start = std::chrono::steady_clock::now();
+        count = func();
+        const auto elapsed = std::chrono::steady_clock::now() - start;
+
+        total += elapsed;
+        best = std::min(best, std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed));
+    }
+
+    const auto average = total / runs;
+    std::println("{:<32} {:>8} matched  avg {:>10.3f} ms  best {:>10.3f} ms",
+                 name,
+                 count,
+                 std::chrono::duration<double, std::milli>(average).count(),
+                 std::chrono::duration<double, std::milli>(best).count());
+}
+
+[[nodiscard]] static std::size_t
+heap_used() noexcept
+{
+    return mallinfo2().uordblks;
+}
+
+[[nodiscard]] static std::vector<std::string>
+scan(const std::filesystem::path& path) noexcept
+{
+    std::vector<vfs::linux::dir_scanner::entry> entries;
+
+    auto scanner = vfs::linux::dir_scanner::create(path);
+    if (scanner)
+    {
+        while (scanner->next(entries) != 0)
+        {
+        }
+    }
+
+    return entries | std::views::transform([](const auto& entry) { return entry.name; }) |
+           std::ranges::to<std::vector>();
+}
+
+int
+main(std::int32_t argc, char** argv)
+{
+    CLI::App app{"Benchmark the mmap mime.cache lookup against the chrome mime type map"};
+
+    std::filesystem::path path;
+    app.add_option("path", path, "Directory with the filenames to look up")
+        ->required()
+        ->check(CLI::ExistingDirectory);
+
+    std::uint32_t runs = 0;
+    app.add_option("-r,--runs", runs, "Number of runs")
+        ->default_val(10)
+        ->check(CLI::PositiveNumber);
+
+    CLI11_PARSE(app, argc, argv);
+
+    logger::initialize();
+
+    const auto names = scan(path);
+
+    // the first call of each loads the mime.cache files
+    {
+        auto before = heap_used();
+        (void)vfs::detail::mime_type::chrome::GetFileMimeType("file.txt");
+        std::println("chrome map loaded      {:>10} bytes", heap_used() - before);
+
+        before = heap_used();
+        (void)vfs::detail::mime_type::mime_database::global()->lookup("file.txt");
+        std::println("mime_database loaded   {:>10} bytes", heap_used() - before);
+    }
+
+    std::println("{} filenames", names.size());
+    std::println();
+
+    benchmark("chrome::GetFileMimeType",
+              runs,
+              [&names]()
+              {
+                  std::size_t matched = 0;
+                  for (const auto& name : names)
+                  {
+                      const auto type = vfs::detail::mime_type::chrome::GetFileMimeType(name);
+                      if (type != vfs::constants::mime_type::unknown)
+                      {
+                          matched += 1;
+                      }
+                  }
+                  return matched;
+              });
+
+    benchmark("mime_database::lookup",
+              runs,
+              [&names]()
+              {
+                  const auto database = vfs::detail::mime_type::mime_database::global();
+
+                  std::size_t matched = 0;
+                  for (const auto& name : names)
+                  {
+                      if (!database->lookup(name).empty())
+                      {
+                          matched += 1;
+                      }
+                  }
+                  return matched;
+              });
+
+    // both have to agree, the chrome map ignores the literal and glob sections
+    std::size_t differ = 0;
+    const auto database = vfs::detail::mime_type::mime_database::global();
+    for (const auto& name : names)
+    {
+        const auto chrome = vfs::detail::mime_type::chrome::GetFileMimeType(name);
+        const auto type = database->lookup(name);
+        if (chrome != vfs::constants::mime_type::unknown && chrome != type)
+        {
+            differ += 1;
+            std::println("differ {:<40} chrome {:<32} mime_database {}", name, chrome, type);
+        }
+    }
+    std::println();
+    std::println("{} suffix lookups differ", differ);
+
+    return EXIT_SUCCESS;
+}
@@ -13,6 +13,8 @@
  * along with this program. If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <filesystem>
 #include <format>
@@ -30,20 +32,41 @@
 
 #include "logger.hxx"
 
+namespace global
+{
+static std::atomic<std::uint64_t> operations{0};
+}
+
+struct options final
+{
+    std::uint32_t file_count;
+    std::uint32_t max_sleep; // ms, 0 runs at full speed
+    bool churn;
+};
+
 void
-worker(std::stop_token stoken, std::uint32_t thread_id, std::uint32_t file_count) noexcept
+worker(std::stop_token stoken, std::uint32_t thread_id, const options& opts) noexcept
 {
     using namespace std::chrono_literals;
 
     static thread_local std::mt19937 rng(std::random_device{}());
-    // std::uniform_int_distribution<std::chrono::milliseconds::rep> dist(100, 1000);
-    std::uniform_int_distribution<std::chrono::milliseconds::rep> dist(1, 50);
+    std::uniform_int_distribution<std::chrono::milliseconds::rep> dist(
+        1,
+        std::max(opts.max_sleep, 1u));
 
-    auto sleep = [&]() { std::this_thread::sleep_for(std::chrono::milliseconds(dist(rng))); };
+    // count the operation and sleep before the next one
+    auto sleep = [&]()
+    {
+        global::operations.fetch_add(1, std::memory_order_relaxed);
+        if (opts.max_sleep != 0)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(dist(rng)));
+        }
+    };
 
     std::vector<std::filesystem::path> filenames;
-    filenames.reserve(file_count);
-    for (const auto i : std::views::iota(0u, file_count))
+    filenames.reserve(opts.file_count);
+    for (const auto i : std::views::iota(0u, opts.file_count))
     {
         filenames.emplace_back(std::format("stress_{}-{}.txt", thread_id, i));
     }
@@ -52,6 +75,39 @@ worker(std::stop_token stoken, std::uint32_t thread_id, std::uint32_t file_count
     {
         try
         {
+            if (opts.churn)
+            {
+                // build tool style, a temp file is created, written, then either
+                // deleted or renamed over its target, every event is short lived
+                for (const auto& filename : filenames)
+                {
+                    if (stoken.stop_requested())
+                    {
+                        break;
+                    }
+
+                    auto temp = filename;
+                    temp += ".tmp";
+
+                    std::ofstream ofs(temp);
+                    sleep();
+                    ofs << "data data data";
+                    ofs.close();
+                    sleep();
+
+                    if (rng() % 2 == 0)
+                    {
+                        std::filesystem::rename(temp, filename);
+                    }
+                    else
+                    {
+                        std::filesystem::remove(temp);
+                    }
+                    sleep();
+                }
+                continue;
+            }
+
             // create events
             for (const auto& filename : filenames)
             {
@@ -109,6 +165,9 @@ worker(std::stop_token stoken, std::uint32_t thread_id, std::uint32_t file_count
     for (const auto& filename : filenames)
     {
         std::filesystem::remove(filename);
+        auto temp = filename;
+        temp += ".tmp";
+        std::filesystem::remove(temp);
     }
 }
 
@@ -123,22 +182,37 @@ main(std::int32_t argc, char** argv)
     std::uint32_t minutes = 0;
     app.add_option("-m,--minutes", minutes, "Runtime in minutes")->default_val(1);
 
-    std::uint32_t file_count = 0;
-    app.add_option("-f,--files", file_count, "File count")->default_val(20);
+    options opts{};
+    app.add_option("-f,--files", opts.file_count, "File count")->default_val(20);
+
+    app.add_option("-s,--sleep", opts.max_sleep, "Max sleep between operations in ms, 0 for none")
+        ->default_val(50);
+
+    app.add_flag("-c,--churn",
+                 opts.churn,
+                 "Create, write and delete or rename temp files, without logging each operation");
+
+    std::filesystem::path directory = std::filesystem::current_path();
+    app.add_option("-d,--directory", directory, "Directory to create files in")
+        ->check(CLI::ExistingDirectory);
 
     CLI11_PARSE(app, argc, argv);
 
     logger::initialize();
 
+    std::filesystem::current_path(directory);
+
+    const auto start = std::chrono::steady_clock::now();
+
     std::vector<std::jthread> workers;
     workers.reserve(thread_count);
     for (const auto i : std::views::iota(0u, thread_count))
     {
         workers.emplace_back(std::jthread(
-            [i, file_count](const std::stop_token& stoken)
+            [i, &opts](const std::stop_token& stoken)
             {
                 //
-                worker(stoken, i, file_count);
+                worker(stoken, i, opts);
             }));
     }
 
@@ -148,6 +222,13 @@ main(std::int32_t argc, char** argv)
     {
         t.request_stop();
     }
+    workers.clear();
+
+    const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start);
+    const auto operations = global::operations.load();
+    logger::info("{} operations, {:.0f} per second",
+                 operations,
+                 static_cast<double>(operations) / elapsed.count());
 
     return EXIT_SUCCESS;
 }